@@ -119,7 +119,7 @@ C4Database* c4db_openNamed(C4String name,
     FilePath path = dbPath(name, config->parentDirectory);
     C4DatabaseConfig oldConfig = newToOldConfig(config);
     return tryCatch<C4Database*>(outError, [=] {
-        return retain(new C4Database(path, oldConfig));
+        return retain(new C4Database(path, oldConfig, config));
     });
 }
 
@@ -199,6 +199,20 @@ bool c4db_maintenance(C4Database* database, C4MaintenanceType type, C4Error *out
 }
 
 
+bool c4db_getCacheStats(C4Database* database, bool reset, C4DatabaseCacheStats *outStats,
+                        C4Error *outError) C4API
+{
+    return tryCatch(outError, [&] {
+        auto dataFile = (SQLiteDataFile*)database->dataFile();
+        auto stats = dataFile->cacheStats(reset);
+        auto &tuning = dataFile->tuning();
+        *outStats = {stats.hits, stats.misses, stats.memoryUsed,
+                     tuning.cacheSize, tuning.mmapSize, tuning.journalSizeLimit,
+                     tuning.pageSize, stats.queryHits, stats.queryMisses};
+    });
+}
+
+
 bool c4db_rekey(C4Database* database, const C4EncryptionKey *newKey, C4Error *outError) noexcept {
     return tryCatch(outError, bind(&Database::rekey, database, newKey));
 }
@@ -283,7 +297,29 @@ bool c4db_endTransaction(C4Database* database,
                          bool commit,
                          C4Error *outError) noexcept
 {
-    return tryCatch(outError, bind(&Database::endTransaction, database, commit));
+    return tryCatch(outError, [&] {
+        database->endTransaction(commit);
+    });
+}
+
+
+bool c4db_endTransactionWithCallback(C4Database* database,
+                                     bool commit,
+                                     C4TransactionDurableCallback callback,
+                                     void *context,
+                                     C4Error *outError) noexcept
+{
+    return tryCatch(outError, [&] {
+        Database::DurableCallback durable;
+        if (callback)
+            durable = [=](bool ok) {callback(context, ok);};
+        database->endTransaction(commit, move(durable));
+    });
+}
+
+
+bool c4db_commitPendingTransactions(C4Database* database, C4Error *outError) noexcept {
+    return tryCatch(outError, bind(&Database::commitPendingTransactions, database));
 }
 
 
@@ -23,8 +23,9 @@
 
 // This is the struct that's forward-declared in the public c4Database.h
 struct c4Database : public c4Internal::Database {
-    c4Database(const FilePath &path, C4DatabaseConfig config)
-    :Database(path, config) { }
+    c4Database(const FilePath &path, C4DatabaseConfig config,
+               const C4DatabaseConfig2 *config2 =nullptr)
+    :Database(path, config, config2) { }
 
     C4ExtraInfo extraInfo { };
 
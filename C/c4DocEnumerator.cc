@@ -26,6 +26,9 @@
 #include "RecordEnumerator.hh"
 #include "Logging.hh"
 #include "InstanceCounted.hh"
+#include <vector>
+
+using namespace std;
 
 
 #pragma mark - DOC ENUMERATION:
@@ -143,3 +146,75 @@ C4Document* c4enum_getDocument(C4DocEnumerator *e, C4Error *outError) noexcept {
     });
 }
 
+
+
+#pragma mark - CHANGES SCAN:
+
+
+// Transfers ownership of a string to a C4HeapString; c4db_releaseChangeInfo frees it.
+static C4HeapString heapString(alloc_slice str) {
+    C4SliceResult result(move(str));
+    return {result.buf, result.size};
+}
+
+
+int64_t c4db_getChanges(C4Database *database,
+                        C4SequenceNumber since,
+                        C4EnumeratorFlags flags,
+                        C4RemoteID remoteDBID,
+                        C4ChangeInfo outChanges[],
+                        uint32_t maxChanges,
+                        C4Error *outError) noexcept
+{
+    memset(outChanges, 0, maxChanges * sizeof(C4ChangeInfo));
+    try {
+        RecordEnumerator::Options options;
+        options.includeDeleted = (flags & kC4IncludeDeleted) != 0;
+        // The rev tree (body) is only needed to look up remote ancestors:
+        if (!remoteDBID)
+            options.contentOption = kMetaOnly;
+
+        // Read the metadata first, so nothing's leaked if something throws:
+        struct Change {
+            Record      record;
+            alloc_slice revID, remoteAncestorRevID;
+        };
+        vector<Change> changes;
+        changes.reserve(maxChanges);
+        auto &factory = database->documentFactory();
+        RecordEnumerator e(database->defaultKeyStore(), since, options);
+        while (changes.size() < maxChanges && e.next()) {
+            const Record &rec = e.record();
+            changes.push_back({rec, factory.revIDFromVersion(rec.version())});
+            if (remoteDBID)
+                changes.back().remoteAncestorRevID = factory.remoteAncestorRevID(rec, remoteDBID);
+            // Only the metadata is kept, not the body:
+            changes.back().record.setUnloadedBodySize(rec.bodySize());
+        }
+
+        for (size_t i = 0; i < changes.size(); ++i) {
+            auto &change = changes[i];
+            auto &info = outChanges[i];
+            info.flags = (C4DocumentFlags)change.record.flags() | kDocExists;
+            info.docID = heapString(change.record.key());
+            info.revID = heapString(move(change.revID));
+            info.sequence = change.record.sequence();
+            info.bodySize = change.record.bodySize();
+            info.expiration = change.record.expiration();
+            info.remoteAncestorRevID = heapString(move(change.remoteAncestorRevID));
+        }
+        return changes.size();
+    } catchError(outError)
+    return -1;
+}
+
+
+void c4db_releaseChangeInfo(C4ChangeInfo changes[], uint32_t numChanges) noexcept {
+    for (uint32_t i = 0; i < numChanges; ++i) {
+        auto &info = changes[i];
+        for (C4HeapString str : {info.docID, info.revID, info.remoteAncestorRevID}) {
+            if (str.buf)
+                c4slice_free({str.buf, str.size});
+        }
+    }
+}
@@ -73,6 +73,36 @@ C4Document* c4doc_get(C4Database *database,
 }
 
 
+int64_t c4db_getDocuments(C4Database *database,
+                          const C4String docIDs[],
+                          size_t count,
+                          bool mustExist,
+                          C4Document* outDocs[],
+                          C4Error *outError) noexcept
+{
+    fill(&outDocs[0], &outDocs[count], nullptr);
+    try {
+        vector<slice> keys(&docIDs[0], &docIDs[count]);
+        vector<Record> records = database->defaultKeyStore().getMany(keys);
+
+        // Create all the Documents before handing any out, so nothing leaks if one throws:
+        vector<Retained<Document>> docs(count);
+        int64_t found = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].exists())
+                ++found;
+            else if (mustExist)
+                continue;
+            docs[i] = database->documentFactory().newDocumentInstance(records[i]);
+        }
+        for (size_t i = 0; i < count; ++i)
+            outDocs[i] = retain(docs[i].get());
+        return found;
+    } catchError(outError)
+    return -1;
+}
+
+
 C4Document* c4doc_getSingleRevision(C4Database *database,
                                     C4Slice docID,
                                     C4Slice revID,
@@ -456,30 +486,38 @@ C4Document* c4doc_getForPut(C4Database *database,
 }
 
 
-C4Document* c4doc_put(C4Database *database,
-                      const C4DocPutRequest *rq,
-                      size_t *outCommonAncestorIndex,
-                      C4Error *outError) noexcept
-{
-    if (!database->mustBeInTransaction(outError))
-        return nullptr;
+// Validates the parameters of a PutRequest.
+static bool checkPutRequest(const C4DocPutRequest *rq, C4Error *outError) {
     if (rq->docID.buf && !Document::isValidDocID(rq->docID)) {
         c4error_return(LiteCoreDomain, kC4ErrorBadDocID, C4STR("Invalid docID"), outError);
-        return nullptr;
+        return false;
     }
     if (rq->existingRevision || rq->historyCount > 0)
         if (!checkParam(rq->docID.buf, "Missing docID", outError))
-            return nullptr;
+            return false;
     if (rq->existingRevision) {
         if (!checkParam(rq->historyCount > 0, "No history", outError))
-            return nullptr;
+            return false;
     } else {
         if (!checkParam(rq->historyCount <= 1, "Too much history", outError))
-            return nullptr;
+            return false;
         if (!checkParam(rq->historyCount > 0 || !(rq->revFlags & kRevDeleted),
                         "Can't create a new already-deleted document", outError))
-            return nullptr;
+            return false;
     }
+    return true;
+}
+
+
+C4Document* c4doc_put(C4Database *database,
+                      const C4DocPutRequest *rq,
+                      size_t *outCommonAncestorIndex,
+                      C4Error *outError) noexcept
+{
+    if (!database->mustBeInTransaction(outError))
+        return nullptr;
+    if (!checkPutRequest(rq, outError))
+        return nullptr;
 
     int commonAncestorIndex = 0;
     C4Document *doc = nullptr;
@@ -527,6 +565,111 @@ C4Document* c4doc_put(C4Database *database,
 }
 
 
+int64_t c4db_putDocuments(C4Database *database,
+                          const C4DocPutRequest requests[],
+                          size_t count,
+                          C4Document* outDocs[],
+                          C4Error outErrors[],
+                          C4Error *outError) noexcept
+{
+    if (!database->mustBeInTransaction(outError))
+        return -1;
+    if (outDocs)
+        fill(&outDocs[0], &outDocs[count], nullptr);
+    if (outErrors)
+        fill(&outErrors[0], &outErrors[count], C4Error{});
+
+    // A new document built in memory, waiting to be written as part of the batch:
+    struct PendingDoc {
+        size_t             index;
+        Retained<Document> doc;
+        alloc_slice        body;
+    };
+
+    try {
+        int64_t succeeded = 0;
+        vector<size_t> oneByOne;
+        vector<PendingDoc> pending;
+        vector<KeyStore::SetRequest> writes;
+        pending.reserve(count);
+        writes.reserve(count);
+
+        // Build the revision trees of new documents in memory, without reading or saving,
+        // as putNewDoc would:
+        for (size_t i = 0; i < count; ++i) {
+            const C4DocPutRequest *rq = &requests[i];
+            C4Error error {};
+            if (!checkPutRequest(rq, &error)) {
+                if (outErrors)
+                    outErrors[i] = error;
+                continue;
+            }
+            if (!rq->save || !isNewDocPutRequest(database, rq)) {
+                oneByOne.push_back(i);
+                continue;
+            }
+            try {
+                C4DocPutRequest unsavedRq = *rq;
+                unsavedRq.save = false;
+                Record record(rq->docID);
+                if (!rq->docID.buf)
+                    record.setKey(createDocUUID());
+                Retained<Document> idoc = database->documentFactory().newDocumentInstance(record);
+                bool ok;
+                if (rq->existingRevision)
+                    ok = idoc->putExistingRevision(unsavedRq, &error) >= 0;
+                else
+                    ok = idoc->putNewRevision(unsavedRq);
+                if (!ok) {
+                    oneByOne.push_back(i);      // Let c4doc_put report the error
+                    continue;
+                }
+                KeyStore::SetRequest write;
+                alloc_slice body = idoc->prepareSave(write, rq->maxRevTreeDepth);
+                pending.push_back({i, move(idoc), move(body)});
+                writes.push_back(write);
+            } catchError(&error)
+            if (error.code && outErrors)
+                outErrors[i] = error;
+        }
+
+        // Insert all the new documents' records at once. Any whose docIDs turn out to exist
+        // already (or to be repeated in the batch) are skipped, and get put one by one:
+        auto seqs = database->defaultKeyStore().setMany(writes, database->transaction(), true);
+        vector<Document*> saved;
+        saved.reserve(pending.size());
+        for (size_t j = 0; j < pending.size(); ++j) {
+            if (seqs[j]) {
+                pending[j].doc->savedAs(seqs[j]);
+                saved.push_back(pending[j].doc);
+                if (outDocs)
+                    outDocs[pending[j].index] = retain(pending[j].doc.get());
+                ++succeeded;
+            } else {
+                oneByOne.push_back(pending[j].index);
+            }
+        }
+        database->documentsSaved(saved);
+
+        for (size_t i : oneByOne) {
+            C4Error error;
+            C4Document *doc = c4doc_put(database, &requests[i], nullptr, &error);
+            if (doc) {
+                ++succeeded;
+                if (outDocs)
+                    outDocs[i] = doc;
+                else
+                    c4doc_release(doc);
+            } else if (outErrors) {
+                outErrors[i] = error;
+            }
+        }
+        return succeeded;
+    } catchError(outError)
+    return -1;
+}
+
+
 C4Document* c4doc_create(C4Database *db,
                          C4String docID,
                          C4Slice revBody,
@@ -261,6 +261,42 @@ C4SliceResult c4db_getIndexesInfo(C4Database* database, C4Error* outError) noexc
 }
 
 
+C4SliceResult c4db_getIndexAdvice(C4Database* database,
+                                  unsigned maxQueries,
+                                  bool reset,
+                                  C4Error* outError) noexcept
+{
+    return tryCatch<C4SliceResult>(outError, [&]{
+        auto dataFile = (SQLiteDataFile*)database->dataFile();
+        auto &advisor = dataFile->indexAdvisor();
+        string keyStoreName = database->defaultKeyStore().name();
+        Encoder enc;
+        enc.beginArray();
+        for (const auto &s : advisor.suggestions(*dataFile, maxQueries)) {
+            if (s.keyStoreName != keyStoreName)
+                continue;
+            enc.beginDictionary();
+            enc.writeKey("type");           enc.writeInt(s.type);
+            enc.writeKey("expr");           enc.writeString(s.expressionJSON);
+            enc.writeKey("queries");
+            enc.beginArray();
+            for (const auto &query : s.queries)
+                enc.writeString(query);
+            enc.endArray();
+            enc.writeKey("runs");           enc.writeUInt(s.runs);
+            enc.writeKey("rowsScanned");    enc.writeUInt(s.rowsScanned);
+            enc.writeKey("time");           enc.writeDouble(s.time * 1000);
+            enc.writeKey("benefit");        enc.writeDouble(s.benefit * 1000);
+            enc.endDictionary();
+        }
+        enc.endArray();
+        if (reset)
+            advisor.reset();
+        return C4SliceResult(enc.finish());
+    });
+}
+
+
 C4SliceResult c4db_getIndexRows(C4Database* database, C4String indexName, C4Error* outError) noexcept {
     return tryCatch<C4SliceResult>(outError, [&]{
         int64_t rowCount;
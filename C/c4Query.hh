@@ -49,6 +49,7 @@ struct c4Query : public RefCounted, public fleece::InstanceCountedIn<c4Query>, L
 
     Retained<C4QueryEnumeratorImpl> createEnumerator(const C4QueryOptions *c4options, slice encodedParameters) {
         Query::Options options(encodedParameters ? encodedParameters : _parameters);
+        options.streaming = c4options && c4options->streaming;
         return wrapEnumerator( _query->createEnumerator(&options) );
     }
 
@@ -57,28 +58,32 @@ struct c4Query : public RefCounted, public fleece::InstanceCountedIn<c4Query>, L
     }
 
     void enableObserver(c4QueryObserver *obs, bool enable) {
-        LOCK(_mutex);
-        if (enable) {
-            _observers.insert(obs);
-            if (!_bgQuerier) {
-                _bgQuerier = new LiveQuerier(_database, _query, true, this);
-                _bgQuerier->start(_parameters);
-            }
-        } else {
-            _observers.erase(obs);
-            if (_observers.empty() && _bgQuerier) {
-                _bgQuerier->stop();
-                _bgQuerier = nullptr;
-            }
+        LOCK(_enableMutex);
+        bool empty;
+        {
+            LOCK(_mutex);
+            if (enable)
+                _observers.insert(obs);
+            else
+                _observers.erase(obs);
+            empty = _observers.empty();
+        }
+        // (Not holding _mutex, since unsubscribe waits for a liveQuerierUpdated call in
+        // progress, which acquires _mutex.)
+        if (!empty && !_bgQuerier) {
+            // Identical live queries share a LiveQuerier:
+            _bgQuerier = LiveQuerier::subscribe(_database, _query, _parameters, this);
+        } else if (empty && _bgQuerier) {
+            _bgQuerier->unsubscribe(this);
+            _bgQuerier = nullptr;
         }
     }
 
     // called on a background thread!
     void liveQuerierUpdated(QueryEnumerator *qe, C4Error err) override {
-        Retained<C4QueryEnumeratorImpl> c4e = wrapEnumerator(qe);
+        // The enumerator may be shared with other C4Queries, so give mine its own position:
+        Retained<C4QueryEnumeratorImpl> c4e = wrapEnumerator(qe ? qe->clone() : nullptr);
         LOCK(_mutex);
-        if (!_bgQuerier)
-            return;
         for (auto &obs : _observers)
             obs->notify(c4e, err);
     }
@@ -88,8 +93,9 @@ private:
     Retained<Query> _query;
     alloc_slice _parameters;
 
-    Retained<LiveQuerier> _bgQuerier;
-    mutable std::mutex _mutex;
+    Retained<LiveQuerier> _bgQuerier;           // Guarded by _enableMutex
+    std::mutex _enableMutex;                    // Serializes enableObserver
+    mutable std::mutex _mutex;                  // Guards _observers
     std::set<c4QueryObserver*> _observers;
 };
 
@@ -46,10 +46,13 @@ CBL {
 		c4db_beginTransaction;
 		c4db_endTransaction;
 		c4db_isInTransaction;
+		c4db_endTransactionWithCallback;
+		c4db_commitPendingTransactions;
 		c4db_getSharedFleeceEncoder;
 		c4db_getFLSharedKeys;
 		c4db_encodeJSON;
 		c4db_maintenance;
+		c4db_getCacheStats;
 
 		c4raw_free;
 		c4raw_get;
@@ -58,6 +61,7 @@ CBL {
 		c4doc_retain;
 		c4doc_release;
 		c4doc_get;
+		c4db_getDocuments;
 		c4doc_getBySequence;
 		c4db_purgeDoc;
 		c4doc_selectRevision;
@@ -71,6 +75,7 @@ CBL {
 		c4doc_selectFirstPossibleAncestorOf;
 		c4doc_selectNextPossibleAncestorOf;
 		c4doc_put;
+		c4db_putDocuments;
 		c4doc_create;
 		c4doc_update;
 		c4doc_resolveConflict;
@@ -92,6 +97,8 @@ CBL {
 		c4db_getIndexes;
 		c4enum_next;
 		c4enum_getDocumentInfo;
+		c4db_getChanges;
+		c4db_releaseChangeInfo;
 		c4enum_getDocument;
 		c4enum_close;
 		c4enum_free;
@@ -373,6 +380,7 @@ CBL {
 		c4doc_generateID;
 
 		c4db_getIndexesInfo;
+		c4db_getIndexAdvice;
 
 		kC4DefaultEnumeratorOptions;
 		kC4DefaultQueryOptions;
@@ -67,6 +67,21 @@ extern "C" {
         C4Slice parentDirectory;        ///< Directory for databases
         C4DatabaseFlags flags;          ///< Create, ReadOnly, NoUpgrade (AutoCompact & SharedKeys always set)
         C4EncryptionKey encryptionKey;  ///< Encryption to use creating/opening the db
+
+        // Storage tuning. A value of 0 means "use the default", which scales with the size of
+        // the database file when it's opened.
+        int64_t  cacheSize;             ///< Max size of the page cache, in bytes
+        int64_t  mmapSize;              ///< Max amount of the file to memory-map; -1 to disable
+        int64_t  journalSizeLimit;      ///< Size the WAL file is truncated to after a checkpoint
+        uint32_t pageSize;              ///< Page size of a new database (power of 2, 512..65536)
+
+        // Group commit. If nonzero, a committed transaction isn't written to the file right
+        // away; it's grouped with the transactions committed after it, and the group is written
+        // in one commit once the first one has waited this long (or when the transaction open
+        // then ends.) Until then the changes aren't durable, or visible to other C4Database
+        // instances on the file, which can't begin transactions meanwhile. See
+        // \ref c4db_endTransactionWithCallback and \ref c4db_commitPendingTransactions.
+        uint32_t groupCommitWindow;     ///< Max milliseconds a commit waits; 0 to disable
     } C4DatabaseConfig2;
 
 
@@ -244,7 +259,30 @@ extern "C" {
 
     // DEPRECATED -- call c4db_maintenance instead
     bool c4db_compact(C4Database* database C4NONNULL, C4Error *outError) C4API;
-    
+
+
+    /** Cache statistics of a database, for sizing `C4DatabaseConfig2.cacheSize`. */
+    typedef struct C4DatabaseCacheStats {
+        uint64_t hits;                  ///< Page reads satisfied by the cache
+        uint64_t misses;                ///< Page reads that went to the file (or the mmap)
+        uint64_t memoryUsed;            ///< Heap memory currently used by the cache, in bytes
+        int64_t  cacheSize;             ///< The cache size in effect, in bytes
+        int64_t  mmapSize;              ///< The memory-mapped size in effect, in bytes
+        int64_t  journalSizeLimit;      ///< The WAL size limit in effect, in bytes
+        uint32_t pageSize;              ///< The database's page size
+        uint64_t queryCacheHits;        ///< Queries created from the compiled-query cache
+        uint64_t queryCacheMisses;      ///< Queries that had to be parsed and compiled
+    } C4DatabaseCacheStats;
+
+    /** Gets the cumulative page-cache hit/miss counts of all of the database's SQLite
+        connections, the hit/miss counts of its compiled-query cache, and the cache settings
+        in effect.
+        If `reset` is true, the hit/miss counters are reset to zero afterwards. */
+    bool c4db_getCacheStats(C4Database* database C4NONNULL,
+                            bool reset,
+                            C4DatabaseCacheStats *outStats C4NONNULL,
+                            C4Error *outError) C4API;
+
 
    /** @} */
     /** \name Transactions
@@ -266,6 +304,27 @@ extern "C" {
     /** Is a transaction active? */
     bool c4db_isInTransaction(C4Database* database C4NONNULL) C4API;
 
+    /** Callback for \ref c4db_endTransactionWithCallback. `durable` is true if the transaction
+        has been committed to the file, false if it was aborted or its group commit failed.
+        It may be called on a background thread. */
+    typedef void (*C4TransactionDurableCallback)(void *context, bool durable);
+
+    /** Like \ref c4db_endTransaction, but also registers a callback that will be called when
+        the transaction has been durably committed, or has failed to be. Without group commit
+        that's before this function returns. With it (see `C4DatabaseConfig2.groupCommitWindow`)
+        the callback is called once the transaction's group has been written to the file.
+        If the transaction is nested, the callback is called when the outermost one ends. */
+    bool c4db_endTransactionWithCallback(C4Database* database C4NONNULL,
+                                         bool commit,
+                                         C4TransactionDurableCallback callback,
+                                         void *context,
+                                         C4Error *outError) C4API;
+
+    /** In group-commit mode, immediately writes the transactions awaiting a group commit to the
+        file. (If a transaction is open, they'll be written when it ends.) */
+    bool c4db_commitPendingTransactions(C4Database* database C4NONNULL,
+                                        C4Error *outError) C4API;
+
     
     /** @} */
     /** @} */
@@ -118,6 +118,50 @@ extern "C" {
     bool c4enum_getDocumentInfo(C4DocEnumerator *e C4NONNULL,
                                 C4DocumentInfo *outInfo C4NONNULL) C4API;
 
+
+    //////// CHANGES SCAN:
+
+
+    /** Metadata about a changed document, as returned by c4db_getChanges. */
+    typedef struct C4ChangeInfo {
+        C4DocumentFlags flags;              ///< Document flags
+        C4HeapString docID;                 ///< Document ID
+        C4HeapString revID;                 ///< RevID of current revision
+        C4SequenceNumber sequence;          ///< Sequence at which doc was last updated
+        uint64_t bodySize;                  ///< Size in bytes of document body (approx)
+        int64_t expiration;                 ///< Expiration time, or 0 if none
+        C4HeapString remoteAncestorRevID;   ///< Latest revision known to be on the remote DB
+    } C4ChangeInfo;
+
+    /** Reads the metadata of the next documents changed after a sequence, in sequence order.
+        Unlike enumerating with c4db_enumerateChanges, this doesn't instantiate a C4Document
+        for each change, even to find its remote ancestor, so it's much faster when reading
+        many changes, as when pushing a database for the first time.
+        @param database  The database.
+        @param since  The sequence number to start _after_. Pass 0 to start from the beginning.
+        @param flags  Only kC4IncludeDeleted is recognized; other flags are ignored.
+        @param remoteDBID  If nonzero, each change's `remoteAncestorRevID` is set to the latest
+                        revision of the document known to be on this remote database, as with
+                        c4doc_getRemoteAncestor. (This requires reading the revision trees, so
+                        it's somewhat slower.)
+        @param outChanges  An array of `maxChanges` structs to be filled in. Call
+                        c4db_releaseChangeInfo when done with them, to free their strings.
+        @param maxChanges  The maximum number of changes to read.
+        @param outError  On failure, the error will be stored here.
+        @return  The number of changes read, or -1 on error. If it's less than `maxChanges`, there
+                 are no more changes. */
+    int64_t c4db_getChanges(C4Database *database C4NONNULL,
+                            C4SequenceNumber since,
+                            C4EnumeratorFlags flags,
+                            C4RemoteID remoteDBID,
+                            C4ChangeInfo outChanges[] C4NONNULL,
+                            uint32_t maxChanges,
+                            C4Error *outError) C4API;
+
+    /** Frees the strings in an array of changes returned by c4db_getChanges. */
+    void c4db_releaseChangeInfo(C4ChangeInfo changes[],
+                                uint32_t numChanges) C4API;
+
     /** @} */
 
 #ifdef __cplusplus
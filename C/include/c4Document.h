@@ -99,6 +99,26 @@ extern "C" {
                           bool mustExist,
                           C4Error *outError) C4API;
 
+    /** Gets multiple documents from the database at once. This is much faster than calling
+        \ref c4doc_get for each docID, since they're all read by a single query.
+        @param database  The database to read from.
+        @param docIDs  An array of `count` document IDs.
+        @param count  The number of document IDs.
+        @param mustExist  Governs what happens if a document doesn't exist. If true, its entry
+                        in `outDocs` is set to NULL; if false, it's set to a new empty document,
+                        as \ref c4doc_get would return.
+        @param outDocs  An array of `count` pointers that will be set to the documents, in the same
+                        order as `docIDs`. You must call `c4doc_release()` on each non-NULL one.
+        @param outError  On return of -1, the error that occurred.
+        @return  The number of documents that exist, or -1 on error (in which case every entry of
+                 `outDocs` is NULL.) */
+    int64_t c4db_getDocuments(C4Database *database C4NONNULL,
+                              const C4String docIDs[] C4NONNULL,
+                              size_t count,
+                              bool mustExist,
+                              C4Document* outDocs[] C4NONNULL,
+                              C4Error *outError) C4API;
+
     /** Gets a document from the database given its sequence number.
         You must call `c4doc_release()` when finished with the document.  */
     C4Document* c4doc_getBySequence(C4Database *database C4NONNULL,
@@ -358,6 +378,30 @@ extern "C" {
                           size_t *outCommonAncestorIndex,
                           C4Error *outError) C4API;
 
+    /** Performs multiple Put operations, like calling c4doc_put on each request, but much
+        faster when importing documents that don't exist yet: those are all written to the
+        database in one batch, and observers are notified of them together.
+        Must be called within a transaction. Requests for documents that already exist, or that
+        don't save, are processed one by one after the batch, so the sequences assigned won't
+        necessarily be in the same order as the requests.
+        @param database  The database to put the documents in.
+        @param requests  An array of `count` put requests.
+        @param count  The number of requests.
+        @param outDocs  If non-NULL, an array of `count` pointers that will be set to the resulting
+                        documents (which the caller must release), or to NULL for failed requests.
+        @param outErrors  If non-NULL, an array of `count` errors that will be set to the reason
+                          each request failed, or to a zero error for successful ones.
+        @param outError  On return of -1, the error that stopped the batch.
+        @return  The number of successful requests, or -1 if the entire batch failed, e.g.
+                 because there's no transaction or a storage error occurred. (In the latter case
+                 the transaction should be aborted.) */
+    int64_t c4db_putDocuments(C4Database *database C4NONNULL,
+                              const C4DocPutRequest requests[] C4NONNULL,
+                              size_t count,
+                              C4Document* outDocs[],
+                              C4Error outErrors[],
+                              C4Error *outError) C4API;
+
     /** Convenience function to create a new document. This just a wrapper around c4doc_put.
         If the document already exists, it will fail with the error kC4ErrorConflict.
         @param db  The database to create the document in
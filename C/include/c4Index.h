@@ -33,9 +33,15 @@ extern "C" {
         kC4FullTextIndex,      ///< Full-text index
         kC4ArrayIndex,         ///< Index of array values, for use with UNNEST
         kC4PredictiveIndex,    ///< Index of prediction() results (Enterprise Edition only)
+        kC4AggregateIndex,     ///< Aggregate values of groups, for GROUP BY queries
     };
 
 
+    /** Callback reporting the progress of building a full-text index; see `C4IndexOptions`.
+        `fractionDone` goes from 0.0 to 1.0. */
+    typedef void (*C4IndexProgressCallback)(void *context, double fractionDone);
+
+
     /** Options for indexes; these each apply to specific types of indexes. */
     typedef struct {
         /** Dominant language of text to be indexed; setting this enables word stemming, i.e.
@@ -68,6 +74,16 @@ extern "C" {
             To provide a custom list of words, use a string containing the words in lowercase
             separated by spaces. */
         const char *stopWords;
+
+        /** Optional callback for a full-text index on a large database (1000 or more
+            documents), which is populated in chunks. It's called on the thread calling
+            \ref c4db_createIndex, after each chunk of documents has been indexed, and finally
+            with 1.0 once the index can be used. Other transactions can run between chunks, but
+            the text is still tokenized by the calling thread. */
+        C4IndexProgressCallback progressCallback;
+
+        /** Passed to `progressCallback`. */
+        void *progressContext;
     } C4IndexOptions;
 
 
@@ -75,7 +91,7 @@ extern "C" {
         The name is used to identify the index for later updating or deletion; if an index with the
         same name already exists, it will be replaced unless it has the exact same expressions.
 
-        Currently four types of indexes are supported:
+        Currently five types of indexes are supported:
 
         * Value indexes speed up queries by making it possible to look up property (or expression)
           values without scanning every document. They're just like regular indexes in SQL or N1QL.
@@ -90,6 +106,9 @@ extern "C" {
           (across all documents) as a table in the SQLite database, and creating a SQL index on it.
         * Predictive indexes optimize queries that use the PREDICTION() function, by materializing
           the function's results as a table and creating a SQL index on a result property.
+        * Aggregate indexes optimize GROUP BY queries, by keeping a table with one row per group
+          that holds the values of aggregate functions over the group's documents. It's updated
+          as documents change, so a query can read the results without scanning the documents.
 
         Note: If some documents are missing the values to be indexed,
         those documents will just be omitted from the index. It's not an error.
@@ -102,11 +121,25 @@ extern "C" {
         In a predictive index, the expression is a PREDICTION() call in JSON query syntax,
         including the optional 3rd parameter that gives the result property to extract (and index.)
 
+        In an aggregate index, the `WHAT` expressions are calls to the aggregate functions
+        COUNT(), SUM(), AVG(), MIN() or MAX(), and a `GROUP_BY` array gives the grouping
+        expressions. A query is answered from the index if it has the same `GROUP_BY` and
+        `WHERE` clauses, no `FROM` or `DISTINCT`, and its other clauses only use the grouping
+        expressions, the indexed aggregates, literals, parameters and non-aggregate functions.
+        Removing the document holding a group's MIN() or MAX() value makes the index rescan the
+        group's documents to find the new one.
+
         `indexSpecJSON` specifies the index as a JSON object, with properties:
         * `WHAT`: An array of expressions in the JSON query syntax. (Note that each
           expression is already an array, so there are two levels of nesting.)
         * `WHERE`: An optional expression. Including this creates a _partial index_: documents
           for which this expression returns `false` or `null` will be skipped.
+        * `INCLUDE`: An optional array of properties, for a value index only. Their values are
+          stored with the index, so a query whose WHAT clause returns them doesn't have to read
+          the documents' bodies. (The stored values are only used as results; a WHERE or
+          ORDER BY clause using them still reads them from the bodies.) This makes the index
+          bigger, and slows down updates.
+        * `GROUP_BY`: An array of expressions, required for an aggregate index only.
 
         For backwards compatibility, `indexSpecJSON` may be an array; this is treated as if it were
         a dictionary with a `WHAT` key mapping to that array.
@@ -156,6 +189,30 @@ extern "C" {
     C4SliceResult c4db_getIndexesInfo(C4Database* database C4NONNULL,
                                       C4Error* outError) C4API;
 
+    /** Suggests indexes that would speed up the queries that have been run on the database.
+        LiteCore records how many times each query runs, how long it takes, and how many rows
+        its full table scans visit. This examines the query plans of the `maxQueries` queries
+        whose scans have cost the most, and suggests value indexes on the properties they test
+        and array indexes on the arrays they UNNEST.
+        The result is a Fleece-encoded array of dictionaries, most beneficial first, with keys:
+        * `"type"`: The index type (a `C4IndexType`)
+        * `"expr"`: The index spec JSON, as passed to `c4db_createIndex`
+        * `"queries"`: An array of the JSON forms of the queries that would use the index
+        * `"runs"`: The number of times those queries have run
+        * `"rowsScanned"`: The number of rows their full table scans have visited
+        * `"time"`: Their total running time, in milliseconds
+        * `"benefit"`: The estimated time in milliseconds that the index would have saved; that
+          is, the share of their time spent scanning rows they didn't return.
+        @param database  The database to check
+        @param maxQueries  The maximum number of queries to examine
+        @param reset  If true, the recorded query statistics are cleared afterwards
+        @param outError  On failure, will be set to the error status.
+        @return  A Fleece-encoded array of dictionaries, or NULL on failure. */
+    C4SliceResult c4db_getIndexAdvice(C4Database* database C4NONNULL,
+                                      unsigned maxQueries,
+                                      bool reset,
+                                      C4Error* outError) C4API;
+
     /** @} */
 
 #ifdef __cplusplus
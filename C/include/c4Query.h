@@ -79,6 +79,14 @@ extern "C" {
     /** Options for running queries. */
     typedef struct {
         bool rankFullText_DEPRECATED;      ///< Ignored; use the `rank()` query function instead.
+        /** If true, rows are read from the database as the enumerator advances, instead of all
+            being collected before \ref c4query_run returns. This uses constant memory and
+            returns the first row sooner, but the enumerator doesn't support
+            \ref c4queryenum_getRowCount, \ref c4queryenum_seek or \ref c4queryenum_refresh.
+            It holds a database read snapshot until it reaches the end or is closed.
+            Streaming needs one of the database's separate read connections; if none is
+            available, as within a transaction, the rows are collected as usual. */
+        bool streaming;
     } C4QueryOptions;
 
 
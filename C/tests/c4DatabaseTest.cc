@@ -22,6 +22,7 @@
 #include "c4BlobStore.h"
 #include "FilePath.hh"
 #include "SecureRandomize.hh"
+#include <atomic>
 #include <cmath>
 #include <errno.h>
 #include <iostream>
@@ -341,6 +342,56 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Changes", "[Database][C]") {
 }
 
 
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Changes Scan", "[Database][C]") {
+    createNumberedDocs(99);
+
+    C4Error error;
+    C4ChangeInfo changes[60];
+
+    // Since start, in two batches:
+    C4SequenceNumber seq = 1;
+    for (int batch = 0; batch < 2; ++batch) {
+        int64_t n = c4db_getChanges(db, seq - 1, 0, 0, changes, 60, &error);
+        REQUIRE(n == (batch == 0 ? 60 : 39));
+        for (int64_t i = 0; i < n; ++i, ++seq) {
+            char docID[30];
+            sprintf(docID, "doc-%03llu", (unsigned long long)seq);
+            CHECK(changes[i].docID == c4str(docID));
+            CHECK(changes[i].revID == kRevID);
+            CHECK(changes[i].sequence == seq);
+            CHECK((changes[i].flags & kDocExists));
+            CHECK(changes[i].bodySize > 0);
+            CHECK(changes[i].remoteAncestorRevID == kC4SliceNull);
+        }
+        c4db_releaseChangeInfo(changes, uint32_t(n));
+    }
+    CHECK(c4db_getChanges(db, 99, 0, 0, changes, 60, &error) == 0);
+
+    // Mark a revision as being on a remote; that also gives the doc a new sequence:
+    C4RemoteID remote = c4db_getRemoteDBID(db, "wss://example.com/db"_sl, true, &error);
+    REQUIRE(remote);
+    {
+        TransactionHelper t(db);
+        C4Document *doc = c4doc_get(db, "doc-010"_sl, true, &error);
+        REQUIRE(doc);
+        REQUIRE(c4doc_setRemoteAncestor(doc, remote, &error));
+        REQUIRE(c4doc_save(doc, 0, &error));
+        c4doc_release(doc);
+    }
+    REQUIRE(c4db_getChanges(db, 99, 0, remote, changes, 60, &error) == 1);
+    CHECK(changes[0].docID == "doc-010"_sl);
+    CHECK(changes[0].sequence == 100);
+    CHECK(changes[0].remoteAncestorRevID == kRevID);
+    c4db_releaseChangeInfo(changes, 1);
+
+    // Docs with no revision on the remote:
+    REQUIRE(c4db_getChanges(db, 98, 0, remote, changes, 60, &error) == 2);
+    CHECK(changes[0].docID == "doc-099"_sl);
+    CHECK(changes[0].remoteAncestorRevID == kC4SliceNull);
+    c4db_releaseChangeInfo(changes, 2);
+}
+
+
 #pragma mark - DOCUMENT EXPIRATION:
 
 
@@ -729,6 +780,172 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Config2 And ExtraInfo", "[Datab
 }
 
 
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Tuning And Cache Stats", "[Database][C]") {
+    C4DatabaseCacheStats stats;
+    C4Error error;
+    REQUIRE(c4db_getCacheStats(db, false, &stats, &error));
+    CHECK(stats.pageSize == 4096);
+    CHECK(stats.cacheSize >= 10 * 1024 * 1024);
+    CHECK(stats.journalSizeLimit >= 5 * 1024 * 1024);
+
+    C4DatabaseConfig2 config = *c4db_getConfig2(db);
+    config.cacheSize = 4 * 1024 * 1024;
+    config.mmapSize = -1;
+    config.journalSizeLimit = 1024 * 1024;
+    config.pageSize = 8192;
+    const string db2Name = string(kDatabaseName) + "_tuned";
+    c4db_deleteNamed(slice(db2Name), config.parentDirectory, &error);
+    C4Database *db2 = c4db_openNamed(slice(db2Name), &config, &error);
+    REQUIRE(db2);
+    CHECK(c4db_getConfig2(db2)->pageSize == 8192);
+
+    {
+        TransactionHelper t(db2);
+        for (int i = 0; i < 100; ++i) {
+            char docID[20];
+            sprintf(docID, "doc-%03d", i);
+            createRev(db2, slice(docID), kRevID, kFleeceBody);
+        }
+    }
+    for (int i = 0; i < 100; ++i) {
+        char docID[20];
+        sprintf(docID, "doc-%03d", i);
+        C4Document *doc = c4doc_get(db2, slice(docID), true, &error);
+        REQUIRE(doc);
+        c4doc_release(doc);
+    }
+
+    REQUIRE(c4db_getCacheStats(db2, true, &stats, &error));
+    CHECK(stats.pageSize == 8192);
+    CHECK(stats.cacheSize == 4 * 1024 * 1024);
+    CHECK(stats.mmapSize == 0);
+    CHECK(stats.journalSizeLimit == 1024 * 1024);
+    CHECK(stats.hits > 0);
+    CHECK(stats.memoryUsed > 0);
+
+    // The page size is fixed when the database is created; reopening doesn't change it:
+    REQUIRE(c4db_close(db2, &error));
+    c4db_release(db2);
+    config.pageSize = 1024;
+    db2 = c4db_openNamed(slice(db2Name), &config, &error);
+    REQUIRE(db2);
+    REQUIRE(c4db_getCacheStats(db2, false, &stats, &error));
+    CHECK(stats.pageSize == 8192);
+    REQUIRE(c4db_delete(db2, &error));
+    c4db_release(db2);
+
+    // Invalid page size:
+    {
+        ExpectingExceptions x;
+        config.pageSize = 1000;
+        CHECK(c4db_openNamed(slice(db2Name), &config, &error) == nullptr);
+        CHECK(error.domain == LiteCoreDomain);
+        CHECK(error.code == kC4ErrorInvalidParameter);
+    }
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Group Commit", "[Database][C]") {
+    struct Durability {
+        atomic<int> durable {0}, failed {0};
+    };
+    auto callback = [](void *context, bool durable) {
+        auto d = (Durability*)context;
+        ++(durable ? d->durable : d->failed);
+    };
+
+    // Reopen with a window long enough that only an explicit flush will commit the group:
+    C4Error error;
+    C4DatabaseConfig2 config = *c4db_getConfig2(db);
+    const string dbName = slice(c4db_getName(db)).asString();
+    const string parentDir = slice(config.parentDirectory).asString();
+    config.parentDirectory = slice(parentDir);
+    config.groupCommitWindow = 60 * 1000;
+    REQUIRE(c4db_close(db, &error));
+    c4db_release(db);
+    db = c4db_openNamed(slice(dbName), &config, &error);
+    REQUIRE(db);
+
+    auto db2 = c4db_openAgain(db, &error);
+    REQUIRE(db2);
+    C4DatabaseObserver *observer = c4dbobs_create(db2, [](C4DatabaseObserver*, void*) { }, nullptr);
+
+    Durability dur;
+    for (int i = 1; i <= 5; ++i) {
+        REQUIRE(c4db_beginTransaction(db, &error));
+        char docID[20];
+        sprintf(docID, "doc-%d", i);
+        createRev(slice(docID), kRevID, kFleeceBody);
+        REQUIRE(c4db_endTransactionWithCallback(db, (i != 3), callback, &dur, &error));
+    }
+    // The aborted transaction's callback is called right away; the others wait for the group:
+    CHECK(dur.durable == 0);
+    CHECK(dur.failed == 1);
+
+    // This instance sees the committed changes, but the other one doesn't yet:
+    CHECK(c4db_getDocumentCount(db) == 4);
+    CHECK(c4db_getDocumentCount(db2) == 0);
+    C4DatabaseChange changes[10];
+    bool external;
+    CHECK(c4dbobs_getChanges(observer, changes, 10, &external) == 0);
+
+    REQUIRE(c4db_commitPendingTransactions(db, &error));
+    CHECK(dur.durable == 4);
+    CHECK(dur.failed == 1);
+    CHECK(c4db_getDocumentCount(db2) == 4);
+
+    // The other instance is notified of the changes, in order:
+    uint32_t n = c4dbobs_getChanges(observer, changes, 10, &external);
+    REQUIRE(n == 4);
+    CHECK(external);
+    const char* expectedIDs[4] = {"doc-1", "doc-2", "doc-4", "doc-5"};
+    for (uint32_t i = 0; i < n; ++i) {
+        CHECK(slice(changes[i].docID) == slice(expectedIDs[i]));
+        if (i > 0)
+            CHECK(changes[i].sequence > changes[i-1].sequence);
+    }
+    c4dbobs_releaseChanges(changes, n);
+    c4dbobs_free(observer);
+
+    c4db_release(db2);
+
+    // Closing the database commits the group:
+    Durability dur2;
+    REQUIRE(c4db_beginTransaction(db, &error));
+    createRev(C4STR("doc-6"), kRevID, kFleeceBody);
+    REQUIRE(c4db_endTransactionWithCallback(db, true, callback, &dur2, &error));
+    CHECK(dur2.durable == 0);
+    REQUIRE(c4db_close(db, &error));
+    CHECK(dur2.durable == 1);
+    c4db_release(db);
+
+    // With a short window, the group is committed at the deadline even if the database is idle:
+    config.groupCommitWindow = 20;
+    db = c4db_openNamed(slice(dbName), &config, &error);
+    REQUIRE(db);
+    CHECK(c4db_getDocumentCount(db) == 5);
+
+    Durability dur3;
+    REQUIRE(c4db_beginTransaction(db, &error));
+    createRev(C4STR("doc-7"), kRevID, kFleeceBody);
+    REQUIRE(c4db_endTransactionWithCallback(db, true, callback, &dur3, &error));
+    for (int i = 0; i < 200 && dur3.durable == 0; ++i)
+        this_thread::sleep_for(chrono::milliseconds(10));
+    REQUIRE(dur3.durable == 1);
+    CHECK(dur3.failed == 0);
+
+    // ...so another instance can begin a transaction while this one stays idle:
+    db2 = c4db_openAgain(db, &error);
+    REQUIRE(db2);
+    CHECK(c4db_getDocumentCount(db2) == 6);
+    REQUIRE(c4db_beginTransaction(db2, &error));
+    createRev(db2, C4STR("doc-8"), kRevID, kFleeceBody);
+    REQUIRE(c4db_endTransaction(db2, true, &error));
+    c4db_release(db2);
+    CHECK(c4db_getDocumentCount(db) == 7);
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Reject invalid top-level keys", "[Database][C]") {
     C4Slice badKeys[] = { C4STR("_id"), C4STR("_rev"), C4STR("_deleted") };
     ExpectingExceptions ee;
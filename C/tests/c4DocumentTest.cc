@@ -18,6 +18,7 @@
 
 #include "c4Test.hh"
 #include "c4Document+Fleece.h"
+#include "c4Observer.h"
 #include "c4Private.h"
 #include "Benchmark.hh"
 #include "fleece/Fleece.hh"
@@ -717,6 +718,131 @@ N_WAY_TEST_CASE_METHOD(C4Test, "Document create from existing rev", "[Database][
 }
 
 
+N_WAY_TEST_CASE_METHOD(C4Test, "Document PutDocuments", "[Database][C]") {
+    createRev(kDocID, kRevID, kFleeceBody);
+    C4DatabaseObserver *observer = c4dbobs_create(db, [](C4DatabaseObserver*, void*) { }, nullptr);
+
+    constexpr size_t kCount = 5;
+    C4DocPutRequest rqs[kCount] = {};
+    C4String history[1] = {"1-31415926"_sl};
+    C4String parentRevID = kRevID;
+    for (auto &rq : rqs) {
+        rq.body = kFleeceBody;
+        rq.save = true;
+    }
+    rqs[0].docID = "new1"_sl;                   // New doc
+    rqs[1].docID = "new2"_sl;                   // New doc, existing revision
+    rqs[1].existingRevision = true;
+    rqs[1].history = history;
+    rqs[1].historyCount = 1;
+    rqs[2].docID = "new1"_sl;                   // Repeat of 0, so a conflict
+    rqs[3].docID = "_invalid"_sl;               // Bad docID
+    rqs[4].docID = kDocID;                      // Update of existing doc
+    rqs[4].history = &parentRevID;
+    rqs[4].historyCount = 1;
+
+    C4Document* docs[kCount];
+    C4Error errors[kCount];
+    C4Error error;
+    {
+        TransactionHelper t(db);
+        CHECK(c4db_putDocuments(db, rqs, kCount, docs, errors, &error) == 3);
+    }
+
+    REQUIRE(docs[0]);
+    CHECK(docs[0]->docID == "new1"_sl);
+    CHECK(docs[0]->sequence == 2);
+    REQUIRE(docs[1]);
+    CHECK(docs[1]->revID == "1-31415926"_sl);
+    CHECK(docs[1]->sequence == 3);
+    CHECK(docs[2] == nullptr);
+    CHECK(errors[2].domain == LiteCoreDomain);
+    CHECK(errors[2].code == kC4ErrorConflict);
+    CHECK(docs[3] == nullptr);
+    CHECK(errors[3].domain == LiteCoreDomain);
+    CHECK(errors[3].code == kC4ErrorBadDocID);
+    REQUIRE(docs[4]);
+    CHECK(c4rev_getGeneration(docs[4]->revID) == 2);
+    CHECK(docs[4]->sequence == 4);
+    for (auto i : {0, 1, 4})
+        CHECK(errors[i].code == 0);
+    for (auto doc : docs)
+        c4doc_release(doc);
+
+    // The saved documents are readable, and observers were notified of them:
+    CHECK(c4db_getLastSequence(db) == 4);
+    C4Document *doc = c4doc_get(db, "new2"_sl, true, &error);
+    REQUIRE(doc);
+    CHECK(doc->revID == "1-31415926"_sl);
+    CHECK(doc->selectedRev.body == kFleeceBody);
+    c4doc_release(doc);
+
+    C4DatabaseChange changes[10];
+    bool external;
+    CHECK(c4dbobs_getChanges(observer, changes, 10, &external) == 3);
+    c4dbobs_releaseChanges(changes, 3);
+    c4dbobs_free(observer);
+
+    // Not in a transaction:
+    {
+        ExpectingExceptions x;
+        CHECK(c4db_putDocuments(db, rqs, kCount, nullptr, nullptr, &error) == -1);
+        CHECK(error.code == kC4ErrorNotInTransaction);
+    }
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4Test, "Document GetDocuments", "[Database][C]") {
+    // More docs than are looked up by one SQL statement:
+    constexpr unsigned kNumDocs = 600;
+    createNumberedDocs(kNumDocs);
+
+    // Request them in reverse order, plus a missing doc and a repeated one:
+    std::vector<std::string> docIDStrs;
+    char docID[20];
+    for (unsigned i = kNumDocs; i >= 1; --i) {
+        sprintf(docID, "doc-%03u", i);
+        docIDStrs.push_back(docID);
+    }
+    docIDStrs.push_back("missing");
+    docIDStrs.push_back("doc-007");
+    std::vector<C4String> docIDs;
+    for (auto &str : docIDStrs)
+        docIDs.push_back(slice(str));
+    size_t count = docIDs.size();
+
+    std::vector<C4Document*> docs(count);
+    C4Error error;
+    CHECK(c4db_getDocuments(db, docIDs.data(), count, true, docs.data(), &error) == kNumDocs + 1);
+    for (size_t i = 0; i < count; ++i) {
+        INFO("Doc #" << i << ", " << docIDStrs[i]);
+        if (i == kNumDocs) {
+            CHECK(docs[i] == nullptr);
+            continue;
+        }
+        REQUIRE(docs[i]);
+        CHECK(docs[i]->docID == docIDs[i]);
+        CHECK(docs[i]->revID == kRevID);
+        CHECK((docs[i]->flags & kDocExists));
+        CHECK(docs[i]->selectedRev.body == kFleeceBody);
+        c4doc_release(docs[i]);
+    }
+
+    // With mustExist false, the missing doc is returned as an empty document:
+    C4String someIDs[2] = {"doc-001"_sl, "missing"_sl};
+    C4Document* someDocs[2];
+    CHECK(c4db_getDocuments(db, someIDs, 2, false, someDocs, &error) == 1);
+    REQUIRE(someDocs[0]);
+    CHECK(someDocs[0]->sequence == 1);
+    REQUIRE(someDocs[1]);
+    CHECK(someDocs[1]->docID == "missing"_sl);
+    CHECK((someDocs[1]->flags & kDocExists) == 0);
+    CHECK(someDocs[1]->sequence == 0);
+    for (auto doc : someDocs)
+        c4doc_release(doc);
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4Test, "Document Update", "[Database][C]") {
     C4Log("Begin test");
     C4Error error;
@@ -312,6 +312,115 @@ N_WAY_TEST_CASE_METHOD(PerfTest, "Import names", "[Perf][C][.slow]") {
 }
 
 
+N_WAY_TEST_CASE_METHOD(PerfTest, "Import names in batches", "[Perf][C][.slow]") {
+    // Same data set as "Import names", but saved with c4db_putDocuments in batches.
+    static constexpr size_t kBatchSize = 1000;
+    vector<alloc_slice> bodies;
+    vector<string> docIDs;
+    vector<C4DocPutRequest> requests;
+    unsigned numDocs = 0;
+
+    auto putBatch = [&] {
+        C4Error error;
+        CHECK(c4db_putDocuments(db, requests.data(), requests.size(),
+                                nullptr, nullptr, &error) == int64_t(requests.size()));
+        numDocs += unsigned(requests.size());
+        requests.clear();
+        bodies.clear();
+        docIDs.clear();
+    };
+
+    Stopwatch st;
+    {
+        TransactionHelper t(db);
+        readFileByLines(sFixturesDir + "names_300000.json", [&](FLSlice line) {
+            C4Error error;
+            bodies.push_back(c4db_encodeJSON(db, {line.buf, line.size}, &error));
+            REQUIRE(bodies.back());
+            char docID[20];
+            sprintf(docID, "%07u", numDocs + unsigned(requests.size()) + 1);
+            docIDs.emplace_back(docID);
+            requests.emplace_back();
+            requests.back().body = bodies.back();
+            requests.back().save = true;
+            if (requests.size() == kBatchSize) {
+                // (docIDs may have reallocated, so point to them only now)
+                for (size_t i = 0; i < requests.size(); ++i)
+                    requests[i].docID = slice(docIDs[i]);
+                putBatch();
+            }
+            return true;
+        });
+        for (size_t i = 0; i < requests.size(); ++i)
+            requests[i].docID = slice(docIDs[i]);
+        if (!requests.empty())
+            putBatch();
+    }
+    st.printReport("Importing in batches", numDocs, "doc");
+#ifdef NDEBUG
+    REQUIRE(numDocs == 300000);
+#endif
+    CHECK(c4db_getDocumentCount(db) == numDocs);
+}
+
+
+N_WAY_TEST_CASE_METHOD(PerfTest, "Document churn", "[Perf][C][.slow]") {
+    // Repeatedly loads and updates documents with deep rev trees, which exercises the
+    // allocation of their revision metadata.
+    static constexpr unsigned kNumDocs = 100, kNumRevs = 100, kNumOps = 100000;
+    // Keep all kNumRevs revisions; by default c4doc_put would prune the trees to 20.
+    c4db_setMaxRevTreeDepth(db, kNumRevs);
+    C4Error error;
+    vector<alloc_slice> curRevIDs(kNumDocs);
+    auto putRev = [&](unsigned docNo) {
+        char docID[20];
+        sprintf(docID, "doc-%03u", docNo);
+        C4String parentRevID = curRevIDs[docNo];
+        C4DocPutRequest rq = {};
+        rq.docID = slice(docID);
+        rq.body = kFleeceBody;
+        rq.history = &parentRevID;
+        rq.historyCount = curRevIDs[docNo] ? 1 : 0;
+        rq.save = true;
+        C4Document *doc = c4doc_put(db, &rq, nullptr, &error);
+        REQUIRE(doc);
+        curRevIDs[docNo] = alloc_slice(doc->revID);
+        c4doc_release(doc);
+    };
+
+    {
+        TransactionHelper t(db);
+        for (unsigned rev = 0; rev < kNumRevs; ++rev)
+            for (unsigned docNo = 0; docNo < kNumDocs; ++docNo)
+                putRev(docNo);
+    }
+
+    Benchmark reads;
+    for (unsigned i = 0; i < kNumOps; ++i) {
+        char docID[20];
+        sprintf(docID, "doc-%03u", unsigned(litecore::RandomNumber() % kNumDocs));
+        reads.start();
+        C4Document *doc = c4doc_get(db, slice(docID), true, &error);
+        REQUIRE(doc);
+        REQUIRE(doc->selectedRev.body.buf);
+        c4doc_release(doc);
+        reads.stop();
+    }
+    reads.printReport(1, "doc read");
+
+    Benchmark updates;
+    {
+        TransactionHelper t(db);
+        for (unsigned i = 0; i < kNumOps / 10; ++i) {
+            updates.start();
+            putRev(unsigned(litecore::RandomNumber() % kNumDocs));
+            updates.stop();
+        }
+    }
+    updates.printReport(1, "doc update");
+}
+
+
 N_WAY_TEST_CASE_METHOD(PerfTest, "Import geoblocks", "[Perf][C][.slow]") {
     // Download https://github.com/arangodb/example-datasets/raw/master/IPRanges/geoblocks.json
     // to C/tests/data/ before running this test.
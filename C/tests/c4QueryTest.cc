@@ -62,6 +62,48 @@ N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query Basic", "[Query][C]") {
     CHECK(run().size() == 10);
 }
 
+N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query streaming", "[Query][C]") {
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    auto expected = run();
+    REQUIRE(expected.size() == 8);
+
+    C4QueryOptions options = kC4DefaultQueryOptions;
+    options.streaming = true;
+    C4Error error;
+    auto e = c4query_run(query, &options, nullslice, &error);
+    REQUIRE(e);
+
+    // Changes made after the enumerator is created aren't visible to it:
+    {
+        TransactionHelper t(db);
+        createRev("0000001"_sl, "2-ffff"_sl, kC4SliceNull, kRevDeleted);
+    }
+
+    vector<string> results;
+    while (c4queryenum_next(e, &error))
+        results.push_back(slice(FLValue_AsString(FLArrayIterator_GetValueAt(&e->columns, 0))).asString());
+    CHECK(error.code == 0);
+    CHECK(results == expected);
+
+    {
+        ExpectingExceptions x;
+        CHECK(c4queryenum_getRowCount(e, &error) == -1);
+        CHECK(error.code == kC4ErrorUnsupported);
+        CHECK(!c4queryenum_seek(e, 0, &error));
+        CHECK(error.code == kC4ErrorUnsupported);
+    }
+    c4queryenum_release(e);
+
+    // A new streaming enumerator sees the deletion, and one that's closed early is fine:
+    e = c4query_run(query, &options, nullslice, &error);
+    REQUIRE(e);
+    REQUIRE(c4queryenum_next(e, &error));
+    CHECK(FLValue_AsString(FLArrayIterator_GetValueAt(&e->columns, 0)) == "0000015"_sl);
+    c4queryenum_close(e);
+    c4queryenum_release(e);
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query LIKE", "[Query][C]") {
     SECTION("General") {
         compile(json5("['LIKE', ['.name.first'], '%j%']"));
@@ -282,6 +324,57 @@ N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query expression index", "[Query][C]") {
 }
 
 
+N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query compiled-query cache", "[Query][C]") {
+    C4Error err;
+    C4DatabaseCacheStats stats;
+    auto checkQueryCache = [&](uint64_t hits, uint64_t misses) {
+        REQUIRE(c4db_getCacheStats(db, true, &stats, &err));
+        CHECK(stats.queryCacheHits == hits);
+        CHECK(stats.queryCacheMisses == misses);
+    };
+    REQUIRE(c4db_getCacheStats(db, true, &stats, &err));
+
+    const vector<string> kInCA {"0000001", "0000015", "0000036", "0000043", "0000053", "0000064", "0000072", "0000073"};
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    CHECK(run() == kInCA);
+    checkQueryCache(0, 1);
+
+    // Same query but with different whitespace (reusing the released query's statement):
+    compile(json5("['=',\n   ['.', 'contact', 'address', 'state'],   'CA' ]"));
+    CHECK(run() == kInCA);
+    checkQueryCache(1, 0);
+
+    // Same query again, while the other one is still in use:
+    C4Query *query2 = c4query_new(db, c4str(json5("['SELECT', {WHAT: [['._id']], WHERE: ['=', ['.', 'contact', 'address', 'state'], 'CA']}]").c_str()), &err);
+    REQUIRE(query2);
+    CHECK(c4query_columnCount(query2) == 1);
+    c4query_release(query2);
+    CHECK(run() == kInCA);
+    checkQueryCache(1, 0);
+
+    // Whitespace in a string literal does matter:
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'C A']"));
+    CHECK(run().empty());
+    checkQueryCache(0, 1);
+
+    // Creating an index invalidates the cache:
+    REQUIRE(c4db_createIndex(db, C4STR("byState"), C4STR("[[\".contact.address.state\"]]"), kC4ValueIndex, nullptr, &err));
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    CHECK(run() == kInCA);
+    checkQueryCache(0, 1);
+
+    // N1QL:
+    for (auto n1ql : {"SELECT META().id FROM _ WHERE contact.address.state = 'CA'"_sl,
+                      "SELECT META().id\n  FROM _   WHERE contact.address.state='CA'"_sl,
+                      "SELECT META().id FROM _ WHERE contact.address.state = 'CA' "_sl}) {
+        C4Query *q = c4query_new2(db, kC4N1QLQuery, n1ql, nullptr, &err);
+        REQUIRE(q);
+        c4query_release(q);
+    }
+    checkQueryCache(1, 2);
+}
+
+
 static bool lookForIndex(C4Database *db, slice name) {
     bool found = false;
     Doc info(alloc_slice(c4db_getIndexesInfo(db, nullptr)));
@@ -983,6 +1076,120 @@ N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query observer", "[Query][C][!throws]") {
     CHECK(c4queryenum_getRowCount(e2, &error) == 8);
 }
 
+N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query shared observers", "[Query][C][!throws]") {
+    // Two separate but identical queries:
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    C4Query *query1 = c4query_retain(query);
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    REQUIRE(query != query1);
+    C4Error error;
+
+    struct State {
+        c4::ref<C4QueryObserver> obs;
+        atomic<int> count = 0;
+    };
+    auto callback = [](C4QueryObserver *obs, C4Query *query, void *context) {
+        ++((State*)context)->count;
+    };
+    State state1, state2;
+    state1.obs = c4queryobs_create(query1, callback, &state1);
+    state2.obs = c4queryobs_create(query, callback, &state2);
+    c4queryobs_setEnabled(state1.obs, true);
+    WaitUntil(2000, [&]{return state1.count > 0;});
+
+    // The 2nd observer joins the running live query, and gets its current results:
+    c4queryobs_setEnabled(state2.obs, true);
+    WaitUntil(2000, [&]{return state2.count > 0;});
+    CHECK(state1.count == 1);
+    CHECK(state2.count == 1);
+    c4::ref<C4QueryEnumerator> e1 = c4queryobs_getEnumerator(state1.obs, true, &error);
+    c4::ref<C4QueryEnumerator> e2 = c4queryobs_getEnumerator(state2.obs, true, &error);
+    REQUIRE(e1);
+    REQUIRE(e2);
+    CHECK(c4queryenum_getRowCount(e1, &error) == 8);
+    CHECK(c4queryenum_getRowCount(e2, &error) == 8);
+    // Each enumerator has its own position:
+    REQUIRE(c4queryenum_next(e1, &error));
+    REQUIRE(c4queryenum_next(e2, &error));
+    CHECK(slice(FLValue_AsString(FLArrayIterator_GetValueAt(&e1->columns, 0)))
+          == slice(FLValue_AsString(FLArrayIterator_GetValueAt(&e2->columns, 0))));
+
+    // Both are notified of a change:
+    state1.count = state2.count = 0;
+    addPersonInState("after1", "CA");
+    WaitUntil(2000, [&]{return state1.count > 0 && state2.count > 0;});
+    e1 = c4queryobs_getEnumerator(state1.obs, true, &error);
+    e2 = c4queryobs_getEnumerator(state2.obs, true, &error);
+    REQUIRE(e1);
+    REQUIRE(e2);
+    CHECK(c4queryenum_getRowCount(e1, &error) == 9);
+    CHECK(c4queryenum_getRowCount(e2, &error) == 9);
+
+    // Disabling one observer doesn't stop the other:
+    c4queryobs_setEnabled(state1.obs, false);
+    state1.count = state2.count = 0;
+    addPersonInState("after2", "CA");
+    WaitUntil(2000, [&]{return state2.count > 0;});
+    CHECK(state1.count == 0);
+    e2 = c4queryobs_getEnumerator(state2.obs, true, &error);
+    REQUIRE(e2);
+    CHECK(c4queryenum_getRowCount(e2, &error) == 10);
+    c4query_release(query1);
+}
+
+N_WAY_TEST_CASE_METHOD(C4QueryTest, "C4Query concurrent observers", "[Query][C][!throws]") {
+    // Different queries have their own live queries, which run concurrently on the
+    // background database's pool of reader DataFiles:
+    static constexpr const char* kStates[] = {"CA", "TX", "AL", "NY", "WA", "OR"};
+    constexpr size_t kNumQueries = sizeof(kStates) / sizeof(kStates[0]);
+
+    struct State {
+        c4::ref<C4Query> query;
+        c4::ref<C4QueryObserver> obs;
+        atomic<int> count = 0;
+    };
+    auto callback = [](C4QueryObserver *obs, C4Query *query, void *context) {
+        ++((State*)context)->count;
+    };
+    auto allCalled = [&](State states[]) {
+        for (size_t i = 0; i < kNumQueries; ++i)
+            if (states[i].count == 0)
+                return false;
+        return true;
+    };
+
+    C4Error error;
+    State states[kNumQueries];
+    int64_t initialRows[kNumQueries];
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        compile(json5("['=', ['.', 'contact', 'address', 'state'], '" + string(kStates[i]) + "']"));
+        states[i].query = c4query_retain(query);
+        states[i].obs = c4queryobs_create(query, callback, &states[i]);
+        c4queryobs_setEnabled(states[i].obs, true);
+    }
+    WaitUntil(5000, [&]{return allCalled(states);});
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        c4::ref<C4QueryEnumerator> e = c4queryobs_getEnumerator(states[i].obs, true, &error);
+        REQUIRE(e);
+        initialRows[i] = c4queryenum_getRowCount(e, &error);
+        states[i].count = 0;
+    }
+
+    // Each live query sees a change that affects it:
+    {
+        TransactionHelper t(db);
+        for (size_t i = 0; i < kNumQueries; ++i)
+            addPersonInState(("after_" + string(kStates[i])).c_str(), kStates[i]);
+    }
+    WaitUntil(5000, [&]{return allCalled(states);});
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        c4::ref<C4QueryEnumerator> e = c4queryobs_getEnumerator(states[i].obs, true, &error);
+        REQUIRE(e);
+        CHECK(c4queryenum_getRowCount(e, &error) == initialRows[i] + 1);
+        c4queryobs_setEnabled(states[i].obs, false);
+    }
+}
+
 N_WAY_TEST_CASE_METHOD(C4QueryTest, "Delete index", "[Query][C][!throws]") {
     C4Error err;
     C4String names[2] = { C4STR("length"), C4STR("byStreet") };
@@ -1008,6 +1215,45 @@ N_WAY_TEST_CASE_METHOD(C4QueryTest, "Delete index", "[Query][C][!throws]") {
     }
 }
 
+N_WAY_TEST_CASE_METHOD(C4QueryTest, "Index advice", "[Query][C][!throws]") {
+    C4Error err;
+    alloc_slice advice = c4db_getIndexAdvice(db, 10, true, &err);     // clear any old stats
+    REQUIRE(advice);
+
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    for (int i = 0; i < 3; ++i) {
+        c4::ref<C4QueryEnumerator> e = c4query_run(query, nullptr, nullslice, &err);
+        REQUIRE(e);
+        CHECK(c4queryenum_getRowCount(e, &err) == 8);
+    }
+
+    advice = c4db_getIndexAdvice(db, 10, false, &err);
+    REQUIRE(advice);
+    FLArray suggestions = FLValue_AsArray(FLValue_FromData(advice, kFLTrusted));
+    REQUIRE(FLArray_Count(suggestions) == 1);
+    FLDict suggestion = FLValue_AsDict(FLArray_Get(suggestions, 0));
+    CHECK(FLValue_AsInt(FLDict_Get(suggestion, "type"_sl)) == kC4ValueIndex);
+    string expr = string(slice(FLValue_AsString(FLDict_Get(suggestion, "expr"_sl))));
+    CHECK(expr == "[[\".contact.address.state\"]]");
+    CHECK(FLArray_Count(FLValue_AsArray(FLDict_Get(suggestion, "queries"_sl))) == 1);
+    CHECK(FLValue_AsUnsigned(FLDict_Get(suggestion, "runs"_sl)) == 3);
+    CHECK(FLValue_AsUnsigned(FLDict_Get(suggestion, "rowsScanned"_sl)) >= 3 * 99);
+    CHECK(FLValue_AsDouble(FLDict_Get(suggestion, "benefit"_sl))
+          <= FLValue_AsDouble(FLDict_Get(suggestion, "time"_sl)));
+
+    // After creating the suggested index the query doesn't scan, so there's no advice:
+    REQUIRE(c4db_createIndex(db, C4STR("byState"), slice(expr), kC4ValueIndex, nullptr, &err));
+    advice = c4db_getIndexAdvice(db, 10, true, &err);
+    REQUIRE(advice);
+    CHECK(FLArray_Count(FLValue_AsArray(FLValue_FromData(advice, kFLTrusted))) == 0);
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    c4::ref<C4QueryEnumerator> e = c4query_run(query, nullptr, nullslice, &err);
+    REQUIRE(e);
+    advice = c4db_getIndexAdvice(db, 10, false, &err);
+    REQUIRE(advice);
+    CHECK(FLArray_Count(FLValue_AsArray(FLValue_FromData(advice, kFLTrusted))) == 0);
+}
+
 N_WAY_TEST_CASE_METHOD(C4QueryTest, "Database alias column names", "[Query][C][!throws]") {
     // https://github.com/couchbase/couchbase-lite-core/issues/750
 
@@ -21,6 +21,8 @@
 #include "Database.hh"
 #include "SequenceTracker.hh"
 #include "c4ExceptionUtils.hh"
+#include <algorithm>
+#include <thread>
 
 namespace litecore {
     using namespace actor;
@@ -28,13 +30,35 @@ namespace litecore {
     using namespace std;
 
 
+    // Delegate of the reader DataFiles. It ignores external commits, since the main background
+    // DataFile already notifies the TransactionObservers of those.
+    class BackgroundDB::ReaderDelegate : public DataFile::Delegate {
+    public:
+        explicit ReaderDelegate(Database *db)       :_database(db) { }
+
+        slice fleeceAccessor(slice recordBody) const override {
+            return _database->fleeceAccessor(recordBody);
+        }
+
+        alloc_slice blobAccessor(const fleece::impl::Dict *dict) const override {
+            return _database->blobAccessor(dict);
+        }
+
+    private:
+        Database* _database;
+    };
+
+
     BackgroundDB::BackgroundDB(Database *db)
     :access_lock(db->dataFile()->openAnother(this))
     ,_database(db)
+    ,_readerDelegate(new ReaderDelegate(db))
+    ,_maxReaders(clamp(thread::hardware_concurrency(), 2u, kMaxReaders))
     { }
 
 
     void BackgroundDB::close() {
+        closeReaders();
         use([this](DataFile* &df) {
             delete df;
             df = nullptr;
@@ -93,6 +117,85 @@ namespace litecore {
     }
 
 
+#pragma mark - READERS:
+
+
+    void BackgroundDB::useReader(function_ref<void(DataFile*)> task) {
+        DataFile *df = borrowReader();
+        try {
+            task(df);
+        } catch (...) {
+            if (df)
+                returnReader(df);
+            throw;
+        }
+        if (df)
+            returnReader(df);
+    }
+
+
+    DataFile* BackgroundDB::borrowReader() {
+        unique_lock<mutex> lock(_readersMutex);
+        _readersCond.wait(lock, [&] {
+            return _readersClosed || !_idleReaders.empty() || _openReaders < _maxReaders;
+        });
+        if (_readersClosed)
+            return nullptr;
+        if (!_idleReaders.empty()) {
+            DataFile *df = _idleReaders.back();
+            _idleReaders.pop_back();
+            return df;
+        }
+        // Open a new reader. (The mutex isn't held meanwhile, since this takes a while.)
+        ++_openReaders;
+        lock.unlock();
+        try {
+            return _database->dataFile()->openBackgroundReader(_readerDelegate.get());
+        } catch (...) {
+            lock.lock();
+            --_openReaders;
+            _readersCond.notify_all();
+            throw;
+        }
+    }
+
+
+    void BackgroundDB::returnReader(DataFile *df) {
+        unique_lock<mutex> lock(_readersMutex);
+        if (!_readersClosed) {
+            _idleReaders.push_back(df);
+        } else {
+            // close() was called while this was borrowed, and is waiting for it:
+            lock.unlock();
+            delete df;
+            lock.lock();
+            --_openReaders;
+        }
+        _readersCond.notify_all();
+    }
+
+
+    // Deletes the reader DataFiles, waiting until the borrowed ones are returned.
+    void BackgroundDB::closeReaders() {
+        unique_lock<mutex> lock(_readersMutex);
+        _readersClosed = true;
+        vector<DataFile*> idle;
+        swap(idle, _idleReaders);
+        _openReaders -= unsigned(idle.size());
+        _readersCond.notify_all();      // Wake up any waiting borrowReader calls
+        lock.unlock();
+
+        for (DataFile *df : idle)
+            delete df;
+
+        lock.lock();
+        _readersCond.wait(lock, [&] {return _openReaders == 0;});
+    }
+
+
+#pragma mark - TRANSACTION OBSERVERS:
+
+
     void BackgroundDB::addTransactionObserver(TransactionObserver *obs) {
         LOCK(_transactionObserversMutex);
         _transactionObservers.push_back(obs);
@@ -9,6 +9,9 @@
 #include "DataFile.hh"
 #include "access_lock.hh"
 #include "function_ref.hh"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace c4Internal {
@@ -30,6 +33,18 @@ namespace litecore {
 
         void useInTransaction(TransactionTask task);
 
+        /// Calls `task` with a DataFile that no other thread is using, taken from a pool of up
+        /// to kMaxReaders of them. Unlike use(), this lets several tasks run at once, so it's
+        /// for read-only work like running queries. The task must not write to the DataFile,
+        /// nor keep any object created on it (like a Query) after it returns.
+        /// The DataFiles are opened by DataFile::openBackgroundReader, so they don't each have a
+        /// full-size cache and a pool of read connections of their own.
+        /// If all the DataFiles are busy, this blocks until one is free.
+        /// After close(), the task is called with nullptr.
+        void useReader(function_ref<void(DataFile*)> task);
+
+        static constexpr unsigned kMaxReaders = 8;
+
         class TransactionObserver {
         public:
             virtual ~TransactionObserver() =default;
@@ -43,6 +58,11 @@ namespace litecore {
         void removeTransactionObserver(TransactionObserver* NONNULL);
 
     private:
+        class ReaderDelegate;
+
+        DataFile* borrowReader();
+        void returnReader(DataFile*);
+        void closeReaders();
         slice fleeceAccessor(slice recordBody) const override;
         alloc_slice blobAccessor(const fleece::impl::Dict*) const override;
         void externalTransactionCommitted(const SequenceTracker &sourceTracker) override;
@@ -51,6 +71,14 @@ namespace litecore {
         c4Internal::Database* _database;
         std::vector<TransactionObserver*> _transactionObservers;
         std::mutex _transactionObserversMutex;
+
+        std::unique_ptr<ReaderDelegate> _readerDelegate;    // Delegate of the reader DataFiles
+        unsigned const _maxReaders;                         // Capacity of the reader pool
+        std::mutex _readersMutex;
+        std::condition_variable _readersCond;               // Signaled when a reader's returned
+        std::vector<DataFile*> _idleReaders;                // Reader DataFiles not in use
+        unsigned _openReaders {0};                          // Number of readers, incl. borrowed
+        bool _readersClosed {false};                        // Set by close()
     };
 
 }
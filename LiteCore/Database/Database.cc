@@ -103,21 +103,37 @@ namespace c4Internal {
 
 
     Database::Database(const string &bundlePath,
-                       C4DatabaseConfig inConfig)
+                       C4DatabaseConfig inConfig,
+                       const C4DatabaseConfig2 *inConfig2)
     :Database(bundlePath,
               inConfig,
+              inConfig2,
               findOrCreateBundle(bundlePath,
                                  (inConfig.flags & kC4DB_Create) != 0,
                                  inConfig.storageEngine))
     { }
 
     
+    // Combines a v1 config with the tuning settings of a v2 config, if any.
+    static C4DatabaseConfig2 makeConfig2(slice parentDirectory,
+                                         const C4DatabaseConfig &config,
+                                         const C4DatabaseConfig2 *config2)
+    {
+        C4DatabaseConfig2 result = config2 ? *config2 : C4DatabaseConfig2{};
+        result.parentDirectory = parentDirectory;
+        result.flags = config.flags;
+        result.encryptionKey = config.encryptionKey;
+        return result;
+    }
+
+
     Database::Database(const string &bundlePath,
                        const C4DatabaseConfig &inConfig,
+                       const C4DatabaseConfig2 *inConfig2,
                        FilePath &&dataFilePath)
     :_name(dataFilePath.dir().unextendedName())
     ,_parentDirectory(dataFilePath.dir().parentDir())
-    ,_config{slice(_parentDirectory), inConfig.flags, inConfig.encryptionKey}
+    ,_config(makeConfig2(slice(_parentDirectory), inConfig, inConfig2))
     ,_configV1(inConfig)
     ,_encoder(new fleece::impl::Encoder())
     {
@@ -128,6 +144,11 @@ namespace c4Internal {
         options.writeable = (_config.flags & kC4DB_ReadOnly) == 0;
         options.upgradeable = (_config.flags & kC4DB_NoUpgrade) == 0;
         options.useDocumentKeys = true;
+        options.cacheSize = _config.cacheSize;
+        options.mmapSize = _config.mmapSize;
+        options.journalSizeLimit = _config.journalSizeLimit;
+        options.pageSize = _config.pageSize;
+        options.groupCommitWindow = _config.groupCommitWindow;
         options.encryptionAlgorithm = (EncryptionAlgorithm)_config.encryptionKey.algorithm;
         if (options.encryptionAlgorithm != kNoEncryption) {
 #ifdef COUCHBASE_ENTERPRISE
@@ -439,6 +460,9 @@ namespace c4Internal {
 
 
     void Database::stopBackgroundTasks() {
+        // First write any pending group commit, which keeps the file locked: a background task
+        // may be waiting to begin a transaction, and stopping it waits for that.
+        _dataFile->commitPendingTransactions();
         if (_housekeeper) {
             _housekeeper->stop();
             _housekeeper = nullptr;
@@ -538,9 +562,11 @@ namespace c4Internal {
     }
 
 
-    void Database::endTransaction(bool commit) {
+    void Database::endTransaction(bool commit, DurableCallback durable) {
         if (_transactionLevel == 0)
             error::_throw(error::NotInTransaction);
+        if (durable)
+            _durableCallbacks.push_back(move(durable));
         if (--_transactionLevel == 0) {
             auto t = _transaction;
             try {
@@ -559,17 +585,67 @@ namespace c4Internal {
 
     // The cleanup part of endTransaction
     void Database::_cleanupTransaction(bool committed) {
+        // A transaction committed to a group isn't durable, or visible to other Database
+        // instances, until the group is committed:
+        bool grouped = committed && _transaction->isGrouped();
         if (_sequenceTracker) {
             _sequenceTracker->use([&](SequenceTracker &st) {
                 if (committed) {
-                    // Notify other Database instances on this file:
-                    _transaction->notifyCommitted(st);
+                    if (grouped) {
+                        // Save the changes, to notify other Database instances of later:
+                        lock_guard<mutex> lock(_groupMutex);
+                        if (!_groupTracker) {
+                            _groupTracker.reset(new SequenceTracker);
+                            _groupTracker->beginTransaction();
+                        }
+                        st.copyTransactionTo(*_groupTracker);
+                    } else {
+                        // Notify other Database instances on this file:
+                        _transaction->notifyCommitted(st);
+                    }
                 }
                 st.endTransaction(committed);
             });
         }
-        delete _transaction;
+
+        auto callbacks = move(_durableCallbacks);
+        _durableCallbacks.clear();
+        if (grouped) {
+            lock_guard<mutex> lock(_groupMutex);
+            for (auto &callback : callbacks)
+                _groupCallbacks.push_back(move(callback));
+            callbacks.clear();
+        }
+
+        delete _transaction;            // (This may commit the group, calling groupCommitEnded)
         _transaction = nullptr;
+
+        for (auto &callback : callbacks)
+            callback(committed);
+    }
+
+
+    // DataFile::Delegate method, called when a group commit has been written to the file, or
+    // failed and was rolled back. In the latter case this instance's own observers have already
+    // been told about the changes, when each Transaction committed; that can't be undone, but
+    // the callbacks report the failure, and other instances never hear of the changes.
+    // This may be called on a background thread.
+    void Database::groupCommitEnded(bool committed) {
+        unique_ptr<SequenceTracker> tracker;
+        vector<DurableCallback> callbacks;
+        {
+            lock_guard<mutex> lock(_groupMutex);
+            tracker = move(_groupTracker);
+            callbacks = move(_groupCallbacks);
+            _groupCallbacks.clear();
+        }
+        if (tracker) {
+            if (committed)
+                _dataFile->notifyCommitted(*tracker);
+            tracker->endTransaction(committed);
+        }
+        for (auto &callback : callbacks)
+            callback(committed);
     }
 
 
@@ -686,18 +762,36 @@ namespace c4Internal {
     }
 
 
-    void Database::documentSaved(Document* doc) {
+    static void trackSavedDocument(SequenceTracker &st, Document *doc) {
         // CBL-1089
         // Conflicted documents are not eligible to be replicated,
         // so ignore them.  Later when the conflict is resolved
         // there will be logic to replicate them (see TreeDocument::resolveConflict)
-        if (_sequenceTracker && !(doc->selectedRev.flags & kRevIsConflict)) {
+        if (doc->selectedRev.flags & kRevIsConflict)
+            return;
+        Assert(doc->selectedRev.sequence == doc->sequence); // The new revision must be selected
+        st.documentChanged(doc->_docIDBuf,
+                           doc->_selectedRevIDBuf,
+                           doc->selectedRev.sequence,
+                           doc->selectedRev.body.size);
+    }
+
+
+    void Database::documentSaved(Document* doc) {
+        if (_sequenceTracker) {
             _sequenceTracker->use([doc](SequenceTracker &st) {
-                Assert(doc->selectedRev.sequence == doc->sequence); // The new revision must be selected
-                st.documentChanged(doc->_docIDBuf,
-                                   doc->_selectedRevIDBuf,
-                                   doc->selectedRev.sequence,
-                                   doc->selectedRev.body.size);
+                trackSavedDocument(st, doc);
+            });
+        }
+    }
+
+
+    // Like documentSaved, but for a batch of documents; locks the SequenceTracker only once.
+    void Database::documentsSaved(const vector<Document*> &docs) {
+        if (_sequenceTracker && !docs.empty()) {
+            _sequenceTracker->use([&](SequenceTracker &st) {
+                for (Document *doc : docs)
+                    trackSavedDocument(st, doc);
             });
         }
     }
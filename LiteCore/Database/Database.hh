@@ -25,9 +25,11 @@
 #include "FilePath.hh"
 #include "InstanceCounted.hh"
 #include "access_lock.hh"
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
 
 namespace fleece { namespace impl {
     class Dict;
@@ -51,7 +53,9 @@ namespace c4Internal {
     /** A top-level LiteCore database. */
     class Database : public RefCounted, public DataFile::Delegate, public fleece::InstanceCountedIn<Database> {
     public:
-        Database(const string &path, C4DatabaseConfig config);
+        /** Opens a database. If `config2` is given, its storage-tuning settings are used. */
+        Database(const string &path, C4DatabaseConfig config,
+                 const C4DatabaseConfig2 *config2 =nullptr);
 
         void close();
         void deleteDatabase();
@@ -85,8 +89,15 @@ namespace c4Internal {
 
         Transaction& transaction() const;
 
+        /** Called when a committed transaction has been durably written to the file (`true`),
+            or when it was aborted or its group commit failed (`false`.) */
+        typedef std::function<void(bool durable)> DurableCallback;
+
         void beginTransaction();
-        void endTransaction(bool commit);
+        void endTransaction(bool commit, DurableCallback =nullptr);
+
+        /** Writes any transactions awaiting a group commit to the file. */
+        void commitPendingTransactions()                    {_dataFile->commitPendingTransactions();}
 
         bool inTransaction() noexcept;
         bool mustBeInTransaction(C4Error *outError) noexcept;
@@ -150,6 +161,7 @@ namespace c4Internal {
         virtual slice fleeceAccessor(slice recordBody) const override;
         virtual alloc_slice blobAccessor(const fleece::impl::Dict*) const override;
         virtual void externalTransactionCommitted(const SequenceTracker&) override;
+        virtual void groupCommitEnded(bool committed) override;
 
         BackgroundDB* backgroundDatabase();
         void stopBackgroundTasks();
@@ -161,13 +173,15 @@ namespace c4Internal {
     public:
         // should be private, but called from Document
         void documentSaved(Document* NONNULL);
+        void documentsSaved(const std::vector<Document*>&);
 
     protected:
         virtual ~Database();
         void mustNotBeInTransaction();
 
     private:
-        Database(const string &bundlePath, const C4DatabaseConfig&, FilePath &&dataFilePath);
+        Database(const string &bundlePath, const C4DatabaseConfig&, const C4DatabaseConfig2*,
+                 FilePath &&dataFilePath);
         static FilePath findOrCreateBundle(const string &path, bool canCreate,
                                            C4StorageEngine &outStorageEngine);
         static bool deleteDatabaseFileAtPath(const string &dbPath, C4StorageEngine);
@@ -186,6 +200,10 @@ namespace c4Internal {
         std::unique_ptr<DataFile>   _dataFile;              // Underlying DataFile
         Transaction*                _transaction {nullptr}; // Current Transaction, or null
         int                         _transactionLevel {0};  // Nesting level of transaction
+        std::vector<DurableCallback> _durableCallbacks;     // Callbacks for current transaction
+        std::mutex                  _groupMutex;            // Guards the two members below:
+        std::vector<DurableCallback> _groupCallbacks;       // Callbacks awaiting group commit
+        std::unique_ptr<SequenceTracker> _groupTracker;     // Changes awaiting group commit
         std::unique_ptr<DocumentFactory> _documentFactory;       // Instantiates C4Documents
         std::unique_ptr<fleece::impl::Encoder> _encoder;         // Shared Fleece Encoder
         FLEncoder                   _flEncoder {nullptr};   // Ditto, for clients
@@ -151,6 +151,17 @@ namespace c4Internal {
         // Returns false on conflict
         virtual bool save(unsigned maxRevTreeDepth =0) =0;
 
+        // A save whose record write is done by the caller, batched with other documents'
+        // (see c4db_putDocuments.) `prepareSave` fills in `outWrite` with the record to write and
+        // returns the buffer its value points into; then call `savedAs` with its new sequence.
+        virtual alloc_slice prepareSave(KeyStore::SetRequest &outWrite,
+                                        unsigned maxRevTreeDepth =0) {
+            failUnsupported();
+        }
+        virtual void savedAs(sequence_t) {
+            failUnsupported();
+        }
+
         void requireValidDocID();   // Throws if invalid
 
         // STATIC UTILITY FUNCTIONS:
@@ -231,6 +242,11 @@ namespace c4Internal {
         virtual alloc_slice revIDFromVersion(slice version) =0;
         virtual bool isFirstGenRevID(slice revID)               {return false;}
 
+        /** Returns the revID of the latest revision of a Record's document that's known to be on a
+            remote database, or a null slice if none, without instantiating a Document.
+            The Record must have been read with its entire body. */
+        virtual alloc_slice remoteAncestorRevID(const Record&, C4RemoteID) =0;
+
         virtual std::vector<alloc_slice> findAncestors(const std::vector<slice> &docIDs,
                                                        const std::vector<slice> &revIDs,
                                                        unsigned maxAncestors,
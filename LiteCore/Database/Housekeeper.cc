@@ -54,8 +54,10 @@ namespace litecore {
 
 
     void Housekeeper::_scheduleExpiration() {
-        expiration_t nextExp = _bgdb->use<expiration_t>([&](DataFile *df) {
-            return df ? df->defaultKeyStore().nextExpiration() : 0;
+        expiration_t nextExp = 0;
+        _bgdb->useReader([&](DataFile *df) {
+            if (df)
+                nextExp = df->defaultKeyStore().nextExpiration();
         });
         if (nextExp == 0) {
             LogToAt(DBLog, Verbose, "Housekeeper: no scheduled document expiration");
@@ -20,9 +20,11 @@
 #include "BackgroundDB.hh"
 #include "DataFile.hh"
 #include "Database.hh"
+#include "Error.hh"
 #include "StringUtil.hh"
 #include "c4ExceptionUtils.hh"
 #include <inttypes.h>
+#include <vector>
 
 namespace litecore {
     using namespace actor;
@@ -50,17 +52,17 @@ namespace litecore {
     ,_expression(query->expression())
     ,_language(query->language())
     ,_continuous(continuous)
-    ,_delegate(delegate)
     {
+        _delegates.emplace(delegate, false);
         logInfo("Created on Query %s", query->loggingName().c_str());
         // Note that we don't keep a reference to `_query`, because it's tied to `db`, but we
-        // need to run the query on `_backgroundDB`. So instead we save the query text and
-        // language, and create a new Query instance the first time `_runQuery` is called.
+        // need to run the query on one of `_backgroundDB`'s reader DataFiles. So instead we save
+        // the query text and language, and `_runQuery` creates a Query instance on the reader.
     }
 
 
     LiveQuerier::~LiveQuerier() {
-        if (_query)
+        if (_observing)
             _stop();
         logVerbose("Deleted");
     }
@@ -71,6 +73,67 @@ namespace litecore {
     }
 
 
+    // Registry of LiveQueriers created by subscribe(), keyed by database and _sharedKey.
+    // A LiveQuerier is removed when its last delegate unsubscribes.
+    static mutex sSharedMutex;
+    static map<pair<c4Internal::Database*, string>, LiveQuerier*> sShared;
+
+
+    /*static*/ Retained<LiveQuerier> LiveQuerier::subscribe(c4Internal::Database *db,
+                                                           Query *query,
+                                                           alloc_slice parameters,
+                                                           Delegate *delegate)
+    {
+        string key;
+        key += char('0' + int(query->language()));
+        key += string(query->expression());
+        key += '\0';
+        key += string(parameters);
+
+        lock_guard<mutex> lock(sSharedMutex);
+        Retained<LiveQuerier> querier;
+        if (auto i = sShared.find({db, key}); i != sShared.end()) {
+            querier = i->second;
+            {
+                lock_guard<mutex> dlock(querier->_delegatesMutex);
+                querier->_delegates.emplace(delegate, false);
+            }
+            // Send it the current results, if there are any yet:
+            querier->enqueue(FUNCTION_TO_QUEUE(LiveQuerier::_delegateAdded), delegate);
+        } else {
+            querier = new LiveQuerier(db, query, true, delegate);
+            querier->_sharedKey = key;
+            sShared.emplace(make_pair(db, key), querier.get());
+            querier->start(Query::Options(parameters));
+        }
+        return querier;
+    }
+
+
+    void LiveQuerier::unsubscribe(Delegate *delegate) {
+        {
+            lock_guard<mutex> lock(sSharedMutex);
+            bool empty;
+            {
+                lock_guard<mutex> dlock(_delegatesMutex);
+                _delegates.erase(delegate);
+                empty = _delegates.empty();
+            }
+            if (empty) {
+                sShared.erase({_database.get(), _sharedKey});
+                stop();
+            }
+        }
+        // Don't return while the delegate is being called, unless it's unsubscribing from
+        // inside that call. (This waits outside sSharedMutex, since the delegate may be calling
+        // subscribe or unsubscribe itself.)
+        unique_lock<mutex> dlock(_delegatesMutex);
+        _delegateCallDone.wait(dlock, [&] {
+            return _callingDelegate != delegate || _callingThread == this_thread::get_id();
+        });
+    }
+
+
     void LiveQuerier::start(Query::Options options) {
         _lastTime = clock::now();
         enqueue(FUNCTION_TO_QUEUE(LiveQuerier::_runQuery), options);
@@ -94,14 +157,11 @@ namespace litecore {
 
 
     void LiveQuerier::_stop() {
-        if (_query) {
-            _backgroundDB->use([&](DataFile *df) {
-                _query = nullptr;
-                _currentEnumerator = nullptr;
-                if (_continuous)
-                    _backgroundDB->removeTransactionObserver(this);
-            });
+        if (_observing) {
+            _backgroundDB->removeTransactionObserver(this);
+            _observing = false;
         }
+        _currentEnumerator = nullptr;
         logVerbose("...stopped");
         _stopping = false;
     }
@@ -131,35 +191,49 @@ namespace litecore {
         _waitingToRun = false;
         logVerbose("Running query...");
         Retained<QueryEnumerator> newQE;
+        bool refreshed = false;
         C4Error error = {};
         fleece::Stopwatch st;
-        _backgroundDB->use([&](DataFile *df) {
+        if (_continuous && !_observing) {
+            _backgroundDB->addTransactionObserver(this);
+            _observing = true;
+        }
+        // Run on whichever reader DataFile is free, so other LiveQueriers can run meanwhile:
+        _backgroundDB->useReader([&](DataFile *df) {
             try {
-                // Create my own Query object associated with the Backgrounder's DataFile:
-                if (!_query) {
-                    _query = df->defaultKeyStore().compileQuery(_expression, _language);
-                    if (_continuous)
-                        _backgroundDB->addTransactionObserver(this);
+                if (!df)
+                    error::_throw(error::NotOpen);
+                // Create a Query object on this DataFile. After the first time this is cheap,
+                // since the DataFile caches compiled queries:
+                Retained<Query> query = df->defaultKeyStore().compileQuery(_expression, _language);
+                if (_continuous && _currentEnumerator) {
+                    // Refresh the current results; for simple queries this only has to look at
+                    // the docs that changed. Returns null if the results are unchanged.
+                    refreshed = true;
+                    newQE = _currentEnumerator->refresh(query);
+                } else {
+                    // Run the query:
+                    newQE = query->createEnumerator(&options);
                 }
-                // Now run the query:
-                newQE = _query->createEnumerator(&options);
             } catchError(&error);
         });
         auto time = st.elapsedMS();
 
+        if (refreshed && !newQE && error.code == 0) {
+            logVerbose("Results unchanged at seq %" PRIu64 " (%.3fms)",
+                       _currentEnumerator->lastSequence(), time);
+            return; // no delegate call
+        }
+
         if (!newQE)
             logError("Query failed with error %s", c4error_descriptionStr(error));
 
         if (_continuous) {
             if (newQE) {
-                if (_currentEnumerator && !_currentEnumerator->obsoletedBy(newQE)) {
-                    logVerbose("Results unchanged at seq %" PRIu64 " (%.3fms)",
-                               newQE->lastSequence(), time);
-                    return; // no delegate call
-                }
                 logInfo("Results changed at seq %" PRIu64 " (%.3fms)", newQE->lastSequence(), time);
                 _currentEnumerator = newQE;
             }
+            _currentError = error;
         } else {
             logInfo("...finished one-shot query in %.3fms", time);
         }
@@ -167,7 +241,50 @@ namespace litecore {
         if (_stopping)
             return;
         
-        _delegate->liveQuerierUpdated(newQE, error);
+        notifyDelegates(newQE, error);
+    }
+
+
+    void LiveQuerier::_delegateAdded(Delegate *delegate) {
+        if (_stopping || (!_currentEnumerator && _currentError.code == 0))
+            return;     // The query hasn't run yet; the delegate will hear when it does
+        unique_lock<mutex> lock(_delegatesMutex);
+        logInfo("Now shared by %zu live queries", _delegates.size());
+        if (auto i = _delegates.find(delegate); i != _delegates.end() && !i->second) {
+            i->second = true;
+            callDelegate(lock, delegate, _currentEnumerator, _currentError);
+        }
+    }
+
+
+    void LiveQuerier::notifyDelegates(QueryEnumerator *qe, C4Error error) {
+        unique_lock<mutex> lock(_delegatesMutex);
+        vector<Delegate*> delegates;
+        delegates.reserve(_delegates.size());
+        for (auto &[delegate, called] : _delegates) {
+            called = true;
+            delegates.push_back(delegate);
+        }
+        for (Delegate *delegate : delegates) {
+            if (_delegates.find(delegate) != _delegates.end())    // skip if unsubscribed meanwhile
+                callDelegate(lock, delegate, qe, error);
+        }
+    }
+
+
+    // Calls a delegate with `lock` released, so that the delegate can subscribe or unsubscribe.
+    // While it runs, `_callingDelegate` makes unsubscribe() wait for it to return.
+    void LiveQuerier::callDelegate(unique_lock<mutex> &lock, Delegate *delegate,
+                                   QueryEnumerator *qe, C4Error error)
+    {
+        _callingDelegate = delegate;
+        _callingThread = this_thread::get_id();
+        lock.unlock();
+        delegate->liveQuerierUpdated(qe, error);
+        lock.lock();
+        _callingDelegate = nullptr;
+        _callingThread = {};
+        _delegateCallDone.notify_all();
     }
 
 }
@@ -13,7 +13,12 @@
 #include "Logging.hh"
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace c4Internal {
     class Database;
@@ -40,6 +45,21 @@ namespace litecore {
                     bool continuous,
                     Delegate* NONNULL);
 
+        /** Adds a delegate to a continuous LiveQuerier for the query with the given parameters,
+            creating and starting one if necessary. Live queries on the same database with the
+            same query text and parameters share one LiveQuerier, so that a change runs the query
+            only once and the results go to all of them. A delegate that joins a querier that's
+            already running is first called with its latest results. */
+        static Retained<LiveQuerier> subscribe(c4Internal::Database* NONNULL,
+                                               Query* NONNULL,
+                                               alloc_slice parameters,
+                                               Delegate* NONNULL);
+
+        /** Removes a delegate added by `subscribe`; it won't be called after this returns.
+            (If the delegate is being called, this waits for that call to finish, unless it's
+            called from within it.) The querier stops when its last delegate is removed. */
+        void unsubscribe(Delegate* NONNULL);
+
         void start(Query::Options);
 
         void stop();
@@ -57,17 +77,26 @@ namespace litecore {
         void _runQuery(Query::Options);
         void _stop();
         void _dbChanged(clock::time_point);
+        void _delegateAdded(Delegate*);
+        void notifyDelegates(QueryEnumerator*, C4Error);
+        void callDelegate(std::unique_lock<std::mutex>&, Delegate*, QueryEnumerator*, C4Error);
 
         Retained<c4Internal::Database> _database;       // The database
         BackgroundDB* _backgroundDB;                    // Shadow DB on background thread
-        Delegate* _delegate;                            // Whom ya gonna call?
+        std::mutex _delegatesMutex;                     // Held while accessing delegates
+        std::condition_variable _delegateCallDone;      // Signaled after each delegate call
+        std::map<Delegate*, bool> _delegates;           // Whom ya gonna call? (--> called yet?)
+        Delegate* _callingDelegate {nullptr};           // Delegate being called right now
+        std::thread::id _callingThread;                 // Thread calling _callingDelegate
+        std::string _sharedKey;                         // Registry key, if created by subscribe()
         alloc_slice _expression;                        // The query text
         QueryLanguage _language;                        // The query language (JSON or N1QL)
-        Retained<Query> _query;                         // Compiled query
         Retained<QueryEnumerator> _currentEnumerator;   // Latest query results
+        C4Error _currentError {};                       // Error from latest query run, if any
         clock::time_point _lastTime;                    // Time the query last ran
         bool _continuous;                               // Do I keep running until stopped?
         bool _waitingToRun {false};                     // Is a call to _runQuery scheduled?
+        bool _observing {false};                        // Am I a TransactionObserver?
         std::atomic<bool> _stopping {false};            // Has stop() been called?
     };
 
@@ -25,23 +25,28 @@
 
 
 /*
-Placeholders are interspersed with the document change objects in the list.
-    Pl1 -> A -> Z -> Pl2 -> B -> F
-if document A is changed, its sequence is updated and it moves to the end:
-    Pl1 -> Z -> Pl2 -> B -> F -> A
-After a notifier iterates through the changes following its placeholder,
-it moves its placeholder to the end:
-           Z -> Pl2 -> B -> F -> A -> Pl1
-Any document change items before the first placeholder can be removed:
-                Pl2 -> B -> F -> A -> Pl1
-After a document changes, if the item(s) directly before its change object are placeholders,
-their notifiers post notifications. Here document F changed, and notifier 1 posts a notification:
-                Pl2 -> B -> A -> Pl1 -> F
+The changes are kept in a ring buffer of Entries, in the order they were made. Each Entry has a
+position, which increases monotonically. A document has at most one live Entry; its interned
+DocInfo records that Entry's position:
+    A B C
+if document A is changed, its Entry is cleared (made dead) and a new one is added at the end,
+and the DocInfo's position is updated:
+    - B C A
+Each database notifier has a cursor, the position after the last change it's read. Here
+notifier 1 has read everything, and notifier 2 only B:
+    - B^2 C A^1
+After a document changes, any notifiers whose cursors were at the end (i.e. that were up to date)
+post notifications. Here document C changed, and notifier 1 posts a notification:
+    - B^2 - A^1 C
+Any Entries before the first cursor can be removed, though some are kept for the sake of
+notifiers that are created later to start from a past sequence.
+When the ring is full, its live Entries are copied to a new one, which closes the gaps left by
+dead Entries; their positions, and the notifiers' cursors, are renumbered to match.
 
 Transactions:
- When a transaction begins, a placeholder is added at the end of the list.
- On commit: Generate a list of all changes since that placeholder, and broadcast to all other databases open on this file. They add those changes to their SequenceTrackers.
- On abort: Iterate over all changes since that placeholder and call documentChanged, with the old committed sequence number. This will notify all observers that the doc has reverted back.
+ When a transaction begins, a notifier (with no callback) is added with its cursor at the end.
+ On commit: Generate a list of all changes since that cursor, and broadcast to all other databases open on this file. They add those changes to their SequenceTrackers.
+ On abort: Iterate over all changes since that cursor and call documentChanged, with the old committed sequence number. This will notify all observers that the doc has reverted back.
 */
 
 
@@ -51,6 +56,9 @@ namespace litecore {
 
     size_t SequenceTracker::kMinChangesToKeep = 100;
 
+    // Minimum capacity of the ring buffer; must be a power of 2.
+    static constexpr size_t kMinRingSize = 64;
+
     LogDomain ChangesLog("Changes", LogLevel::Warning);
 
 
@@ -70,33 +78,32 @@ namespace litecore {
 
     void SequenceTracker::endTransaction(bool commit) {
         Assert(inTransaction());
+        position transactionStart = _transaction->_cursor;
 
         if (commit) {
             logInfo("commit: sequences #%" PRIu64 " -- #%" PRIu64, _preTransactionLastSequence, _lastSequence);
             // Bump their committedSequences:
-            for (auto entry = next(_transaction->_placeholder); entry != _changes.end(); ++entry) {
-                if (!entry->isPlaceholder()) {
-                    const_cast<Entry&>(*entry).committedSequence = entry->sequence;
-                }
+            for (position pos = transactionStart; pos < _endPos; ++pos) {
+                Entry &entry = entryAt(pos);
+                if (entry.isLive())
+                    entry.doc->committedSequence = entry.sequence;
             }
 
         } else {
             logInfo("abort: from seq #%" PRIu64 " back to #%" PRIu64, _lastSequence, _preTransactionLastSequence);
             _lastSequence = _preTransactionLastSequence;
 
-            // Revert their committedSequences:
-            const_iterator lastEntry = prev(_changes.end());
-            const_iterator nextEntry = _transaction->_placeholder;
-            const_iterator entry;
-            do {
-                entry = nextEntry;
-                nextEntry = next(entry);
-                if (!entry->isPlaceholder()) {
-                    // moves entry!
-                    _documentChanged(entry->docID, entry->revID,
-                                     entry->committedSequence, entry->bodySize);
-                }
-            } while (entry != lastEntry);
+            // Revert their committedSequences. Re-adding the changes can renumber the Entries,
+            // so collect them first:
+            vector<Change> reverted;
+            for (position pos = transactionStart; pos < _endPos; ++pos) {
+                Entry &entry = entryAt(pos);
+                if (entry.isLive())
+                    reverted.push_back({entry.doc->docID, entry.revID,
+                                        entry.doc->committedSequence, entry.bodySize});
+            }
+            for (auto &change : reverted)
+                _documentChanged(change.docID, change.revID, change.sequence, change.bodySize);
         }
 
         _transaction.reset();
@@ -129,72 +136,117 @@ namespace litecore {
                                            uint64_t bodySize)
     {
         auto shortBodySize = (uint32_t)min(bodySize, (uint64_t)UINT32_MAX);
-        bool listChanged = true;
-        Entry *entry;
-        auto i = _byDocID.find(docID);
-        if (i != _byDocID.end()) {
-            // Move existing entry to the end of the list:
-            entry = &*i->second;
-            if (entry->isIdle() && !hasDBChangeNotifiers()) {
-                listChanged = false;
-            } else {
-                if (entry->isIdle()) {
-                    _changes.splice(_changes.end(), _idle, i->second);
-                    entry->idle = false;
-                } else if (next(i->second) != _changes.end())
-                    _changes.splice(_changes.end(), _changes, i->second);
-                else
-                    listChanged = false;
-            }
-            // Update its revID & sequence:
-            entry->revID = revID;
-            entry->sequence = sequence;
-            entry->bodySize = shortBodySize;
+        DocInfo *doc;
+        bool addEntry = true;
+        auto i = _docs.find(docID);
+        if (i != _docs.end()) {
+            doc = &i->second;
+            // An idle doc doesn't need an Entry unless someone's going to read it:
+            if (doc->isIdle() && !hasDBChangeNotifiers())
+                addEntry = false;
         } else {
-            // or create a new entry at the end:
-            _changes.emplace_back(docID, revID, sequence, shortBodySize);
-            iterator change = prev(_changes.end());
-            _byDocID[change->docID] = change;
-            entry = &*change;
+            doc = &internDocID(docID);
         }
 
-        if (!inTransaction()) {
-            entry->committedSequence = sequence;
-            entry->external = true; // it must have come from addExternalTransaction()
+        _notifying.clear();
+        if (addEntry) {
+            // Notifiers that are up to date will need to be notified of this change:
+            for (auto n = _notifiers.rbegin(); n != _notifiers.rend() && (*n)->_cursor == _endPos; ++n)
+                _notifying.push_back(*n);
+            // Replace the doc's Entry with a new one at the end:
+            if (!doc->isIdle())
+                killEntry(*doc);
+            appendEntry(*doc, revID, sequence, shortBodySize);
         }
 
+        doc->sequence = sequence;
+        if (!inTransaction())
+            doc->committedSequence = sequence;
+
         // Notify document notifiers:
-        for (auto docNotifier : entry->documentObservers)
-            docNotifier->notify(entry);
-
-        if (listChanged && _numPlaceholders > 0) {
-            // Any placeholders right before this change were up to date, should be notified:
-            bool notified = false;
-            auto ph = next(_changes.rbegin());      // iterating _backwards_, skipping latest
-            while (ph != _changes.rend() && ph->isPlaceholder()) {
-                auto nextph = ph;
-                ++nextph; // precompute next pos, in case 'ph' moves itself during the callback
-                if (ph->databaseObserver) {
-                    ph->databaseObserver->notify();
-                    notified = true;
-                }
-                ph = nextph;
+        for (auto docNotifier : doc->documentObservers)
+            docNotifier->notify(*doc);
+
+        if (!_notifying.empty()) {
+            for (size_t n = 0; n < _notifying.size(); ++n)
+                _notifying[n]->notify();
+            removeObsoleteEntries();
+        }
+    }
+
+
+    SequenceTracker::DocInfo& SequenceTracker::internDocID(const alloc_slice &docID) {
+        // The key points to the DocInfo's own copy of the docID:
+        return _docs.emplace(piecewise_construct,
+                             forward_as_tuple(docID),
+                             forward_as_tuple(docID)).first->second;
+    }
+
+
+    void SequenceTracker::killEntry(DocInfo &doc) {
+        entryAt(doc.pos) = Entry();
+        doc.pos = kNoPosition;
+        --_liveCount;
+    }
+
+
+    void SequenceTracker::appendEntry(DocInfo &doc, const alloc_slice &revID,
+                                      sequence_t sequence, uint32_t bodySize)
+    {
+        if (_endPos - _firstPos == _ring.size())
+            growRing();
+        Entry &entry = entryAt(_endPos);
+        entry.docID = doc.docID;
+        entry.revID = revID;
+        entry.sequence = sequence;
+        entry.bodySize = bodySize;
+        entry.external = !inTransaction(); // it must have come from addExternalTransaction()
+        entry.doc = &doc;
+        doc.pos = _endPos++;
+        ++_liveCount;
+    }
+
+
+    // Called when the ring is full. Copies the live Entries to a new ring, closing the gaps left by
+    // dead ones, and renumbers the positions in the DocInfos and notifiers' cursors to match.
+    void SequenceTracker::growRing() {
+        size_t newSize = kMinRingSize;
+        while (newSize < 2 * _liveCount)
+            newSize *= 2;
+        vector<Entry> newRing(newSize);
+
+        position newPos = _firstPos;
+        auto notifier = _notifiers.begin();
+        for (position pos = _firstPos; pos < _endPos; ++pos) {
+            for (; notifier != _notifiers.end() && (*notifier)->_cursor <= pos; ++notifier)
+                (*notifier)->_cursor = newPos;
+            Entry &entry = entryAt(pos);
+            if (entry.isLive()) {
+                entry.doc->pos = newPos;
+                newRing[newPos & (newSize - 1)] = move(entry);
+                ++newPos;
             }
-            if (notified)
-                removeObsoleteEntries();
         }
+        for (; notifier != _notifiers.end(); ++notifier)
+            (*notifier)->_cursor = newPos;
+
+        logVerbose("Resized ring from %zu to %zu; dropped %" PRIu64 " dead entries",
+                   _ring.size(), newSize, _endPos - newPos);
+        _ring = move(newRing);
+        _endPos = newPos;
     }
 
 
     void SequenceTracker::addExternalTransaction(const SequenceTracker &other) {
         Assert(!inTransaction());
         Assert(other.inTransaction());
-        if (!_changes.empty() || _numDocObservers > 0) {
+        if (_endPos > _firstPos || !_notifiers.empty() || _numDocObservers > 0) {
             logInfo("addExternalTransaction from %s", other.loggingIdentifier().c_str());
-            for (auto e = next(other._transaction->_placeholder); e != other._changes.end(); ++e) {
-                if (!e->isPlaceholder()) {
-                    _lastSequence = e->sequence;
-                    _documentChanged(e->docID, e->revID, e->sequence, e->bodySize);
+            for (position pos = other._transaction->_cursor; pos < other._endPos; ++pos) {
+                const Entry &e = other.entryAt(pos);
+                if (e.isLive()) {
+                    _lastSequence = e.sequence;
+                    _documentChanged(e.doc->docID, e.revID, e.sequence, e.bodySize);
                 }
             }
             removeObsoleteEntries();
@@ -202,128 +254,149 @@ namespace litecore {
     }
 
 
-    SequenceTracker::const_iterator
-    SequenceTracker::_since(sequence_t sinceSeq) const {
-        if (sinceSeq >= _lastSequence) {
-            return _changes.cend();
-        } else {
-            // Scan back till we find a document entry with sequence less than sinceSeq
-            // (but not a purge); then back up one:
-            auto result = _changes.crbegin();
-            for (auto i = _changes.crbegin(); i != _changes.crend(); ++i) {
-                if (i->sequence > sinceSeq || i->isPurge())
-                    result = i;
-                else if (!i->isPlaceholder())
+    void SequenceTracker::copyTransactionTo(SequenceTracker &group) const {
+        Assert(inTransaction());
+        for (position pos = _transaction->_cursor; pos < _endPos; ++pos) {
+            const Entry &e = entryAt(pos);
+            if (e.isPurge())
+                group.documentPurged(e.docID);
+            else if (e.isLive())
+                group.documentChanged(e.doc->docID, e.revID, e.sequence, e.bodySize);
+        }
+    }
+
+
+    SequenceTracker::position SequenceTracker::_since(sequence_t sinceSeq) const {
+        // Scan back till we find a document entry with sequence less than sinceSeq
+        // (but not a purge); the result is the position after it.
+        position result = _endPos;
+        if (sinceSeq < _lastSequence) {
+            for (position pos = _endPos; pos > _firstPos; ) {
+                const Entry &entry = entryAt(--pos);
+                if (!entry.isLive())
+                    continue;
+                if (entry.sequence > sinceSeq || entry.isPurge())
+                    result = pos;
+                else
                     break;
             }
-            return prev(result.base());      // (convert `result` to regular fwd iterator)
         }
+        return result;
     }
 
 
-    SequenceTracker::const_iterator
-    SequenceTracker::addPlaceholderAfter(DatabaseChangeNotifier *obs, sequence_t seq) {
-        Assert(obs);
-        ++_numPlaceholders;
-        return _changes.emplace(_since(seq), obs);
+    void SequenceTracker::addNotifier(DatabaseChangeNotifier *notifier, sequence_t afterSeq) {
+        Assert(notifier);
+        notifier->_cursor = _since(afterSeq);
+        insertNotifier(notifier);
     }
 
-    void SequenceTracker::removePlaceholder(const_iterator placeholder) {
-        _changes.erase(placeholder);
-        --_numPlaceholders;
-        removeObsoleteEntries();
+
+    // Inserts a notifier into `_notifiers`, after any others with the same cursor.
+    void SequenceTracker::insertNotifier(DatabaseChangeNotifier *notifier) {
+        auto i = upper_bound(_notifiers.begin(), _notifiers.end(), notifier->_cursor,
+                             [](position cursor, DatabaseChangeNotifier *n) {
+                                 return cursor < n->_cursor;
+                             });
+        _notifiers.insert(i, notifier);
     }
 
 
-    bool SequenceTracker::hasChangesAfterPlaceholder(const_iterator placeholder) const {
-        for (auto i = next(placeholder); i != _changes.end(); ++i) {
-            if (!i->isPlaceholder())
-                return true;
-        }
-        return false;
+    void SequenceTracker::removeNotifier(DatabaseChangeNotifier *notifier) {
+        auto i = find(_notifiers.begin(), _notifiers.end(), notifier);
+        Assert(i != _notifiers.end());
+        _notifiers.erase(i);
+        removeObsoleteEntries();
     }
 
 
-    size_t SequenceTracker::readChanges(const_iterator placeholder,
-                                        Change changes[], size_t maxChanges,
-                                        bool &external)
-    {
-        external = false;
+    SequenceTracker::ChangeSpan
+    SequenceTracker::readChanges(DatabaseChangeNotifier *notifier, size_t maxChanges) {
+        position begin = notifier->_cursor, end = begin;
         size_t n = 0;
-        auto i = next(placeholder);
-        while (i != _changes.end() && n < maxChanges) {
-            if (!i->isPlaceholder()) {
-                if (n == 0)
-                    external = i->external;
-                else if (i->external != external)
-                    break;
-                if (changes)
-                    changes[n++] = Change{i->docID, i->revID, i->sequence, i->bodySize};
-            }
-            ++i;
+        bool external = false;
+        for (position pos = begin; pos < _endPos && n < maxChanges; ++pos) {
+            const Entry &entry = entryAt(pos);
+            if (!entry.isLive())
+                continue;
+            if (n == 0)
+                external = entry.external;
+            else if (entry.external != external)
+                break;
+            ++n;
+            end = pos + 1;
         }
         if (n > 0) {
-            _changes.splice(i, _changes, placeholder);
-            removeObsoleteEntries();
+            // Move the cursor past the changes, keeping `_notifiers` in order. (Old Entries
+            // aren't removed here, since the returned span points to them.)
+            _notifiers.erase(find(_notifiers.begin(), _notifiers.end(), notifier));
+            notifier->_cursor = end;
+            insertNotifier(notifier);
         }
-        return n;
-   }
+        return ChangeSpan(this, begin, end, n, external);
+    }
+
+
+    // Removes the first Entry in the ring.
+    void SequenceTracker::popFront() {
+        Entry &entry = entryAt(_firstPos);
+        DocInfo *doc = entry.doc;
+        entry = Entry();
+        ++_firstPos;
+        if (doc) {
+            --_liveCount;
+            if (doc->documentObservers.empty()) {
+                // Remove the DocInfo entirely if it has no observers
+                _docs.erase(doc->docID);
+            } else {
+                // Otherwise it becomes idle
+                doc->pos = kNoPosition;
+            }
+        }
+    }
 
 
     void SequenceTracker::removeObsoleteEntries() {
         if (inTransaction())
             return;
-        // Any changes before the first placeholder aren't going to be seen, so remove them:
+        // Any changes before the first cursor aren't going to be seen, so remove them:
+        position minCursor = _notifiers.empty() ? _endPos : _notifiers.front()->_cursor;
         size_t nRemoved = 0;
-        while (_changes.size() > kMinChangesToKeep + _numPlaceholders
-                    && !_changes.front().isPlaceholder()) {
-            auto &entry = _changes.front();
-            if (entry.documentObservers.empty()) {
-                // Remove entry entirely if it has no observers
-                _byDocID.erase(entry.docID);
-                _changes.erase(_changes.begin());
-            } else {
-                // Move entry to idle list if it has observers
-                _idle.splice(_idle.end(), _changes, _changes.begin());
-                entry.idle = true;
-            }
+        while (_firstPos < minCursor
+                    && (_liveCount > kMinChangesToKeep || !entryAt(_firstPos).isLive())) {
+            popFront();
             ++nRemoved;
         }
-        logVerbose("Removed %zu old entries (%zu left; idle has %zd, byDocID has %zu)",
-                   nRemoved, _changes.size(), _idle.size(), _byDocID.size());
+        logVerbose("Removed %zu old entries (%zu live, %" PRIu64 " in ring; %zu docIDs)",
+                   nRemoved, _liveCount, _endPos - _firstPos, _docs.size());
     }
 
 
-    SequenceTracker::const_iterator
+    SequenceTracker::DocInfo*
     SequenceTracker::addDocChangeNotifier(slice docID, DocChangeNotifier* notifier) {
-        iterator entry;
-        // Find the entry for the document:
-        auto i = _byDocID.find(docID);
-        if (i != _byDocID.end()) {
-            entry = i->second;
+        DocInfo *doc;
+        // Find the DocInfo for the document:
+        auto i = _docs.find(docID);
+        if (i != _docs.end()) {
+            doc = &i->second;
         } else {
-            // Document isn't known yet; create an entry and put it in the _idle list
-            entry = _idle.emplace(_idle.end(), alloc_slice(docID), alloc_slice(), 0, 0);
-            entry->idle = true;
-            _byDocID[entry->docID] = entry;
+            // Document isn't known yet; create an idle DocInfo for it
+            doc = &internDocID(alloc_slice(docID));
         }
-        entry->documentObservers.push_back(notifier);
+        doc->documentObservers.push_back(notifier);
         ++_numDocObservers;
-        return entry;
+        return doc;
     }
 
 
-    void SequenceTracker::removeDocChangeNotifier(const_iterator entry, DocChangeNotifier* notifier) {
-        auto &observers = const_cast<vector<DocChangeNotifier*>&>(entry->documentObservers);
+    void SequenceTracker::removeDocChangeNotifier(DocInfo *doc, DocChangeNotifier* notifier) {
+        auto &observers = doc->documentObservers;
         auto i = find(observers.begin(), observers.end(), notifier);
         Assert(i != observers.end());
         observers.erase(i);
         --_numDocObservers;
-        if (observers.empty() && entry->isIdle()) {
-            _byDocID.erase(entry->docID);
-            Assert(!_idle.empty());
-            _idle.erase(entry);
-        }
+        if (observers.empty() && doc->isIdle())
+            _docs.erase(doc->docID);
     }
 
 
@@ -332,24 +405,38 @@ namespace litecore {
         stringstream s;
         s << "[";
         bool first = true;
-        for (auto i = begin(); i != end(); ++i) {
-            if (first)
-                first = false;
-            else
-                s << ", ";
-            if (!i->isPlaceholder()) {
-                s << (string)i->docID << "@" << i->sequence;
+        auto notifier = _notifiers.begin();
+        // Writes the notifiers whose cursors are at or before `pos`:
+        auto writeNotifiers = [&](position pos) {
+            for (; notifier != _notifiers.end() && (*notifier)->_cursor <= pos; ++notifier) {
+                if (first)
+                    first = false;
+                else
+                    s << ", ";
+                if (*notifier == _transaction.get()) {
+                    s << "(";
+                    first = true;
+                } else {
+                    s << "*";
+                }
+            }
+        };
+        for (position pos = _firstPos; pos < _endPos; ++pos) {
+            writeNotifiers(pos);
+            const Entry &entry = entryAt(pos);
+            if (entry.isLive()) {
+                if (first)
+                    first = false;
+                else
+                    s << ", ";
+                s << (string)entry.docID << "@" << entry.sequence;
                 if (verbose)
-                    s << '#' << i->bodySize;
-                if (i->external)
+                    s << '#' << entry.bodySize;
+                if (entry.external)
                     s << "'";
-            } else if (_transaction && i == _transaction->_placeholder) {
-                s << "(";
-                first = true;
-            } else {
-                s << "*";
             }
         }
+        writeNotifiers(_endPos);
         if (_transaction)
             s << ")";
         s << "]";
@@ -363,15 +450,15 @@ namespace litecore {
 
     DocChangeNotifier::DocChangeNotifier(SequenceTracker &t, slice docID, Callback cb)
     :tracker(t),
-    _docEntry(tracker.addDocChangeNotifier(docID, this)),
-    callback(cb)
+    callback(cb),
+    _doc(tracker.addDocChangeNotifier(docID, this))
     {
         t._logVerbose("Added doc change notifier %p for '%.*s'", this, SPLAT(docID));
     }
 
     DocChangeNotifier::~DocChangeNotifier() {
-        tracker._logVerbose("Removing doc change notifier %p from '%.*s'", this, SPLAT(_docEntry->docID));
-        tracker.removeDocChangeNotifier(_docEntry, this);
+        tracker._logVerbose("Removing doc change notifier %p from '%.*s'", this, SPLAT(_doc->docID));
+        tracker.removeDocChangeNotifier(_doc, this);
     }
 
 
@@ -384,8 +471,8 @@ namespace litecore {
     :Logging(ChangesLog)
     ,tracker(t)
     ,callback(cb)
-    ,_placeholder(tracker.addPlaceholderAfter(this, afterSeq))
     {
+        tracker.addNotifier(this, afterSeq);
         if (callback)
             logInfo("Created, starting after #%" PRIu64, afterSeq);
     }
@@ -394,7 +481,7 @@ namespace litecore {
     DatabaseChangeNotifier::~DatabaseChangeNotifier() {
         if (callback)
             logInfo("Deleting");
-        tracker.removePlaceholder(_placeholder);
+        tracker.removeNotifier(this);
     }
 
 
@@ -406,11 +493,26 @@ namespace litecore {
     }
 
 
-    size_t DatabaseChangeNotifier::readChanges(SequenceTracker::Change changes[],
+    SequenceTracker::ChangeSpan DatabaseChangeNotifier::changes(size_t maxChanges) {
+        auto span = tracker.readChanges(this, maxChanges);
+        logInfo("changes(%zu) -> %zu changes", maxChanges, span.size());
+        return span;
+    }
+
+
+    size_t DatabaseChangeNotifier::readChanges(SequenceTracker::Change outChanges[],
                                                size_t maxChanges,
                                                bool &external) {
-        size_t n = tracker.readChanges(_placeholder, changes, maxChanges, external);
-        logInfo("readChanges(%zu) -> %zu changes", maxChanges, n);
+        auto span = tracker.readChanges(this, maxChanges);
+        size_t n = 0;
+        if (outChanges) {
+            for (auto &entry : span)
+                outChanges[n++] = {entry.doc->docID, entry.revID, entry.sequence, entry.bodySize};
+        }
+        external = span.external();
+        if (!span.empty())
+            tracker.removeObsoleteEntries();
+        logInfo("readChanges(%zu) -> %zu changes", maxChanges, span.size());
         return n;
     }
 
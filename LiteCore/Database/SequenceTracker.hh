@@ -20,7 +20,7 @@
 #include "Base.hh"
 #include "Error.hh"
 #include "Logging.hh"
-#include <list>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <functional>
@@ -42,6 +42,12 @@ namespace litecore {
     class SequenceTracker : public Logging {
     public:
         struct Entry;
+        struct DocInfo;
+        class ChangeSpan;
+
+        /** A position in the ring buffer of Entries. Positions increase monotonically as
+            entries are added, so they also order the changes. */
+        typedef uint64_t position;
 
         SequenceTracker();
 
@@ -60,34 +66,40 @@ namespace litecore {
         /** Copy the other tracker's transaction's changes into myself as committed & external */
         void addExternalTransaction(const SequenceTracker &from);
 
+        /** Copy the changes in my transaction into another tracker's transaction. This collects
+            the changes of transactions that are committed as a group. */
+        void copyTransactionTo(SequenceTracker &group) const;
+
         sequence_t lastSequence() const        {return _lastSequence;}
 
-        /** Tracks a document's current sequence. */
-        struct Entry {
+        /** The interned state of a document that's been changed or is being observed. There is
+            only one per docID, and its address doesn't change, so Entries and DocChangeNotifiers
+            can point to it. */
+        struct DocInfo {
             alloc_slice const               docID;
             sequence_t                      sequence {0};
-
-            // Document entry (when docID != nullslice):
             sequence_t                      committedSequence {0};
-            alloc_slice                     revID;
+            position                        pos;            // Position of its Entry, if any
             std::vector<DocChangeNotifier*> documentObservers;
-            uint32_t                        bodySize;
-            bool                            idle     :1;
-            bool                            external :1;
-
-            // Placeholder entry (when docID == nullslice):
-            DatabaseChangeNotifier* const   databaseObserver {nullptr};
-
-            Entry(const alloc_slice &d, alloc_slice r, sequence_t s, uint32_t bs)
-            :docID(d), revID(r), sequence(s), bodySize(bs), idle(false), external(false) {
-                DebugAssert(docID != nullslice);
-            }
-            Entry(DatabaseChangeNotifier *o)
-            :databaseObserver(o) { }    // placeholder
-
-            bool isPlaceholder() const          {return docID.buf == nullptr;}
-            bool isPurge() const                {return sequence == 0 && !isPlaceholder();}
-            bool isIdle() const                 {return idle && !isPlaceholder();}
+
+            explicit DocInfo(const alloc_slice &d)  :docID(d), pos(kNoPosition) { }
+
+            /** True if the document has no Entry in the ring, only observers. */
+            bool isIdle() const                 {return pos == kNoPosition;}
+        };
+
+        /** A document change, as stored in the ring buffer. When a document changes again, its
+            previous Entry is cleared (made "dead") and a new one is added at the end. */
+        struct Entry {
+            slice           docID;              // Points into doc->docID
+            alloc_slice     revID;
+            sequence_t      sequence {0};
+            uint32_t        bodySize {0};
+            bool            external {false};
+            DocInfo*        doc {nullptr};      // nullptr if the Entry is dead
+
+            bool isLive() const                 {return doc != nullptr;}
+            bool isPurge() const                {return sequence == 0 && isLive();}
         };
 
         struct Change {
@@ -97,6 +109,49 @@ namespace litecore {
             uint32_t bodySize;
         };
 
+        /** A range of the ring buffer returned by DatabaseChangeNotifier::changes(). Iterating it
+            visits the live Entries in order, without copying them. It's only valid until the
+            SequenceTracker is next modified. */
+        class ChangeSpan {
+        public:
+            class iterator {
+            public:
+                const Entry& operator*() const      {return _tracker->entryAt(_pos);}
+                const Entry* operator->() const     {return &_tracker->entryAt(_pos);}
+                iterator& operator++()              {_pos = _tracker->nextLive(_pos + 1, _end);
+                                                     return *this;}
+                bool operator== (const iterator &i) const   {return _pos == i._pos;}
+                bool operator!= (const iterator &i) const   {return _pos != i._pos;}
+            private:
+                friend class ChangeSpan;
+                iterator(const SequenceTracker *t, position pos, position end)
+                :_tracker(t), _pos(pos), _end(end) { }
+
+                const SequenceTracker* _tracker;
+                position _pos, _end;
+            };
+
+            iterator begin() const  {return iterator(_tracker, _tracker->nextLive(_begin, _end), _end);}
+            iterator end() const    {return iterator(_tracker, _end, _end);}
+
+            /** The number of changes. */
+            size_t size() const     {return _count;}
+            bool empty() const      {return _count == 0;}
+
+            /** True if the changes came from another SequenceTracker (all of them do, or none.) */
+            bool external() const   {return _external;}
+
+        private:
+            friend class SequenceTracker;
+            ChangeSpan(const SequenceTracker *t, position b, position e, size_t n, bool ext)
+            :_tracker(t), _begin(b), _end(e), _count(n), _external(ext) { }
+
+            const SequenceTracker* _tracker;
+            position _begin, _end;
+            size_t _count;
+            bool _external;
+        };
+
 #if DEBUG
         /** Writes a string representation for debugging/testing purposes. Format is a list of
             comma-separated entries, inside square brackets. Each entry is either "docid@sequence"
@@ -109,28 +164,31 @@ namespace litecore {
         static size_t kMinChangesToKeep;        // exposed for testing purposes only
 
     protected:
-        typedef std::list<Entry>::const_iterator const_iterator;
+        static constexpr position kNoPosition = UINT64_MAX;
 
         bool inTransaction() const              {return _transaction.get() != nullptr;}
 
         bool hasDBChangeNotifiers() const {
-            return _numPlaceholders - (int)inTransaction() > 0;
+            return _notifiers.size() > (size_t)inTransaction();
         }
 
-        /** Returns the oldest Entry. */
-        const_iterator begin() const            {return _changes.begin();}
+        /** The Entry at a position, which must be in the range [_firstPos, _endPos). */
+        const Entry& entryAt(position pos) const    {return _ring[pos & (_ring.size() - 1)];}
+        Entry& entryAt(position pos)                {return _ring[pos & (_ring.size() - 1)];}
 
-        /** Returns the end of the Entry list. */
-        const_iterator end() const              {return _changes.end();}
+        /** Returns the position of the first live Entry in [pos, end), or `end` if none. */
+        position nextLive(position pos, position end) const {
+            while (pos < end && !entryAt(pos).isLive())
+                ++pos;
+            return pos;
+        }
 
-        const_iterator addPlaceholderAfter(DatabaseChangeNotifier *obs, sequence_t);
-        void removePlaceholder(const_iterator);
-        bool hasChangesAfterPlaceholder(const_iterator) const;
-        size_t readChanges(const_iterator placeholder,
-                           Change changes[], size_t maxChanges,
-                           bool &external);
-        const_iterator addDocChangeNotifier(slice docID, DocChangeNotifier*);
-        void removeDocChangeNotifier(const_iterator, DocChangeNotifier*);
+        void addNotifier(DatabaseChangeNotifier*, sequence_t afterSeq);
+        void removeNotifier(DatabaseChangeNotifier*);
+        bool hasChangesAfter(position cursor) const     {return cursor < _endPos;}
+        ChangeSpan readChanges(DatabaseChangeNotifier*, size_t maxChanges);
+        DocInfo* addDocChangeNotifier(slice docID, DocChangeNotifier*);
+        void removeDocChangeNotifier(DocInfo*, DocChangeNotifier*);
         void removeObsoleteEntries();
 
     private:
@@ -142,15 +200,25 @@ namespace litecore {
                               const alloc_slice &revID,
                               sequence_t sequence,
                               uint64_t bodySize);
-        const_iterator _since(sequence_t s) const;
-
-        typedef std::list<Entry>::iterator iterator;
-
-        std::list<Entry>                        _changes;
-        std::list<Entry>                        _idle;
-        std::unordered_map<slice, iterator, fleece::sliceHash> _byDocID;
+        position _since(sequence_t s) const;
+        DocInfo& internDocID(const alloc_slice &docID);
+        void killEntry(DocInfo&);
+        void appendEntry(DocInfo&, const alloc_slice &revID, sequence_t, uint32_t bodySize);
+        void growRing();
+        void insertNotifier(DatabaseChangeNotifier*);
+        void popFront();
+
+        // The ring buffer holds the Entries at positions [_firstPos, _endPos). The last Entry
+        // is always live. Its capacity is a power of 2.
+        std::vector<Entry>                      _ring;
+        position                                _firstPos {0};
+        position                                _endPos {0};
+        size_t                                  _liveCount {0};
+        std::unordered_map<slice, DocInfo, fleece::sliceHash> _docs;  // Interned docIDs
+        // Database notifiers, in order of their cursors:
+        std::vector<DatabaseChangeNotifier*>    _notifiers;
+        std::vector<DatabaseChangeNotifier*>    _notifying;     // Scratch space for notifying
         sequence_t                              _lastSequence {0};
-        size_t                                  _numPlaceholders {0};
         size_t                                  _numDocObservers {0};
         std::unique_ptr<DatabaseChangeNotifier> _transaction;
         sequence_t                              _preTransactionLastSequence;
@@ -168,17 +236,17 @@ namespace litecore {
         SequenceTracker &tracker;
         Callback const callback;
 
-        slice docID() const             {return _docEntry->docID;}
-        sequence_t sequence() const     {return _docEntry->sequence;}
+        slice docID() const             {return _doc->docID;}
+        sequence_t sequence() const     {return _doc->sequence;}
 
     protected:
-        void notify(const SequenceTracker::Entry* entry) {
-            if (callback) callback(*this, entry->docID, entry->sequence);
+        void notify(const SequenceTracker::DocInfo &doc) {
+            if (callback) callback(*this, doc.docID, doc.sequence);
         }
 
     private:
         friend class SequenceTracker;
-        SequenceTracker::const_iterator const _docEntry;
+        SequenceTracker::DocInfo* const _doc;
     };
 
 
@@ -186,7 +254,7 @@ namespace litecore {
     class DatabaseChangeNotifier : public Logging {
     public:
         /** A callback that will be invoked _once_ when new changes arrive. After that, calling
-            `readChanges` will reset the state so the callback can be called again. */
+            `changes` or `readChanges` will reset the state so the callback can be called again. */
         typedef std::function<void(DatabaseChangeNotifier&)> Callback;
 
         DatabaseChangeNotifier(SequenceTracker&, Callback, sequence_t afterSeq =UINT64_MAX);
@@ -196,14 +264,20 @@ namespace litecore {
         SequenceTracker &tracker;
         Callback const callback;
 
-        /** Returns true if there are new changes, i.e. if `changes` would return a non-empty vector. */
+        /** Returns true if there are new changes, i.e. if `changes` would return a non-empty span. */
         bool hasChanges() const {
-            return tracker.hasChangesAfterPlaceholder(_placeholder);
+            return tracker.hasChangesAfter(_cursor);
         }
 
-        /** Returns changes that have occurred since the last call to `changes` (or since
-            construction.) Resets the callback state so it can be called again. */
-        size_t readChanges(SequenceTracker::Change changes[], size_t maxChanges, bool &external);
+        /** Returns changes that have occurred since the last call to `changes` or `readChanges`
+            (or since construction), up to `maxChanges` of them. They're all either external or
+            not. Resets the callback state so it can be called again.
+            The span points into the SequenceTracker, so it's only valid until the tracker is
+            next modified. */
+        SequenceTracker::ChangeSpan changes(size_t maxChanges);
+
+        /** Like `changes`, but copies the changes into an array. */
+        size_t readChanges(SequenceTracker::Change outChanges[], size_t maxChanges, bool &external);
 
     protected:
         void notify();
@@ -211,7 +285,8 @@ namespace litecore {
     private:
         friend class SequenceTracker;
 
-        SequenceTracker::const_iterator const _placeholder;
+        // Position in the ring after the last change read (or skipped):
+        SequenceTracker::position _cursor {0};
     };
 
 }
@@ -62,6 +62,7 @@ namespace c4Internal {
         :Document(other)
         ,_versionedDoc(other._versionedDoc)
         ,_selectedRev(nullptr)
+        ,_selectedRevIsLazy(other._selectedRevIsLazy)
         {
             if (other._selectedRev)
                 _selectedRev = _versionedDoc[other._selectedRev->revID];
@@ -100,13 +101,15 @@ namespace c4Internal {
         void loadRevisions() override {
             if (!_versionedDoc.revsAvailable()) {
                 _versionedDoc.read();
-                selectRevision(_versionedDoc.currentRevision());
+                selectCurrentRevision();
             }
         }
 
         bool hasRevisionBody() noexcept override {
             if (!revisionsLoaded())
                 Warn("c4doc_hasRevisionBody called on doc loaded without kC4IncludeBodies");
+            if (_selectedRevIsLazy)
+                return selectedRev.body.buf != nullptr;
             return _selectedRev && _selectedRev->isBodyAvailable();
         }
 
@@ -117,6 +120,7 @@ namespace c4Internal {
 
         bool selectRevision(const Rev *rev) noexcept {   // doesn't throw
             _selectedRev = rev;
+            _selectedRevIsLazy = false;
             if (rev) {
                 _selectedRevIDBuf = rev->revID.expanded();
                 selectedRev.revID = _selectedRevIDBuf;
@@ -130,12 +134,45 @@ namespace c4Internal {
             }
         }
 
+        // Selects a revision read from the rev tree without decoding it into Revs. The Rev is
+        // looked up later, if needed, by `selectedRevision`.
+        void selectRevision(const RevInfo &info) {
+            _selectedRev = nullptr;
+            _selectedRevIsLazy = true;
+            _selectedRevIDBuf = info.revID.expanded();
+            selectedRev.revID = _selectedRevIDBuf;
+            selectedRev.flags = (C4RevisionFlags)info.flags;
+            selectedRev.sequence = info.sequence;
+            selectedRev.body = info.body;
+        }
+
+        // Returns the selected Rev, decoding the rev tree if it hasn't been yet.
+        const Rev* selectedRevision() {
+            if (_selectedRevIsLazy) {
+                _selectedRev = _versionedDoc[revidBuffer(_selectedRevIDBuf)];
+                _selectedRevIsLazy = false;
+            }
+            return _selectedRev;
+        }
+
         bool selectRevision(C4Slice revID, bool withBody) override {
             if (revID.buf) {
                 loadRevisions();
-                const Rev *rev = _versionedDoc[revidBuffer(revID)];
-                if (!selectRevision(rev))
-                    return false;
+                if (!_versionedDoc.isDecoded()) {
+                    // Look up the revision without decoding the tree. Its RevInfo points to its
+                    // body in the record, which loadRevisions has read, so it's available as
+                    // with a decoded Rev:
+                    RevInfo info;
+                    if (!_versionedDoc.revisionInfo(revidBuffer(revID), info)) {
+                        selectRevision(nullptr);
+                        return false;
+                    }
+                    selectRevision(info);
+                } else {
+                    const Rev *rev = _versionedDoc[revidBuffer(revID)];
+                    if (!selectRevision(rev))
+                        return false;
+                }
                 if (withBody)
                     loadSelectedRevBody();
             } else {
@@ -146,10 +183,20 @@ namespace c4Internal {
 
         bool selectCurrentRevision() noexcept override { // doesn't throw
             if (_versionedDoc.revsAvailable()) {
-                selectRevision(_versionedDoc.currentRevision());
+                if (_versionedDoc.isDecoded()) {
+                    selectRevision(_versionedDoc.currentRevision());
+                } else {
+                    // Read the current revision in place, so plain reads don't decode the tree:
+                    RevInfo info;
+                    if (_versionedDoc.currentRevisionInfo(info))
+                        selectRevision(info);
+                    else
+                        selectRevision(nullptr);
+                }
                 return true;
             } else {
                 _selectedRev = nullptr;
+                _selectedRevIsLazy = false;
                 Document::selectCurrentRevision();
                 return false;
             }
@@ -158,6 +205,16 @@ namespace c4Internal {
         bool selectParentRevision() noexcept override {
             if (!revisionsLoaded())
                 Warn("Trying to access revision tree of doc loaded without kC4IncludeBodies");
+            if (_selectedRevIsLazy) {
+                // Walk the history without decoding the tree:
+                RevInfo info;
+                if (_versionedDoc.parentRevisionInfo(revidBuffer(_selectedRevIDBuf), info)) {
+                    selectRevision(info);
+                    return true;
+                }
+                selectRevision(nullptr);
+                return false;
+            }
             if (_selectedRev)
                 selectRevision(_selectedRev->parent);
             return _selectedRev != nullptr;
@@ -166,7 +223,7 @@ namespace c4Internal {
         bool selectNextRevision() noexcept override {    // does not throw
             if (!revisionsLoaded())
                 Warn("Trying to access revision tree of doc loaded without kC4IncludeBodies");
-            if (_selectedRev)
+            if (selectedRevision())
                 selectRevision(_selectedRev->next());
             return _selectedRev != nullptr;
         }
@@ -174,7 +231,7 @@ namespace c4Internal {
         bool selectNextLeafRevision(bool includeDeleted) noexcept override {
             if (!revisionsLoaded())
                 Warn("Trying to access revision tree of doc loaded without kC4IncludeBodies");
-            auto rev = _selectedRev;
+            auto rev = selectedRevision();
             if (!rev)
                 return false;
             do {
@@ -206,12 +263,14 @@ namespace c4Internal {
         }
 
         alloc_slice remoteAncestorRevID(C4RemoteID remote) override {
-            auto rev = _versionedDoc.latestRevisionOnRemote(remote);
-            return rev ? rev->revID.expanded() : alloc_slice();
+            RevInfo info;
+            if (!_versionedDoc.latestRevisionInfoOnRemote(remote, info))
+                return alloc_slice();
+            return info.revID.expanded();
         }
 
         void setRemoteAncestorRevID(C4RemoteID remote) override {
-            _versionedDoc.setLatestRevisionOnRemote(remote, _selectedRev);
+            _versionedDoc.setLatestRevisionOnRemote(remote, selectedRevision());
         }
 
         void updateFlags() {
@@ -220,7 +279,7 @@ namespace c4Internal {
         }
 
         bool removeSelectedRevBody() noexcept override {
-            if (!_selectedRev)
+            if (!selectedRevision())
                 return false;
             _versionedDoc.removeBody(_selectedRev);
             return true;
@@ -230,12 +289,16 @@ namespace c4Internal {
             return _versionedDoc.fleeceDocFor(selectedRev.body);
         }
 
-        bool save(unsigned maxRevTreeDepth =0) override {
-            requireValidDocID();
+        void pruneRevisions(unsigned maxRevTreeDepth) {
             if (maxRevTreeDepth > 0)
                 _versionedDoc.prune(maxRevTreeDepth);
             else
                 _versionedDoc.prune();
+        }
+
+        bool save(unsigned maxRevTreeDepth =0) override {
+            requireValidDocID();
+            pruneRevisions(maxRevTreeDepth);
             switch (_versionedDoc.save(_db->transaction())) {
                 case litecore::VersionedDocument::kConflict:
                     return false;
@@ -255,6 +318,25 @@ namespace c4Internal {
             }
         }
 
+        alloc_slice prepareSave(KeyStore::SetRequest &outWrite,
+                                unsigned maxRevTreeDepth =0) override
+        {
+            requireValidDocID();
+            pruneRevisions(maxRevTreeDepth);
+            alloc_slice body = _versionedDoc.encodeForSave();
+            auto &rec = _versionedDoc.record();
+            outWrite = {rec.key(), rec.version(), body, rec.flags()};
+            return body;
+        }
+
+        void savedAs(sequence_t seq) override {
+            _versionedDoc.savedAs(seq);
+            selectedRev.flags &= ~kRevNew;
+            sequence = seq;
+            if (selectedRev.sequence == 0)
+                selectedRev.sequence = seq;
+        }
+
         int32_t purgeRevision(C4Slice revID) override {
             int32_t total;
             if (revID.buf)
@@ -484,7 +566,7 @@ namespace c4Internal {
             auto newRev = _versionedDoc.insert(encodedNewRevID,
                                                body,
                                                (Rev::Flags)rq.revFlags,
-                                               _selectedRev,
+                                               selectedRevision(),
                                                rq.allowConflict,
                                                false,
                                                httpStatus);
@@ -543,6 +625,7 @@ namespace c4Internal {
     private:
         VersionedDocument _versionedDoc;
         const Rev *_selectedRev;
+        bool _selectedRevIsLazy {false};    // Selected rev was read without decoding the tree
     };
 
 
@@ -569,6 +652,18 @@ namespace c4Internal {
         return revID.hasPrefix(slice("1-", 2));
     }
 
+    alloc_slice TreeDocumentFactory::remoteAncestorRevID(const Record &rec, C4RemoteID remote) {
+        // If the doc's flagged as synced, its current revision is on the default remote, as in
+        // VersionedDocument::didDecodeLazily:
+        if (remote == RevTree::kDefaultRemoteID && (rec.flags() & DocumentFlags::kSynced))
+            return revIDFromVersion(rec.version());
+        // Otherwise look it up in the raw tree, which doesn't need to decode it:
+        RevInfo info;
+        if (!rec.body() || !RawRevision::getLatestRevOnRemote(rec.body(), remote, rec.sequence(), info))
+            return alloc_slice();
+        return info.revID.expanded();
+    }
+
     Document* TreeDocumentFactory::treeDocumentContaining(const Value *value) {
         VersionedDocument *vdoc = VersionedDocument::containing(value);
         return vdoc ? (TreeDocument*)vdoc->owner : nullptr;
@@ -593,13 +688,13 @@ namespace c4Internal {
             revidBuffer revID;
             revID.parse(revMap[docID]);
 
-            RevTree tree(docBody, 0);
-
-            // Does it exist in the doc?
-            if (tree[revID]) {
+            // Does it exist in the doc? (Checking doesn't need to decode the tree)
+            RevInfo info;
+            if (RawRevision::findRev(docBody, revID, 0, info)) {
                 if (remoteDBID) {
-                    const Rev *curRemoteRev = tree.latestRevisionOnRemote(remoteDBID);
-                    if (curRemoteRev && curRemoteRev->revID != revID) {
+                    RevInfo curRemoteRev;
+                    if (RawRevision::getLatestRevOnRemote(docBody, remoteDBID, 0, curRemoteRev)
+                            && curRemoteRev.revID != revID) {
                         return alloc_slice(kC4AncestorExistsButNotCurrent);
                     }
                 }
@@ -608,6 +703,7 @@ namespace c4Internal {
             }
 
             // Find revs that could be ancestors of it and write them as a JSON array:
+            RevTree tree(docBody, 0);
             result.str("");
             result << '[';
             auto generation = revID.generation();
@@ -31,6 +31,7 @@ namespace c4Internal {
         Retained<Document> newLeafDocumentInstance(C4Slice docID, C4Slice revID, bool withBody) override;
         alloc_slice revIDFromVersion(slice version) override;
         bool isFirstGenRevID(slice revID) override;
+        alloc_slice remoteAncestorRevID(const Record&, C4RemoteID) override;
         static slice fleeceAccessor(slice docBody);
 
         std::vector<alloc_slice> findAncestors(const std::vector<slice> &docIDs, const std::vector<slice> &revIDs,
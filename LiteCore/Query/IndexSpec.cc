@@ -69,5 +69,36 @@ namespace litecore {
         return nullptr;
     }
 
+    const Array* IndexSpec::groupBy() const {
+        if (auto dict = doc()->asDict(); dict) {
+            if (auto groupByVal = qp::getCaseInsensitive(dict, "GROUP_BY"); groupByVal)
+                return qp::requiredArray(groupByVal, "Index GROUP_BY term");
+        }
+        return nullptr;
+    }
+
+    const Array* IndexSpec::include() const {
+        if (!expressionJSON)
+            return nullptr;     // (indexes found without the 'indexes' table have no JSON)
+        if (auto dict = doc()->asDict(); dict) {
+            if (auto includeVal = qp::getCaseInsensitive(dict, "INCLUDE"); includeVal)
+                return qp::requiredArray(includeVal, "Index INCLUDE term");
+        }
+        return nullptr;
+    }
+
+    std::vector<std::string> IndexSpec::includedProperties() const {
+        std::vector<std::string> properties;
+        for (Array::iterator i(include()); i; ++i) {
+            // Like the WHAT clause of a query, accept either a property string or expression:
+            Path path = (i.value()->type() == kString) ? Path(i.value()->asString())
+                                                       : qp::propertyFromNode(i.value());
+            if (path.empty())
+                error::_throw(error::InvalidQuery, "Index INCLUDE items must be properties");
+            properties.push_back(std::string(path));
+        }
+        return properties;
+    }
+
 
 }
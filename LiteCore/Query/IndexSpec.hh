@@ -22,6 +22,7 @@
 #include "Doc.hh"
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace litecore {
 
@@ -31,6 +32,7 @@ namespace litecore {
             kFullText,      ///< Full-text index, for MATCH queries
             kArray,         ///< Index of array values, for UNNEST queries
             kPredictive,    ///< Index of prediction results
+            kAggregate,     ///< Table of aggregate values, for GROUP BY queries
         };
 
         struct Options {
@@ -38,6 +40,9 @@ namespace litecore {
             bool ignoreDiacritics;  ///< True to strip diacritical marks/accents from letters
             bool disableStemming;   ///< Disables stemming
             const char* stopWords;  ///< NULL for default, or comma-delimited string, or empty
+            /// Called while a full-text index is populated in chunks, with the fraction done:
+            void (*progressCallback)(void *context, double fractionDone);
+            void* progressContext;  ///< Passed to progressCallback
         };
 
         IndexSpec(std::string name_,
@@ -54,7 +59,8 @@ namespace litecore {
         void validateName() const;
 
         const char* typeName() const {
-            static const char* kTypeName[] = {"value", "full-text", "array", "predictive"};
+            static const char* kTypeName[] = {"value", "full-text", "array", "predictive",
+                                             "aggregate"};
             return kTypeName[type];
         }
 
@@ -66,6 +72,18 @@ namespace litecore {
         /** The optional WHERE clause: the condition for a partial index */
         const fleece::impl::Array* where() const;
 
+        /** The GROUP_BY clause of an aggregate index: the expressions whose distinct values
+            define the groups. Null for other types of index. */
+        const fleece::impl::Array* groupBy() const;
+
+        /** The optional INCLUDE clause of a value index: extra properties whose values are
+            stored along with the index, so queries can return them without reading the docs. */
+        const fleece::impl::Array* include() const;
+
+        /** The paths of the properties in the INCLUDE clause, in order. Throws if an item
+            isn't a property. */
+        std::vector<std::string> includedProperties() const;
+
         std::string const            name;
         Type        const            type;
         alloc_slice const            expressionJSON;
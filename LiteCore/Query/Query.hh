@@ -67,7 +67,8 @@ namespace litecore {
             Options() { }
             
             Options(const Options &o)
-            :paramBindings(o.paramBindings), afterSequence(o.afterSequence) { }
+            :paramBindings(o.paramBindings), afterSequence(o.afterSequence)
+            ,streaming(o.streaming) { }
 
             template <class T>
             Options(T bindings, sequence_t afterSeq =0, uint64_t withPurgeCount =0)
@@ -83,6 +84,7 @@ namespace litecore {
             alloc_slice const paramBindings;
             sequence_t const  afterSequence {0};
             uint64_t const purgeCount {0};
+            bool streaming {false};         ///< Step through rows lazily instead of collecting them
         };
 
         virtual QueryEnumerator* createEnumerator(const Options* =nullptr) =0;
@@ -127,6 +129,9 @@ namespace litecore {
 
         virtual bool obsoletedBy(const QueryEnumerator*) =0;
 
+        /** Returns a new enumerator over the same results, with its own position. */
+        virtual QueryEnumerator* clone() {error::_throw(error::UnsupportedOperation);}
+
     protected:
         QueryEnumerator(const Query::Options *options, sequence_t lastSeq, uint64_t purgeCount)
         :_options(options ? *options : Query::Options{})
@@ -166,11 +166,18 @@ namespace litecore {
         _variables.clear();
         _ftsTables.clear();
         _indexJoinTables.clear();
+        _coveringTables.clear();
+        _coveringJoinTables.clear();
+        _indexableProperties.clear();
+        _recordingIndexable = _writingUnnest = false;
+        _aggregateColumns.clear();
         _aliases.clear();
         _dbAlias.clear();
         _columnTitles.clear();
         _1stCustomResultCol = 0;
         _isAggregateQuery = _aggregatesOK = _propertiesUseSourcePrefix = _checkedExpiration = false;
+        _usesSubquery = _isIncremental = _hasOrderBy = _hasLimit = false;
+        _whatPos = _whereEndPos = 0;
 
         _aliases.insert({_dbAlias, kDBAlias});
     }
@@ -231,6 +238,10 @@ namespace litecore {
 
 
     void QueryParser::writeSelect(const Value *where, const Dict *operands) {
+        // An aggregate index may be able to answer the query without reading any documents:
+        if (writeAggregateIndexSelect(where, operands))
+            return;
+
         // Find all the joins in the FROM clause first, to populate alias info. This has to be done
         // before writing the WHAT clause, because that will depend on the aliases.
         auto from = getCaseInsensitive(operands, "FROM"_sl);
@@ -246,6 +257,10 @@ namespace litecore {
         // Add the indexed prediction() calls to _indexJoinTables now
         findPredictionCalls(operands);
 
+        // Covering indexes may store the values of properties returned by the WHAT clause:
+        if (getCaseInsensitive(operands, "WHAT"_sl))
+            _coveringTables = _delegate.coveringTables();
+
         _sql << "SELECT ";
 
         // DISTINCT:
@@ -272,11 +287,15 @@ namespace litecore {
             _columnTitles.push_back(string(kSequenceProperty));
         }
 
+        // Properties used from here on affect which documents are found, or their order:
+        _recordingIndexable = true;
+
         // FROM clause:
         writeFromClause(from);
 
         // WHERE clause:
         writeWhereClause(where);
+        _whereEndPos = size_t(_sql.tellp());
 
         // GROUP_BY clause:
         bool grouped = (writeSelectListClause(operands, "GROUP_BY"_sl, " GROUP BY ") > 0);
@@ -312,14 +331,46 @@ namespace litecore {
         }
 
         // ORDER_BY clause:
-        writeSelectListClause(operands, "ORDER_BY"_sl, " ORDER BY ", true);
+        _hasOrderBy = writeSelectListClause(operands, "ORDER_BY"_sl, " ORDER BY ", true) > 0;
 
         // LIMIT, OFFSET clauses:
-        if (!writeOrderOrLimitClause(operands, "LIMIT"_sl,  "LIMIT")) {
+        _hasLimit = writeOrderOrLimitClause(operands, "LIMIT"_sl,  "LIMIT");
+        if (!_hasLimit) {
             if (getCaseInsensitive(operands, "OFFSET"_sl))
                 _sql << " LIMIT -1";            // SQL does not allow OFFSET without LIMIT
         }
-        writeOrderOrLimitClause(operands, "OFFSET"_sl, "OFFSET");
+        _recordingIndexable = false;
+        bool hasOffset = writeOrderOrLimitClause(operands, "OFFSET"_sl, "OFFSET");
+
+        _isIncremental = !_isAggregateQuery && !hasOffset && !_usesSubquery
+                      && _ftsTables.empty() && _indexJoinTables.empty()
+                      && none_of(_aliases.begin(), _aliases.end(), [](auto &alias) {
+                             return alias.second != kDBAlias && alias.second != kResultAlias;
+                         });
+        if (_isIncremental)
+            _whatPos = size_t(startPosOfWhat);
+    }
+
+
+    string QueryParser::incrementalSQL(IncrementalScope scope) const {
+        Assert(_isIncremental);
+        string sql = _sql.str();
+        string prefix = quoteTableName(_dbAlias) + ".";
+        string result = sql.substr(0, _whatPos) + prefix + "key, "
+                      + sql.substr(_whatPos, _whereEndPos - _whatPos);
+        switch (scope) {
+            case IncrementalScope::kAllDocs:
+                result += sql.substr(_whereEndPos);
+                break;
+            case IncrementalScope::kChangedDocs:
+                result += " AND " + prefix + "sequence > :since";
+                break;
+            case IncrementalScope::kCandidateDocs:
+                result += " AND (" + prefix + "sequence > :since OR " + prefix + "key IN "
+                          "(SELECT value FROM fl_each(:docIDs)))" + sql.substr(_whereEndPos);
+                break;
+        }
+        return result;
     }
 
 
@@ -410,6 +461,162 @@ namespace litecore {
     }
 
 
+#pragma mark - AGGREGATE INDEXES:
+
+
+    // Returns a canonical JSON form of an expression, for comparing expressions: operator and
+    // function names are lowercased. If `stringIsProperty` is true, a string is a property path,
+    // as in a WHAT clause.
+    static string canonicalExpression(const Value *expr, bool stringIsProperty =false) {
+        if (!expr)
+            return "";
+        if (stringIsProperty && expr->type() == kString) {
+            string json = expr->toJSONString();
+            if (!expr->asString().hasPrefix('.'))
+                json.insert(1, ".");
+            return "[" + json + "]";
+        }
+        const Array *array = expr->asArray();
+        if (!array)
+            return expr->toJSONString();
+        string result = "[";
+        for (Array::iterator i(array); i; ++i) {
+            if (result.size() > 1)
+                result += ",";
+            slice op = i.value()->asString();
+            if (result.size() == 1 && op && !op.hasPrefix('.') && !op.hasPrefix('$')
+                                         && !op.hasPrefix('?'))
+                result += lowercase(i.value()->toJSONString());
+            else
+                result += canonicalExpression(i.value());
+        }
+        return result + "]";
+    }
+
+
+    /*static*/ string QueryParser::aggregateIndexFunction(const Value *item, const Value* &outArg) {
+        const Array *call = item->asArray();
+        slice op = (call && !call->empty()) ? call->get(0)->asString() : nullslice;
+        if (op.hasSuffix("()"_sl)) {
+            string fn = lowercase(op.asString().substr(0, op.size - 2));
+            unsigned nArgs = call->count() - 1;
+            if ((fn == "count" && nArgs <= 1) || ((fn == "sum" || fn == "avg" || fn == "min"
+                                                   || fn == "max") && nArgs == 1)) {
+                outArg = (nArgs > 0) ? call->get(1) : nullptr;
+                return fn;
+            }
+        }
+        fail("Aggregate index WHAT items must be calls to COUNT(), SUM(), AVG(), MIN() or MAX()");
+    }
+
+
+    // If the delegate has an aggregate index with the same GROUP_BY and WHERE clauses as the
+    // query, and the rest of the query only uses the values it stores, writes a SELECT that
+    // reads from the index's table instead of the documents, and returns true.
+    bool QueryParser::writeAggregateIndexSelect(const Value *where, const Dict *operands) {
+        auto groupBy = getCaseInsensitive(operands, "GROUP_BY"_sl);
+        if (!groupBy || getCaseInsensitive(operands, "FROM"_sl))
+            return false;
+        auto distinct = getCaseInsensitive(operands, "DISTINCT"_sl);
+        if (distinct && distinct->asBool())
+            return false;
+
+        for (auto &table : _delegate.aggregateTables()) {
+            Retained<Doc> spec = Doc::fromJSON(table.specJSON);
+            const Dict *specDict = spec->asDict();
+            if (!specDict)
+                continue;
+            if (canonicalExpression(getCaseInsensitive(specDict, "GROUP_BY"_sl))
+                        != canonicalExpression(groupBy)
+                    || canonicalExpression(getCaseInsensitive(specDict, "WHERE"_sl))
+                        != canonicalExpression(where))
+                continue;
+            QueryParser qp(this);
+            if (qp.writeAggregateTableSelect(table.tableName,
+                                             getCaseInsensitive(specDict, "GROUP_BY"_sl)->asArray(),
+                                             getCaseInsensitive(specDict, "WHAT"_sl)->asArray(),
+                                             operands)) {
+                _sql << qp.SQL();
+                _columnTitles = qp._columnTitles;
+                _parameters.insert(qp._parameters.begin(), qp._parameters.end());
+                _usesSubquery = qp._usesSubquery;
+                _isAggregateQuery = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    // Writes a SELECT that reads the query's results from an aggregate index's table, where each
+    // row is a group. Returns false if the query uses anything the table doesn't store.
+    bool QueryParser::writeAggregateTableSelect(const string &tableName,
+                                                const Array *groupBy,
+                                                const Array *aggregates,
+                                                const Dict *operands)
+    {
+        reset();
+        // See SQLiteKeyStore+AggregateIndexes.cc for the table's columns:
+        unsigned i = 0;
+        for (Array::iterator key(groupBy); key; ++key, ++i) {
+            _aggregateColumns[canonicalExpression(key.value())] = {format("_agg.k%u", i),
+                                                                   format("_agg.r%u", i)};
+        }
+        i = 0;
+        for (Array::iterator item(aggregates); item; ++item, ++i) {
+            const Value *arg;
+            string fn = aggregateIndexFunction(item.value(), arg), sql;
+            if (fn == "count")
+                sql = arg ? format("_agg.c%u", i) : "_agg.n";
+            else if (fn == "sum")
+                sql = format("(CASE WHEN _agg.c%u > 0 THEN _agg.s%u END)", i, i);
+            else if (fn == "avg")
+                sql = format("(CASE WHEN _agg.c%u > 0 THEN CAST(_agg.s%u AS REAL) / _agg.c%u END)",
+                             i, i, i);
+            else
+                sql = format("_agg.m%u", i);
+            _aggregateColumns[canonicalExpression(item.value())] = {sql, sql};
+        }
+
+        // Aggregate functions aren't allowed, except the ones stored in the table, since they'd be
+        // computed over its rows, i.e. the groups:
+        try {
+            _sql << "SELECT ";
+            if (writeSelectListClause(operands, "WHAT"_sl, "") == 0)
+                return false;
+            _sql << " FROM \"" << tableName << "\" AS _agg";
+            // Each row is a group, so the HAVING clause becomes the WHERE clause:
+            if (auto having = getCaseInsensitive(operands, "HAVING"_sl); having) {
+                _sql << " WHERE ";
+                parseNode(having);
+            }
+            writeSelectListClause(operands, "ORDER_BY"_sl, " ORDER BY ");
+            if (!writeOrderOrLimitClause(operands, "LIMIT"_sl, "LIMIT")) {
+                if (getCaseInsensitive(operands, "OFFSET"_sl))
+                    _sql << " LIMIT -1";
+            }
+            writeOrderOrLimitClause(operands, "OFFSET"_sl, "OFFSET");
+        } catch (const std::exception &x) {
+            LogVerbose(QueryLog, "Can't use aggregate index %s: %s", tableName.c_str(), x.what());
+            return false;
+        }
+        return true;
+    }
+
+
+    // When reading from an aggregate index, if `node` is a grouping expression or aggregate
+    // function that it stores, writes the column holding its value and returns true.
+    bool QueryParser::writeAggregateColumn(const Value *node, bool isResult) {
+        if (_aggregateColumns.empty())
+            return false;
+        auto i = _aggregateColumns.find(canonicalExpression(node, isResult));
+        if (i == _aggregateColumns.end())
+            return false;
+        _sql << (isResult ? i->second.second : i->second.first);
+        return true;
+    }
+
+
 #pragma mark - "FROM" / "JOIN" clauses:
 
 
@@ -482,7 +689,9 @@ namespace litecore {
                     case kUnnestVirtualTableAlias:
                         // UNNEST: Use fl_each() to make a virtual table:
                         _sql << " JOIN ";
+                        _writingUnnest = true;
                         writeEachExpression(unnest);
+                        _writingUnnest = false;
                         _sql << " AS \"" << alias << "\"";
                         break;
                     case kUnnestTableAlias: {
@@ -542,6 +751,12 @@ namespace litecore {
             _sql << " JOIN \"" << table << "\" AS " << alias
                  << " ON " << alias << ".docid = " << quoteTableName(_dbAlias) << ".rowid";
         }
+
+        // Add joins to the tables of covering indexes that supply result columns:
+        for (auto &[table, alias] : _coveringJoinTables) {
+            _sql << " JOIN \"" << table << "\" AS " << alias
+                 << " ON " << alias << ".docid = " << quoteTableName(_dbAlias) << ".rowid";
+        }
     }
 
 
@@ -575,7 +790,8 @@ namespace litecore {
             case kData:
                 fail("Binary data not supported in query");
             case kArray:
-                parseOpNode((const Array*)node);
+                if (!writeAggregateColumn(node, false))
+                    parseOpNode((const Array*)node);
                 break;
             case kDict:
                 writeDictLiteral((const Dict*)node);
@@ -742,12 +958,15 @@ namespace litecore {
 
                 result = expr[1];
                 _sql << kResultFnName << "(";
-                parseCollatableNode(result);
+                if (!writeCoveredProperty(result) && !writeAggregateColumn(result, true))
+                    parseCollatableNode(result);
                 _sql << ") AS \"" << title << '"';
                 addAlias(title, kResultAlias);
             } else {
                 _sql << kResultFnName << "(";
-                if (result->type() == kString) {
+                if (writeCoveredProperty(result) || writeAggregateColumn(result, true)) {
+                    // (value read from a covering or aggregate index)
+                } else if (result->type() == kString) {
                     // Convenience shortcut: interpret a string in a WHAT as a property path
                     writePropertyGetter(kValueFnName, Path(result->asString()));
                 } else {
@@ -1097,6 +1316,9 @@ namespace litecore {
             QueryParser nested(this);
             nested.parse(dict);
             _sql << nested.SQL();
+            _indexableProperties.insert(nested._indexableProperties.begin(),
+                                        nested._indexableProperties.end());
+            _usesSubquery = true;
         }
     }
 
@@ -1352,6 +1574,9 @@ namespace litecore {
             _sql << "fl_nested_value(\"" << iType->first << "\", '" << string(property) << "')";
             return;
         } 
+
+        require(_aggregateColumns.empty(),
+                "property '%s' isn't available from the aggregate index", string(property).c_str());
         
         if (property.size() == 1) {
             // Check if this is a document metadata property:
@@ -1381,6 +1606,13 @@ namespace litecore {
         if (property.empty() && fn == kValueFnName)
             fn = kRootFnName;
 
+        if (_recordingIndexable && !property.empty()) {
+            if (fn == kValueFnName)
+                _indexableProperties.insert({alias, string(property), false});
+            else if (fn == kEachFnName && _writingUnnest)
+                _indexableProperties.insert({alias, string(property), true});
+        }
+
         // Write the function call:
         _sql << fn << "(" << tablePrefix << _bodyColumnName;
         if(!property.empty()) {
@@ -1395,6 +1627,46 @@ namespace litecore {
     }
 
 
+    // If `node` is a property of the main documents whose value a covering index stores,
+    // writes the column of the index's table that holds it, and returns true.
+    // This is only done for result columns, since the stored values have been through
+    // fl_result(), which makes them unsuitable for comparisons.
+    bool QueryParser::writeCoveredProperty(const Value *node) {
+        if (_coveringTables.empty())
+            return false;
+        Path property = (node->type() == kString) ? Path(node->asString())
+                                                  : propertyFromNode(node);
+        if (property.empty() || !property[0].isKey())
+            return false;
+        if (_propertiesUseSourcePrefix) {
+            if (property[0].keyStr() != slice(_dbAlias))
+                return false;
+            property.drop(1);
+            if (property.empty() || !property[0].isKey())
+                return false;
+        } else if (_aliases.find(string(property[0].keyStr())) != _aliases.end()) {
+            return false;       // (it's a result alias)
+        }
+        if (property.size() == 1 && property[0].keyStr().hasPrefix('_'))
+            return false;       // (it may be a metadata property like _id)
+
+        string path(property);
+        for (auto &table : _coveringTables) {
+            auto i = find(table.properties.begin(), table.properties.end(), path);
+            if (i != table.properties.end()) {
+                auto j = _coveringJoinTables.find(table.tableName);
+                if (j == _coveringJoinTables.end()) {
+                    string alias = "cov" + to_string(_coveringJoinTables.size() + 1);
+                    j = _coveringJoinTables.emplace(table.tableName, alias).first;
+                }
+                _sql << j->second << ".c" << (i - table.properties.begin());
+                return true;
+            }
+        }
+        return false;
+    }
+
+
     void QueryParser::writeUnnestPropertyGetter(slice fn, Path &property,
                                                 const string &alias, aliasType type)
     {
@@ -24,6 +24,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 namespace fleece { namespace impl {
@@ -38,6 +39,35 @@ namespace litecore {
 
     class QueryParser {
     public:
+        /** A table in which a covering value index stores the values of its INCLUDE properties,
+            keyed by `docid`. */
+        struct CoveringTable {
+            std::string              tableName;
+            std::vector<std::string> properties;    // Property paths stored in columns c0, c1...
+        };
+
+        /** The table of an aggregate index, with one row per group, and the index's spec. */
+        struct AggregateTable {
+            std::string tableName;
+            alloc_slice specJSON;
+        };
+
+        /** A property of the documents that a query filters, joins, groups or sorts on, or an
+            array it UNNESTs; i.e. one that an index could help find the documents by.
+            (Properties only read by the WHAT clause aren't included.) */
+        struct IndexableProperty {
+            std::string alias;          // Alias of the documents' table in the SQL; may be empty
+            std::string path;           // Property path
+            bool        unnested;       // True if it's an UNNESTed array, else a value
+
+            bool operator< (const IndexableProperty &p) const {
+                return std::tie(alias, path, unnested) < std::tie(p.alias, p.path, p.unnested);
+            }
+            bool operator== (const IndexableProperty &p) const {
+                return std::tie(alias, path, unnested) == std::tie(p.alias, p.path, p.unnested);
+            }
+        };
+
         /** Delegate knows about the naming & existence of tables. */
         class delegate {
         public:
@@ -50,6 +80,8 @@ namespace litecore {
             virtual std::string predictiveTableName(const std::string &property) const =0;
 #endif
             virtual bool tableExists(const std::string &tableName) const =0;
+            virtual std::vector<CoveringTable> coveringTables() const   {return {};}
+            virtual std::vector<AggregateTable> aggregateTables() const {return {};}
         };
 
         QueryParser(const delegate &delegate)
@@ -81,6 +113,29 @@ namespace litecore {
         bool isAggregateQuery() const                               {return _isAggregateQuery;}
         bool usesExpiration() const                                 {return _checkedExpiration;}
 
+        /** The document properties the query filters, joins, groups or sorts on, or UNNESTs,
+            including those of nested SELECTs. */
+        const std::set<IndexableProperty>& indexableProperties() const {return _indexableProperties;}
+
+        /** Documents that an incremental form of the query is restricted to. */
+        enum class IncrementalScope {
+            kAllDocs,           ///< All docs, as in the original query
+            kChangedDocs,       ///< Only docs with sequence > `:since`; no ORDER BY or LIMIT
+            kCandidateDocs,     ///< Changed docs, plus those whose IDs are in Fleece array `:docIDs`
+        };
+
+        /** True if every result row comes from a single document, so that the results can be
+            updated by re-running the query on just the documents that changed. That rules out
+            joins, UNNEST, full-text or indexed-prediction matches, aggregates, DISTINCT,
+            subqueries and OFFSET. */
+        bool isIncremental() const                                  {return _isIncremental;}
+        bool hasOrderBy() const                                     {return _hasOrderBy;}
+        bool hasLimit() const                                       {return _hasLimit;}
+
+        /** For an incremental query, returns its SQL with the docID prepended as an extra
+            result column, and with the WHERE clause restricted as specified. */
+        std::string incrementalSQL(IncrementalScope) const;
+
         std::string expressionSQL(const fleece::impl::Value*);
         std::string whereClauseSQL(const fleece::impl::Value*, string_view dbAlias);
         std::string eachExpressionSQL(const fleece::impl::Value*);
@@ -90,6 +145,12 @@ namespace litecore {
         std::string predictiveIdentifier(const fleece::impl::Value *) const;
         std::string predictiveTableName(const fleece::impl::Value *) const;
 
+        /** Returns the (lowercase) aggregate function called by an item of an aggregate index's
+            WHAT clause -- "count", "sum", "avg", "min" or "max" -- and sets `outArg` to its
+            argument, or to null for `COUNT()`. Throws if it's not a call to one of those. */
+        static std::string aggregateIndexFunction(const fleece::impl::Value *item,
+                                                  const fleece::impl::Value* &outArg);
+
     private:
 
         enum aliasType {
@@ -129,6 +190,13 @@ namespace litecore {
 
         void writeSelect(const fleece::impl::Dict *dict);
         void writeSelect(const fleece::impl::Value *where, const fleece::impl::Dict *operands);
+        bool writeAggregateIndexSelect(const fleece::impl::Value *where,
+                                       const fleece::impl::Dict *operands);
+        bool writeAggregateTableSelect(const std::string &tableName,
+                                       const fleece::impl::Array *groupBy,
+                                       const fleece::impl::Array *aggregates,
+                                       const fleece::impl::Dict *operands);
+        bool writeAggregateColumn(const fleece::impl::Value*, bool isResult);
         unsigned writeSelectListClause(const fleece::impl::Dict *operands, slice key, const char *sql, bool aggregatesOK =false);
 
         void writeWhereClause(const fleece::impl::Value *where);
@@ -181,6 +249,7 @@ namespace litecore {
         void writeArgList(fleece::impl::Array::iterator& operands);
         void writeColumnList(fleece::impl::Array::iterator& operands);
         void writeResultColumn(const fleece::impl::Value*);
+        bool writeCoveredProperty(const fleece::impl::Value*);
         void writeCollation();
         void parseCollatableNode(const fleece::impl::Value*);
         void writeMetaProperty(slice fn, const std::string &tablePrefix, const char *property);
@@ -211,11 +280,23 @@ namespace litecore {
         std::set<std::string> _variables;           // Active variables, inside ANY/EVERY exprs
         std::map<std::string, std::string> _indexJoinTables;  // index table name --> alias
         std::vector<std::string> _ftsTables;        // FTS virtual tables being used
+        std::vector<CoveringTable> _coveringTables; // Tables of covering indexes' properties
+        std::map<std::string, std::string> _coveringJoinTables; // covering table name --> alias
+        std::set<IndexableProperty> _indexableProperties; // See indexableProperties()
+        bool _recordingIndexable {false};           // Add properties to _indexableProperties?
+        bool _writingUnnest {false};                // Writing the array source of an UNNEST?
+        // When reading from an aggregate index: canonical JSON of an expression --> SQL of the
+        // column holding its value, and of the one holding its value for a result column
+        std::map<std::string, std::pair<std::string,std::string>> _aggregateColumns;
         unsigned _1stCustomResultCol {0};           // Index of 1st result after _baseResultColumns
         bool _aggregatesOK {false};                 // Are aggregate fns OK to call?
         bool _isAggregateQuery {false};             // Is this an aggregate query?
         bool _checkedDeleted {false};               // Has query accessed _deleted meta-property?
         bool _checkedExpiration {false};            // Has query accessed _expiration meta-property?
+        bool _usesSubquery {false};                 // Does query contain a nested SELECT?
+        bool _isIncremental {false};                // See isIncremental()
+        bool _hasOrderBy {false}, _hasLimit {false};
+        size_t _whatPos {0}, _whereEndPos {0};      // Offsets in SQL, for incrementalSQL()
         Collation _collation;                       // Collation in use during parse
         bool _collationUsed {true};                 // Emitted SQL "COLLATION" yet?
         bool _functionWantsCollation {false};       // The current function wants to receive collation in its argument list
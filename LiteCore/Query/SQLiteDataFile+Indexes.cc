@@ -76,7 +76,7 @@ namespace litecore {
         stmt.bind(      2, spec.type);
         stmt.bindNoCopy(3, keyStoreName);
         stmt.bindNoCopy(4, (char*)spec.expressionJSON.buf, (int)spec.expressionJSON.size);
-        if (spec.type != IndexSpec::kValue)
+        if (!indexTableName.empty())
             stmt.bindNoCopy(5, indexTableName);
         LogStatement(stmt);
         stmt.exec();
@@ -108,6 +108,12 @@ namespace litecore {
                     same = schemaExistsWithSQL(indexTableName, "table", indexTableName, indexSQL);
                 else
                     same = schemaExistsWithSQL(spec.name, "index", indexTableName, indexSQL);
+                if (same && spec.type == IndexSpec::kValue) {
+                    // The SQL index doesn't reflect the INCLUDE clause, so compare that too:
+                    auto include = spec.include(), existingInclude = existingSpec->include();
+                    same = include ? (existingInclude && include->isEqual(existingInclude))
+                                   : !existingInclude;
+                }
                 if (same)
                     return false;       // This is a duplicate of an existing index; do nothing
             }
@@ -116,7 +122,13 @@ namespace litecore {
         }
         LogTo(QueryLog, "Creating %s index: %s", spec.typeName(), indexSQL.c_str());
         exec(indexSQL);
-        registerIndex(spec, keyStore->name(), indexTableName);
+        if (spec.type == IndexSpec::kValue) {
+            // A value index is on the KeyStore's own table, but a covering one has a table too:
+            registerIndex(spec, keyStore->name(),
+                          spec.include() ? keyStore->coveringTableName(spec.name) : "");
+        } else {
+            registerIndex(spec, keyStore->name(), indexTableName);
+        }
         return true;
     }
 
@@ -136,6 +148,17 @@ namespace litecore {
     }
 
 
+    // True if the table belongs to a registered index; a table can exist without one, while a
+    // FTS index is being populated or after that was interrupted.
+    bool SQLiteDataFile::indexTableIsRegistered(const string &tableName) {
+        if (!indexTableExists())
+            return tableExists(tableName);  // Old-style schema has no registry; the table is it
+        SQLite::Statement stmt(*this, "SELECT 1 FROM indexes WHERE indexTableName=?");
+        stmt.bind(1, tableName);
+        return stmt.executeStep();
+    }
+
+
     // Drops unnested-array tables that no longer have any indexes on them.
     void SQLiteDataFile::garbageCollectIndexTable(const string &tableName) {
         {
@@ -36,26 +36,30 @@ namespace litecore {
     const char* const kFleeceValuePointerType = "FleeceValue";
 
 
-    static slice argAsDocBody(sqlite3_context* ctx, sqlite3_value *arg, bool &copied) {
-        copied = false;
-        auto type = sqlite3_value_type(arg);
-        if (type == SQLITE_NULL)
-            return nullslice;             // No 'body' column; may be deleted doc
-        Assert(type == SQLITE_BLOB);
-        Assert(sqlite3_value_subtype(arg) == 0);
-        slice fleece = fleeceAccessor(ctx, valueAsSlice(arg));
-
+    // Fleece data at odd addresses used to be allowed, and CBL 2.0/2.1 didn't 16-bit-align
+    // revision data, so it could occur. Now that it's not allowed, we have to work around
+    // this by copying the data to an even address. (#589)
+    static slice alignedFleece(slice fleece, alloc_slice &copy) {
         if (size_t(fleece.buf) & 1) {
-            // Fleece data at odd addresses used to be allowed, and CBL 2.0/2.1 didn't 16-bit-align
-            // revision data, so it could occur. Now that it's not allowed, we have to work around
-            // this by copying the data to an even address. (#589)
-            fleece = fleece.copy();
-            copied = true;
+            copy = alloc_slice(fleece);
+            return copy;
         }
         return fleece;
     }
 
 
+    static const Value* fleeceRoot(slice fleece) {
+        if (!fleece)
+            return Dict::kEmpty;             // No current revision body; may be deleted rev
+        const Value *root = Value::fromTrustedData(fleece);
+        if (!root) {
+            Warn("Invalid Fleece data in SQLite table");
+            error::_throw(error::CorruptRevisionData);
+        }
+        return root;
+    }
+
+
     const Value* fleeceParam(sqlite3_context* ctx, sqlite3_value *arg, bool required) noexcept {
         switch (sqlite3_value_type(arg)) {
             case SQLITE_BLOB: {
@@ -125,29 +129,72 @@ namespace litecore {
     }
 
 
-    QueryFleeceScope::QueryFleeceScope(sqlite3_context *ctx, sqlite3_value **argv)
-    :Scope(argAsDocBody(ctx, argv[0], _copied),
-           ((fleeceFuncContext*)sqlite3_user_data(ctx))->sharedKeys)
-    {
-        if (data()) {
-            root = Value::fromTrustedData(data());
+    QueryFleeceScope::QueryFleeceScope(sqlite3_context *ctx, sqlite3_value **argv) {
+        auto funcCtx = (fleeceFuncContext*)sqlite3_user_data(ctx);
+        auto type = sqlite3_value_type(argv[0]);
+        if (type == SQLITE_NULL) {
+            root = Dict::kEmpty;             // No 'body' column; may be deleted doc
+        } else {
+            Assert(type == SQLITE_BLOB);
+            Assert(sqlite3_value_subtype(argv[0]) == 0);
+            slice body = valueAsSlice(argv[0]);
+            root = funcCtx->bodyCache ? funcCtx->bodyCache->root(ctx, body) : nullptr;
             if (!root) {
-                Warn("Invalid Fleece data in SQLite table");
-                error::_throw(error::CorruptRevisionData);
+                slice fleece = alignedFleece(fleeceAccessor(ctx, body), _copy);
+                root = fleeceRoot(fleece);
+                if (fleece)
+                    _scope.emplace(fleece, funcCtx->sharedKeys);
             }
-        } else {
-            root = Dict::kEmpty;             // No current revision body; may be deleted rev
         }
         if (sqlite3_value_type(argv[1]) != SQLITE_NULL)
-        root = evaluatePathFromArg(ctx, argv, 1, root);
+            root = evaluatePathFromArg(ctx, argv, 1, root);
     }
 
 
-    QueryFleeceScope::~QueryFleeceScope() {
-        if (_copied) {
-            unregister();
-            data().free();
+    bool QueryBodyCache::sEnabled = true;
+
+
+    const Value* QueryBodyCache::root(sqlite3_context *ctx, slice body) {
+        if (body.size > kMaxBodySize || !sEnabled)
+            return nullptr;
+        if (!_active) {
+            // Turn back on if another call site (SQLite gives each one its own context) is
+            // passed the same buffer as the last call, i.e. probably the same row's body. This
+            // only compares addresses; if it's wrong, the cache just turns itself off again.
+            bool sameRow = (ctx != _lastCtx && body.buf == _lastBody.buf
+                                            && body.size == _lastBody.size);
+            _lastCtx = ctx;
+            _lastBody = body;
+            if (!sameRow)
+                return nullptr;
+            _active = true;
+            _misses = 0;
+        } else if (_root && body == _body) {
+            _misses = 0;
+            return _root;
+        } else if (++_misses > kMaxMisses) {
+            // Each body has been read only once, so copying them isn't paying off:
+            _active = false;
+            _scope.reset();
+            _copy = _body = nullslice;
+            _root = nullptr;
+            _lastCtx = ctx;
+            _lastBody = body;
+            return nullptr;
         }
+
+        // Replace the cached body. It has to be copied, since SQLite only guarantees the
+        // argument's data for the duration of the call:
+        _scope.reset();
+        _copy = nullslice;
+        _root = nullptr;
+        _body = alloc_slice(body);
+        slice fleece = alignedFleece(fleeceAccessor(ctx, _body), _copy);
+        const Value *root = fleeceRoot(fleece);
+        if (fleece)
+            _scope.emplace(fleece, ((fleeceFuncContext*)sqlite3_user_data(ctx))->sharedKeys);
+        _root = root;
+        return _root;
     }
 
 
@@ -283,6 +330,7 @@ namespace litecore {
 
     void RegisterSQLiteFunctions(sqlite3 *db, fleeceFuncContext context)
     {
+        context.bodyCache = make_shared<QueryBodyCache>();
         registerFunctionSpecs(db, context, kFleeceFunctionsSpec);
         registerFunctionSpecs(db, context, kRankFunctionsSpec);
         registerFunctionSpecs(db, context, kN1QLFunctionsSpec);
@@ -294,6 +342,7 @@ namespace litecore {
         // The functions registered below operate on virtual tables, not on the actual db,
         // so they should not use the db's Fleece accessor. That's why we clear it first.
         context.delegate = nullptr;
+        context.bodyCache = make_shared<QueryBodyCache>();
         registerFunctionSpecs(db, context, kFleeceNullAccessorFunctionsSpec);
     }
 
@@ -21,6 +21,7 @@
 #include "DataFile.hh"
 #include "SQLite_Internal.hh"
 #include "FleeceImpl.hh"
+#include <optional>
 #include <sqlite3.h>
 
 
@@ -43,13 +44,45 @@ namespace litecore {
 
     // Takes a document body from argv[0] and key-path from argv[1].
     // Establishes a scope for the Fleece data, and evaluates the path, setting `root`
-    class QueryFleeceScope : public fleece::impl::Scope {
+    class QueryFleeceScope {
     public:
         QueryFleeceScope(sqlite3_context *ctx, sqlite3_value **argv);
-        ~QueryFleeceScope();
         const fleece::impl::Value *root;
     private:
-        bool _copied;
+        std::optional<fleece::impl::Scope> _scope;  // Used if the body isn't in the cache
+        alloc_slice _copy;                          // Copy of body at an odd address
+    };
+
+
+    // Remembers the last document body the Fleece functions on a connection were called with.
+    // A query usually calls them several times per row on the same body, once per property, so
+    // this saves extracting the Fleece data and registering a Scope for it on every call.
+    // Caching means copying the body, which is wasted when each row's body is read only once,
+    // so the cache turns itself off after a few bodies in a row without a hit, and back on
+    // when a different call site is passed the same body as the last call.
+    class QueryBodyCache {
+    public:
+        // Bodies larger than this aren't cached, to bound the memory held by a connection.
+        static constexpr size_t kMaxBodySize = 256 * 1024;
+
+        // Consecutive bodies read only once, after which the cache turns itself off.
+        static constexpr unsigned kMaxMisses = 4;
+
+        // Can be cleared to disable all caching; only useful for benchmarks.
+        static bool sEnabled;
+
+        // Returns the root of the Fleece data in `body`, or nullptr if it isn't cached.
+        const fleece::impl::Value* root(sqlite3_context*, slice body);
+
+    private:
+        alloc_slice _body;                          // Copy of the cached body
+        alloc_slice _copy;                          // Copy of its Fleece data at an odd address
+        std::optional<fleece::impl::Scope> _scope;  // Scope of the Fleece data
+        const fleece::impl::Value* _root {nullptr};
+        bool _active {true};                        // False while the cache is turned off
+        unsigned _misses {0};                       // Consecutive bodies that weren't hits
+        sqlite3_context* _lastCtx {nullptr};        // Call site of the last call, while off
+        slice _lastBody;                            // Body of the last call, while off (not owned)
     };
 
 
@@ -0,0 +1,226 @@
+//
+// SQLiteIndexAdvisor.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "SQLiteIndexAdvisor.hh"
+#include "SQLiteDataFile.hh"
+#include "SQLiteQueryCache.hh"
+#include "Logging.hh"
+#include "StringUtil.hh"
+#include "SQLiteCpp/SQLiteCpp.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+
+using namespace std;
+using namespace fleece::impl;
+
+namespace litecore {
+
+    static constexpr const char* kSharedObjectKey = "SQLiteIndexAdvisor";
+
+
+    /*static*/ Retained<SQLiteIndexAdvisor> SQLiteIndexAdvisor::forDataFile(SQLiteDataFile &df) {
+        Retained<RefCounted> advisor = df.sharedObject(kSharedObjectKey);
+        if (!advisor)
+            advisor = df.addSharedObject(kSharedObjectKey, new SQLiteIndexAdvisor);
+        return (SQLiteIndexAdvisor*)advisor.get();
+    }
+
+
+    void SQLiteIndexAdvisor::recordRun(const SQLiteQueryPlan &plan,
+                                       uint64_t rowsScanned,
+                                       uint64_t rowsReturned,
+                                       double time)
+    {
+        lock_guard<mutex> lock(_mutex);
+        auto i = _queries.find(plan.sql);
+        if (i == _queries.end()) {
+            if (_queries.size() >= kMaxQueries) {
+                // Make room by forgetting the query that's taken the least time:
+                auto cheapest = min_element(_queries.begin(), _queries.end(),
+                                            [](const auto &a, const auto &b) {
+                                                return a.second.time < b.second.time;
+                                            });
+                _queries.erase(cheapest);
+            }
+            i = _queries.emplace(plan.sql,
+                                 QueryStats{plan.json, plan.indexableProperties}).first;
+        }
+        QueryStats &stats = i->second;
+        ++stats.runs;
+        stats.rowsScanned += rowsScanned;
+        stats.rowsReturned += rowsReturned;
+        stats.time += time;
+    }
+
+
+    optional<SQLiteIndexAdvisor::QueryStats> SQLiteIndexAdvisor::stats(const string &sql) const {
+        lock_guard<mutex> lock(_mutex);
+        auto i = _queries.find(sql);
+        if (i == _queries.end())
+            return nullopt;
+        return i->second;
+    }
+
+
+    void SQLiteIndexAdvisor::reset() {
+        lock_guard<mutex> lock(_mutex);
+        _queries.clear();
+    }
+
+
+#pragma mark - SUGGESTIONS:
+
+
+    // Estimates the time a query would save if its full table scans used an index instead:
+    // the share of its running time spent on scanned rows that it didn't return.
+    static double estimatedBenefit(const SQLiteIndexAdvisor::QueryStats &stats) {
+        if (stats.rowsScanned == 0)
+            return 0;
+        double wasted = 1.0 - min(1.0, double(stats.rowsReturned) / double(stats.rowsScanned));
+        return stats.time * wasted;
+    }
+
+
+    // Parses a line of EXPLAIN QUERY PLAN output. If it's a full scan of a KeyStore's table,
+    // returns true and sets the KeyStore name and the table's alias in the query.
+    // The format is "SCAN kv_default AS _doc", or "SCAN TABLE kv_default AS _doc" before
+    // SQLite 3.36. A scan of an index looks the same but has a "USING ..." suffix.
+    static bool parseTableScan(string detail, string &keyStoreName, string &alias) {
+        if (!hasPrefix(detail, "SCAN "))
+            return false;
+        detail.erase(0, 5);
+        if (hasPrefix(detail, "TABLE "))
+            detail.erase(0, 6);
+        if (detail.find(" USING ") != string::npos)
+            return false;
+        string table = detail.substr(0, detail.find(' '));
+        if (!hasPrefix(table, "kv_") || hasPrefix(table, "kv_del_")
+                                     || table.find(':') != string::npos)
+            return false;           // (not a KeyStore table, or an index table)
+        keyStoreName = table.substr(3);
+        auto as = detail.find(" AS ");
+        alias = (as != string::npos) ? detail.substr(as + 4, detail.find(' ', as + 4) - (as + 4))
+                                     : table;
+        return true;
+    }
+
+
+    // Returns the JSON of a property expression, e.g. `[".name.first"]`.
+    static string propertyJSON(const string &path) {
+        string json = "[\".";
+        for (char c : path) {
+            if (c == '"' || c == '\\')
+                json += '\\';
+            json += c;
+        }
+        json += "\"]";
+        return json;
+    }
+
+
+    vector<SQLiteIndexAdvisor::Suggestion> SQLiteIndexAdvisor::suggestions(SQLiteDataFile &df,
+                                                                           size_t maxQueries) const
+    {
+        // Pick the queries whose scans have cost the most time:
+        vector<pair<string, QueryStats>> queries;
+        {
+            lock_guard<mutex> lock(_mutex);
+            for (auto &entry : _queries) {
+                if (entry.second.rowsScanned > 0)
+                    queries.push_back(entry);
+            }
+        }
+        sort(queries.begin(), queries.end(), [](const auto &a, const auto &b) {
+            return estimatedBenefit(a.second) > estimatedBenefit(b.second);
+        });
+        if (queries.size() > maxQueries)
+            queries.resize(maxQueries);
+
+        // Existing indexes, as (KeyStore name, type, 1st expression):
+        set<tuple<string, IndexSpec::Type, string>> existing;
+        for (auto &spec : df.getIndexes(nullptr)) {
+            if (spec.type == IndexSpec::kValue || spec.type == IndexSpec::kArray) {
+                const Value *expr = spec.what()->get(0);
+                if (expr)
+                    existing.emplace(spec.keyStoreName, spec.type, expr->toJSONString());
+            }
+        }
+
+        map<tuple<string, IndexSpec::Type, string>, Suggestion> suggestions;
+        auto suggest = [&](const string &keyStoreName, IndexSpec::Type type, const string &path,
+                           const QueryStats &stats) {
+            string expr = propertyJSON(path);
+            auto key = make_tuple(keyStoreName, type, expr);
+            if (existing.find(key) != existing.end())
+                return;
+            Suggestion &s = suggestions[key];
+            if (s.expressionJSON.empty()) {
+                s.keyStoreName = keyStoreName;
+                s.type = type;
+                s.expressionJSON = "[" + expr + "]";
+            }
+            if (!s.queries.empty() && s.queries.back() == stats.json)
+                return;     // (already counted this query)
+            s.queries.push_back(stats.json);
+            s.runs += stats.runs;
+            s.rowsScanned += stats.rowsScanned;
+            s.time += stats.time;
+            s.benefit += estimatedBenefit(stats);
+        };
+
+        for (auto &[sql, stats] : queries) {
+            // Find the KeyStore tables the query scans, according to SQLite's query plan:
+            set<pair<string,string>> scans;     // (KeyStore name, alias)
+            try {
+                SQLite::Statement explain(df, "EXPLAIN QUERY PLAN " + sql);
+                while (explain.executeStep()) {
+                    string keyStoreName, alias;
+                    if (parseTableScan(explain.getColumn(3).getText(), keyStoreName, alias))
+                        scans.emplace(keyStoreName, alias);
+                }
+            } catch (const SQLite::Exception &x) {
+                // The schema may have changed since the query ran, e.g. a KeyStore was deleted
+                LogVerbose(QueryLog, "IndexAdvisor: couldn't explain query: %s", x.what());
+                continue;
+            }
+
+            // Suggest indexing the properties the query tests on the scanned tables, or the
+            // arrays it UNNESTs from them. (A table without an alias is listed by its name.)
+            for (auto &[keyStoreName, alias] : scans) {
+                string table = "kv_" + keyStoreName;
+                for (auto &prop : stats.properties) {
+                    if (prop.alias == alias || (prop.alias.empty() && alias == table))
+                        suggest(keyStoreName,
+                                prop.unnested ? IndexSpec::kArray : IndexSpec::kValue,
+                                prop.path, stats);
+                }
+            }
+        }
+
+        vector<Suggestion> result;
+        for (auto &entry : suggestions)
+            result.push_back(move(entry.second));
+        sort(result.begin(), result.end(), [](const Suggestion &a, const Suggestion &b) {
+            return a.benefit > b.benefit;
+        });
+        return result;
+    }
+
+}
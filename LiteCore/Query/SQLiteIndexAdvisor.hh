@@ -0,0 +1,91 @@
+//
+// SQLiteIndexAdvisor.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "Base.hh"
+#include "IndexSpec.hh"
+#include "QueryParser.hh"
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace litecore {
+    class SQLiteDataFile;
+    struct SQLiteQueryPlan;
+
+
+    /** Records how often, and how expensively, queries on a database file run, and uses that
+        plus SQLite's query plans to suggest indexes that would speed up the costliest ones.
+        There's one instance per file, shared by all the SQLiteDataFiles open on it. */
+    class SQLiteIndexAdvisor : public RefCounted {
+    public:
+        /** Maximum number of distinct queries tracked; beyond that the cheapest are forgotten. */
+        static constexpr size_t kMaxQueries = 100;
+
+        /** Execution statistics of one query. */
+        struct QueryStats {
+            alloc_slice json;                   // The query, in JSON form
+            std::set<QueryParser::IndexableProperty> properties; // Properties it tests, or UNNESTs
+            uint64_t    runs {0};               // Number of times it ran
+            uint64_t    rowsScanned {0};        // Rows visited by full table scans
+            uint64_t    rowsReturned {0};       // Result rows
+            double      time {0};               // Total running time, in seconds
+        };
+
+        /** A suggested index, with the statistics of the queries it would help. */
+        struct Suggestion {
+            std::string         keyStoreName;
+            IndexSpec::Type     type;           // kValue or kArray
+            std::string         expressionJSON; // Index spec, as passed to KeyStore::createIndex
+            std::vector<alloc_slice> queries;   // JSON of the queries that would use it
+            uint64_t            runs {0};       // Total runs of those queries
+            uint64_t            rowsScanned {0};// Rows they visited in full table scans
+            double              time {0};       // Time they took, in seconds
+            double              benefit {0};    // Estimated time the index would have saved
+        };
+
+        /** Returns the advisor for the file a DataFile is open on. */
+        static Retained<SQLiteIndexAdvisor> forDataFile(SQLiteDataFile&);
+
+        /** Records one run of a query. */
+        void recordRun(const SQLiteQueryPlan&,
+                       uint64_t rowsScanned,
+                       uint64_t rowsReturned,
+                       double time);
+
+        /** Returns the statistics of a query, given its SQL, or nullopt if it hasn't run. */
+        std::optional<QueryStats> stats(const std::string &sql) const;
+
+        /** Runs EXPLAIN QUERY PLAN on the (up to) `maxQueries` queries that have spent the most
+            time in full table scans, and suggests value indexes on the properties they test,
+            or array indexes on the arrays they UNNEST, as recorded by the QueryParser. Properties that already have such an
+            index aren't suggested. Suggestions are sorted by decreasing `benefit`. */
+        std::vector<Suggestion> suggestions(SQLiteDataFile&, size_t maxQueries) const;
+
+        /** Forgets all recorded statistics. */
+        void reset();
+
+    private:
+        mutable std::mutex                              _mutex;
+        std::unordered_map<std::string, QueryStats>     _queries;     // Keyed by SQL
+    };
+
+}
@@ -0,0 +1,327 @@
+//
+// SQLiteKeyStore+AggregateIndexes.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "SQLiteKeyStore.hh"
+#include "SQLiteDataFile.hh"
+#include "QueryParser.hh"
+#include "Error.hh"
+#include "StringUtil.hh"
+#include "SQLiteCpp/SQLiteCpp.h"
+#include <sstream>
+
+using namespace std;
+using namespace fleece;
+using namespace fleece::impl;
+
+namespace litecore {
+
+    /*
+     An aggregate index's table has one row per group, i.e. per distinct combination of the
+     GROUP_BY values of the live records that match the index's WHERE clause. Its columns are:
+        - k0, k1, ...   The GROUP_BY values, as stored in the records (the SQL index is on these)
+        - r0, r1, ...   The same values converted for use as result columns, by fl_result()
+        - n             The number of records in the group
+        - c<i>          For a COUNT(x), SUM(x) or AVG(x) at WHAT index i: the number of records
+                        in which x isn't null
+        - s<i>          For a SUM(x) or AVG(x): the sum of the non-null values of x
+        - m<i>          For a MIN(x) or MAX(x): the minimum or maximum value of x
+     QueryParser::writeAggregateTableSelect reads these columns.
+
+     Triggers on the KeyStore's table add a record's values to its group's row when it's inserted,
+     and subtract them when it's deleted; an update does both. The exception is removing a
+     record whose value is its group's MIN() or MAX(), which makes the trigger rescan the group's
+     other records to find the new one.
+     */
+
+
+    namespace {
+
+        // Generates the SQL for an aggregate index's columns and for the statements that add a
+        // record to its group's row, or remove it.
+        class AggregateIndexSQL {
+        public:
+            AggregateIndexSQL(const SQLiteKeyStore &store,
+                              const IndexSpec &spec,
+                              const string &tableName)
+            :_store(store)
+            ,_kvTableName(store.tableName())
+            ,_tableName(tableName)
+            ,_where(spec.where())
+            {
+                auto groupBy = spec.groupBy();
+                if (!groupBy || groupBy->empty())
+                    error::_throw(error::InvalidQuery, "Aggregate index requires a GROUP_BY clause");
+                for (Array::iterator i(groupBy); i; ++i)
+                    _keys.push_back(i.value());
+                for (Array::iterator i(spec.what()); i; ++i) {
+                    const Value *arg;
+                    string fn = QueryParser::aggregateIndexFunction(i.value(), arg);
+                    _aggregates.push_back({fn, arg});
+                }
+            }
+
+            // The SQL of an expression evaluated on a record whose body column is `body`.
+            string eval(const Value *expr, const string &body) const {
+                QueryParser qp(_store);
+                qp.setBodyColumnName(body);
+                return qp.expressionSQL(expr);
+            }
+
+            // The condition that a record is live and matches the WHERE clause.
+            string matches(const string &alias) const {
+                string sql = "(" + alias + ".flags & 1) = 0";
+                if (_where)
+                    sql += " AND (" + eval(_where, alias + ".body") + ")";
+                return sql;
+            }
+
+            string createTableSQL() const {
+                stringstream sql;
+                sql << "CREATE TABLE \"" << _tableName << "\" (";
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    sql << "k" << k << ", ";
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    sql << "r" << k << ", ";
+                sql << "n INTEGER NOT NULL";
+                for (size_t i = 0; i < _aggregates.size(); ++i) {
+                    auto &fn = _aggregates[i].fn;
+                    if (fn == "count" || fn == "sum" || fn == "avg") {
+                        if (_aggregates[i].arg)
+                            sql << ", c" << i << " INTEGER NOT NULL DEFAULT 0";
+                        if (fn != "count")
+                            sql << ", s" << i;
+                    } else {
+                        sql << ", m" << i;
+                    }
+                }
+                sql << ")";
+                return sql.str();
+            }
+
+            string createIndexSQL(const string &indexName) const {
+                stringstream sql;
+                sql << "CREATE INDEX \"" << indexName << "\" ON \"" << _tableName << "\" (";
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    sql << (k ? ", k" : "k") << k;
+                sql << ")";
+                return sql.str();
+            }
+
+            // Fills the table with the groups of the existing records.
+            string populateSQL() const {
+                stringstream columns, values, groupBy;
+                writeKeyColumns(columns);
+                columns << ", n";
+                writeKeyValues(values, "doc.body");
+                values << ", count(*)";
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    groupBy << (k ? ", " : "") << eval(_keys[k], "doc.body");
+                for (size_t i = 0; i < _aggregates.size(); ++i) {
+                    auto &[fn, arg] = _aggregates[i];
+                    if (!arg)
+                        continue;
+                    string x = eval(arg, "doc.body");
+                    if (fn == "min" || fn == "max") {
+                        columns << ", m" << i;
+                        values << ", " << fn << "(" << x << ")";
+                    } else {
+                        columns << ", c" << i;
+                        values << ", count(" << x << ")";
+                        if (fn != "count") {
+                            columns << ", s" << i;
+                            values << ", sum(" << x << ")";
+                        }
+                    }
+                }
+                return CONCAT("INSERT INTO \"" << _tableName << "\" (" << columns.str() << ") "
+                              "SELECT " << values.str() << " FROM " << _kvTableName << " AS doc "
+                              "WHERE " << matches("doc") << " GROUP BY " << groupBy.str());
+            }
+
+            // Adds record `rec` (i.e. "new" or "old" in a trigger) to its group, creating the
+            // group's row if necessary.
+            string addSQL(const string &rec) const {
+                string body = rec + ".body";
+                stringstream columns, values, sql;
+                writeKeyColumns(columns);
+                writeKeyValues(values, body);
+                sql << "INSERT INTO \"" << _tableName << "\" (" << columns.str() << ", n) "
+                       "SELECT " << values.str() << ", 0 "
+                       "WHERE NOT EXISTS (SELECT 1 FROM \"" << _tableName << "\" "
+                       "WHERE " << groupMatch(body) << "); ";
+
+                sql << "UPDATE \"" << _tableName << "\" SET n = n + 1";
+                for (size_t i = 0; i < _aggregates.size(); ++i) {
+                    auto &[fn, arg] = _aggregates[i];
+                    if (!arg)
+                        continue;
+                    string x = eval(arg, body);
+                    if (fn == "min" || fn == "max") {
+                        sql << ", m" << i << " = CASE WHEN " << x << " IS NULL THEN m" << i
+                            << " WHEN m" << i << " IS NULL THEN " << x
+                            << " ELSE " << fn << "(m" << i << ", " << x << ") END";
+                    } else {
+                        sql << ", c" << i << " = c" << i << " + (" << x << " IS NOT NULL)";
+                        if (fn != "count")
+                            sql << ", s" << i << " = CASE WHEN " << x << " IS NULL THEN s" << i
+                                << " ELSE ifnull(s" << i << ", 0) + " << x << " END";
+                    }
+                }
+                sql << " WHERE " << groupMatch(body);
+                return sql.str();
+            }
+
+            // Removes record `rec` from its group, deleting the group's row if it's now empty.
+            string removeSQL(const string &rec) const {
+                string body = rec + ".body";
+                stringstream sql;
+                sql << "UPDATE \"" << _tableName << "\" SET n = n - 1";
+                for (size_t i = 0; i < _aggregates.size(); ++i) {
+                    auto &[fn, arg] = _aggregates[i];
+                    if (!arg)
+                        continue;
+                    string x = eval(arg, body);
+                    if (fn == "min" || fn == "max") {
+                        // If this was the min/max value, find the new one among the other records
+                        // in the group:
+                        sql << ", m" << i << " = CASE WHEN " << x << " IS NOT m" << i
+                            << " THEN m" << i << " ELSE "
+                            << "(SELECT " << fn << "(" << eval(arg, "doc.body") << ") "
+                            << "FROM " << _kvTableName << " AS doc "
+                            << "WHERE doc.rowid != " << rec << ".rowid AND " << matches("doc");
+                        for (size_t k = 0; k < _keys.size(); ++k)
+                            sql << " AND " << eval(_keys[k], "doc.body")
+                                << " IS " << eval(_keys[k], body);
+                        sql << ") END";
+                    } else {
+                        sql << ", c" << i << " = c" << i << " - (" << x << " IS NOT NULL)";
+                        if (fn != "count")
+                            // (Reset the sum when the count reaches 0, so rounding errors don't
+                            // accumulate in it)
+                            sql << ", s" << i << " = CASE WHEN " << x << " IS NULL THEN s" << i
+                                << " WHEN c" << i << " <= 1 THEN NULL"
+                                << " ELSE s" << i << " - " << x << " END";
+                    }
+                }
+                sql << " WHERE " << groupMatch(body) << "; ";
+
+                sql << "DELETE FROM \"" << _tableName << "\" "
+                       "WHERE " << groupMatch(body) << " AND n <= 0";
+                return sql.str();
+            }
+
+        private:
+            void writeKeyColumns(stringstream &out) const {
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    out << (k ? ", " : "") << "k" << k;
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    out << ", r" << k;
+            }
+
+            void writeKeyValues(stringstream &out, const string &body) const {
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    out << (k ? ", " : "") << eval(_keys[k], body);
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    out << ", fl_result(" << eval(_keys[k], body) << ")";
+            }
+
+            // The condition that a table row is the group of the record whose body is `body`.
+            // (`IS` is used because NULL is a valid key.)
+            string groupMatch(const string &body) const {
+                stringstream sql;
+                for (size_t k = 0; k < _keys.size(); ++k)
+                    sql << (k ? " AND k" : "k") << k << " IS " << eval(_keys[k], body);
+                return sql.str();
+            }
+
+            struct Aggregate {
+                string       fn;        // "count", "sum", "avg", "min" or "max"
+                const Value* arg;       // Argument, or nullptr for COUNT()
+            };
+
+            const SQLiteKeyStore&   _store;
+            string                  _kvTableName;
+            string                  _tableName;
+            const Value*            _where;
+            vector<const Value*>    _keys;
+            vector<Aggregate>       _aggregates;
+        };
+
+    }
+
+
+    bool SQLiteKeyStore::createAggregateIndex(const IndexSpec &spec) {
+        // The SQL index only covers the group keys, so compare the entire spec with any existing
+        // index's:
+        if (auto existing = db().getIndex(spec.name); existing) {
+            if (existing->type == spec.type && existing->keyStoreName == name()
+                    && existing->expressionJSON == spec.expressionJSON)
+                return false;
+            db().deleteIndex(*existing);
+        }
+
+        auto aggTableName = aggregateTableName(spec.name);
+        AggregateIndexSQL gen(*this, spec, aggTableName);
+
+        LogTo(QueryLog, "Creating aggregate table '%s'", aggTableName.c_str());
+        db().exec(gen.createTableSQL());
+
+        // Populate the table with the groups of the existing records:
+        db().exec(gen.populateSQL());
+
+        // Set up triggers to keep the table up to date
+        // ...on insertion:
+        createTrigger(aggTableName, "ins",
+                      "AFTER INSERT",
+                      "WHEN " + gen.matches("new"),
+                      gen.addSQL("new"));
+        // ...on delete:
+        createTrigger(aggTableName, "del",
+                      "BEFORE DELETE",
+                      "WHEN " + gen.matches("old"),
+                      gen.removeSQL("old"));
+        // ...on update:
+        createTrigger(aggTableName, "preupdate",
+                      "BEFORE UPDATE OF body, flags",
+                      "WHEN " + gen.matches("old"),
+                      gen.removeSQL("old"));
+        createTrigger(aggTableName, "postupdate",
+                      "AFTER UPDATE OF body, flags",
+                      "WHEN " + gen.matches("new"),
+                      gen.addSQL("new"));
+
+        return db().createIndex(spec, this, aggTableName, gen.createIndexSQL(spec.name));
+    }
+
+
+    string SQLiteKeyStore::aggregateTableName(const string &indexName) const {
+        return tableName() + ":aggregate:" + indexName;
+    }
+
+
+    // Part of the QueryParser delegate API
+    vector<QueryParser::AggregateTable> SQLiteKeyStore::aggregateTables() const {
+        vector<QueryParser::AggregateTable> tables;
+        for (auto &spec : getIndexes()) {
+            if (spec.type == IndexSpec::kAggregate)
+                tables.push_back({aggregateTableName(spec.name), spec.expressionJSON});
+        }
+        return tables;
+    }
+
+}
@@ -21,8 +21,17 @@
 #include "SQLiteKeyStore.hh"
 #include "SQLiteDataFile.hh"
 #include "QueryParser.hh"
+#include "SQLite_Internal.hh"
 #include "StringUtil.hh"
+#include "Stopwatch.hh"
+#include "SQLiteCpp/SQLiteCpp.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <thread>
 
 extern "C" {
 #include "sqlite3_unicodesn_tokenizer.h"
@@ -37,71 +46,330 @@ namespace litecore {
     static void writeTokenizerOptions(stringstream &sql, const IndexSpec::Options*);
 
 
+    // FTS indexes of KeyStores with at least this many records are populated in chunks, after
+    // the transaction that creates the FTS table; smaller ones are populated in that transaction.
+    static constexpr int64_t kMinRecordsToPopulateInChunks = 1000;
+    // Number of rowids in a chunk; each chunk is inserted into the FTS table in one transaction.
+    static constexpr int64_t kPopulateChunkSize = 1000;
+    // Max number of threads reading chunks, and of chunks read but not yet inserted.
+    static constexpr size_t kMaxPopulateThreads = 4, kMaxQueuedChunks = 8;
+
+
+    namespace {
+
+        // The SQL fragments used to create and populate a FTS table.
+        struct FTSIndexSQL {
+            FTSIndexSQL(SQLiteKeyStore &store, const IndexSpec &spec) {
+                // Collect the name of each FTS column and the SQL expression that populates it:
+                QueryParser qp(store);
+                qp.setBodyColumnName("new.body");
+                vector<string> colNames, colExprs;
+                for (Array::iterator i(spec.what()); i; ++i) {
+                    colNames.push_back(CONCAT('"' << QueryParser::FTSColumnName(i.value()) << '"'));
+                    colExprs.push_back(qp.FTSExpressionSQL(i.value()));
+                }
+                columnCount = colNames.size();
+                columns = join(colNames, ", ");
+                exprs = join(colExprs, ", ");
+
+                auto where = spec.where();
+                qp.setBodyColumnName("body");
+                whereNewSQL = qp.whereClauseSQL(where, "new");
+                whereOldSQL = qp.whereClauseSQL(where, "old");
+            }
+
+            size_t columnCount;
+            string columns, exprs, whereNewSQL, whereOldSQL;
+        };
+
+
+        // The text to index from one record, read in a chunk by populateFTSTable.
+        struct FTSRow {
+            int64_t rowid, sequence;
+            vector<optional<string>> columns;
+        };
+
+        using FTSChunk = vector<FTSRow>;
+
+
+        // Reads the FTS rows of the records with rowids in [first, last], using the SELECT
+        // statement made by populateFTSTable.
+        FTSChunk readFTSChunk(SQLite::Statement &stmt, int64_t first, int64_t last, size_t nCols) {
+            FTSChunk chunk;
+            UsingStatement u(stmt);
+            stmt.bind(1, (long long)first);
+            stmt.bind(2, (long long)last);
+            while (stmt.executeStep()) {
+                FTSRow row {stmt.getColumn(0).getInt64(), stmt.getColumn(1).getInt64(), {}};
+                for (int i = 0; i < int(nCols); ++i) {
+                    SQLite::Column col = stmt.getColumn(2 + i);
+                    if (col.isNull())
+                        row.columns.emplace_back();
+                    else
+                        row.columns.emplace_back(string(col.getText(), col.getBytes()));
+                }
+                chunk.push_back(move(row));
+            }
+            return chunk;
+        }
+
+    }
+
+
     // Creates a FTS index.
-    bool SQLiteKeyStore::createFTSIndex(const IndexSpec &spec)
-    {
-        auto ftsTableName = FTSTableName(spec.name);
-        // Collect the name of each FTS column and the SQL expression that populates it:
-        QueryParser qp(*this);
-        qp.setBodyColumnName("new.body");
-        vector<string> colNames, colExprs;
-        for (Array::iterator i(spec.what()); i; ++i) {
-            colNames.push_back(CONCAT('"' << QueryParser::FTSColumnName(i.value()) << '"'));
-            colExprs.push_back(qp.FTSExpressionSQL(i.value()));
+    bool SQLiteKeyStore::createFTSIndex(const IndexSpec &spec) {
+        // Populating a large index in one transaction would block other writers for a long time.
+        // (maxRowid is read in the transaction that creates the triggers, so that every record
+        // after it is indexed by them.)
+        int64_t maxRowid;
+        bool populateNow;
+        {
+            Transaction t(db());
+            maxRowid = db().intQuery(CONCAT("SELECT max(rowid) FROM kv_" << name()).c_str());
+            populateNow = (maxRowid < kMinRecordsToPopulateInChunks || !_capabilities.sequences);
+            if (!createFTSTable(spec, populateNow))
+                return false;
+            t.commit();
         }
-        string columns = join(colNames, ", ");
-        string exprs = join(colExprs, ", ");
+        if (!populateNow) {
+            try {
+                populateFTSTable(spec, maxRowid);
+            } catch (...) {
+                // The index isn't registered yet, so this drops its incomplete table:
+                Transaction t(db());
+                db().garbageCollectIndexTable(FTSTableName(spec.name));
+                t.commit();
+                throw;
+            }
+        }
+        return true;
+    }
 
-        auto where = spec.where();
-        qp.setBodyColumnName("body");
-        string whereNewSQL = qp.whereClauseSQL(where, "new");
-        string whereOldSQL = qp.whereClauseSQL(where, "old");
+
+    // Creates a FTS table and its triggers. If `populate` is true it also indexes the existing
+    // records and registers the index; otherwise populateFTSTable does that afterwards.
+    bool SQLiteKeyStore::createFTSTable(const IndexSpec &spec, bool populate) {
+        auto ftsTableName = FTSTableName(spec.name);
+        FTSIndexSQL fts(*this, spec);
 
         // Build the SQL that creates an FTS table, including the tokenizer options:
+        string createSQL;
         {
             stringstream sql;
-            sql << "CREATE VIRTUAL TABLE \"" << ftsTableName << "\" USING fts4(" << columns << ", ";
+            sql << "CREATE VIRTUAL TABLE \"" << ftsTableName << "\" USING fts4("
+                << fts.columns << ", ";
             writeTokenizerOptions(sql, spec.optionsPtr());
             sql << ")";
-            if (!db().createIndex(spec, this, ftsTableName, sql.str()))
-                return false;
+            createSQL = sql.str();
         }
 
-        // Index the existing records:
-        db().exec(CONCAT("INSERT INTO \"" << ftsTableName << "\" (docid, " << columns << ") "
-                         "SELECT rowid, " << exprs << " FROM kv_" << name() << " AS new "
-                         << whereNewSQL));
+        // A table left behind by an interrupted populateFTSTable isn't used by any index:
+        db().ensureIndexTableExists();
+        if (db().tableExists(ftsTableName))
+            db().garbageCollectIndexTable(ftsTableName);
+
+        if (populate) {
+            if (!db().createIndex(spec, this, ftsTableName, createSQL))
+                return false;
+
+            // Index the existing records:
+            db().exec(CONCAT("INSERT INTO \"" << ftsTableName << "\" (docid, " << fts.columns << ") "
+                             "SELECT rowid, " << fts.exprs << " FROM kv_" << name() << " AS new "
+                             << fts.whereNewSQL));
+        } else {
+            // Same as SQLiteDataFile::createIndex, except for registering the index:
+            if (auto existing = db().getIndex(spec.name); existing) {
+                if (existing->type == spec.type && existing->keyStoreName == name()
+                        && db().schemaExistsWithSQL(ftsTableName, "table", ftsTableName, createSQL))
+                    return false;
+                db().deleteIndex(*existing);
+            }
+            LogTo(QueryLog, "Creating %s index: %s", spec.typeName(), createSQL.c_str());
+            db().exec(createSQL);
+        }
 
         // Set up triggers to keep the FTS table up to date
         // ...on insertion:
         string insertNewSQL = CONCAT("INSERT INTO \"" << ftsTableName
-                                     << "\" (docid, " << columns << ") "
-                                     "VALUES (new.rowid, " << exprs << ")");
+                                     << "\" (docid, " << fts.columns << ") "
+                                     "VALUES (new.rowid, " << fts.exprs << ")");
         createTrigger(ftsTableName, "ins",
                       "AFTER INSERT",
-                      whereNewSQL,
+                      fts.whereNewSQL,
                       insertNewSQL);
 
         // ...on delete:
         string deleteOldSQL = CONCAT("DELETE FROM \"" << ftsTableName << "\" WHERE docid = old.rowid");
         createTrigger(ftsTableName, "del",
                       "AFTER DELETE",
-                      whereOldSQL,
+                      fts.whereOldSQL,
                       deleteOldSQL);
 
         // ...on update:
         createTrigger(ftsTableName, "preupdate",
                       "BEFORE UPDATE OF body",
-                      whereOldSQL,
+                      fts.whereOldSQL,
                       deleteOldSQL);
         createTrigger(ftsTableName, "postupdate",
                       "AFTER UPDATE OF body",
-                      whereNewSQL,
+                      fts.whereNewSQL,
                       insertNewSQL);
         return true;
     }
 
 
+    // Indexes the records that existed when the FTS table was created, then registers the index.
+    // Until then, queries can't use the table (see SQLiteDataFile::indexTableIsRegistered.)
+    // Threads using pooled read-only connections read the text to index from chunks of records,
+    // while this thread inserts it into the table (which is where the tokenizer runs), one chunk
+    // per transaction, so other writers can get in between. Records changed since the table was
+    // created have been indexed by its triggers; so a record's row is only inserted if it still
+    // has the sequence it was read with, and the table doesn't have a row for it yet.
+    void SQLiteKeyStore::populateFTSTable(const IndexSpec &spec, int64_t maxRowid) {
+        auto ftsTableName = FTSTableName(spec.name);
+        FTSIndexSQL fts(*this, spec);
+        string selectSQL = CONCAT("SELECT new.rowid, new.sequence, " << fts.exprs
+                                  << " FROM kv_" << name() << " AS new " << fts.whereNewSQL
+                                  << " AND new.rowid BETWEEN ? AND ?");
+        stringstream insertSQL;
+        insertSQL << "INSERT INTO \"" << ftsTableName << "\" (docid, " << fts.columns << ") "
+                     "SELECT ?1";
+        for (size_t i = 0; i < fts.columnCount; ++i)
+            insertSQL << ", ?" << (3 + i);
+        insertSQL << " WHERE EXISTS (SELECT 1 FROM kv_" << name()
+                  << " WHERE rowid = ?1 AND sequence = ?2)"
+                     " AND NOT EXISTS (SELECT 1 FROM \"" << ftsTableName << "\" WHERE docid = ?1)";
+        SQLite::Statement insertStmt(db(), insertSQL.str());
+        const IndexSpec::Options *progress = spec.optionsPtr();
+        if (progress && !progress->progressCallback)
+            progress = nullptr;
+
+        const int64_t nChunks = maxRowid / kPopulateChunkSize + 1;
+        atomic<int64_t> nextChunk {0};
+        mutex queueMutex;
+        condition_variable queueCond;
+        deque<FTSChunk> queue;
+        unsigned activeReaders = 0;
+        atomic<bool> stop {false};
+        exception_ptr readerError;
+
+        auto readChunks = [&](SQLiteDataFile::BorrowedReader reader) {
+            try {
+                SQLite::Statement &stmt = reader->compile(selectSQL);
+                for (int64_t c; !stop && (c = nextChunk++) < nChunks; ) {
+                    FTSChunk chunk = readFTSChunk(stmt, c * kPopulateChunkSize,
+                                                  (c + 1) * kPopulateChunkSize - 1,
+                                                  fts.columnCount);
+                    unique_lock<mutex> lock(queueMutex);
+                    queueCond.wait(lock, [&] {return queue.size() < kMaxQueuedChunks || stop;});
+                    queue.push_back(move(chunk));
+                    queueCond.notify_all();
+                }
+            } catch (...) {
+                lock_guard<mutex> lock(queueMutex);
+                if (!readerError)
+                    readerError = current_exception();
+                stop = true;
+            }
+            lock_guard<mutex> lock(queueMutex);
+            --activeReaders;
+            queueCond.notify_all();
+        };
+
+        vector<thread> threads;
+        for (size_t i = 0; i < kMaxPopulateThreads; ++i) {
+            auto reader = db().borrowReader();
+            if (!reader)
+                break;
+            ++activeReaders;
+            threads.emplace_back(readChunks, move(reader));
+        }
+        unique_ptr<SQLite::Statement> selectStmt;
+        if (threads.empty()) {
+            // No read-only connections are available, so read the chunks on this one:
+            selectStmt = make_unique<SQLite::Statement>(db(), selectSQL);
+        }
+
+        auto finishThreads = [&] {
+            {
+                lock_guard<mutex> lock(queueMutex);
+                stop = true;
+                queueCond.notify_all();
+            }
+            for (auto &t : threads)
+                t.join();
+            threads.clear();
+        };
+
+        try {
+            Stopwatch st;
+            double lastLogTime = 0;
+            for (int64_t chunksDone = 0; ; ) {
+                FTSChunk chunk;
+                if (selectStmt) {
+                    int64_t c = nextChunk++;
+                    if (c >= nChunks)
+                        break;
+                    chunk = readFTSChunk(*selectStmt, c * kPopulateChunkSize,
+                                         (c + 1) * kPopulateChunkSize - 1, fts.columnCount);
+                } else {
+                    unique_lock<mutex> lock(queueMutex);
+                    queueCond.wait(lock, [&] {return !queue.empty() || activeReaders == 0;});
+                    if (queue.empty())
+                        break;
+                    chunk = move(queue.front());
+                    queue.pop_front();
+                    queueCond.notify_all();
+                }
+
+                if (!chunk.empty()) {
+                    Transaction t(db());
+                    for (auto &row : chunk) {
+                        UsingStatement u(insertStmt);
+                        insertStmt.bind(1, (long long)row.rowid);
+                        insertStmt.bind(2, (long long)row.sequence);
+                        for (size_t i = 0; i < row.columns.size(); ++i) {
+                            if (row.columns[i])
+                                insertStmt.bindNoCopy(int(3 + i), *row.columns[i]);
+                            else
+                                insertStmt.bind(int(3 + i));
+                        }
+                        insertStmt.exec();
+                    }
+                    t.commit();
+                }
+
+                ++chunksDone;
+                if (progress)
+                    progress->progressCallback(progress->progressContext,
+                                               0.99 * double(chunksDone) / double(nChunks));
+                if (st.elapsed() - lastLogTime >= 1.0) {
+                    lastLogTime = st.elapsed();
+                    LogTo(QueryLog, "Populating index '%s': %lld of %lld rowids done (%.0f%%)",
+                          spec.name.c_str(),
+                          (long long)min(chunksDone * kPopulateChunkSize, maxRowid),
+                          (long long)maxRowid, 100.0 * chunksDone / nChunks);
+                }
+            }
+        } catch (...) {
+            finishThreads();
+            throw;
+        }
+        finishThreads();
+        if (readerError)
+            rethrow_exception(readerError);
+
+        // Now that the table is complete, register the index:
+        Transaction t(db());
+        db().registerIndex(spec, name(), ftsTableName);
+        t.commit();
+        LogTo(QueryLog, "Populated index '%s' with %lld rowids", spec.name.c_str(),
+              (long long)maxRowid);
+        if (progress)
+            progress->progressCallback(progress->progressContext, 1.0);
+    }
+
+
     string SQLiteKeyStore::FTSTableName(const std::string &property) const {
         return tableName() + "::" + property;
     }
@@ -34,7 +34,9 @@ using namespace fleece::impl;
 namespace litecore {
 
     /*
-     - A value index is a SQL index named 'NAME'.
+     - A value index is a SQL index named 'NAME'. If it has an INCLUDE clause, it also has
+       a SQL table named `kv_default:covering:NAME` holding the values of the included
+       properties of every record, in columns c0, c1, ... keyed by docid.
      - A FTS index is a SQL virtual table named 'kv_default::NAME'
      - An array index has two parts:
          * A SQL table named `kv_default:unnest:PATH`, where PATH is the property path
@@ -43,6 +45,8 @@ namespace litecore {
          * A SQL table named `kv_default:prediction:DIGEST`, where DIGEST is a unique digest
             of the prediction function name and the parameter dictionary
          * An index on that table named `NAME`
+     - An aggregate index is a SQL table named `kv_default:aggregate:NAME` with one row per
+       group, and an index on its group keys named `NAME`.
 
      Index table:
         - name (string primary key)
@@ -57,20 +61,26 @@ namespace litecore {
         spec.validateName();
 
         Stopwatch st;
-        Transaction t(db());
         bool created;
-        switch (spec.type) {
-            case IndexSpec::kValue:      created = createValueIndex(spec); break;
-            case IndexSpec::kFullText:   created = createFTSIndex(spec); break;
-            case IndexSpec::kArray:      created = createArrayIndex(spec); break;
+        if (spec.type == IndexSpec::kFullText) {
+            // (This uses multiple transactions, so other writers aren't blocked while it runs)
+            created = createFTSIndex(spec);
+        } else {
+            Transaction t(db());
+            switch (spec.type) {
+                case IndexSpec::kValue:      created = createValueIndex(spec); break;
+                case IndexSpec::kArray:      created = createArrayIndex(spec); break;
+                case IndexSpec::kAggregate:  created = createAggregateIndex(spec); break;
 #ifdef COUCHBASE_ENTERPRISE
-            case IndexSpec::kPredictive: created = createPredictiveIndex(spec); break;
+                case IndexSpec::kPredictive: created = createPredictiveIndex(spec); break;
 #endif
-            default:                     error::_throw(error::Unimplemented);
+                default:                     error::_throw(error::Unimplemented);
+            }
+            if (created)
+                t.commit();
         }
 
         if (created) {
-            t.commit();
             db().optimize();
             double time = st.elapsed();
             QueryLog.log((time < 3.0 ? LogLevel::Info : LogLevel::Warning),
@@ -155,7 +165,64 @@ namespace litecore {
 
     bool SQLiteKeyStore::createValueIndex(const IndexSpec &spec) {
         Array::iterator expressions(spec.what());
-        return createIndex(spec, tableName(), expressions);
+        bool created = createIndex(spec, tableName(), expressions);
+        if (created && spec.include())
+            createCoveringTable(spec);
+        return created;
+    }
+
+
+    // Creates the table in which a value index stores its INCLUDE properties. SQLite can't read
+    // values back out of an index on expressions, so they go in a table keyed by docid instead;
+    // a query that returns them then doesn't need to read the document body.
+    void SQLiteKeyStore::createCoveringTable(const IndexSpec &spec) {
+        auto kvTableName = tableName();
+        auto covTableName = coveringTableName(spec.name);
+        vector<string> properties = spec.includedProperties();
+
+        stringstream columns, values, newValues, assignments;
+        for (size_t i = 0; i < properties.size(); ++i) {
+            stringstream path;
+            QueryParser::writeSQLString(path, properties[i]);
+            // Store the values the way result columns want them, e.g. with booleans and nulls
+            // converted to Fleece:
+            columns << ", c" << i;
+            values << ", fl_result(fl_value(body, " << path.str() << "))";
+            newValues << ", fl_result(fl_value(new.body, " << path.str() << "))";
+            assignments << (i ? ", " : "") << "c" << i
+                        << " = fl_result(fl_value(new.body, " << path.str() << "))";
+        }
+
+        LogTo(QueryLog, "Creating covering table '%s'", covTableName.c_str());
+        db().exec(CONCAT("CREATE TABLE \"" << covTableName << "\" "
+                         "(docid INTEGER PRIMARY KEY REFERENCES " << kvTableName << "(rowid)"
+                         << columns.str() << ") WITHOUT ROWID"));
+
+        // Populate the table with data from existing records. Unlike other index tables, this
+        // includes deleted ones, since queries can return those too:
+        db().exec(CONCAT("INSERT INTO \"" << covTableName << "\" (docid" << columns.str() << ") "
+                         "SELECT rowid" << values.str() << " FROM " << kvTableName));
+
+        // Set up triggers to keep the table up to date
+        // ...on insertion:
+        createTrigger(covTableName, "ins",
+                      "AFTER INSERT", "",
+                      CONCAT("INSERT OR REPLACE INTO \"" << covTableName << "\" (docid" << columns.str()
+                             << ") VALUES (new.rowid" << newValues.str() << ")"));
+        // ...on delete:
+        createTrigger(covTableName, "del",
+                      "BEFORE DELETE", "",
+                      CONCAT("DELETE FROM \"" << covTableName << "\" WHERE docid = old.rowid"));
+        // ...on update:
+        createTrigger(covTableName, "upd",
+                      "AFTER UPDATE OF body", "",
+                      CONCAT("UPDATE \"" << covTableName << "\" SET " << assignments.str()
+                             << " WHERE docid = new.rowid"));
+    }
+
+
+    string SQLiteKeyStore::coveringTableName(const string &indexName) const {
+        return tableName() + ":covering:" + indexName;
     }
 
 
@@ -167,4 +234,23 @@ namespace litecore {
         return db().tableExists(tableName);
     }
 
+
+    // Part of the QueryParser delegate API. This is called whenever a query is compiled, so
+    // the list is cached. Creating or deleting a covering index creates or drops its table,
+    // which changes the schema version, even if it's done through another connection.
+    vector<QueryParser::CoveringTable> SQLiteKeyStore::coveringTables() const {
+        int64_t schemaVersion = db().schemaVersion();
+        lock_guard<mutex> lock(_coveringTablesMutex);
+        if (schemaVersion != _coveringTablesSchemaVersion) {
+            _coveringTables.clear();
+            for (auto &spec : getIndexes()) {
+                if (spec.type == IndexSpec::kValue && spec.include())
+                    _coveringTables.push_back({coveringTableName(spec.name),
+                                               spec.includedProperties()});
+            }
+            _coveringTablesSchemaVersion = schemaVersion;
+        }
+        return _coveringTables;
+    }
+
 }
@@ -18,6 +18,7 @@
 
 #include "SQLiteKeyStore.hh"
 #include "SQLiteDataFile.hh"
+#include "SQLiteQueryCache.hh"
 #include "SQLite_Internal.hh"
 #include "Logging.hh"
 #include "Query.hh"
@@ -33,6 +34,9 @@
 #include <sqlite3.h>
 #include <sstream>
 #include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 extern "C" {
 #include "sqlite3_unicodesn_tokenizer.h"        // for unicodesn_tokenizerRunningQuery()
@@ -61,48 +65,82 @@ namespace litecore {
             static constexpr const char* kLanguageName[] = {"JSON", "N1QL"};
             logInfo("Compiling %s query: %.*s", kLanguageName[(int)language], SPLAT(queryStr));
 
+            auto &cache = keyStore.db().queryCache();
+            string cacheKey = SQLiteQueryCache::key(keyStore.name(), language, queryStr);
+            int64_t schemaVersion = keyStore.db().schemaVersion();
+            if (auto cached = cache.get(cacheKey, schemaVersion); cached) {
+                _plan = cached->plan;
+                if (_plan->usesExpiration)
+                    keyStore.addExpiration();
+                if (cached->statement) {
+                    _statement = cached->statement;
+                    logInfo("Reusing cached compiled query");
+                } else {
+                    _statement.reset(keyStore.compile(_plan->sql));
+                    logInfo("Reusing cached query plan: %s", _plan->sql.c_str());
+                }
+                return;
+            }
+
+            auto plan = make_shared<SQLiteQueryPlan>();
             switch (language) {
                 case QueryLanguage::kJSON:
-                    _json = queryStr;
+                    plan->json = queryStr;
                     break;
                 case QueryLanguage::kN1QL: {
                     unsigned errPos;
                     FLMutableDict result = n1ql::parse(string(queryStr), &errPos);
                     if (!result)
                         throw Query::parseError("N1QL syntax error", errPos);
-                    _json = ((MutableDict*)result)->toJSON(true);
+                    plan->json = ((MutableDict*)result)->toJSON(true);
                     FLMutableDict_Release(result);
                     break;
                 }
             }
 
             QueryParser qp(keyStore);
-            qp.parseJSON(_json);
+            qp.parseJSON(plan->json);
 
-            _parameters = qp.parameters();
-            for (auto p = _parameters.begin(); p != _parameters.end();) {
+            plan->parameters = qp.parameters();
+            for (auto p = plan->parameters.begin(); p != plan->parameters.end();) {
                 if (hasPrefix(*p, "opt_"))
-                    p = _parameters.erase(p);       // Optional param, don't warn if it's unbound
+                    p = plan->parameters.erase(p);  // Optional param, don't warn if it's unbound
                 else
                     ++p;
             }
 
-            _ftsTables = qp.ftsTablesUsed();
-            for (auto ftsTable : _ftsTables) {
-                if (!keyStore.db().tableExists(ftsTable))
+            plan->ftsTables = qp.ftsTablesUsed();
+            for (auto ftsTable : plan->ftsTables) {
+                // (A table whose index isn't registered yet is still being populated.)
+                if (!keyStore.db().indexTableIsRegistered(ftsTable))
                     error::_throw(error::NoSuchIndex, "'match' test requires a full-text index");
             }
 
-            if (qp.usesExpiration())
+            plan->usesExpiration = qp.usesExpiration();
+            plan->indexableProperties = qp.indexableProperties();
+            if (plan->usesExpiration)
                 keyStore.addExpiration();
 
-            string sql = qp.SQL();
-            logInfo("Compiled as %s", sql.c_str());
-            LogTo(SQL, "Compiled {Query#%u}: %s", getObjectRef(), sql.c_str());
-            _statement.reset(keyStore.compile(sql));
+            plan->sql = qp.SQL();
+            logInfo("Compiled as %s", plan->sql.c_str());
+            LogTo(SQL, "Compiled {Query#%u}: %s", getObjectRef(), plan->sql.c_str());
+            _statement.reset(keyStore.compile(plan->sql));
             
-            _1stCustomResultColumn = qp.firstCustomResultColumn();
-            _columnTitles = qp.columnTitles();
+            plan->firstCustomResultColumn = qp.firstCustomResultColumn();
+            plan->columnTitles = qp.columnTitles();
+            if (qp.isIncremental()) {
+                using Scope = QueryParser::IncrementalScope;
+                plan->trackedSQL       = qp.incrementalSQL(Scope::kAllDocs);
+                plan->changedDocsSQL   = qp.incrementalSQL(Scope::kChangedDocs);
+                plan->candidateDocsSQL = qp.incrementalSQL(Scope::kCandidateDocs);
+                plan->hasOrderBy = qp.hasOrderBy();
+                plan->hasLimit = qp.hasLimit();
+            }
+            _plan = plan;
+
+            if (plan->usesExpiration)
+                schemaVersion = keyStore.db().schemaVersion(); // (addExpiration may change it)
+            cache.put(cacheKey, schemaVersion, {_plan, _statement});
         }
 
 
@@ -110,6 +148,7 @@ namespace litecore {
             logInfo("Closing query (db is closing)");
             _statement.reset();
             _matchedTextStatement.reset();
+            _auxStatements.clear();
             Query::close();
         }
 
@@ -126,9 +165,9 @@ namespace litecore {
 
         alloc_slice getMatchedText(const FullTextTerm &term) override {
             // Get the expression that generated the text
-            if (_ftsTables.size() == 0)
+            if (_plan->ftsTables.size() == 0)
                 error::_throw(error::NoSuchIndex);
-            string expr = _ftsTables[0];    // TODO: Support for multiple matches in a query
+            string expr = _plan->ftsTables[0];    // TODO: Support for multiple matches in a query
 
             if (!_matchedTextStatement) {
                 auto &df = (SQLiteDataFile&) keyStore().dataFile();
@@ -148,12 +187,12 @@ namespace litecore {
 
 
         virtual unsigned columnCount() const noexcept override {
-            return statement()->getColumnCount() - _1stCustomResultColumn;
+            return statement()->getColumnCount() - _plan->firstCustomResultColumn;
         }
 
 
         virtual const vector<string>& columnTitles() const noexcept override {
-            return _columnTitles;
+            return _plan->columnTitles;
         }
 
 
@@ -172,12 +211,14 @@ namespace litecore {
                 result << " " << x.getColumn(3).getText() << "\n";
             }
 
-            result << '\n' << _json << '\n';
+            result << '\n' << _plan->json << '\n';
             return result.str();
         }
 
         QueryEnumerator* createEnumerator(const Options *options) override;
 
+        QueryEnumerator* refresh(SQLiteQueryEnumerator*);
+
         shared_ptr<SQLite::Statement> statement() const {
             if (!_statement)
                 error::_throw(error::NotOpen);
@@ -186,47 +227,81 @@ namespace litecore {
 
         unsigned objectRef() const                  {return getObjectRef();}   // (for logging)
 
-        set<string> _parameters;            // Names of the bindable parameters
-        vector<string> _ftsTables;          // Names of the FTS tables used
-        unsigned _1stCustomResultColumn;    // Column index of the 1st column declared in JSON
+        shared_ptr<const SQLiteQueryPlan> _plan;    // Parsed query; may be shared via the cache
 
     protected:
         ~SQLiteQuery() =default;
         string loggingClassName() const override    {return "Query";}
 
     private:
-        alloc_slice _json;                                  // Original JSON form of the query
+        template <class FN> void withSnapshot(FN fn);
+        SQLite::Statement& mainConnectionStatement(const string &sql);
+
         shared_ptr<SQLite::Statement> _statement;           // Compiled SQLite statement
         unique_ptr<SQLite::Statement> _matchedTextStatement;// Gets the matched text
-        vector<string> _columnTitles;                       // Titles of columns
+        unordered_map<string, unique_ptr<SQLite::Statement>> _auxStatements; // Used by refresh
     };
 
 
 #pragma mark - QUERY ENUMERATOR:
 
 
+    // Reads the full-text matches from the implicit FTS columns of a result row.
+    static void readFullTextTerms(const Array *row, QueryEnumerator::FullTextTerms &terms) {
+        terms.clear();
+        uint64_t dataSource = row->get(kFTSRowidCol)->asInt();
+        // The offsets() function returns a string of space-separated numbers in groups of 4.
+        string offsets = row->get(kFTSOffsetsCol)->asString().asString();
+        const char *termStr = offsets.c_str();
+        while (*termStr) {
+            uint32_t n[4];
+            for (int i = 0; i < 4; ++i) {
+                char *next;
+                n[i] = (uint32_t)strtol(termStr, &next, 10);
+                termStr = next;
+            }
+            terms.push_back({dataSource, n[0], n[1], n[2], n[3]});
+            // {rowid, key #, term #, byte offset, byte length}
+        }
+    }
+
+
     // Query enumerator that reads from prerecorded Fleece data (generated by fastForward(), below)
     // Each array item is a row, which is itself an array of column values.
     class SQLiteQueryEnumerator : public QueryEnumerator, Logging {
     public:
+        using DocIDs = vector<alloc_slice>;
+
         SQLiteQueryEnumerator(SQLiteQuery *query,
                               const Query::Options *options,
                               sequence_t lastSequence,
                               uint64_t purgeCount,
                               Doc *recording,
                               unsigned long long rowCount,
-                              double elapsedTime)
+                              double elapsedTime,
+                              optional<DocIDs> docIDs =nullopt)
         :QueryEnumerator(options, lastSequence, purgeCount)
         ,Logging(QueryLog)
         ,_recording(recording)
+        ,_docIDs(move(docIDs))
         ,_iter(_recording->asArray())
-        ,_1stCustomResultColumn(query->_1stCustomResultColumn)
-        ,_hasFullText(!query->_ftsTables.empty())
+        ,_1stCustomResultColumn(query->_plan->firstCustomResultColumn)
+        ,_hasFullText(!query->_plan->ftsTables.empty())
         {
             logInfo("Created on {Query#%u} with %llu rows (%zu bytes) in %.3fms",
                 query->objectRef(), rowCount, recording->data().size, elapsedTime*1000);
         }
 
+        // Copy constructor, used by clone(). The rows are shared, but not the docIDs.
+        SQLiteQueryEnumerator(const SQLiteQueryEnumerator &e)
+        :QueryEnumerator(&e._options, e._lastSequence, e._purgeCount)
+        ,Logging(QueryLog)
+        ,_recording(e._recording)
+        ,_iter(_recording->asArray())
+        ,_1stCustomResultColumn(e._1stCustomResultColumn)
+        ,_hasFullText(e._hasFullText)
+        { }
+
         ~SQLiteQueryEnumerator() {
             logInfo("Deleted");
         }
@@ -300,15 +375,11 @@ namespace litecore {
         }
 
         QueryEnumerator* refresh(Query *query) override {
-            auto newOptions = _options.after(_lastSequence).withPurgeCount(_purgeCount);
-            auto sqliteQuery = (SQLiteQuery*)query;
-            unique_ptr<SQLiteQueryEnumerator> newEnum(
-                (SQLiteQueryEnumerator*)sqliteQuery->createEnumerator(&newOptions) );
-            if (obsoletedBy(newEnum.get())) {
-                // Results have changed, so return new enumerator:
-                return newEnum.release();
-            }
-            return nullptr;
+            return ((SQLiteQuery*)query)->refresh(this);
+        }
+
+        QueryEnumerator* clone() override {
+            return new SQLiteQueryEnumerator(*this);
         }
 
         bool hasFullText() const override {
@@ -316,29 +387,22 @@ namespace litecore {
         }
 
         const FullTextTerms& fullTextTerms() override {
-            _fullTextTerms.clear();
-            uint64_t dataSource = _iter->asArray()->get(kFTSRowidCol)->asInt();
-            // The offsets() function returns a string of space-separated numbers in groups of 4.
-            string offsets = _iter->asArray()->get(kFTSOffsetsCol)->asString().asString();
-            const char *termStr = offsets.c_str();
-            while (*termStr) {
-                uint32_t n[4];
-                for (int i = 0; i < 4; ++i) {
-                    char *next;
-                    n[i] = (uint32_t)strtol(termStr, &next, 10);
-                    termStr = next;
-                }
-                _fullTextTerms.push_back({dataSource, n[0], n[1], n[2], n[3]});
-                // {rowid, key #, term #, byte offset, byte length}
-            }
+            readFullTextTerms(_iter->asArray(), _fullTextTerms);
             return _fullTextTerms;
         }
 
+        // Accessors used by SQLiteQuery::refresh:
+        const Array* rows() const                   {return _recording->asArray();}
+        const optional<DocIDs>& docIDs() const      {return _docIDs;}
+        void setLastSequence(sequence_t seq)        {_lastSequence = seq;}
+        void adoptDocIDs(SQLiteQueryEnumerator &e)  {_docIDs = move(e._docIDs);}
+
     protected:
         string loggingClassName() const override    {return "QueryEnum";}
 
     private:
         Retained<Doc> _recording;
+        optional<DocIDs> _docIDs;           // DocID of each row, if the query tracked them
         Array::iterator _iter;
         unsigned _1stCustomResultColumn;    // Column index of the 1st column declared in JSON
         bool _hasFullText;
@@ -347,20 +411,34 @@ namespace litecore {
 
 
 
+    // Tells the FTS tokenizer that a query is running, for the lifetime of this object.
+    struct RunningQueryScope {
+        RunningQueryScope()         {unicodesn_tokenizerRunningQuery(true);}
+        ~RunningQueryScope()        {unicodesn_tokenizerRunningQuery(false);}
+    };
+
+
     // Reads from 'live' SQLite statement and records the results into a Fleece array,
     // which is then used as the data source of a SQLiteQueryEnum.
     class SQLiteQueryRunner {
     public:
-        SQLiteQueryRunner(SQLiteQuery *query, const Query::Options *options, sequence_t lastSequence, uint64_t purgeCount)
+        // If `tracksDocIDs` is true, the statement's first column is the docID, which is collected
+        // separately instead of being recorded as a column. (See SQLiteQueryPlan::trackedSQL.)
+        SQLiteQueryRunner(SQLiteQuery *query, const Query::Options *options, sequence_t lastSequence, uint64_t purgeCount,
+                          SQLite::Statement &statement, bool tracksDocIDs =false)
         :_query(query)
         ,_lastSequence(lastSequence)
         ,_purgeCount(purgeCount)
-        ,_statement(query->statement())
+        ,_statement(&statement)
         ,_sk(query->keyStore().dataFile().documentKeys())
         ,_options(options ? *options : Query::Options())
+        ,_firstColumn(tracksDocIDs ? 1 : 0)
+        ,_1stCustomResultColumn(_firstColumn + int(query->_plan->firstCustomResultColumn))
         {
+            if (tracksDocIDs)
+                _docIDs.emplace();
             _statement->clearBindings();
-            _unboundParameters = query->_parameters;
+            _unboundParameters = query->_plan->parameters;
             if (options && options->paramBindings.buf)
                 bindParameters(options->paramBindings);
             if (!_unboundParameters.empty()) {
@@ -440,7 +518,7 @@ namespace litecore {
                     enc.writeDouble(col.getDouble());
                     break;
                 case SQLITE_BLOB: {
-                    if (i >= _query->_1stCustomResultColumn) {
+                    if (i >= _1stCustomResultColumn) {
                         slice fleeceData {col.getBlob(), (size_t)col.getBytes()};
                         Scope fleeceScope(fleeceData, _sk);
                         const Value *value = Value::fromTrustedData(fleeceData);
@@ -458,6 +536,28 @@ namespace litecore {
             return true;
         }
 
+        // Steps to the next row; if there is one, encodes it as an array of column values followed
+        // by an integer bit-map of which columns are missing/undefined, and returns true.
+        bool encodeNextRow(Encoder &enc, int nCols) {
+            if (!_statement->executeStep())
+                return false;
+            if (_docIDs) {
+                SQLite::Column docID = _statement->getColumn(0);
+                _docIDs->emplace_back(slice{docID.getText(), (size_t)docID.getBytes()});
+            }
+            uint64_t missingCols = 0;
+            enc.beginArray(nCols - _firstColumn);
+            for (int i = _firstColumn; i < nCols; ++i) {
+                int offsetColumn = i - _1stCustomResultColumn;
+                if (!encodeColumn(enc, i) && offsetColumn >= 0 && offsetColumn < 64) {
+                    missingCols |= (1ULL << offsetColumn);
+                }
+            }
+            enc.endArray();
+            enc.writeUInt(missingCols);
+            return true;
+        }
+
         // Collects all the (remaining) rows into a Fleece array of arrays,
         // and returns an enumerator impl that will replay them.
         SQLiteQueryEnumerator* fastForward() {
@@ -472,33 +572,23 @@ namespace litecore {
             enc.setSharedKeys(sk);
             enc.beginArray();
 
-            unicodesn_tokenizerRunningQuery(true);
-            try {
-                 auto firstCustomCol = _query->_1stCustomResultColumn;
-                 while (_statement->executeStep()) {
-                     uint64_t missingCols = 0;
-                     enc.beginArray(nCols);
-                     for (int i = 0; i < nCols; ++i) {
-                         int offsetColumn = i - firstCustomCol;
-                         if (!encodeColumn(enc, i) && offsetColumn >= 0 && offsetColumn < 64) {
-                             missingCols |= (1ULL << offsetColumn);
-                         }
-                    }
-                    enc.endArray();
-                    // Add an integer containing a bit-map of which columns are missing/undefined:
-                    enc.writeUInt(missingCols);
+            // Count the rows visited by full table scans, for the SQLiteIndexAdvisor:
+            sqlite3_stmt *stmt = _statement->getStatement();
+            sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, true);
+            {
+                RunningQueryScope running;
+                while (encodeNextRow(enc, nCols))
                     ++rowCount;
-                }
-            } catch (...) {
-                unicodesn_tokenizerRunningQuery(false);
-                throw;
             }
-            unicodesn_tokenizerRunningQuery(false);
+            uint64_t rowsScanned = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, true);
 
             enc.endArray();
             Retained<Doc> recording = enc.finishDoc();
+            double elapsed = st.elapsed();
+            auto &df = (SQLiteDataFile&)_query->keyStore().dataFile();
+            df.indexAdvisor().recordRun(*_query->_plan, rowsScanned, rowCount, elapsed);
             return new SQLiteQueryEnumerator(_query, &_options, _lastSequence, _purgeCount,
-                                             recording, rowCount, st.elapsed());
+                                             recording, rowCount, elapsed, move(_docIDs));
         }
 
     private:
@@ -506,9 +596,142 @@ namespace litecore {
         Query::Options _options;
         sequence_t _lastSequence;       // DB's lastSequence at the time the query ran
         uint64_t _purgeCount;           // DB's purgeCount at the time the query ran
-        shared_ptr<SQLite::Statement> _statement;
+        SQLite::Statement* _statement;  // Compiled statement (on the main or a pooled connection)
         set<string> _unboundParameters;
         SharedKeys* _sk;
+        int _firstColumn;               // Index of 1st recorded column (1 if col 0 is the docID)
+        int _1stCustomResultColumn;     // Index of 1st column declared in JSON
+        optional<SQLiteQueryEnumerator::DocIDs> _docIDs;    // Collected docIDs, if tracking
+    };
+
+
+
+    // Query enumerator that steps the SQLite statement as the client advances, encoding only the
+    // current row, instead of recording all the rows up front. (See Query::Options::streaming.)
+    // The statement's read transaction keeps the snapshot it started with until it's reset.
+    class SQLiteStreamingQueryEnumerator : public QueryEnumerator, Logging {
+    public:
+        SQLiteStreamingQueryEnumerator(SQLiteQuery *query,
+                                       const Query::Options *options,
+                                       sequence_t lastSequence,
+                                       uint64_t purgeCount,
+                                       SQLite::Statement &statement)
+        :QueryEnumerator(options, lastSequence, purgeCount)
+        ,Logging(QueryLog)
+        ,_1stCustomResultColumn(query->_plan->firstCustomResultColumn)
+        ,_hasFullText(!query->_plan->ftsTables.empty())
+        {
+            _runner.emplace(query, options, lastSequence, purgeCount, statement);
+            _nCols = statement.getColumnCount();
+            logInfo("Created streaming enumerator on {Query#%u}", query->objectRef());
+            // Step to the first row now, so the snapshot is fixed while the caller still holds
+            // the read transaction that lastSequence and purgeCount came from:
+            _prefetched = readRow();
+        }
+
+        ~SQLiteStreamingQueryEnumerator() {
+            finish();
+            logInfo("Deleted");
+        }
+
+        // Called after construction with the pooled connection the statement is on, which is
+        // then kept until the enumeration ends.
+        void adoptReader(SQLiteDataFile::BorrowedReader &&reader) {
+            if (_runner)
+                _reader.emplace(move(reader));
+        }
+
+        bool next() override {
+            if (_prefetched)
+                _prefetched = false;
+            else if (!readRow())
+                return false;
+            if (!_row) {
+                logVerbose("END");
+                return false;
+            }
+            return true;
+        }
+
+        Array::iterator columns() const noexcept override {
+            Array::iterator i(_row->asArray()->get(0)->asArray());
+            i += _1stCustomResultColumn;
+            return i;
+        }
+
+        uint64_t missingColumns() const noexcept override {
+            return _row->asArray()->get(1)->asUnsigned();
+        }
+
+        int64_t getRowCount() const override {
+            error::_throw(error::UnsupportedOperation,
+                          "Streaming query enumerators don't know their row count");
+        }
+
+        bool obsoletedBy(const QueryEnumerator *other) override {
+            // The rows aren't kept, so there's nothing to compare but the sequences:
+            return !other || other->purgeCount() != _purgeCount
+                          || other->lastSequence() > _lastSequence;
+        }
+
+        QueryEnumerator* refresh(Query *query) override {
+            error::_throw(error::UnsupportedOperation,
+                          "Streaming query enumerators can't be refreshed");
+        }
+
+        bool hasFullText() const override {
+            return _hasFullText;
+        }
+
+        const FullTextTerms& fullTextTerms() override {
+            readFullTextTerms(_row->asArray()->get(0)->asArray(), _fullTextTerms);
+            return _fullTextTerms;
+        }
+
+    protected:
+        string loggingClassName() const override    {return "QueryEnum";}
+
+    private:
+        // Reads the next row into _row, or sets it to null at the end. Returns false at the end.
+        bool readRow() {
+            _row = nullptr;
+            if (!_runner)
+                return false;
+            try {
+                RunningQueryScope running;
+                _enc.beginArray(2);
+                if (!_runner->encodeNextRow(_enc, _nCols)) {
+                    _enc.reset();
+                    finish();
+                    return false;
+                }
+                _enc.endArray();
+                _row = _enc.finishDoc();
+                _enc.reset();
+            } catch (...) {
+                _enc.reset();
+                finish();
+                throw;
+            }
+            return true;
+        }
+
+        // Resets the statement and gives back the connection, as soon as the rows run out.
+        void finish() {
+            _runner.reset();
+            _reader.reset();
+        }
+
+        // (Declaration order matters: the runner resets the statement, so it must be destroyed
+        // before the connection is returned.)
+        optional<SQLiteDataFile::BorrowedReader> _reader;           // Pooled connection
+        optional<SQLiteQueryRunner>              _runner;           // Steps the statement
+        Encoder                                  _enc;
+        Retained<Doc>                            _row;              // Current row: [cols, missing]
+        int                                      _nCols;
+        unsigned                                 _1stCustomResultColumn;
+        bool                                     _hasFullText;
+        bool                                     _prefetched {false};
     };
 
 
@@ -522,16 +745,245 @@ namespace litecore {
     // The factory method that creates a SQLite QueryEnumerator, but only if the database has
     // changed since lastSeq.
     QueryEnumerator* SQLiteQuery::createEnumerator(const Options *options) {
-        // Start a read-only transaction, to ensure that the result of lastSequence() and purgeCount() will be
-        // consistent with the query results.
-        ReadOnlyTransaction t(keyStore().dataFile());
+        auto &df = (SQLiteDataFile&)keyStore().dataFile();
+        auto statement = this->statement();
+
+        if (options && options->streaming) {
+            // A streaming enumerator needs a statement of its own, since it keeps it busy. It
+            // has to be on a pooled connection, whose read transaction stays open while it runs,
+            // isolating it from writes; the main connection can't do that, so if no pooled one
+            // is available the rows are collected as usual instead.
+            if (auto reader = df.borrowReader(); reader) {
+                unique_ptr<SQLiteStreamingQueryEnumerator> result;
+                reader->withSnapshot([&] {
+                    const string &ksName = keyStore().name();
+                    result.reset(new SQLiteStreamingQueryEnumerator(
+                                            this, options,
+                                            df.lastSequence(ksName, &*reader),
+                                            df.purgeCount(ksName, &*reader),
+                                            reader->compile(statement->getQuery())));
+                });
+                result->adoptReader(move(reader));
+                return result.release();
+            }
+            logVerbose("No read connection available, so not streaming the results");
+        }
+
+        if (auto reader = df.borrowReader(); reader) {
+            // Run the query on a pooled read-only connection, so that it doesn't contend with
+            // other threads using the main connection, or other queries. Its read transaction
+            // ensures that lastSequence and purgeCount are consistent with the query results.
+            QueryEnumerator *result = nullptr;
+            reader->withSnapshot([&] {
+                const string &ksName = keyStore().name();
+                sequence_t curSeq = df.lastSequence(ksName, &*reader);
+                uint64_t purgeCnt = df.purgeCount(ksName, &*reader);
+                if (options && options->notOlderThan(curSeq, purgeCnt))
+                    return;
+                SQLiteQueryRunner recorder(this, options, curSeq, purgeCnt,
+                                           reader->compile(statement->getQuery()));
+                result = recorder.fastForward();
+            });
+            return result;
+        }
+
+        // Otherwise use the main connection. Start a read-only transaction, to ensure that the
+        // result of lastSequence() and purgeCount() will be consistent with the query results.
+        ReadOnlyTransaction t(df);
 
         sequence_t curSeq = lastSequence();
         uint64_t purgeCnt = purgeCount();
         if(options && options->notOlderThan(curSeq, purgeCnt))
             return nullptr;
-        SQLiteQueryRunner recorder(this, options, curSeq, purgeCnt);
+        SQLiteQueryRunner recorder(this, options, curSeq, purgeCnt, *statement);
         return recorder.fastForward();
     }
 
+
+#pragma mark - REFRESHING:
+
+
+    // If a refresh finds more changed docs than this, it's probably faster to re-run the query.
+    static constexpr size_t kMaxIncrementalChanges = 1000;
+
+
+    // Calls `fn(compile, lastSequence, purgeCount)` in a read transaction, on a pooled read-only
+    // connection if there is one, else the main connection. `compile` is a function that returns
+    // a statement compiled from a SQL string, on the connection being used.
+    template <class FN>
+    void SQLiteQuery::withSnapshot(FN fn) {
+        auto &df = (SQLiteDataFile&)keyStore().dataFile();
+        if (auto reader = df.borrowReader(); reader) {
+            reader->withSnapshot([&] {
+                const string &ksName = keyStore().name();
+                auto compile = [&](const string &sql) -> SQLite::Statement& {
+                    return reader->compile(sql);
+                };
+                fn(compile, df.lastSequence(ksName, &*reader), df.purgeCount(ksName, &*reader));
+            });
+        } else {
+            ReadOnlyTransaction t(df);
+            auto compile = [&](const string &sql) -> SQLite::Statement& {
+                return mainConnectionStatement(sql);
+            };
+            fn(compile, lastSequence(), purgeCount());
+        }
+    }
+
+
+    SQLite::Statement& SQLiteQuery::mainConnectionStatement(const string &sql) {
+        if (sql == statement()->getQuery())
+            return *_statement;
+        auto &stmt = _auxStatements[sql];
+        if (!stmt)
+            stmt.reset(((SQLiteKeyStore&)keyStore()).compile(sql));
+        return *stmt;
+    }
+
+
+    static bool rowsEqual(const Array *rows1, uint32_t i1, const Array *rows2, uint32_t i2) {
+        return rows1->get(2*i1)->isEqual(rows2->get(2*i2))
+            && rows1->get(2*i1 + 1)->asUnsigned() == rows2->get(2*i2 + 1)->asUnsigned();
+    }
+
+
+    // Returns a new enumerator if the query results have changed since `current` was created,
+    // else updates its lastSequence and returns null.
+    //
+    // If the query is incremental (see QueryParser::isIncremental) and `current` knows the docIDs
+    // of its rows, only the documents changed since then are queried. If the query is unordered,
+    // the new results are derived by replacing the rows of those documents; otherwise the query
+    // runs on just those documents plus the ones already in the results. Anything else, like a
+    // purge or a large number of changes, makes the whole query run again.
+    QueryEnumerator* SQLiteQuery::refresh(SQLiteQueryEnumerator *current) {
+        const SQLiteQueryPlan &plan = *_plan;
+        const bool incremental = !plan.trackedSQL.empty();
+        const Options *options = &current->options();
+        const sequence_t oldSeq = current->lastSequence();
+        unique_ptr<SQLiteQueryEnumerator> result;
+        bool mustCompare = true;        // Does `result` need to be compared with `current`?
+
+        withSnapshot([&](auto compile, sequence_t curSeq, uint64_t purgeCnt) {
+            if (purgeCnt == current->purgeCount()) {
+                if (curSeq <= oldSeq)
+                    return;                                         // Nothing has changed
+                if (incremental && current->docIDs()) {
+                    // Get the IDs of the documents changed (including deleted) since oldSeq:
+                    auto &changedStmt = compile("SELECT key FROM "
+                                            + ((SQLiteKeyStore&)keyStore()).tableName()
+                                            + " WHERE sequence > ? LIMIT ?");
+                    unordered_set<alloc_slice> changed;
+                    changedStmt.bind(1, (long long)oldSeq);
+                    changedStmt.bind(2, (long long)kMaxIncrementalChanges + 1);
+                    while (changedStmt.executeStep()) {
+                        SQLite::Column key = changedStmt.getColumn(0);
+                        changed.emplace(slice{key.getText(), (size_t)key.getBytes()});
+                    }
+                    changedStmt.reset();
+
+                    if (changed.size() <= kMaxIncrementalChanges) {
+                        const Array *oldRows = current->rows();
+                        const auto &oldIDs = *current->docIDs();
+
+                        // Query the changed docs:
+                        auto &deltaStmt = compile(plan.changedDocsSQL);
+                        SQLiteQueryRunner deltaRunner(this, options, curSeq, purgeCnt,
+                                                      deltaStmt, true);
+                        deltaStmt.bind(":since", (long long)oldSeq);
+                        unique_ptr<SQLiteQueryEnumerator> delta(deltaRunner.fastForward());
+                        const Array *deltaRows = delta->rows();
+                        const auto &deltaIDs = *delta->docIDs();
+
+                        // Find the current rows whose docs changed:
+                        unordered_map<slice, uint32_t> oldChangedRows;
+                        for (uint32_t i = 0; i < oldIDs.size(); ++i) {
+                            if (changed.find(oldIDs[i]) != changed.end())
+                                oldChangedRows.emplace(oldIDs[i], i);
+                        }
+
+                        // Are the results the same? If the query's ordered, a changed doc may
+                        // have moved even if its row is the same, so any change counts:
+                        bool same = (deltaIDs.size() == oldChangedRows.size());
+                        if (plan.hasOrderBy) {
+                            same = same && deltaIDs.empty();
+                        } else {
+                            for (uint32_t j = 0; same && j < deltaIDs.size(); ++j) {
+                                auto i = oldChangedRows.find(deltaIDs[j]);
+                                same = (i != oldChangedRows.end()
+                                        && rowsEqual(oldRows, i->second, deltaRows, j));
+                            }
+                        }
+                        if (same) {
+                            current->setLastSequence(curSeq);
+                            mustCompare = false;
+                            return;
+                        }
+
+                        if (!plan.hasOrderBy && !plan.hasLimit) {
+                            // Unordered: keep the unchanged rows, and append the changed ones:
+                            fleece::Stopwatch st;
+                            Encoder enc;
+                            auto sk = retained(new SharedKeys);
+                            enc.setSharedKeys(sk);
+                            enc.beginArray();
+                            SQLiteQueryEnumerator::DocIDs docIDs;
+                            docIDs.reserve(oldIDs.size() - oldChangedRows.size() + deltaIDs.size());
+                            auto writeRow = [&](const Array *rows, uint32_t i, const alloc_slice &docID) {
+                                enc.writeValue(rows->get(2*i));
+                                enc.writeValue(rows->get(2*i + 1));
+                                docIDs.push_back(docID);
+                            };
+                            for (uint32_t i = 0; i < oldIDs.size(); ++i) {
+                                if (oldChangedRows.find(oldIDs[i]) == oldChangedRows.end())
+                                    writeRow(oldRows, i, oldIDs[i]);
+                            }
+                            for (uint32_t j = 0; j < deltaIDs.size(); ++j)
+                                writeRow(deltaRows, j, deltaIDs[j]);
+                            enc.endArray();
+                            auto rowCount = docIDs.size();
+                            result.reset(new SQLiteQueryEnumerator(this, options, curSeq, purgeCnt,
+                                                                   enc.finishDoc(), rowCount,
+                                                                   st.elapsed(), move(docIDs)));
+                            mustCompare = false;
+                            return;
+                        }
+
+                        if (!plan.hasLimit || oldChangedRows.empty()) {
+                            // Ordered, or only new docs matched: the new results can only come
+                            // from the changed docs and the current rows, so query just those.
+                            // (If the query has a LIMIT and a current row's doc changed, docs
+                            // that didn't fit before might now, so that needs a full query.)
+                            Encoder idEnc;
+                            idEnc.beginArray(oldIDs.size());
+                            for (auto &docID : oldIDs)
+                                idEnc.writeString(docID);
+                            idEnc.endArray();
+                            alloc_slice idData = idEnc.finish();
+
+                            auto &stmt = compile(plan.candidateDocsSQL);
+                            SQLiteQueryRunner runner(this, options, curSeq, purgeCnt, stmt, true);
+                            stmt.bind(":since", (long long)oldSeq);
+                            stmt.bind(":docIDs", idData.buf, (int)idData.size);
+                            result.reset(runner.fastForward());
+                            return;
+                        }
+                    }
+                }
+            }
+
+            // Run the entire query; if it's incremental, track the docIDs for next time:
+            auto &stmt = compile(incremental ? plan.trackedSQL : statement()->getQuery());
+            SQLiteQueryRunner runner(this, options, curSeq, purgeCnt, stmt, incremental);
+            result.reset(runner.fastForward());
+        });
+
+        if (result && mustCompare && !current->obsoletedBy(result.get())) {
+            // Results are unchanged. Identical rows may still come from different docs, so take
+            // the new docIDs, to make the next refresh incremental:
+            current->adoptDocIDs(*result);
+            return nullptr;
+        }
+        return result.release();
+    }
+
 }
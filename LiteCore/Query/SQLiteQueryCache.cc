@@ -0,0 +1,135 @@
+//
+// SQLiteQueryCache.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "SQLiteQueryCache.hh"
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace std;
+
+namespace litecore {
+
+    static inline bool isWhitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+
+    // Appends the query text to `out`, leaving out whitespace that doesn't affect its meaning.
+    // In JSON, whitespace outside strings is removed. In N1QL it's collapsed to a single space,
+    // since it can separate words.
+    static void appendNormalized(string &out, slice text, QueryLanguage language) {
+        const bool json = (language == QueryLanguage::kJSON);
+        const size_t start = out.size();
+        char quote = 0;             // The delimiter of the literal we're in, if any
+        bool pendingSpace = false;
+        for (auto p = (const char*)text.buf, end = (const char*)text.end(); p < end; ++p) {
+            char c = *p;
+            if (quote) {
+                out += c;
+                if (json && c == '\\' && p + 1 < end)
+                    out += *++p;    // JSON escape sequence
+                else if (c == quote)
+                    quote = 0;      // (A doubled N1QL quote just closes and reopens the literal)
+            } else if (isWhitespace(c)) {
+                pendingSpace = !json;
+            } else {
+                if (pendingSpace && out.size() > start)
+                    out += ' ';
+                pendingSpace = false;
+                out += c;
+                if (c == '"' || (!json && (c == '\'' || c == '`')))
+                    quote = c;
+            }
+        }
+    }
+
+
+    /*static*/ string SQLiteQueryCache::key(const string &keyStoreName,
+                                            QueryLanguage language,
+                                            slice queryText)
+    {
+        string key;
+        key.reserve(keyStoreName.size() + 3 + queryText.size);
+        key += keyStoreName;
+        key += '\n';
+        key += char('0' + int(language));
+        key += '\n';
+        appendNormalized(key, queryText, language);
+        return key;
+    }
+
+
+    optional<SQLiteQueryCache::Entry> SQLiteQueryCache::get(const string &key,
+                                                           int64_t schemaVersion)
+    {
+        lock_guard<mutex> lock(_mutex);
+        auto i = _index.find(key);
+        if (i == _index.end()) {
+            ++_stats.misses;
+            return nullopt;
+        }
+        List::iterator item = i->second;
+        if (item->schemaVersion != schemaVersion) {
+            // Compiled before a schema change, so the SQL may be out of date:
+            _items.erase(item);
+            _index.erase(i);
+            ++_stats.misses;
+            return nullopt;
+        }
+        _items.splice(_items.begin(), _items, item);    // Move to front (most recently used)
+        ++_stats.hits;
+
+        Entry result {item->entry.plan, nullptr};
+        // Only hand out the statement if no other query is using it. (If the count is stale,
+        // it can only be too high, since new references are only made here, under the mutex.)
+        if (item->entry.statement && item->entry.statement.use_count() == 1)
+            result.statement = item->entry.statement;
+        return result;
+    }
+
+
+    void SQLiteQueryCache::put(const string &key, int64_t schemaVersion, Entry entry) {
+        lock_guard<mutex> lock(_mutex);
+        if (auto i = _index.find(key); i != _index.end()) {
+            _items.erase(i->second);
+            _index.erase(i);
+        }
+        _items.push_front({key, schemaVersion, move(entry)});
+        _index.emplace(key, _items.begin());
+        if (_items.size() > _capacity) {
+            _index.erase(_items.back().key);
+            _items.pop_back();
+        }
+    }
+
+
+    void SQLiteQueryCache::clear() {
+        lock_guard<mutex> lock(_mutex);
+        _index.clear();
+        _items.clear();
+    }
+
+
+    SQLiteQueryCache::Stats SQLiteQueryCache::stats(bool reset) {
+        lock_guard<mutex> lock(_mutex);
+        Stats stats = _stats;
+        if (reset)
+            _stats = {};
+        return stats;
+    }
+
+}
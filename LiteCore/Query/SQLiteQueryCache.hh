@@ -0,0 +1,115 @@
+//
+// SQLiteQueryCache.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "Base.hh"
+#include "KeyStore.hh"
+#include "QueryParser.hh"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SQLite {
+    class Statement;
+}
+
+namespace litecore {
+
+    /** Everything a SQLiteQuery derives from its query text by parsing it. */
+    struct SQLiteQueryPlan {
+        alloc_slice              json;                      // JSON form of the query
+        std::string              sql;                       // Generated SQL
+        std::set<std::string>    parameters;                // Names of the bindable parameters
+        std::vector<std::string> ftsTables;                 // Names of the FTS tables used
+        std::vector<std::string> columnTitles;              // Titles of columns
+        unsigned                 firstCustomResultColumn {0};// Index of 1st column declared in JSON
+        bool                     usesExpiration {false};    // Does it use the expiration column?
+        std::set<QueryParser::IndexableProperty> indexableProperties; // For SQLiteIndexAdvisor
+
+        // Forms of the SQL used to refresh results incrementally; empty if that's not possible.
+        // (See QueryParser::isIncremental.) Each has the docID as an extra first column.
+        std::string              trackedSQL;                // Full query
+        std::string              changedDocsSQL;            // Only docs changed since `:since`
+        std::string              candidateDocsSQL;          // Changed docs or those in `:docIDs`
+        bool                     hasOrderBy {false};
+        bool                     hasLimit {false};
+    };
+
+
+    /** An LRU cache of compiled queries, owned by a SQLiteDataFile. Creating a query whose text
+        is in the cache skips parsing and SQL generation, and also reuses the compiled SQLite
+        statement if no other live query is using it.
+        Entries are keyed by KeyStore, query language, and query text with insignificant
+        whitespace removed. They're tagged with the database's schema version, so they're
+        invalidated by any schema change, such as creating or deleting an index. */
+    class SQLiteQueryCache {
+    public:
+        static constexpr size_t kDefaultCapacity = 50;
+
+        struct Entry {
+            std::shared_ptr<const SQLiteQueryPlan> plan;
+            std::shared_ptr<SQLite::Statement>     statement;   // Null if in use by a query
+        };
+
+        struct Stats {
+            uint64_t hits {0};
+            uint64_t misses {0};
+        };
+
+        explicit SQLiteQueryCache(size_t capacity =kDefaultCapacity)
+        :_capacity(capacity)
+        { }
+
+        /** Returns the cache key for a query. */
+        static std::string key(const std::string &keyStoreName,
+                               QueryLanguage,
+                               slice queryText);
+
+        /** Looks up a query, given the database's current schema version. */
+        std::optional<Entry> get(const std::string &key, int64_t schemaVersion);
+
+        /** Adds a newly compiled query, evicting the least recently used one if necessary. */
+        void put(const std::string &key, int64_t schemaVersion, Entry);
+
+        /** Removes all entries. Must be called before the SQLite database is closed, since the
+            entries contain compiled statements. */
+        void clear();
+
+        Stats stats(bool reset =false);
+
+    private:
+        struct Item {
+            std::string key;
+            int64_t     schemaVersion;
+            Entry       entry;
+        };
+        using List = std::list<Item>;
+
+        size_t const                                  _capacity;
+        std::mutex                                    _mutex;
+        List                                          _items;       // Most recently used first
+        std::unordered_map<std::string, List::iterator> _index;
+        Stats                                         _stats;
+    };
+
+}
@@ -35,23 +35,27 @@ namespace litecore {
 #pragma pack()
 
 
-    std::deque<Rev> RawRevision::decodeTree(slice raw_tree,
-                                            RevTree::RemoteRevMap &remoteMap,
-                                            RevTree* owner,
-                                            sequence_t curSeq)
+    void RawRevision::decodeTree(slice raw_tree,
+                                 RevTree::RevVector &revs,
+                                 RevTree::RemoteRevMap &remoteMap,
+                                 RevTree* owner,
+                                 sequence_t curSeq,
+                                 Arena &arena)
     {
         const RawRevision *rawRev = (const RawRevision*)raw_tree.buf;
         unsigned count = rawRev->count();
         if (count > UINT16_MAX)
             error::_throw(error::CorruptRevisionData);
-        deque<Rev> revs(count);
-        auto rev = revs.begin();
-        for (; rawRev->isValid(); rawRev = rawRev->next()) {
-            rawRev->copyTo(*rev, revs);
+        // Allocate all the Revs at once, as an array:
+        Rev *storage = (Rev*)arena.alloc(count * sizeof(Rev), alignof(Rev));
+        revs.reserve(count);
+        for (Rev *rev = storage; rawRev->isValid(); rawRev = rawRev->next()) {
+            new (rev) Rev();
+            rawRev->copyTo(*rev, storage, count);
             if (rev->sequence == 0)
                 rev->sequence = curSeq;
             rev->owner = owner;
-            rev++;
+            revs.push_back(rev++);
         }
 
         auto entry = (const RemoteEntry*)offsetby(rawRev, sizeof(uint32_t));
@@ -60,18 +64,17 @@ namespace litecore {
             auto revIndex = endian::dec16(entry->revIndex_BE);
             if (remoteID == 0 || revIndex >= count)
                 error::_throw(error::CorruptRevisionData);
-            remoteMap[remoteID] = &revs[revIndex];
+            remoteMap[remoteID] = revs[revIndex];
             ++entry;
         }
 
         if ((uint8_t*)entry != (uint8_t*)raw_tree.end()) {
             error::_throw(error::CorruptRevisionData);
         }
-        return revs;
     }
 
 
-    alloc_slice RawRevision::encodeTree(const vector<Rev*> &revs,
+    alloc_slice RawRevision::encodeTree(const RevTree::RevVector &revs,
                                         const RevTree::RemoteRevMap &remoteMap)
     {
         // Allocate output buffer:
@@ -127,15 +130,17 @@ namespace litecore {
         return (RawRevision*)offsetby(this, revSize);
     }
 
-    void RawRevision::copyTo(Rev &dst, const deque<Rev> &revs) const {
+    void RawRevision::copyTo(Rev &dst, Rev *revs, unsigned count) const {
         const void* end = this->next();
         dst.revID = {this->revID, this->revIDLen};
         dst.flags = (Rev::Flags)(this->flags & ~kPersistentOnlyFlags);
         auto parentIndex = endian::dec16(this->parentIndex_BE);
         if (parentIndex == kNoParent)
             dst.parent = nullptr;
-        else
+        else if (parentIndex < count)
             dst.parent = &revs[parentIndex];
+        else
+            error::_throw(error::CorruptRevisionData);
         const void *data = offsetby(&this->revID, this->revIDLen);
         ptrdiff_t len = (uint8_t*)end-(uint8_t*)data;
         data = offsetby(data, GetUVarInt(slice(data, len), &dst.sequence));
@@ -146,6 +151,132 @@ namespace litecore {
     }
 
 
+    void RawRevision::validateTree(slice raw_tree) {
+        // Check that the revs, and the trailing zero size, fit in the tree:
+        auto rawRev = (const RawRevision*)raw_tree.buf;
+        unsigned count = 0;
+        for (;;) {
+            size_t left = (uint8_t*)raw_tree.end() - (uint8_t*)rawRev;
+            if (left < sizeof(uint32_t))
+                error::_throw(error::CorruptRevisionData);
+            if (!rawRev->isValid())
+                break;
+            size_t size = endian::dec32(rawRev->size_BE);
+            if (left < offsetof(RawRevision, revID) || size > left
+                    || size < offsetof(RawRevision, revID) + rawRev->revIDLen + 1)
+                error::_throw(error::CorruptRevisionData);
+            rawRev = rawRev->next();
+            ++count;
+        }
+        if (count > UINT16_MAX)
+            error::_throw(error::CorruptRevisionData);
+
+        // Check the parent indexes:
+        auto endOfRevs = rawRev;
+        rawRev = (const RawRevision*)raw_tree.buf;
+        for (; rawRev != endOfRevs; rawRev = rawRev->next()) {
+            auto parentIndex = endian::dec16(rawRev->parentIndex_BE);
+            if (parentIndex != kNoParent && parentIndex >= count)
+                error::_throw(error::CorruptRevisionData);
+        }
+
+        // Check the remote entries:
+        auto entry = (const RemoteEntry*)offsetby(endOfRevs, sizeof(uint32_t));
+        if (((uint8_t*)raw_tree.end() - (uint8_t*)entry) % sizeof(RemoteEntry) != 0)
+            error::_throw(error::CorruptRevisionData);
+        for (; entry < raw_tree.end(); ++entry) {
+            if (entry->remoteDBID_BE == 0 || endian::dec16(entry->revIndex_BE) >= count)
+                error::_throw(error::CorruptRevisionData);
+        }
+    }
+
+
+    void RawRevision::getInfo(RevInfo &info, sequence_t curSeq) const {
+        info.revID = {this->revID, this->revIDLen};
+        info.flags = (Rev::Flags)(this->flags & ~kPersistentOnlyFlags);
+        const void *data = offsetby(&this->revID, this->revIDLen);
+        ptrdiff_t len = (uint8_t*)this->next()-(uint8_t*)data;
+        GetUVarInt(slice(data, len), &info.sequence);
+        if (info.sequence == 0)
+            info.sequence = curSeq;
+        info.body = this->body();
+    }
+
+
+    bool RawRevision::getCurrentRev(slice raw_tree, sequence_t curSeq, RevInfo &info) {
+        const RawRevision *rawRev = (const RawRevision*)raw_tree.buf;
+        if (raw_tree.size < sizeof(uint32_t) || !rawRev->isValid())
+            return false;
+        rawRev->getInfo(info, curSeq);          // Revs are sorted, so the 1st one is current
+        return true;
+    }
+
+
+    const RawRevision* RawRevision::find(slice raw_tree, revid revID) {
+        if (raw_tree.size < sizeof(uint32_t))
+            return nullptr;
+        auto rawRev = (const RawRevision*)raw_tree.buf;
+        for (; rawRev->isValid(); rawRev = rawRev->next()) {
+            if (revid(rawRev->revID, rawRev->revIDLen) == revID)
+                return rawRev;
+        }
+        return nullptr;
+    }
+
+
+    const RawRevision* RawRevision::at(slice raw_tree, unsigned index) {
+        auto rawRev = (const RawRevision*)raw_tree.buf;
+        for (; rawRev->isValid(); rawRev = rawRev->next()) {
+            if (index-- == 0)
+                return rawRev;
+        }
+        error::_throw(error::CorruptRevisionData);
+    }
+
+
+    bool RawRevision::findRev(slice raw_tree, revid revID, sequence_t curSeq, RevInfo &info) {
+        const RawRevision *rawRev = find(raw_tree, revID);
+        if (!rawRev)
+            return false;
+        rawRev->getInfo(info, curSeq);
+        return true;
+    }
+
+
+    bool RawRevision::findParentRev(slice raw_tree, revid revID, sequence_t curSeq,
+                                    RevInfo &info)
+    {
+        const RawRevision *rawRev = find(raw_tree, revID);
+        if (!rawRev)
+            return false;
+        auto parentIndex = endian::dec16(rawRev->parentIndex_BE);
+        if (parentIndex == kNoParent)
+            return false;
+        at(raw_tree, parentIndex)->getInfo(info, curSeq);
+        return true;
+    }
+
+
+    bool RawRevision::getLatestRevOnRemote(slice raw_tree, RevTree::RemoteID remote,
+                                           sequence_t curSeq, RevInfo &info)
+    {
+        if (raw_tree.size < sizeof(uint32_t))
+            return false;
+        auto rawRev = (const RawRevision*)raw_tree.buf;
+        while (rawRev->isValid())
+            rawRev = rawRev->next();
+
+        auto entry = (const RemoteEntry*)offsetby(rawRev, sizeof(uint32_t));
+        for (; entry < raw_tree.end(); ++entry) {
+            if (endian::dec16(entry->remoteDBID_BE) == remote) {
+                at(raw_tree, endian::dec16(entry->revIndex_BE))->getInfo(info, curSeq);
+                return true;
+            }
+        }
+        return false;
+    }
+
+
     slice RawRevision::body() const {
         if (_usuallyTrue(this->flags & RawRevision::kHasData)) {
             const void* end = this->next();
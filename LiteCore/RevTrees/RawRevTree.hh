@@ -21,7 +21,6 @@
 #include "RevTree.hh"
 #include "KeyStore.hh"
 #include "Endian.hh"
-#include <deque>
 #include <vector>
 
 
@@ -36,12 +35,14 @@ namespace litecore {
     // revision is the current one for every remote database.
     class RawRevision {
     public:
-        static std::deque<Rev> decodeTree(slice raw_tree,
-                                          RevTree::RemoteRevMap &remoteMap,
-                                          RevTree *owner NONNULL,
-                                          sequence_t curSeq);
-
-        static alloc_slice encodeTree(const std::vector<Rev*> &revs,
+        static void decodeTree(slice raw_tree,
+                               RevTree::RevVector &revs,
+                               RevTree::RemoteRevMap &remoteMap,
+                               RevTree *owner NONNULL,
+                               sequence_t curSeq,
+                               Arena&);
+
+        static alloc_slice encodeTree(const RevTree::RevVector &revs,
                                       const RevTree::RemoteRevMap &remoteMap);
 
         static inline slice getCurrentRevBody(slice raw_tree) noexcept {
@@ -49,6 +50,18 @@ namespace litecore {
             return rawRev->body();
         }
 
+        // Throws CorruptRevisionData unless the encoded tree is well-formed, so that the
+        // functions below can read it in place without failing:
+        static void validateTree(slice raw_tree);
+
+        // These read revisions in place, without decoding the tree (see RevTree::decodeLazily.)
+        // They return false if there's no such revision:
+        static bool getCurrentRev(slice raw_tree, sequence_t curSeq, RevInfo&);
+        static bool findRev(slice raw_tree, revid, sequence_t curSeq, RevInfo&);
+        static bool findParentRev(slice raw_tree, revid, sequence_t curSeq, RevInfo&);
+        static bool getLatestRevOnRemote(slice raw_tree, RevTree::RemoteID, sequence_t curSeq,
+                                         RevInfo&);
+
     private:
         static const uint16_t kNoParent = UINT16_MAX;
 
@@ -87,7 +100,10 @@ namespace litecore {
         }
 
         static size_t sizeToWrite(const Rev&);
-        void copyTo(Rev &dst, const std::deque<Rev>&) const;
+        void copyTo(Rev &dst, Rev *revs, unsigned count) const;
+        void getInfo(RevInfo&, sequence_t curSeq) const;
+        static const RawRevision* find(slice raw_tree, revid);
+        static const RawRevision* at(slice raw_tree, unsigned index);
         RawRevision* copyFrom(const Rev &rev);
     };
 
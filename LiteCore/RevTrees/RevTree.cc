@@ -41,24 +41,25 @@ namespace litecore {
     }
 
     RevTree::RevTree(const RevTree &other)
-    :_insertedData(other._insertedData)
-    ,_sorted(other._sorted)
-    ,_changed(other._changed)
+    :_changed(other._changed)
     ,_unknown(other._unknown)
+    ,_sorted(other._sorted)
+    ,_insertedData(other._insertedData.begin(), other._insertedData.end(), _arena)
+    ,_rawTree(other._rawTree)
+    ,_rawSequence(other._rawSequence)
     {
-        // It's important to have _revs in the same order as other._revs.
-        // That means we can't just copy other._revsStorage to _revsStorage;
-        // we have to copy _revs in order:
+        // (If other hasn't been decoded yet, its _revs is empty, and so will mine be.)
+        // It's important to have _revs in the same order as other._revs, so copy them in order:
         _revs.reserve(other._revs.size());
-        for (const Rev *otherRev : other._revs) {
-            _revsStorage.emplace_back(*otherRev);
-            _revs.push_back(&_revsStorage.back());
-        }
-        // Fix up the newly copied Revs so they point to me (and my other Revs), not other:
+        for (const Rev *otherRev : other._revs)
+            _revs.push_back(_arena.make<Rev>(*otherRev));
+        // Fix up the newly copied Revs so they point to me (and my other Revs), not other.
+        // The revIDs of inserted Revs are in other's arena, so copy them to mine:
         for (Rev *rev : _revs) {
             if (rev->parent)
                 rev->parent = _revs[rev->parent->index()];
             rev->owner = this;
+            rev->revID = revid(_arena.copy(rev->revID));
         }
         // Copy _remoteRevs:
         for (auto &i : other._remoteRevs) {
@@ -67,20 +68,29 @@ namespace litecore {
     }
 
     void RevTree::decode(litecore::slice raw_tree, sequence_t seq) {
-        _revsStorage = RawRevision::decodeTree(raw_tree, _remoteRevs, this, seq);
-        initRevs();
+        _rawTree = nullslice;
+        _revs.clear();
+        _remoteRevs.clear();
+        RawRevision::decodeTree(raw_tree, _revs, _remoteRevs, this, seq, _arena);
     }
 
-    void RevTree::initRevs() {
-        _revs.resize(_revsStorage.size());
-        auto i = _revs.begin();
-        for (Rev &rev : _revsStorage) {
-            *i = &rev;
-            ++i;
-        }
+    void RevTree::decodeLazily(slice raw_tree, sequence_t seq) {
+        // Fail now if the tree is corrupt, not later when it's read or decoded:
+        RawRevision::validateTree(raw_tree);
+        _revs.clear();
+        _remoteRevs.clear();
+        _sorted = true;
+        _rawTree = raw_tree;
+        _rawSequence = seq;
+    }
+
+    void RevTree::decodeNow() {
+        decode(_rawTree, _rawSequence);
+        didDecodeLazily();
     }
 
     alloc_slice RevTree::encode() {
+        decodeIfNeeded();
         sort();
         return RawRevision::encodeTree(_revs, _remoteRevs);
     }
@@ -103,17 +113,20 @@ namespace litecore {
 
     const Rev* RevTree::currentRevision() {
         Assert(!_unknown);
+        decodeIfNeeded();
         sort();
         return _revs.size() == 0 ? nullptr : _revs[0];
     }
 
     const Rev* RevTree::get(unsigned index) const {
         Assert(!_unknown);
+        decodeIfNeeded();
         Assert(index < _revs.size());
         return _revs[index];
     }
 
     const Rev* RevTree::get(revid revID) const {
+        decodeIfNeeded();
         for (Rev *rev : _revs) {
             if (rev->revID == revID)
                 return rev;
@@ -123,6 +136,7 @@ namespace litecore {
     }
 
     const Rev* RevTree::getBySequence(sequence_t seq) const {
+        decodeIfNeeded();
         for (Rev *rev : _revs) {
             if (rev->sequence == seq)
                 return rev;
@@ -132,6 +146,7 @@ namespace litecore {
     }
 
     bool RevTree::hasConflict() const {
+        decodeIfNeeded();
         if (_revs.size() < 2) {
             Assert(!_unknown);
             return false;
@@ -149,6 +164,59 @@ namespace litecore {
         }
     }
 
+    static RevInfo infoOf(const Rev *rev) {
+        return {rev->revID, rev->flags, rev->sequence, rev->body()};
+    }
+
+    bool RevTree::currentRevisionInfo(RevInfo &info) {
+        Assert(!_unknown);
+        if (isDecoded()) {
+            const Rev *rev = currentRevision();
+            if (!rev)
+                return false;
+            info = infoOf(rev);
+            return true;
+        }
+        return rawRevInfo(RawRevision::getCurrentRev(_rawTree, _rawSequence, info), info);
+    }
+
+    bool RevTree::revisionInfo(revid revID, RevInfo &info) {
+        Assert(!_unknown);
+        if (isDecoded()) {
+            const Rev *rev = get(revID);
+            if (!rev)
+                return false;
+            info = infoOf(rev);
+            return true;
+        }
+        return rawRevInfo(RawRevision::findRev(_rawTree, revID, _rawSequence, info), info);
+    }
+
+    bool RevTree::parentRevisionInfo(revid revID, RevInfo &info) {
+        Assert(!_unknown);
+        if (isDecoded()) {
+            const Rev *rev = get(revID);
+            if (!rev || !rev->parent)
+                return false;
+            info = infoOf(rev->parent);
+            return true;
+        }
+        return rawRevInfo(RawRevision::findParentRev(_rawTree, revID, _rawSequence, info), info);
+    }
+
+    // Finishes a RevInfo read from _rawTree, e.g. making sure its body is usable as Fleece.
+    bool RevTree::rawRevInfo(bool found, RevInfo &info) {
+        if (!found)
+            return false;
+        if ((size_t)info.body.buf & 1) {
+            // Fleece data must be 2-byte-aligned, so we have to copy body to the heap
+            // (as Rev::body does):
+            info.body = (slice)copyBody(info.body);
+        }
+        didReadRevInfo(info);
+        return true;
+    }
+
     bool Rev::isActive() const {
         // "Active" revs contribute to conflicts, or rather, a conflict is when there is more than
         // one active rev.
@@ -227,6 +295,7 @@ namespace litecore {
                                                     bool allowConflict)
     {
         Assert(history.size() > 0);
+        decodeIfNeeded();
         unsigned lastGen = 0;
         Rev* parent = nullptr;
         size_t historyCount = history.size();
@@ -289,12 +358,11 @@ namespace litecore {
         Assert(!((revFlags & Rev::kClosed) && !(revFlags & Rev::kDeleted)));
 
         Assert(!_unknown);
+        decodeIfNeeded();
         // Allocate copies of the revID and data so they'll stay around:
-        _insertedData.emplace_back(unownedRevID);
-        revid revID = revid(_insertedData.back());
+        revid revID = revid(_arena.copy(unownedRevID));
 
-        _revsStorage.emplace_back();
-        Rev *newRev = &_revsStorage.back();
+        Rev *newRev = _arena.make<Rev>();
         newRev->owner = this;
         newRev->revID = revID;
         newRev->_body = (slice)copyBody(body);
@@ -455,6 +523,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
 
     // Remove bodies of already-saved revs that are no longer leaves:
     void RevTree::removeNonLeafBodies() {
+        decodeIfNeeded();
         for (Rev *rev : _revs) {
             if (rev->_body.size > 0 && !(rev->flags & (Rev::kLeaf | Rev::kNew | Rev::kKeepBody))) {
                 rev->removeBody();
@@ -464,6 +533,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     unsigned RevTree::prune(unsigned maxDepth) {
+        decodeIfNeeded();
         Assert(maxDepth > 0);
         if (_revs.size() <= maxDepth)
             return 0;
@@ -512,6 +582,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     int RevTree::purge(revid leafID) {
+        decodeIfNeeded();
         int nPurged = 0;
         Rev* rev = (Rev*)get(leafID);
         if (!rev || !rev->isLeaf())
@@ -529,6 +600,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     int RevTree::purgeAll() {
+        decodeIfNeeded();
         int result = (int)_revs.size();
         _revs.resize(0);
         _changed = true;
@@ -585,6 +657,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     void RevTree::sort() {
+        decodeIfNeeded();
         if (_sorted)
             return;
         std::sort(_revs.begin(), _revs.end(), &compareRevs);
@@ -599,6 +672,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     bool RevTree::hasNewRevisions() const {
+        decodeIfNeeded();
         for (Rev *rev : _revs) {
             if (rev->isNew() || rev->sequence == 0)
                 return true;
@@ -607,6 +681,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
     void RevTree::saved(sequence_t newSequence) {
+        decodeIfNeeded();
         for (Rev *rev : _revs) {
             rev->clearFlag(Rev::kNew);
             if (rev->sequence == 0) {
@@ -628,6 +703,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
 
     const Rev* RevTree::latestRevisionOnRemote(RemoteID remote) {
         Assert(remote != kNoRemoteID);
+        decodeIfNeeded();
         auto i = _remoteRevs.find(remote);
         if (i == _remoteRevs.end())
             return nullptr;
@@ -637,6 +713,7 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
 
     void RevTree::setLatestRevisionOnRemote(RemoteID remote, const Rev *rev) {
         Assert(remote != kNoRemoteID);
+        decodeIfNeeded();
         if (rev) {
             _remoteRevs[remote] = rev;
         } else {
@@ -646,12 +723,27 @@ void RevTree::resetConflictSequence(const Rev* winningRev) {
     }
 
 
+    bool RevTree::latestRevisionInfoOnRemote(RemoteID remote, RevInfo &info) {
+        Assert(remote != kNoRemoteID);
+        if (isDecoded()) {
+            const Rev *rev = latestRevisionOnRemote(remote);
+            if (!rev)
+                return false;
+            info = infoOf(rev);
+            return true;
+        }
+        return rawRevInfo(RawRevision::getLatestRevOnRemote(_rawTree, remote, _rawSequence, info),
+                          info);
+    }
+
+
 #if DEBUG
     void RevTree::dump() {
         dump(std::cerr);
     }
 
     void RevTree::dump(std::ostream& out) {
+        decodeIfNeeded();
         int i = 0;
         for (Rev *rev : _revs) {
             out << "\t" << (++i) << ": ";
@@ -20,8 +20,8 @@
 #include "PlatformCompat.hh"
 #include "fleece/slice.hh"
 #include "RevID.hh"
+#include "Arena.hh"
 #include <climits>
-#include <deque>
 #include <unordered_map>
 #include <vector>
 
@@ -88,9 +88,21 @@ namespace litecore {
     };
 
 
+    /** A revision's metadata, as returned by the RevTree accessors that don't need to decode
+        the tree into Rev objects. */
+    struct RevInfo {
+        revid       revID;
+        Rev::Flags  flags;
+        sequence_t  sequence;
+        slice       body;
+    };
+
+
     /** A serializable tree of Revisions. */
     class RevTree {
     public:
+        using RevVector = std::vector<Rev*, ArenaAllocator<Rev*>>;
+
         RevTree() { }
         RevTree(slice raw_tree, sequence_t seq);
         RevTree(const RevTree&);
@@ -98,20 +110,33 @@ namespace litecore {
 
         void decode(slice raw_tree, sequence_t seq);
 
+        /** Like `decode`, but defers decoding until Rev objects are first needed, e.g. by a
+            mutation. Until then the `...Info` accessors read revisions in place from `raw_tree`,
+            which must remain valid. Throws CorruptRevisionData if `raw_tree` is malformed. */
+        void decodeLazily(slice raw_tree, sequence_t seq);
+
+        bool isDecoded() const                          {return _rawTree.buf == nullptr;}
+
         alloc_slice encode();
 
-        size_t size() const                             {return _revs.size();}
+        size_t size() const                             {decodeIfNeeded(); return _revs.size();}
         const Rev* get(unsigned index) const;
         const Rev* get(revid) const;
         const Rev* operator[](unsigned index) const {return get(index);}
         const Rev* operator[](revid revID) const    {return get(revID);}
         const Rev* getBySequence(sequence_t) const;
 
-        const std::vector<Rev*>& allRevisions() const   {return _revs;}
+        const RevVector& allRevisions() const           {decodeIfNeeded(); return _revs;}
         const Rev* currentRevision();
         bool hasConflict() const;
         bool hasNewRevisions() const;
 
+        // These don't decode the tree, if it's being decoded lazily.
+        // They return false if there's no such revision.
+        bool currentRevisionInfo(RevInfo&);
+        bool revisionInfo(revid, RevInfo&);
+        bool parentRevisionInfo(revid, RevInfo&);
+
         /// Given an array of revision IDs in consecutive descending-generation order,
         /// finds the first one that exists in this tree. Returns:
         /// * {rev, index} if a common ancestor was found;
@@ -182,6 +207,7 @@ namespace litecore {
 
         const Rev* latestRevisionOnRemote(RemoteID);
         void setLatestRevisionOnRemote(RemoteID, const Rev*);
+        virtual bool latestRevisionInfoOnRemote(RemoteID, RevInfo&);  // doesn't decode
 
 #if DEBUG
         void dump();
@@ -193,6 +219,12 @@ namespace litecore {
         virtual alloc_slice readBodyOfRevision(const Rev* r NONNULL) const;
         virtual alloc_slice copyBody(slice body);
         virtual alloc_slice copyBody(const alloc_slice &body);
+        virtual void didDecodeLazily()                  { }
+        virtual void didReadRevInfo(RevInfo&)           { }
+        void decodeIfNeeded() const {
+            if (_usuallyFalse(_rawTree.buf != nullptr))
+                const_cast<RevTree*>(this)->decodeNow();
+        }
 #if DEBUG
         virtual void dump(std::ostream&);
 #endif
@@ -203,20 +235,34 @@ namespace litecore {
     private:
         friend class Rev;
         friend class RawRevision;
-        void initRevs();
+        void decodeNow();
+        bool rawRevInfo(bool found, RevInfo&);
         Rev* _insert(revid, alloc_slice body, Rev *parentRev, Rev::Flags, bool markConflicts);
         bool confirmLeaf(Rev* testRev NONNULL);
         void compact();
         void checkForResolvedConflict();
 
-        using RemoteRevMap = std::unordered_map<RemoteID, const Rev*>;
-
+        using RemoteRevMap = std::unordered_map<RemoteID, const Rev*, std::hash<RemoteID>,
+                                                std::equal_to<RemoteID>,
+                                                ArenaAllocator<std::pair<const RemoteID, const Rev*>>>;
+        using DataVector = std::vector<alloc_slice, ArenaAllocator<alloc_slice>>;
+
+        // The Revs, new revIDs, and containers' storage are all allocated from _arena, which
+        // frees them together when the tree is destructed. (It must be declared first, so it's
+        // destructed after the containers.) The arena isn't reset when the tree is decoded
+        // again, or when a container's storage is reallocated, so it holds the Revs of each
+        // decode plus storage abandoned by growing containers; growth is geometric, so the
+        // latter is less than their final size. A VersionedDocument decodes its tree at most
+        // once, since it only re-reads a record that was read without its body.
+        Arena                    _arena;
         bool                     _sorted {true};        // Is _revs currently sorted?
-        std::vector<Rev*>        _revs;                 // Revs in sorted order
-        std::deque<Rev>          _revsStorage;          // Actual storage of the Rev objects
-        std::vector<alloc_slice> _insertedData;         // Storage for new revids
-        RemoteRevMap             _remoteRevs;           // Tracks current rev for a remote DB URL
+        RevVector                _revs {_arena};        // Revs in sorted order
+        DataVector               _insertedData {_arena};// Storage for new bodies
+        RemoteRevMap             _remoteRevs {RemoteRevMap::allocator_type(_arena)};
+                                                        // Tracks current rev for a remote DB URL
         unsigned                 _pruneDepth {UINT_MAX};// Tree depth to prune to
+        slice                    _rawTree;              // Encoded tree not decoded yet
+        sequence_t               _rawSequence {0};      // Sequence of _rawTree's record
     };
 
 }
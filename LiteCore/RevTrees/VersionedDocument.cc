@@ -64,22 +64,39 @@ namespace litecore {
         _unknown = false;
         updateScope();
         if (_rec.body().buf) {
-            RevTree::decode(_rec.body(), _rec.sequence());
-            // The kSynced flag is set when the document's current revision is pushed to a server.
-            // This is done instead of updating the doc body, for reasons of speed. So when loading
-            // the document, detect that flag and belatedly update the current revision's flags.
-            // Since the revision is now likely stored on the server, it may be the base of a merge
-            // in the future, so preserve its body:
-            if (_rec.flags() & DocumentFlags::kSynced) {
-                setLatestRevisionOnRemote(kDefaultRemoteID, currentRevision());
-                keepBody(currentRevision());
-                _changed = false;
-            }
+            // Most documents are only read, often just their current revision, so don't
+            // allocate Revs for the whole tree until they're needed:
+            RevTree::decodeLazily(_rec.body(), _rec.sequence());
         } else if (_rec.bodySize() > 0) {
             _unknown = true;        // i.e. rec was read as meta-only
         }
     }
 
+    void VersionedDocument::didDecodeLazily() {
+        // The kSynced flag is set when the document's current revision is pushed to a server.
+        // This is done instead of updating the doc body, for reasons of speed. So when loading
+        // the document, detect that flag and belatedly update the current revision's flags.
+        // Since the revision is now likely stored on the server, it may be the base of a merge
+        // in the future, so preserve its body:
+        if (_rec.flags() & DocumentFlags::kSynced) {
+            bool changed = _changed;
+            setLatestRevisionOnRemote(kDefaultRemoteID, currentRevision());
+            keepBody(currentRevision());
+            _changed = changed;
+        }
+    }
+
+    void VersionedDocument::didReadRevInfo(RevInfo &info) {
+        if ((_rec.flags() & DocumentFlags::kSynced) && info.revID == revID())
+            info.flags = Rev::Flags(info.flags | Rev::kKeepBody);   // as didDecodeLazily does
+    }
+
+    bool VersionedDocument::latestRevisionInfoOnRemote(RemoteID remote, RevInfo &info) {
+        if (!isDecoded() && remote == kDefaultRemoteID && (_rec.flags() & DocumentFlags::kSynced))
+            return currentRevisionInfo(info);                      // as didDecodeLazily does
+        return RevTree::latestRevisionInfoOnRemote(remote, info);
+    }
+
     void VersionedDocument::updateScope() {
         Assert(_fleeceScopes.empty());
         addScope(_rec.body());
@@ -192,6 +209,20 @@ namespace litecore {
         return createSequence ? kNewSequence : kNoNewSequence;
     }
 
+    alloc_slice VersionedDocument::encodeForSave() {
+        Assert(currentRevision());
+        updateMeta();
+        removeNonLeafBodies();
+        return encode();
+    }
+
+    void VersionedDocument::savedAs(sequence_t seq) {
+        _rec.updateSequence(seq);
+        _rec.setExists();
+        saved(seq);
+        _changed = false;
+    }
+
 #if DEBUG
     void VersionedDocument::dump(std::ostream& out) {
         out << "\"" << (std::string)docID() << "\" / " << (std::string)revID();
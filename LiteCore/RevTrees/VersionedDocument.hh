@@ -64,8 +64,18 @@ namespace litecore {
         enum SaveResult {kConflict, kNoNewSequence, kNewSequence};
         SaveResult save(Transaction& transaction);
 
+        /** The first half of a save whose record write is done by the caller (e.g. batched with
+            others via `KeyStore::setMany`.) Updates the metadata, and returns the new body.
+            The document must have a current revision. */
+        alloc_slice encodeForSave();
+
+        /** The second half: call after the record has been written with a new sequence. */
+        void savedAs(sequence_t);
+
         bool updateMeta();
 
+        virtual bool latestRevisionInfoOnRemote(RemoteID, RevInfo&) override;
+
         fleece::Retained<fleece::impl::Doc> fleeceDocFor(slice) const;
 
         /** Given a Fleece Value, finds the VersionedDocument it belongs to. */
@@ -80,6 +90,8 @@ namespace litecore {
     protected:
         virtual alloc_slice copyBody(slice body) override;
         virtual alloc_slice copyBody(const alloc_slice &body) override;
+        virtual void didDecodeLazily() override;
+        virtual void didReadRevInfo(RevInfo&) override;
 #if DEBUG
         virtual void dump(std::ostream&) override;
 #endif
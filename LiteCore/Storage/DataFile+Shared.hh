@@ -110,7 +110,7 @@ namespace litecore {
         void setTransaction(Transaction* t) {
             Assert(t);
             unique_lock<mutex> lock(_transactionMutex);
-            while (_transaction != nullptr)
+            while (_transaction != nullptr || _lockHolder != nullptr)
                 _transactionCond.wait(lock);
             _transaction = t;
         }
@@ -124,6 +124,28 @@ namespace litecore {
         }
 
 
+        // Ends Transaction `t` without unlocking the file; it stays locked by the DataFile,
+        // whose group commit is pending, until it calls passLock.
+        void holdLock(Transaction* t, DataFile *dataFile) {
+            unique_lock<mutex> lock(_transactionMutex);
+            Assert(t && _transaction == t && !_lockHolder);
+            _transaction = nullptr;
+            _lockHolder = dataFile;
+        }
+
+
+        // Passes the lock held by a DataFile to its new Transaction, or unlocks the file if
+        // `t` is null.
+        void passLock(DataFile *dataFile, Transaction* t) {
+            unique_lock<mutex> lock(_transactionMutex);
+            Assert(_lockHolder == dataFile && !_transaction);
+            _lockHolder = nullptr;
+            _transaction = t;
+            if (!t)
+                _transactionCond.notify_one();
+        }
+
+
         Retained<RefCounted> sharedObject(const string &key) {
             lock_guard<mutex> lock(_mutex);
             auto i = _sharedObjects.find(key);
@@ -164,6 +186,7 @@ namespace litecore {
         mutex              _transactionMutex;       // Mutex for transactions
         condition_variable _transactionCond;        // For waiting on the mutex
         Transaction*       _transaction {nullptr};  // Currently active Transaction object
+        DataFile*          _lockHolder {nullptr};   // DataFile holding lock for group commit
         vector<DataFile*>  _dataFiles;              // Open DataFiles on this File
         unordered_map<string, Retained<RefCounted>> _sharedObjects;
         bool               _condemned {false};      // Prevents db from being opened or deleted
@@ -28,6 +28,7 @@
 #include "PlatformIO.hh"
 #include "Stopwatch.hh"
 #include "Instrumentation.hh"
+#include "Timer.hh"
 #include <errno.h>
 #include <dirent.h>
 #include <algorithm>
@@ -43,6 +44,9 @@ namespace litecore {
     // How long deleteDataFile() should wait for other threads to close their connections
     static const unsigned kOtherDBCloseTimeoutSecs = 3;
 
+    // Max number of Transactions in a group commit; a bigger group is committed right away
+    static const unsigned kMaxGroupCommitSize = 500;
+
 
     LogDomain DBLog("DB");
 
@@ -143,6 +147,9 @@ namespace litecore {
         // 2. The data file must indicate that it is no longer valid so that
         //    other classes with interest in the data file do not continue to
         //    operate on it
+        _groupTimer.reset();        // (waits for the timer's callback, if it's running)
+        commitPendingTransactions();
+
         _closeSignaled = true;
         for (auto &query : _queries)
             query->close();
@@ -177,7 +184,19 @@ namespace litecore {
 
 
     DataFile* DataFile::openAnother(Delegate *delegate) {
-        return factory().openFile(_path, delegate, &_options);
+        // Other instances are for internal use, like BackgroundDB, which notifies other DataFiles
+        // of its commits itself; so they don't use group commit.
+        Options options = _options;
+        options.groupCommitWindow = 0;
+        return factory().openFile(_path, delegate, &options);
+    }
+
+
+    DataFile* DataFile::openBackgroundReader(Delegate *delegate) {
+        Options options = _options;
+        options.groupCommitWindow = 0;
+        options.backgroundReader = true;
+        return factory().openFile(_path, delegate, &options);
     }
 
 
@@ -193,6 +212,14 @@ namespace litecore {
     }
 
 
+    void DataFile::notifyCommitted(SequenceTracker &sequenceTracker) {
+        forOtherDataFiles([&](DataFile *other) {
+            if (other->delegate())
+                other->delegate()->externalTransactionCommitted(sequenceTracker);
+        });
+    }
+
+
     Retained<RefCounted> DataFile::sharedObject(const string &key) {
         return _shared->sharedObject(key);
     }
@@ -325,7 +352,23 @@ namespace litecore {
     void DataFile::beginTransactionScope(Transaction* t) {
         Assert(!_inTransaction);
         checkOpen();
+        {
+            lock_guard<recursive_mutex> lock(_groupMutex);
+            if (_groupOpen) {
+                if (groupCommitDue() && _readOnlyTransactions == 0) {
+                    endGroup(true);
+                } else {
+                    // I've kept the file locked since my last Transaction, which is awaiting its
+                    // group commit; the new one gets the lock:
+                    _shared->passLock(this, t);
+                    _inTransaction = true;
+                    return;
+                }
+            }
+        }
+        // (_groupMutex isn't held while waiting for another DataFile to unlock the file.)
         _shared->setTransaction(t);
+        lock_guard<recursive_mutex> lock(_groupMutex);
         _inTransaction = true;
     }
 
@@ -344,13 +387,122 @@ namespace litecore {
     }
     
     void DataFile::endTransactionScope(Transaction* t) {
-        _shared->unsetTransaction(t);
-        _inTransaction = false;
+        {
+            lock_guard<recursive_mutex> lock(_groupMutex);
+            _inTransaction = false;
+            if (_groupOpen) {
+                // Keep the file locked until the group is committed:
+                _shared->holdLock(t, this);
+                if (_groupSize == 0)
+                    endGroup(false);        // Nothing was committed to the group
+                else if (groupCommitDue() && _readOnlyTransactions == 0)
+                    endGroup(true);
+            } else {
+                _shared->unsetTransaction(t);
+            }
+        }
         if (_documentKeys)
             _documentKeys->transactionEnded();
     }
 
 
+#pragma mark - GROUP COMMIT:
+
+
+    /*  In group-commit mode (Options::groupCommitWindow > 0), a Transaction is a SQLite-level
+        savepoint nested in a longer-lived "group" transaction. Committing the Transaction only
+        releases its savepoint, which makes its changes visible through this DataFile but not yet
+        durable, and this DataFile keeps the file locked. The group is committed, and the file
+        unlocked, once the first Transaction in it has been waiting for the window's duration,
+        when the group gets too big, or when commitPendingTransactions is called (as by close).
+        A Timer commits the group at its deadline, so an idle DataFile doesn't keep the file
+        locked. If a Transaction or ReadOnlyTransaction is open then, the commit would break it,
+        so it's left to the end of that Transaction or ReadOnlyTransaction. _groupMutex is held
+        across each of these decisions and the commit, and while either kind of transaction
+        begins or ends, since they can happen on different threads.
+        So many small transactions in a row cost one file commit, at the expense of delaying
+        their durability, and their visibility to other DataFiles, by up to the window. */
+
+
+    void DataFile::beginGroupedTransaction(Transaction *t) {
+        lock_guard<recursive_mutex> lock(_groupMutex);
+        if (!_groupOpen) {
+            _beginTransaction(t);
+            _groupOpen = true;
+            _groupSize = 0;
+        }
+        _beginNestedTransaction(t);
+    }
+
+
+    void DataFile::groupedTransactionCommitted() {
+        lock_guard<recursive_mutex> lock(_groupMutex);
+        if (_groupSize++ == 0) {
+            _groupDeadline = chrono::steady_clock::now()
+                                + chrono::milliseconds(_options.groupCommitWindow);
+            if (!_groupTimer)
+                _groupTimer.reset(new actor::Timer([this]{ commitPendingTransactionsIfDue(); }));
+            _groupTimer->fireAt(_groupDeadline);
+        }
+    }
+
+
+    bool DataFile::groupCommitDue() const {
+        return _groupSize >= kMaxGroupCommitSize || chrono::steady_clock::now() >= _groupDeadline;
+    }
+
+
+    void DataFile::commitPendingTransactions() {
+        lock_guard<recursive_mutex> lock(_groupMutex);
+        if (_groupOpen && !_inTransaction && _readOnlyTransactions == 0)
+            endGroup(true);
+    }
+
+
+    void DataFile::commitPendingTransactionsIfDue() {
+        lock_guard<recursive_mutex> lock(_groupMutex);
+        if (_groupOpen && groupCommitDue())
+            commitPendingTransactions();
+    }
+
+
+    // Commits or aborts the group transaction, then unlocks the file.
+    // Must be called with _groupMutex locked, and not in a Transaction or ReadOnlyTransaction.
+    void DataFile::endGroup(bool commit) noexcept {
+        bool committed = false;
+        try {
+            Stopwatch st;
+            _endGroupTransaction(commit);
+            committed = commit;
+            auto elapsed = st.elapsed();
+            if (elapsed >= 0.1)
+                _logInfo("Group commit of %u transactions took %.3f sec", _groupSize, elapsed);
+            else if (commit)
+                _logVerbose("group commit of %u transactions", _groupSize);
+        } catch (const exception &x) {
+            warn("Group commit of %u transactions failed: %s", _groupSize, x.what());
+            try {
+                _endGroupTransaction(false);
+            } catch (...) { }
+            // NOTE: The rollback can't be undone in memory everywhere. The delegate has already
+            // notified its own observers of the grouped Transactions as they committed, and any
+            // shared keys they added are still in _documentKeys. _endGroupTransaction(false)
+            // resets the KeyStores' cached state, and the delegate hears of the failure below.
+        }
+
+        if (_groupSize > 0 && _delegate) {
+            try {
+                _delegate->groupCommitEnded(committed);
+            } catch (const exception &x) {
+                warn("Caught exception notifying of group commit: %s", x.what());
+            }
+        }
+        _groupSize = 0;
+        _groupOpen = false;
+        _shared->passLock(this, nullptr);
+    }
+
+
     Transaction& DataFile::transaction() {
         Assert(_inTransaction);
         return *_shared->transaction();
@@ -375,11 +527,20 @@ namespace litecore {
     :_db(*db),
      _active(false)
     {
+        if (!active) {
+            // A bare file lock isn't a transaction, so it can't be nested in a group:
+            _db.commitPendingTransactions();
+        }
         _db.beginTransactionScope(this);
         if (active) {
             _db._logVerbose("begin transaction");
             Signpost::begin(Signpost::transaction, uintptr_t(this));
-            _db._beginTransaction(this);
+            if (_db._options.groupCommitWindow > 0) {
+                _db.beginGroupedTransaction(this);
+                _grouped = true;
+            } else {
+                _db._beginTransaction(this);
+            }
             _active = true;
             _db.transactionBegan(this);
         }
@@ -392,7 +553,12 @@ namespace litecore {
         _active = false;
         _db._logVerbose("commit transaction");
         Stopwatch st;
-        _db._endTransaction(this, true);
+        if (_grouped) {
+            _db._endNestedTransaction(this, true);
+            _db.groupedTransactionCommitted();
+        } else {
+            _db._endTransaction(this, true);
+        }
         auto elapsed = st.elapsed();
         Signpost::end(Signpost::transaction, uintptr_t(this));
         if (elapsed >= 0.1)
@@ -405,16 +571,16 @@ namespace litecore {
         _db.transactionEnding(this, false);
         _active = false;
         _db._logVerbose("abort transaction");
-        _db._endTransaction(this, false);
+        if (_grouped)
+            _db._endNestedTransaction(this, false);
+        else
+            _db._endTransaction(this, false);
         Signpost::end(Signpost::transaction, uintptr_t(this));
     }
 
 
     void Transaction::notifyCommitted(SequenceTracker &sequenceTracker) {
-        _db.forOtherDataFiles([&](DataFile *other) {
-            if (other->delegate())
-                other->delegate()->externalTransactionCommitted(sequenceTracker);
-        });
+        _db.notifyCommitted(sequenceTracker);
     }
 
 
@@ -428,14 +594,22 @@ namespace litecore {
 
 
     ReadOnlyTransaction::ReadOnlyTransaction(DataFile *db) {
+        lock_guard<recursive_mutex> lock(db->_groupMutex);
+        if (db->_readOnlyTransactions == 0 && !db->_inTransaction)
+            db->commitPendingTransactionsIfDue();
         db->beginReadOnlyTransaction();
+        ++db->_readOnlyTransactions;
         _db = db;
     }
 
     ReadOnlyTransaction::~ReadOnlyTransaction() {
         if (_db) {
+            lock_guard<recursive_mutex> lock(_db->_groupMutex);
+            --_db->_readOnlyTransactions;
             try {
                 _db->endReadOnlyTransaction();
+                if (_db->_readOnlyTransactions == 0 && !_db->_inTransaction)
+                    _db->commitPendingTransactionsIfDue();
             } catch (...) {
                 _db->warn("~ReadOnlyTransaction caught C++ exception in endReadOnlyTransaction");
             }
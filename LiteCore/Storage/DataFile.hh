@@ -26,7 +26,9 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <atomic> // for std::atomic_uint
+#include <chrono>
 #include <functional> // for std::function
+#include <mutex>
 #ifdef check
 #undef check
 #endif
@@ -42,6 +44,9 @@ namespace litecore {
     class Query;
     class Transaction;
     class SequenceTracker;
+    namespace actor {
+        class Timer;
+    }
 
 
     /** A database file, primarily a container of KeyStores which store the actual data.
@@ -58,6 +63,10 @@ namespace litecore {
             virtual alloc_slice blobAccessor(const fleece::impl::Dict*) const =0;
             // Notifies that another DataFile on the same physical file has committed a transaction
             virtual void externalTransactionCommitted(const SequenceTracker &sourceTracker) { }
+            // Notifies that the transactions awaiting a group commit have been committed, or
+            // rolled back if the commit failed. Called while the file is still locked, possibly
+            // on a background thread.
+            virtual void groupCommitEnded(bool committed) { }
         };
 
         struct Options {
@@ -68,6 +77,15 @@ namespace litecore {
             bool                upgradeable    :1;      ///< DB schema can be upgraded
             EncryptionAlgorithm encryptionAlgorithm;    ///< What encryption (if any)
             alloc_slice         encryptionKey;          ///< Encryption key, if encrypting
+            // Storage tuning; 0 means a default based on the size of the file:
+            int64_t             cacheSize       {0};    ///< Max size of page cache, in bytes
+            int64_t             mmapSize        {0};    ///< Max bytes to memory-map; -1 to disable
+            int64_t             journalSizeLimit{0};    ///< Max size of idle WAL file, in bytes
+            uint32_t            pageSize        {0};    ///< Page size, if creating the file
+            // Group commit; 0 means every Transaction is committed to the file on its own:
+            uint32_t            groupCommitWindow{0};   ///< Max ms a commit waits to be grouped
+            // Set by openBackgroundReader:
+            bool                backgroundReader{false};///< Small cache, no extra connections
             static const Options defaults;
         };
 
@@ -93,6 +111,10 @@ namespace litecore {
         /** Opens another instance on the same file. */
         DataFile* openAnother(Delegate* NONNULL);
 
+        /** Opens another instance on the same file, for read-only work on a background thread.
+            It uses less memory: a smaller cache, and no pool of extra read connections. */
+        DataFile* openBackgroundReader(Delegate* NONNULL);
+
         virtual uint64_t fileSize();
 
         /** Types of things \ref maintenance() can do.
@@ -114,6 +136,18 @@ namespace litecore {
 
         void forOtherDataFiles(function_ref<void(DataFile*)> fn);
 
+        /** Tells the other DataFiles on this file about the changes in a committed transaction. */
+        void notifyCommitted(SequenceTracker&);
+
+        /** True if Transactions have been committed, but are still waiting for their group
+            commit to be written to the file. (Only in group-commit mode; see Options.) */
+        bool groupCommitPending() const noexcept            {return _groupOpen;}
+
+        /** Writes the pending group commit, if any, to the file. Does nothing if this DataFile
+            is in a Transaction or ReadOnlyTransaction, since the group is committed when that
+            ends. */
+        void commitPendingTransactions();
+
         /** Private API to run a raw (e.g. SQL) query, for diagnostic purposes only */
         virtual fleece::alloc_slice rawQuery(const std::string &query) =0;
 
@@ -211,6 +245,18 @@ namespace litecore {
         /** Override to commit or abort a database transaction. */
         virtual void _endTransaction(Transaction* t NONNULL, bool commit) =0;
 
+        /** Override to begin a transaction nested in the one begun by `_beginTransaction`, so
+            that it can be committed or aborted on its own. Used for group commit. */
+        virtual void _beginNestedTransaction(Transaction* t NONNULL) =0;
+
+        /** Override to commit or abort a nested transaction. Committing it only merges its
+            changes into the enclosing transaction. */
+        virtual void _endNestedTransaction(Transaction* t NONNULL, bool commit) =0;
+
+        /** Override to commit or abort the transaction enclosing a group of nested ones, after
+            they've all ended. */
+        virtual void _endGroupTransaction(bool commit) =0;
+
         /** Is this DataFile object currently in a transaction? */
         bool inTransaction() const                      {return _inTransaction;}
 
@@ -246,6 +292,11 @@ namespace litecore {
         void transactionBegan(Transaction*);
         void transactionEnding(Transaction*, bool committing);
         void endTransactionScope(Transaction*);
+        void beginGroupedTransaction(Transaction*);
+        void groupedTransactionCommitted();
+        bool groupCommitDue() const;
+        void commitPendingTransactionsIfDue();
+        void endGroup(bool commit) noexcept;
         Transaction& transaction();
 
         DataFile(const DataFile&) = delete;
@@ -260,7 +311,16 @@ namespace litecore {
         mutable Retained<fleece::impl::PersistentSharedKeys> _documentKeys;
         std::unordered_set<Query*> _queries;                    // Query objects
         bool                    _inTransaction {false};         // Am I in a Transaction?
+        unsigned                _readOnlyTransactions {0};      // Nesting of ReadOnlyTransactions
         std::atomic_bool        _closeSignaled {false};         // Have I been asked to close?
+
+        // Group commit state. The mutex is held while deciding whether to commit the group and
+        // while committing it, and while changing the two members above, which that depends on:
+        std::recursive_mutex    _groupMutex;
+        std::unique_ptr<actor::Timer> _groupTimer;              // Commits group at its deadline
+        std::atomic_bool        _groupOpen {false};             // Is a group transaction open?
+        unsigned                _groupSize {0};                 // # Transactions committed to it
+        std::chrono::steady_clock::time_point _groupDeadline;   // When it has to be committed
     };
 
 
@@ -282,6 +342,11 @@ namespace litecore {
 
         void notifyCommitted(SequenceTracker&);
 
+        /** True if this Transaction is part of a group commit. Then committing it only makes its
+            changes visible to its DataFile; they're written to the file, and become visible to
+            other DataFiles, when the group is committed. */
+        bool isGrouped() const              {return _grouped;}
+
     private:
         friend class DataFile;
         friend class KeyStore;
@@ -291,6 +356,7 @@ namespace litecore {
 
         DataFile&   _db;        // The DataFile
         bool _active;           // Is there an open transaction at the db level?
+        bool _grouped {false};  // Is it nested in a group transaction?
     };
 
 
@@ -49,6 +49,14 @@ namespace litecore {
         fn(get(seq));
     }
 
+    vector<Record> KeyStore::getMany(const vector<slice> &keys, ContentOption option) const {
+        vector<Record> records;
+        records.reserve(keys.size());
+        for (slice key : keys)
+            records.push_back(get(key, option));
+        return records;
+    }
+
     void KeyStore::readBody(Record &rec) const {
         if (!rec.body()) {
             Record fullDoc = rec.sequence() ? get(rec.sequence())
@@ -69,6 +77,19 @@ namespace litecore {
         rec.updateSequence(seq);
     }
 
+    vector<sequence_t> KeyStore::setMany(const vector<SetRequest> &requests,
+                                         Transaction &t,
+                                         bool insertOnly)
+    {
+        const sequence_t kInsertOnly = 0;
+        vector<sequence_t> seqs;
+        seqs.reserve(requests.size());
+        for (auto &rq : requests)
+            seqs.push_back(set(rq.key, rq.version, rq.value, rq.flags, t,
+                               (insertOnly ? &kInsertOnly : nullptr)));
+        return seqs;
+    }
+
     bool KeyStore::createIndex(slice name,
                                slice expressionJSON,
                                IndexSpec::Type type,
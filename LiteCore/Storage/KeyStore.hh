@@ -80,6 +80,12 @@ namespace litecore {
         /** Reads a record whose key() is already set. */
         virtual bool read(Record &rec, ContentOption = kEntireBody) const =0;
 
+        /** Reads multiple records by key, which is faster than calling `get` for each one.
+            Returns a Record for each key, in the same order as `keys`; the Records of keys that
+            weren't found don't `exists()`. */
+        virtual std::vector<Record> getMany(const std::vector<slice> &keys,
+                                            ContentOption = kEntireBody) const;
+
         /** Reads the body of a Record that's already been read with kMetaonly.
             Does nothing if the record's body is non-null. */
         virtual void readBody(Record &rec) const;
@@ -113,6 +119,20 @@ namespace litecore {
 
         void write(Record&, Transaction&, const sequence_t *replacingSequence =nullptr);
 
+        /** One record to write, in a call to `setMany`. */
+        struct SetRequest {
+            slice         key, version, value;
+            DocumentFlags flags {DocumentFlags::kNone};
+        };
+
+        /** Writes multiple records, which is faster than calling `set` for each one. New
+            sequences are assigned to the records in order.
+            If `insertOnly` is true, requests whose keys already exist are skipped.
+            Returns the sequence assigned to each request, or 0 if it was skipped. */
+        virtual std::vector<sequence_t> setMany(const std::vector<SetRequest>&,
+                                                Transaction&,
+                                                bool insertOnly =false);
+
         virtual bool del(slice key, Transaction&, sequence_t replacingSequence =0) =0;
         bool del(const Record &rec, Transaction &t)                 {return del(rec.key(), t);}
 
@@ -79,21 +79,33 @@ namespace litecore {
 
     static const int64_t MB = 1024 * 1024;
 
-    // SQLite page size
-    static const int64_t kPageSize = 4096;
+    // Default SQLite page size, for new databases
+    static const uint32_t kPageSize = 4096;
 
-    // SQLite cache size (per connection)
-    static const size_t kCacheSize = 10 * MB;
+    // Default SQLite cache size (per connection.) Files bigger than 16x this get a cache of
+    // 1/16 their size, up to kMaxDefaultCacheSize.
+    static const int64_t kCacheSize = 10 * MB;
+    static const int64_t kMaxDefaultCacheSize = 64 * MB;
 
-    // Maximum size WAL journal will be left at after a commit
+    // Cache size of pooled read-only connections (smaller, since most reads are memory-mapped)
+    static const int64_t kReaderCacheSize = 2 * MB;
+
+    // Maximum number of pooled read-only connections per SQLiteDataFile
+    static const unsigned kMaxReadConnections = 4;
+
+    // Default maximum size WAL journal will be left at after a commit. Files bigger than 64x
+    // this get a limit of 1/64 their size, up to kMaxDefaultJournalSize.
     static const int64_t kJournalSize = 5 * MB;
+    static const int64_t kMaxDefaultJournalSize = 64 * MB;
 
-    // Amount of file to memory-map
+    // Default amount of file to memory-map. Files bigger than half of this get twice their
+    // size mapped (leaving room to grow), up to kMaxDefaultMMapSize.
 #if TARGET_OS_OSX || TARGET_OS_SIMULATOR
-    static const int kMMapSize =  -1;    // Avoid possible file corruption hazard on macOS
+    static const int64_t kMMapSize =  -1;    // Avoid possible file corruption hazard on macOS
 #else
-    static const int kMMapSize = 50 * MB;
+    static const int64_t kMMapSize = 50 * MB;
 #endif
+    static const int64_t kMaxDefaultMMapSize = (sizeof(void*) >= 8) ? 64 * 1024 * MB : 256 * MB;
 
     // If this fraction of the database is composed of free pages, vacuum it on close
     static const float kVacuumFractionThreshold = 0.25;
@@ -187,6 +199,7 @@ namespace litecore {
 
     SQLiteDataFile::SQLiteDataFile(const FilePath &path, Delegate *delegate, const Options *options)
     :DataFile(path, delegate, options)
+    ,_indexAdvisor(SQLiteIndexAdvisor::forDataFile(*this))
     {
         reopen();
     }
@@ -199,6 +212,7 @@ namespace litecore {
 
     void SQLiteDataFile::reopen() {
         DataFile::reopen();
+        computeTuning();
         reopenSQLiteHandle();
         decrypt();
 
@@ -211,7 +225,9 @@ namespace litecore {
                 // Configure persistent db settings, and create the schema.
                 // `auto_vacuum` has to be enabled ASAP, before anything's written to the db!
                 // (even setting `auto_vacuum` writes to the db, it turns out! See CBSE-7971.)
-                _exec("PRAGMA auto_vacuum=incremental; "
+                // Likewise `page_size`, which can't be changed once the db is in WAL mode.
+                _exec(format("PRAGMA page_size=%u; ", _tuning.pageSize) +
+                      "PRAGMA auto_vacuum=incremental; "
                       "PRAGMA journal_mode=WAL; "
                       "BEGIN; "
                       "CREATE TABLE IF NOT EXISTS "      // Table of metadata about KeyStores
@@ -249,12 +265,11 @@ namespace litecore {
             }
         });
 
-        _exec(format("PRAGMA cache_size=%d; "            // Memory cache
-                     "PRAGMA mmap_size=%d; "             // Memory-mapped reads
-                     "PRAGMA synchronous=normal; "       // Speeds up commits
-                     "PRAGMA journal_size_limit=%lld; "  // Limit WAL disk usage
-                     "PRAGMA case_sensitive_like=true",  // Case sensitive LIKE, for N1QL compat
-                     -(int)kCacheSize/1024, kMMapSize, (long long)kJournalSize));
+        configureSQLiteHandle(*_sqlDb, _collationContexts, _tuning.cacheSize);
+        // Record the actual values, since SQLite may have clamped the mmap size, and an existing
+        // db keeps the page size it was created with:
+        _tuning.mmapSize = intQuery("PRAGMA mmap_size");
+        _tuning.pageSize = (uint32_t)intQuery("PRAGMA page_size");
 
 #if DEBUG
         // Deliberately make unordered queries unpredictable, to expose any LiteCore code that
@@ -263,18 +278,77 @@ namespace litecore {
             _sqlDb->exec("PRAGMA reverse_unordered_selects=1");
 #endif
 
+        // Read-only connections can only run alongside the main one if the db is in WAL mode.
+        // A background reader doesn't need them, since it's one of a pool itself:
+        if (!options().backgroundReader
+                && _sqlDb->execAndGet("PRAGMA journal_mode").getString() == "wal")
+            _readers = make_shared<ReaderPool>();
+    }
+
+
+    // Fills in `_tuning` from the Options, replacing zero values with defaults that scale with
+    // the current size of the file.
+    void SQLiteDataFile::computeTuning() {
+        auto &opts = options();
+        if (opts.cacheSize < 0 || opts.journalSizeLimit < 0)
+            error::_throw(error::InvalidParameter, "Negative SQLite cache or journal size");
+        if (opts.pageSize != 0 && (opts.pageSize < 512 || opts.pageSize > 65536
+                                   || (opts.pageSize & (opts.pageSize - 1)) != 0))
+            error::_throw(error::InvalidParameter, "SQLite page size must be a power of 2 "
+                                                   "from 512 to 65536");
+
+        int64_t fileSize = max(filePath().dataSize(), int64_t(0));
+        auto scaled = [=](int64_t option, int64_t dflt, int64_t size, int64_t maxDflt) {
+            return option ? option : max(dflt, min(size, maxDflt));
+        };
+        _tuning.cacheSize = scaled(opts.cacheSize, kCacheSize, fileSize / 16,
+                                   kMaxDefaultCacheSize);
+        _tuning.readerCacheSize = min(_tuning.cacheSize,
+                                      max(kReaderCacheSize, _tuning.cacheSize / 4));
+        if (opts.backgroundReader)
+            _tuning.cacheSize = _tuning.readerCacheSize;
+        _tuning.journalSizeLimit = scaled(opts.journalSizeLimit, kJournalSize, fileSize / 64,
+                                          kMaxDefaultJournalSize);
+        if (opts.mmapSize != 0 || kMMapSize < 0)
+            _tuning.mmapSize = max(opts.mmapSize ? opts.mmapSize : kMMapSize, int64_t(0));
+        else
+            _tuning.mmapSize = scaled(0, kMMapSize, 2 * fileSize, kMaxDefaultMMapSize);
+        _tuning.pageSize = opts.pageSize ? opts.pageSize : kPageSize;
+        logVerbose("Tuning for %lld-byte file: cache=%lld, mmap=%lld, journal=%lld",
+                   (long long)fileSize, (long long)_tuning.cacheSize,
+                   (long long)_tuning.mmapSize, (long long)_tuning.journalSizeLimit);
+    }
+
+
+    // Sets the per-connection pragmas, and registers collators, custom functions and the FTS
+    // tokenizer. Used for the main connection and for ReadConnections.
+    void SQLiteDataFile::configureSQLiteHandle(SQLite::Database &sqlDb,
+                                               CollationContextVector &collationContexts,
+                                               int64_t cacheSize)
+    {
+        string sql = format("PRAGMA cache_size=%lld; "          // Memory cache
+                            "PRAGMA mmap_size=%lld; "           // Memory-mapped reads
+                            "PRAGMA synchronous=normal; "       // Speeds up commits
+                            "PRAGMA journal_size_limit=%lld; "  // Limit WAL disk usage
+                            "PRAGMA case_sensitive_like=true; " // Case sensitive LIKE, for N1QL compat
+                            "PRAGMA recursive_triggers=true",   // INSERT OR REPLACE fires DELETE triggers
+                            -(long long)cacheSize/1024, (long long)_tuning.mmapSize,
+                            (long long)_tuning.journalSizeLimit);
+        LogTo(SQL, "%s", sql.c_str());
+        sqlDb.exec(sql);
+
         // Configure number of extra threads to be used by SQLite:
         int maxThreads = 0;
 #if TARGET_OS_OSX
         maxThreads = 2;
         // TODO: Configure for other platforms
 #endif
-        auto sqlite = _sqlDb->getHandle();
+        auto sqlite = sqlDb.getHandle();
         if (maxThreads > 0)
             sqlite3_limit(sqlite, SQLITE_LIMIT_WORKER_THREADS, maxThreads);
 
         // Register collators, custom functions, and the FTS tokenizer:
-        RegisterSQLiteUnicodeCollations(sqlite, _collationContexts);
+        RegisterSQLiteUnicodeCollations(sqlite, collationContexts);
         RegisterSQLiteFunctions(sqlite, {delegate(), documentKeys()});
         int rc = register_unicodesn_tokenizer(sqlite);
         if (rc != SQLITE_OK)
@@ -284,7 +358,9 @@ namespace litecore {
 
     void SQLiteDataFile::reopenSQLiteHandle() {
         // We are about to replace the sqlite3 handle, so the compiled statements
-        // need to be cleared
+        // need to be cleared, and the read-only connections closed
+        closeReaders(false);
+        _queryCache.clear();
         _getLastSeqStmt.reset();
         _setLastSeqStmt.reset();
         _getPurgeCntStmt.reset();
@@ -315,6 +391,8 @@ namespace litecore {
 
     // Called by DataFile::close (the public method)
     void SQLiteDataFile::_close(bool forDelete) {
+        closeReaders(forDelete);
+        _queryCache.clear();
         _getLastSeqStmt.reset();
         _setLastSeqStmt.reset();
         _getPurgeCntStmt.reset();
@@ -356,6 +434,7 @@ namespace litecore {
         auto alg = options().encryptionAlgorithm;
         if (!factory().encryptionEnabled(alg))
             error::_throw(error::UnsupportedEncryption);
+        commitPendingTransactions();
 #ifdef COUCHBASE_ENTERPRISE
         // Set the encryption key in SQLite:
         slice key;
@@ -492,6 +571,33 @@ namespace litecore {
     }
 
 
+    void SQLiteDataFile::_beginNestedTransaction(Transaction*) {
+        _exec("SAVEPOINT groupedTransaction");
+    }
+
+
+    void SQLiteDataFile::_endNestedTransaction(Transaction*, bool commit) {
+        forOpenKeyStores([commit](KeyStore &ks) {
+            ((SQLiteKeyStore&)ks).transactionWillEnd(commit);
+        });
+
+        if (!commit)
+            exec("ROLLBACK TO SAVEPOINT groupedTransaction");
+        exec("RELEASE SAVEPOINT groupedTransaction");
+    }
+
+
+    void SQLiteDataFile::_endGroupTransaction(bool commit) {
+        // (Not in a Transaction, so exec() can't be used)
+        _exec(commit ? "COMMIT" : "ROLLBACK");
+        if (!commit) {
+            forOpenKeyStores([](KeyStore &ks) {
+                ((SQLiteKeyStore&)ks).groupTransactionRolledBack();
+            });
+        }
+    }
+
+
     void SQLiteDataFile::beginReadOnlyTransaction() {
         checkOpen();
         _exec("SAVEPOINT roTransaction");
@@ -529,6 +635,12 @@ namespace litecore {
     }
 
 
+    int64_t SQLiteDataFile::schemaVersion() {
+        checkOpen();
+        return intQuery("PRAGMA schema_version");
+    }
+
+
     SQLite::Statement& SQLiteDataFile::compile(const unique_ptr<SQLite::Statement>& ref,
                                                const char *sql) const
     {
@@ -583,7 +695,15 @@ namespace litecore {
     }
 
     
-    sequence_t SQLiteDataFile::lastSequence(const string& keyStoreName) const {
+    sequence_t SQLiteDataFile::lastSequence(const string& keyStoreName,
+                                            ReadConnection *reader) const
+    {
+        if (reader) {
+            auto &stmt = reader->compile("SELECT lastSeq FROM kvmeta WHERE name=?");
+            UsingStatement u(stmt);
+            stmt.bindNoCopy(1, keyStoreName);
+            return stmt.executeStep() ? (int64_t)stmt.getColumn(0) : 0;
+        }
         sequence_t seq = 0;
         compile(_getLastSeqStmt, "SELECT lastSeq FROM kvmeta WHERE name=?");
         UsingStatement u(_getLastSeqStmt);
@@ -605,8 +725,20 @@ namespace litecore {
     }
 
 
-    uint64_t SQLiteDataFile::purgeCount(const std::string& keyStoreName) const {
+    uint64_t SQLiteDataFile::purgeCount(const std::string& keyStoreName,
+                                        ReadConnection *reader) const
+    {
         uint64_t purgeCnt = 0;
+        if (reader) {
+            if (_schemaVersion >= SchemaVersion::WithPurgeCount) {
+                auto &stmt = reader->compile("SELECT purgeCnt FROM kvmeta WHERE name=?");
+                UsingStatement u(stmt);
+                stmt.bindNoCopy(1, keyStoreName);
+                if (stmt.executeStep())
+                    purgeCnt = (int64_t)stmt.getColumn(0);
+            }
+            return purgeCnt;
+        }
         if (_schemaVersion >= SchemaVersion::WithPurgeCount) {
             compile(_getPurgeCntStmt, "SELECT purgeCnt FROM kvmeta WHERE name=?");
             UsingStatement u(_getPurgeCntStmt);
@@ -631,6 +763,205 @@ namespace litecore {
     }
 
 
+#pragma mark - READ-ONLY CONNECTION POOL:
+
+
+    // Returns one of a connection's `sqlite3_db_status` counters, optionally resetting it.
+    static uint64_t dbStatus(sqlite3 *db, int op, bool reset =false) {
+        int current = 0, highwater = 0;
+        sqlite3_db_status(db, op, &current, &highwater, reset);
+        return uint64_t(max(current, 0));
+    }
+
+
+    class SQLiteDataFile::ReaderPool {
+    public:
+        mutex                               _mutex;
+        vector<unique_ptr<ReadConnection>>  _idle;          // Connections not in use
+        unsigned                            _open {0};      // Total connections, incl. borrowed
+        bool                                _closed {false};
+        bool                                _failed {false};// Couldn't open a connection
+        uint64_t                            _cacheHits {0}, _cacheMisses {0}; // of returned conns
+
+        void giveBack(unique_ptr<ReadConnection> conn) {
+            // Collect the cache counters now, since the connection won't be in use:
+            sqlite3 *db = conn->db().getHandle();
+            uint64_t hits = dbStatus(db, SQLITE_DBSTATUS_CACHE_HIT, true);
+            uint64_t misses = dbStatus(db, SQLITE_DBSTATUS_CACHE_MISS, true);
+            unique_lock<mutex> lock(_mutex);
+            _cacheHits += hits;
+            _cacheMisses += misses;
+            if (!_closed) {
+                _idle.push_back(move(conn));
+            } else {
+                // DataFile was closed (or reopened) while this was borrowed, so discard it:
+                --_open;
+                lock.unlock();
+                conn.reset();
+            }
+        }
+    };
+
+
+    SQLiteDataFile::ReadConnection::ReadConnection() =default;
+    SQLiteDataFile::ReadConnection::~ReadConnection() =default;
+
+
+    SQLite::Statement& SQLiteDataFile::ReadConnection::compile(const string &sql) {
+        auto &stmt = _statements[sql];
+        if (!stmt) {
+            try {
+                stmt = make_unique<SQLite::Statement>(*_sqlDb, sql, true);
+            } catch (const SQLite::Exception &x) {
+                _statements.erase(sql);
+                LogToAt(SQL, Warning, "SQLite error compiling statement \"%s\": %s",
+                        sql.c_str(), x.what());
+                throw;
+            }
+        }
+        return *stmt;
+    }
+
+
+    SQLite::Statement& SQLiteDataFile::ReadConnection::compile(const void *key,
+                                                               function_ref<string()> getSQL)
+    {
+        auto &stmt = _keyedStatements[key];
+        if (!stmt) {
+            string sql = getSQL();
+            try {
+                stmt = make_unique<SQLite::Statement>(*_sqlDb, sql, true);
+            } catch (const SQLite::Exception &x) {
+                _keyedStatements.erase(key);
+                LogToAt(SQL, Warning, "SQLite error compiling statement \"%s\": %s",
+                        sql.c_str(), x.what());
+                throw;
+            }
+        }
+        return *stmt;
+    }
+
+
+    void SQLiteDataFile::ReadConnection::withSnapshot(function_ref<void()> fn) {
+        _sqlDb->exec("BEGIN");
+        try {
+            fn();
+        } catch (...) {
+            try { _sqlDb->exec("END"); } catch (...) { }
+            throw;
+        }
+        _sqlDb->exec("END");
+    }
+
+
+    SQLiteDataFile::BorrowedReader::~BorrowedReader() {
+        if (_conn)
+            _pool->giveBack(move(_conn));
+    }
+
+
+    SQLiteDataFile::BorrowedReader SQLiteDataFile::borrowReader() const {
+        BorrowedReader reader;
+        // The main connection has to be used in a transaction, or while a group commit is pending,
+        // since other connections can't see the changes yet:
+        if (!_readers || inTransaction() || groupCommitPending())
+            return reader;
+        {
+            lock_guard<mutex> lock(_readers->_mutex);
+            if (!_readers->_idle.empty()) {
+                reader._conn = move(_readers->_idle.back());
+                _readers->_idle.pop_back();
+            } else if (_readers->_open >= kMaxReadConnections || _readers->_failed) {
+                return reader;
+            } else {
+                ++_readers->_open;
+            }
+        }
+        if (!reader._conn) {
+            try {
+                reader._conn = const_cast<SQLiteDataFile*>(this)->openReadConnection();
+            } catch (const exception &x) {
+                // Fall back to using only the main connection from now on:
+                warn("Couldn't open a read-only connection; not using them: %s", x.what());
+                lock_guard<mutex> lock(_readers->_mutex);
+                --_readers->_open;
+                _readers->_failed = true;
+                return reader;
+            }
+        }
+        reader._pool = _readers;
+        return reader;
+    }
+
+
+    unique_ptr<SQLiteDataFile::ReadConnection> SQLiteDataFile::openReadConnection() {
+        auto conn = make_unique<ReadConnection>();
+        conn->_sqlDb = make_unique<SQLite::Database>(filePath().path().c_str(),
+                                                     SQLite::OPEN_READONLY,
+                                                     kBusyTimeoutSecs * 1000);
+#ifdef COUCHBASE_ENTERPRISE
+        if (auto alg = options().encryptionAlgorithm; alg != kNoEncryption) {
+            slice key = options().encryptionKey;
+            sqlite3 *handle = conn->_sqlDb->getHandle();
+            int rc = sqlite3_key_v2(handle, nullptr, key.buf, (int)key.size);
+            if (rc == SQLITE_OK)
+                rc = sqlite3_exec(handle, "SELECT count(*) FROM sqlite_master", NULL, NULL, NULL);
+            if (rc != SQLITE_OK)
+                error::_throw(error::SQLite, rc);
+        }
+#endif
+        configureSQLiteHandle(*conn->_sqlDb, conn->_collationContexts, _tuning.readerCacheSize);
+        logVerbose("Opened read-only SQLite connection");
+        return conn;
+    }
+
+
+    void SQLiteDataFile::closeReaders(bool forDelete) {
+        if (!_readers)
+            return;
+        vector<unique_ptr<ReadConnection>> idle;
+        {
+            lock_guard<mutex> lock(_readers->_mutex);
+            if (forDelete && _readers->_open > _readers->_idle.size())
+                error::_throw(error::Busy, "SQLite db has active readers, can't be deleted");
+            _readers->_closed = true;
+            _readers->_open -= unsigned(_readers->_idle.size());
+            idle.swap(_readers->_idle);
+        }
+        _readers.reset();
+        // `idle` is destructed here, closing the connections
+    }
+
+
+#pragma mark - MAINTENANCE:
+
+
+    SQLiteDataFile::CacheStats SQLiteDataFile::cacheStats(bool reset) {
+        checkOpen();
+        CacheStats stats;
+        sqlite3 *db = _sqlDb->getHandle();
+        stats.hits = dbStatus(db, SQLITE_DBSTATUS_CACHE_HIT, reset);
+        stats.misses = dbStatus(db, SQLITE_DBSTATUS_CACHE_MISS, reset);
+        stats.memoryUsed = dbStatus(db, SQLITE_DBSTATUS_CACHE_USED);
+        if (_readers) {
+            // Borrowed connections' counts are added to the pool's when they're returned;
+            // idle ones' memory is still in use, though.
+            lock_guard<mutex> lock(_readers->_mutex);
+            stats.hits += _readers->_cacheHits;
+            stats.misses += _readers->_cacheMisses;
+            for (auto &conn : _readers->_idle)
+                stats.memoryUsed += dbStatus(conn->db().getHandle(), SQLITE_DBSTATUS_CACHE_USED);
+            if (reset)
+                _readers->_cacheHits = _readers->_cacheMisses = 0;
+        }
+        auto queryStats = _queryCache.stats(reset);
+        stats.queryHits = queryStats.hits;
+        stats.queryMisses = queryStats.misses;
+        return stats;
+    }
+
+
+
     uint64_t SQLiteDataFile::fileSize() {
         // Move all WAL changes into the main database file, so its size is accurate:
         _exec("PRAGMA wal_checkpoint(FULL)");
@@ -669,11 +1000,11 @@ namespace litecore {
                        100.0 * freePages / pageCount);
 
             if (!always && (pageCount == 0 || (float)freePages / pageCount < kVacuumFractionThreshold)
-                        && (freePages * kPageSize < kVacuumSizeThreshold))
+                        && (freePages * _tuning.pageSize < kVacuumSizeThreshold))
                 return;
 
             string sql;
-            bool fixAutoVacuum = (always || (pageCount * kPageSize) < 10*MB)
+            bool fixAutoVacuum = (always || (pageCount * _tuning.pageSize) < 10*MB)
                                     && (intQuery("PRAGMA auto_vacuum") == 0);
             if (fixAutoVacuum) {
                 // Due to issue CBL-707, auto-vacuum did not take effect when creating databases.
@@ -696,7 +1027,7 @@ namespace litecore {
 
             int64_t shrunk = pageCount - intQuery("PRAGMA page_count");
             logInfo("    ...removed %" PRIi64 " pages (%" PRIi64 "KB) in %.3f sec",
-                    shrunk, shrunk * kPageSize / 1024, elapsed);
+                    shrunk, shrunk * _tuning.pageSize / 1024, elapsed);
 
             if (fixAutoVacuum && intQuery("PRAGMA auto_vacuum") == 0)
                 warn("auto_vacuum mode did not take effect after running full VACUUM!");
@@ -727,6 +1058,8 @@ namespace litecore {
 
 
     void SQLiteDataFile::maintenance(MaintenanceType what) {
+        // None of these can run inside the transaction of a pending group commit:
+        commitPendingTransactions();
         switch (what) {
             case kCompact:
                 checkOpen();
@@ -20,8 +20,12 @@
 
 #include "DataFile.hh"
 #include "IndexSpec.hh"
+#include "SQLiteIndexAdvisor.hh"
+#include "SQLiteQueryCache.hh"
 #include "UnicodeCollator.hh"
+#include <memory>
 #include <optional>
+#include <unordered_map>
 
 namespace SQLite {
     class Database;
@@ -86,6 +90,102 @@ namespace litecore {
                           int64_t &outRowCount,
                           alloc_slice *outRows =nullptr);
 
+        /** Storage settings in effect: the Options' values, with defaults filled in. */
+        struct Tuning {
+            int64_t  cacheSize {0};             ///< Main connection's page cache size
+            int64_t  readerCacheSize {0};       ///< Each ReadConnection's page cache size
+            int64_t  mmapSize {0};              ///< Memory-mapped size (0 if disabled)
+            int64_t  journalSizeLimit {0};      ///< WAL size limit
+            uint32_t pageSize {0};              ///< Actual page size of the file
+        };
+
+        const Tuning& tuning() const                        {return _tuning;}
+
+        struct CacheStats {
+            uint64_t hits {0};                  ///< Page reads satisfied by a page cache
+            uint64_t misses {0};                ///< Page reads that weren't
+            uint64_t memoryUsed {0};            ///< Heap memory used by the page caches
+            uint64_t queryHits {0};             ///< Queries found in the compiled-query cache
+            uint64_t queryMisses {0};           ///< Queries that had to be compiled
+        };
+
+        /** Returns page-cache statistics summed over all of this DataFile's connections.
+            If `reset` is true, the hit & miss counts start over from zero afterwards. */
+        CacheStats cacheStats(bool reset =false);
+
+        /** The cache of compiled queries, used by SQLiteQuery. */
+        SQLiteQueryCache& queryCache()                      {return _queryCache;}
+
+        /** Query statistics and index suggestions, shared with other DataFiles on this file. */
+        SQLiteIndexAdvisor& indexAdvisor()                  {return *_indexAdvisor;}
+
+        /** The schema version (cookie), which SQLite changes whenever the schema changes. */
+        int64_t schemaVersion();
+
+        //////// READ-ONLY CONNECTION POOL:
+
+        /** An additional read-only SQLite connection to the same file. Since the database is in
+            WAL mode, reads on it see a consistent snapshot of the last commit, and can run on
+            another thread in parallel with the main connection (even during a write transaction)
+            and with other ReadConnections. */
+        class ReadConnection {
+        public:
+            ReadConnection();
+            ~ReadConnection();
+
+            SQLite::Database& db()                          {return *_sqlDb;}
+
+            /** Returns a statement compiled on this connection, cached for next time. */
+            SQLite::Statement& compile(const std::string &sql);
+
+            /** Like the other `compile`, but the statement is cached by `key`, which must always
+                identify the same SQL; `getSQL` is only called the first time. This saves
+                building and hashing the SQL string on every call. */
+            SQLite::Statement& compile(const void *key, function_ref<std::string()> getSQL);
+
+            /** Calls `fn` within a read transaction, so that all of its reads see the same
+                snapshot of the database. */
+            void withSnapshot(function_ref<void()> fn);
+
+        private:
+            friend class SQLiteDataFile;
+
+            // (Declaration order matters: statements must be freed before the db, and the
+            // collation contexts must outlive it.)
+            CollationContextVector                        _collationContexts;
+            std::unique_ptr<SQLite::Database>             _sqlDb;
+            std::unordered_map<std::string, std::unique_ptr<SQLite::Statement>> _statements;
+            std::unordered_map<const void*, std::unique_ptr<SQLite::Statement>> _keyedStatements;
+        };
+
+        class ReaderPool;
+
+        /** A ReadConnection borrowed from the pool by `borrowReader`. It's returned to the pool
+            when this object is destructed. */
+        class BorrowedReader {
+        public:
+            BorrowedReader() =default;
+            BorrowedReader(BorrowedReader&&) =default;
+            ~BorrowedReader();
+
+            explicit operator bool() const                  {return _conn != nullptr;}
+            ReadConnection* operator-> () const             {return _conn.get();}
+            ReadConnection& operator* () const              {return *_conn;}
+
+        private:
+            friend class SQLiteDataFile;
+            BorrowedReader& operator=(BorrowedReader&&) =delete;
+
+            std::shared_ptr<ReaderPool>     _pool;
+            std::unique_ptr<ReadConnection> _conn;
+        };
+
+        /** Borrows a pooled read-only connection, opening one if necessary. Never blocks:
+            returns an empty BorrowedReader if all connections are in use, or if this DataFile
+            is in a transaction (whose uncommitted changes are only visible to the main
+            connection.) In that case the caller should use the main connection as usual. */
+        BorrowedReader borrowReader() const;
+
     protected:
         std::string loggingClassName() const override       {return "DB";}
         void logKeyStoreOp(SQLiteKeyStore&, const char *op, slice key);
@@ -94,6 +194,9 @@ namespace litecore {
         void rekey(EncryptionAlgorithm, slice newKey) override;
         void _beginTransaction(Transaction*) override;
         void _endTransaction(Transaction*, bool commit) override;
+        void _beginNestedTransaction(Transaction*) override;
+        void _endNestedTransaction(Transaction*, bool commit) override;
+        void _endGroupTransaction(bool commit) override;
         void beginReadOnlyTransaction() override;
         void endReadOnlyTransaction() override;
         KeyStore* newKeyStore(const std::string &name, KeyStore::Capabilities) override;
@@ -101,9 +204,11 @@ namespace litecore {
         void deleteKeyStore(const std::string &name) override;
 #endif
 
-        sequence_t lastSequence(const std::string& keyStoreName) const;
+        sequence_t lastSequence(const std::string& keyStoreName,
+                                ReadConnection* =nullptr) const;
         void setLastSequence(SQLiteKeyStore&, sequence_t);
-        uint64_t purgeCount(const std::string& keyStoreName) const;
+        uint64_t purgeCount(const std::string& keyStoreName,
+                            ReadConnection* =nullptr) const;
         void setPurgeCount(SQLiteKeyStore&, uint64_t);
 
         SQLite::Statement& compile(const std::unique_ptr<SQLite::Statement>& ref,
@@ -124,6 +229,8 @@ namespace litecore {
 
     private:
         friend class SQLiteKeyStore;
+        friend class SQLiteQuery;
+        friend class SQLiteIndexAdvisor;
 
         // SQLite schema versioning (values of `pragma user_version`)
         enum class SchemaVersion {
@@ -135,7 +242,11 @@ namespace litecore {
             WithPurgeCount  = 302,  // Added 'purgeCnt' column to KeyStores (CBL 2.7)
         };
 
+        void computeTuning();
         void reopenSQLiteHandle();
+        void configureSQLiteHandle(SQLite::Database&, CollationContextVector&, int64_t cacheSize);
+        std::unique_ptr<ReadConnection> openReadConnection();
+        void closeReaders(bool forDelete);
         void ensureSchemaVersionAtLeast(SchemaVersion);
         void decrypt();
         bool _decrypt(EncryptionAlgorithm, slice key);
@@ -148,6 +259,7 @@ namespace litecore {
                            const std::string &indexTableName);
         void unregisterIndex(slice indexName);
         void garbageCollectIndexTable(const std::string &tableName);
+        bool indexTableIsRegistered(const std::string &tableName);
         SQLiteIndexSpec specFromStatement(SQLite::Statement &stmt);
         std::vector<SQLiteIndexSpec> getIndexesOldStyle(const KeyStore *store =nullptr);
 
@@ -156,6 +268,10 @@ namespace litecore {
         std::unique_ptr<SQLite::Statement>   _getPurgeCntStmt, _setPurgeCntStmt;
         CollationContextVector               _collationContexts;
         SchemaVersion                        _schemaVersion {SchemaVersion::None};
+        Tuning                               _tuning;        // Cache/mmap/page size settings
+        std::shared_ptr<ReaderPool>          _readers;       // Pool of ReadConnections
+        SQLiteQueryCache                     _queryCache;    // Compiled queries
+        Retained<SQLiteIndexAdvisor>         _indexAdvisor;  // Query stats, for index advice
     };
 
 
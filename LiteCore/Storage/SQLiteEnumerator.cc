@@ -36,8 +36,10 @@ namespace litecore {
 
    class SQLiteEnumerator : public RecordEnumerator::Impl {
     public:
-        SQLiteEnumerator(SQLite::Statement *stmt, ContentOption content)
-        :_stmt(stmt),
+        SQLiteEnumerator(SQLite::Statement *stmt, ContentOption content,
+                         SQLiteDataFile::BorrowedReader &&reader)
+        :_reader(move(reader)),
+         _stmt(stmt),
          _content(content)
         {
             LogTo(SQL, "Enumerator: %s", _stmt->getQuery().c_str());
@@ -57,7 +59,8 @@ namespace litecore {
         }
 
     private:
-        unique_ptr<SQLite::Statement> _stmt;
+        SQLiteDataFile::BorrowedReader _reader;     // Pooled connection _stmt runs on, if any
+        unique_ptr<SQLite::Statement> _stmt;        // (must be destructed before _reader)
         ContentOption _content;
     };
 
@@ -111,12 +114,17 @@ namespace litecore {
                 sql << " DESC";
         }
 
+        // Use a pooled read-only connection if available, so the enumeration can run in
+        // parallel with other uses of the database:
+        auto reader = db().borrowReader();
+        SQLite::Database &sqlDb = reader ? reader->db() : (SQLite::Database&)db();
+
         auto sqlStr = sql.str();
-        auto stmt = new SQLite::Statement(db(), sqlStr);        // TODO: Cache a statement
+        auto stmt = new SQLite::Statement(sqlDb, sqlStr);       // TODO: Cache a statement
         LogTo(SQL, "%s", sqlStr.c_str());
         if (QueryLog.willLog(LogLevel::Debug)) {
             // https://www.sqlite.org/eqp.html
-            SQLite::Statement x(db(), "EXPLAIN QUERY PLAN " + sqlStr);
+            SQLite::Statement x(sqlDb, "EXPLAIN QUERY PLAN " + sqlStr);
             while (x.executeStep()) {
                 sql << "\n\t";
                 for (int i = 0; i < 3; ++i)
@@ -129,7 +137,7 @@ namespace litecore {
 
         if (bySequence)
             stmt->bind(1, (long long)since);
-        return new SQLiteEnumerator(stmt, options.contentOption);
+        return new SQLiteEnumerator(stmt, options.contentOption, move(reader));
     }
 
 }
@@ -100,6 +100,7 @@ namespace litecore {
         _nextExpStmt.reset();
         _findExpStmt.reset();
         _withDocBodiesStmt.reset();
+        _getManyStmts.clear();
         KeyStore::close();
     }
 
@@ -224,6 +225,21 @@ namespace litecore {
     }
 
 
+    // Called after a group transaction was rolled back, although the nested transactions in it
+    // had already called transactionWillEnd(true). Forgets state that may describe rolled-back
+    // changes; it'll be looked up again from the file as needed.
+    void SQLiteKeyStore::groupTransactionRolledBack() {
+        _lastSequence = -1;
+        _purgeCountValid = false;
+        _hasExpirationColumn = false;
+        _createdSeqIndex = _createdConflictsIndex = _createdBlobsIndex = false;
+        if (_existence == kCommitted && !db().keyStoreExists(name())) {
+            _existence = kNonexistent;
+            close();
+        }
+    }
+
+
     /*static*/ slice SQLiteKeyStore::columnAsSlice(const SQLite::Column &col) {
         return slice(col.getBlob(), col.getBytes());
     }
@@ -254,36 +270,137 @@ namespace litecore {
     
 
     bool SQLiteKeyStore::read(Record &rec, ContentOption content) const {
-        SQLite::Statement *stmt;
+        const unique_ptr<SQLite::Statement> *stmtRef;
+        const char *sql;
         switch (content) {
             case kMetaOnly:
-                stmt = &compile(_getMetaByKeyStmt,
-                        "SELECT sequence, flags, 0, version, length(body) FROM kv_@ WHERE key=?");
+                stmtRef = &_getMetaByKeyStmt;
+                sql = "SELECT sequence, flags, 0, version, length(body) FROM kv_@ WHERE key=?";
                 break;
             case kCurrentRevOnly:
-                stmt = &compile(_getCurByKeyStmt,
-                        "SELECT sequence, flags, 0, version, fl_root(body) FROM kv_@ WHERE key=?");
+                stmtRef = &_getCurByKeyStmt;
+                sql = "SELECT sequence, flags, 0, version, fl_root(body) FROM kv_@ WHERE key=?";
                 break;
             case kEntireBody:
-                stmt = &compile(_getByKeyStmt,
-                        "SELECT sequence, flags, 0, version, body FROM kv_@ WHERE key=?");
+                stmtRef = &_getByKeyStmt;
+                sql = "SELECT sequence, flags, 0, version, body FROM kv_@ WHERE key=?";
                 break;
             default:
                 return false;
         }
 
-        {
-            lock_guard<mutex> lock(_stmtMutex);
-            stmt->bindNoCopy(1, (const char*)rec.key().buf, (int)rec.key().size);
-            UsingStatement u(*stmt);
-            if (!stmt->executeStep())
+        auto readFrom = [&](SQLite::Statement &stmt) {
+            stmt.bindNoCopy(1, (const char*)rec.key().buf, (int)rec.key().size);
+            UsingStatement u(stmt);
+            if (!stmt.executeStep())
                 return false;
 
-            sequence_t seq = (int64_t)stmt->getColumn(0);
+            sequence_t seq = (int64_t)stmt.getColumn(0);
             rec.updateSequence(seq);
-            setRecordMetaAndBody(rec, *stmt, content);
+            setRecordMetaAndBody(rec, stmt, content);
+            return true;
+        };
+
+        // Prefer a pooled read-only connection, which doesn't need the statement mutex. Its
+        // statement is cached under the address of this KeyStore's own statement for the SQL
+        // (KeyStores are never deleted while the DataFile is open):
+        if (auto reader = db().borrowReader(); reader)
+            return readFrom(reader->compile(stmtRef, [&]{return subst(sql);}));
+
+        SQLite::Statement &stmt = compile(*stmtRef, sql);
+        lock_guard<mutex> lock(_stmtMutex);
+        return readFrom(stmt);
+    }
+
+
+    // Maximum number of keys looked up by a single statement in getMany. (This must not exceed
+    // SQLITE_MAX_VARIABLE_NUMBER, which defaults to 999 in older versions of SQLite.)
+    static constexpr size_t kMaxKeysPerStatement = 512;
+
+
+    vector<Record> SQLiteKeyStore::getMany(const vector<slice> &keys,
+                                           ContentOption content) const
+    {
+        const char *bodyColumn;
+        switch (content) {
+            case kMetaOnly:         bodyColumn = "length(body)"; break;
+            case kCurrentRevOnly:   bodyColumn = "fl_root(body)"; break;
+            case kEntireBody:       bodyColumn = "body"; break;
+            default:                error::_throw(error::InvalidParameter);
         }
-        return true;
+
+        vector<Record> records;
+        records.reserve(keys.size());
+        unordered_map<slice,size_t> indices;    // maps key -> index of its Record
+        indices.reserve(keys.size());
+        bool duplicates = false;
+        for (slice key : keys) {
+            duplicates |= !indices.emplace(key, records.size()).second;
+            records.emplace_back(key);
+        }
+
+        // The keys are looked up in chunks, each with a single "key IN (...)" statement.
+        // The number of parameters is rounded up to a power of two, and the extras bound to
+        // NULL, so that only a handful of different statements get compiled and cached.
+        auto sqlForChunk = [&](size_t nParams) {
+            stringstream sql;
+            sql << "SELECT sequence, flags, key, version, " << bodyColumn
+                << " FROM kv_@ WHERE key IN (?";
+            for (size_t p = 1; p < nParams; ++p)
+                sql << ",?";
+            sql << ")";
+            return subst(sql.str().c_str());
+        };
+
+        auto readAll = [&](function_ref<SQLite::Statement&(const string&)> getStatement) {
+            for (size_t start = 0; start < keys.size(); start += kMaxKeysPerStatement) {
+                size_t n = min(keys.size() - start, kMaxKeysPerStatement);
+                size_t nParams = 1;
+                while (nParams < n)
+                    nParams *= 2;
+                SQLite::Statement &stmt = getStatement(sqlForChunk(nParams));
+                UsingStatement u(stmt);
+                for (size_t p = 0; p < nParams; ++p) {
+                    if (p < n)
+                        stmt.bindNoCopy(int(p + 1), (const char*)keys[start + p].buf,
+                                        (int)keys[start + p].size);
+                    else
+                        stmt.bind(int(p + 1)); // null
+                }
+                while (stmt.executeStep()) {
+                    Record &rec = records[indices[columnAsSlice(stmt.getColumn(2))]];
+                    rec.updateSequence((int64_t)stmt.getColumn(0));
+                    setRecordMetaAndBody(rec, stmt, content);
+                }
+            }
+        };
+
+        // Prefer a pooled read-only connection, reading all the chunks from one snapshot:
+        if (auto reader = db().borrowReader(); reader) {
+            reader->withSnapshot([&] {
+                readAll([&](const string &sql) -> SQLite::Statement& {
+                    return reader->compile(sql);
+                });
+            });
+        } else {
+            lock_guard<mutex> lock(_stmtMutex);
+            readAll([&](const string &sql) -> SQLite::Statement& {
+                auto &stmt = _getManyStmts[sql];
+                if (!stmt)
+                    stmt.reset(compile(sql));
+                return *stmt;
+            });
+        }
+
+        if (duplicates) {
+            // Copy the Records of repeated keys from the first occurrence, which was the one read:
+            vector<Record> result;
+            result.reserve(keys.size());
+            for (slice key : keys)
+                result.emplace_back(records[indices[key]]);
+            return result;
+        }
+        return records;
     }
 
 
@@ -291,35 +408,53 @@ namespace litecore {
         constexpr ContentOption content = kEntireBody;  // this used to be a param but not used
         Assert(_capabilities.sequences);
         Record rec;
-        SQLite::Statement *stmt;
+        const unique_ptr<SQLite::Statement> *stmtRef;
+        const char *sql;
         switch (content) {
             case kMetaOnly:
-                stmt = &compile(_getMetaBySeqStmt,
-                        "SELECT 0, flags, key, version, length(body) FROM kv_@ WHERE sequence=?");
+                stmtRef = &_getMetaBySeqStmt;
+                sql = "SELECT 0, flags, key, version, length(body) FROM kv_@ WHERE sequence=?";
                 break;
             case kCurrentRevOnly:
-                stmt = &compile(_getCurBySeqStmt,
-                        "SELECT 0, flags, key, version, fl_root(body) FROM kv_@ WHERE sequence=?");
+                stmtRef = &_getCurBySeqStmt;
+                sql = "SELECT 0, flags, key, version, fl_root(body) FROM kv_@ WHERE sequence=?";
                 break;
             case kEntireBody:
-                stmt = &compile(_getBySeqStmt,
-                        "SELECT 0, flags, key, version, body FROM kv_@ WHERE sequence=?");
+                stmtRef = &_getBySeqStmt;
+                sql = "SELECT 0, flags, key, version, body FROM kv_@ WHERE sequence=?";
                 break;
             default:
                 error::_throw(error::UnexpectedError);
         }
 
-        UsingStatement u(*stmt);
-        stmt->bind(1, (long long)seq);
-        if (stmt->executeStep()) {
-            rec.setKey(columnAsSlice(stmt->getColumn(2)));
+        auto reader = db().borrowReader();
+        SQLite::Statement &stmt = reader ? reader->compile(stmtRef, [&]{return subst(sql);})
+                                         : compile(*stmtRef, sql);
+        UsingStatement u(stmt);
+        stmt.bind(1, (long long)seq);
+        if (stmt.executeStep()) {
+            rec.setKey(columnAsSlice(stmt.getColumn(2)));
             rec.updateSequence(seq);
-            setRecordMetaAndBody(rec, *stmt, content);
+            setRecordMetaAndBody(rec, stmt, content);
         }
         return rec;
     }
 
 
+    // Returns the statement that writes a record, replacing any existing one unless `insertOnly`.
+    // Its parameters are (version, body, flags, sequence, key).
+    SQLite::Statement& SQLiteKeyStore::setStatement(bool insertOnly) {
+        if (insertOnly)
+            return compile(_insertStmt,
+                           "INSERT OR IGNORE INTO kv_@ (version, body, flags, sequence, key)"
+                           " VALUES (?, ?, ?, ?, ?)");
+        else
+            return compile(_setStmt,
+                           "INSERT OR REPLACE INTO kv_@ (version, body, flags, sequence, key)"
+                           " VALUES (?, ?, ?, ?, ?)");
+    }
+
+
     sequence_t SQLiteKeyStore::set(slice key, slice vers, slice body, DocumentFlags flags,
                                    Transaction&,
                                    const sequence_t *replacingSequence,
@@ -329,17 +464,11 @@ namespace litecore {
         SQLite::Statement *stmt;
         if (replacingSequence == nullptr) {
             // Default:
-            compile(_setStmt,
-                    "INSERT OR REPLACE INTO kv_@ (version, body, flags, sequence, key)"
-                    " VALUES (?, ?, ?, ?, ?)");
-            stmt = _setStmt.get();
+            stmt = &setStatement(false);
             opName = "set";
         } else if (*replacingSequence == 0) {
             // Insert only:
-            compile(_insertStmt,
-                    "INSERT OR IGNORE INTO kv_@ (version, body, flags, sequence, key)"
-                    " VALUES (?, ?, ?, ?, ?)");
-            stmt = _insertStmt.get();
+            stmt = &setStatement(true);
             opName = "insert";
         } else {
             // Replace only:
@@ -383,6 +512,47 @@ namespace litecore {
     }
 
 
+    vector<sequence_t> SQLiteKeyStore::setMany(const vector<SetRequest> &requests,
+                                               Transaction&,
+                                               bool insertOnly)
+    {
+        // Same as calling `set` repeatedly, but with the statement, logging check and
+        // last-sequence update hoisted out of the loop:
+        SQLite::Statement &stmt = setStatement(insertOnly);
+        bool logging = db().willLog(LogLevel::Verbose) && name() != "default";
+        const char *opName = insertOnly ? "insert" : "set";
+        sequence_t seq = _capabilities.sequences ? lastSequence() : 0;
+        vector<sequence_t> seqs;
+        seqs.reserve(requests.size());
+
+        UsingStatement u(stmt);
+        for (auto &rq : requests) {
+            stmt.bindNoCopy(1, rq.version.buf, (int)rq.version.size);
+            stmt.bindNoCopy(2, rq.value.buf, (int)rq.value.size);
+            stmt.bind(3, (int)rq.flags);
+            if (_capabilities.sequences)
+                stmt.bind(4, (long long)(seq + 1));
+            else
+                stmt.bind(4); // null
+            stmt.bindNoCopy(5, (const char*)rq.key.buf, (int)rq.key.size);
+            if (logging)
+                db()._logVerbose("KeyStore(%-s) %s %.*s", name().c_str(), opName, SPLAT(rq.key));
+            bool written = stmt.exec() > 0;
+            stmt.reset();
+            if (!written)
+                seqs.push_back(0);              // key exists, and insertOnly
+            else if (_capabilities.sequences)
+                seqs.push_back(++seq);
+            else
+                seqs.push_back(1);
+        }
+
+        if (_capabilities.sequences && seq > lastSequence())
+            setLastSequence(seq);
+        return seqs;
+    }
+
+
     bool SQLiteKeyStore::del(slice key, Transaction&, sequence_t seq) {
         Assert(key);
         SQLite::Statement *stmt;
@@ -21,6 +21,7 @@
 #include "QueryParser.hh"
 #include "FleeceImpl.hh"
 #include <mutex>
+#include <unordered_map>
 #include <atomic>
 
 namespace SQLite {
@@ -45,12 +46,18 @@ namespace litecore {
 
         Record get(sequence_t) const override;
         bool read(Record &rec, ContentOption) const override;
+        std::vector<Record> getMany(const std::vector<slice> &keys,
+                                    ContentOption =kEntireBody) const override;
 
         sequence_t set(slice key, slice meta, slice value, DocumentFlags,
                        Transaction&,
                        const sequence_t *replacingSequence =nullptr,
                        bool newSequence =true) override;
 
+        std::vector<sequence_t> setMany(const std::vector<SetRequest>&,
+                                        Transaction&,
+                                        bool insertOnly =false) override;
+
         bool del(slice key, Transaction&, sequence_t s) override;
 
         bool setDocumentFlag(slice key, sequence_t, DocumentFlags, Transaction&) override;
@@ -83,6 +90,11 @@ namespace litecore {
         virtual std::string predictiveTableName(const std::string &property) const override;
 #endif
         virtual bool tableExists(const std::string &tableName) const override;
+        virtual std::vector<QueryParser::CoveringTable> coveringTables() const override;
+        virtual std::vector<QueryParser::AggregateTable> aggregateTables() const override;
+
+        std::string coveringTableName(const std::string &indexName) const;
+        std::string aggregateTableName(const std::string &indexName) const;
 
 
     protected:
@@ -96,6 +108,7 @@ namespace litecore {
                                    const char *sqlTemplate) const;
 
         void transactionWillEnd(bool commit);
+        void groupTransactionRolledBack();
 
         void close() override;
         void reopen() override;
@@ -115,6 +128,7 @@ namespace litecore {
         void createTable();
         SQLiteDataFile& db() const                    {return (SQLiteDataFile&)dataFile();}
         std::string subst(const char *sqlTemplate) const;
+        SQLite::Statement& setStatement(bool insertOnly);
         void setLastSequence(sequence_t seq);
         void incrementPurgeCount();
         void createTrigger(string_view triggerName,
@@ -123,13 +137,17 @@ namespace litecore {
                            std::string when,
                            string_view statements);
         bool createValueIndex(const IndexSpec&);
+        void createCoveringTable(const IndexSpec&);
         bool createIndex(const IndexSpec&,
                               const std::string &sourceTableName,
                               fleece::impl::Array::iterator &expressions);
         void _createFlagsIndex(const char *indexName NONNULL, DocumentFlags flag, bool &created);
         bool createFTSIndex(const IndexSpec&);
+        bool createFTSTable(const IndexSpec&, bool populate);
+        void populateFTSTable(const IndexSpec&, int64_t maxRowid);
         bool createArrayIndex(const IndexSpec&);
         std::string createUnnestedTable(const fleece::impl::Value *arrayPath, const IndexSpec::Options*);
+        bool createAggregateIndex(const IndexSpec&);
         void addExpiration();
 
 #ifdef COUCHBASE_ENTERPRISE
@@ -146,6 +164,7 @@ namespace litecore {
         std::unique_ptr<SQLite::Statement> _delByKeyStmt, _delBySeqStmt, _delByBothStmt;
         std::unique_ptr<SQLite::Statement> _setFlagStmt, _withDocBodiesStmt;
         std::unique_ptr<SQLite::Statement> _setExpStmt, _getExpStmt, _nextExpStmt, _findExpStmt;
+        mutable std::unordered_map<std::string, std::unique_ptr<SQLite::Statement>> _getManyStmts;
 
         enum Existence : uint8_t { kNonexistent, kUncommitted, kCommitted };
 
@@ -159,6 +178,11 @@ namespace litecore {
         bool _uncommittedExpirationColumn {false};
         mutable std::mutex _stmtMutex;
         Existence _existence;
+
+        // Cached by coveringTables(), along with the schema version it was read at:
+        mutable std::mutex _coveringTablesMutex;
+        mutable std::vector<QueryParser::CoveringTable> _coveringTables;
+        mutable int64_t _coveringTablesSchemaVersion {-1};
     };
 
 }
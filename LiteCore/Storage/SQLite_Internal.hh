@@ -34,6 +34,7 @@ namespace fleece { namespace impl {
 
 
 namespace litecore {
+    class QueryBodyCache;
 
     extern LogDomain SQL;
 
@@ -68,6 +69,7 @@ namespace litecore {
 
         DataFile::Delegate* delegate;
         fleece::impl::SharedKeys* const sharedKeys;
+        std::shared_ptr<QueryBodyCache> bodyCache;  // Shared by a connection's functions
     };
 
 
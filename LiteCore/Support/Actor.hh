@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 #include <thread>
 
@@ -62,9 +63,11 @@ namespace litecore { namespace actor {
     #define ACTOR_BIND_FN(FN, ARGS)                 ^{ FN(ARGS...); }
 #else
     using Mailbox = ThreadedMailbox;
-    #define ACTOR_BIND_METHOD0(RCVR, METHOD)        std::bind(METHOD, RCVR)
-    #define ACTOR_BIND_METHOD(RCVR, METHOD, ARGS)   std::bind(METHOD, RCVR, ARGS...)
-    #define ACTOR_BIND_FN(FN, ARGS)                 std::bind(FN, ARGS...)
+    // These produce lambdas, not std::bind, so the result is small enough to fit in a MessageFn
+    // without a heap allocation.
+    #define ACTOR_BIND_METHOD0(RCVR, METHOD)        [=]{ ((RCVR)->*METHOD)(); }
+    #define ACTOR_BIND_METHOD(RCVR, METHOD, ARGS)   [=]{ ((RCVR)->*METHOD)(ARGS...); }
+    #define ACTOR_BIND_FN(FN, ARGS)                 [=]{ FN(ARGS...); }
 #endif
 
     #define FUNCTION_TO_QUEUE(METHOD) #METHOD, &METHOD
@@ -129,8 +132,10 @@ namespace litecore { namespace actor {
         template <class... Args>
         std::function<void(Args...)> _asynchronize(const char* methodName, std::function<void(Args...)> fn) {
             Retained<Actor> ret(this);
+            // Share the function, so each message only copies a pointer to it:
+            auto sharedFn = std::make_shared<std::function<void(Args...)>>(std::move(fn));
             return [=](Args ...arg) mutable {
-                ret->_mailbox.enqueue(methodName, ACTOR_BIND_FN(fn, arg));
+                ret->_mailbox.enqueue(methodName, ACTOR_BIND_FN((*sharedFn), arg));
             };
         }
 
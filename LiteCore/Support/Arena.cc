@@ -0,0 +1,116 @@
+//
+// Arena.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "Arena.hh"
+#include <stdlib.h>
+
+namespace litecore {
+
+    // Max number of free blocks kept by each thread's pool:
+    static constexpr size_t kMaxPooledBlocks = 64;
+
+
+    // Set when this thread's pool has been destructed, as the thread exits. (This is trivially
+    // destructible, so it can still be read after that, by Arenas destructed later.)
+    static thread_local bool sPoolDestructed = false;
+
+
+    // Per-thread cache of unused blocks of size kBlockSize.
+    struct Arena::BlockPool {
+        ~BlockPool() {
+            sPoolDestructed = true;
+            while (head) {
+                Block *block = head;
+                head = block->next;
+                ::free(block);
+            }
+        }
+
+        Block* head {nullptr};
+        size_t count {0};
+    };
+
+
+    // Returns this thread's pool, or nullptr if it's already been destructed.
+    Arena::BlockPool* Arena::blockPool() noexcept {
+        if (sPoolDestructed)
+            return nullptr;
+        static thread_local BlockPool sPool;
+        return &sPool;
+    }
+
+
+    void* Arena::allocSlow(size_t size, size_t alignment) {
+        size_t needed = sizeof(Block) + size + alignment;
+        if (needed > kBlockSize / 4) {
+            // A big allocation gets a block of its own, so the current block's free space isn't
+            // abandoned. It goes after the current block in the list:
+            auto block = (Block*)::malloc(needed);
+            if (!block)
+                throw std::bad_alloc();
+            block->size = needed;
+            if (_blocks) {
+                block->next = _blocks->next;
+                _blocks->next = block;
+            } else {
+                block->next = nullptr;
+                _blocks = block;
+            }
+            uintptr_t start = (uintptr_t)(block + 1);
+            return (void*)((start + alignment - 1) & ~uintptr_t(alignment - 1));
+        }
+
+        // Start a new current block, from the pool if possible:
+        BlockPool *pool = blockPool();
+        Block *block = pool ? pool->head : nullptr;
+        if (block) {
+            pool->head = block->next;
+            --pool->count;
+        } else {
+            block = (Block*)::malloc(kBlockSize);
+            if (!block)
+                throw std::bad_alloc();
+        }
+        block->size = kBlockSize;
+        block->next = _blocks;
+        _blocks = block;
+        _pos = (uintptr_t)(block + 1);
+        _end = (uintptr_t)block + kBlockSize;
+        return alloc(size, alignment);
+    }
+
+
+    void Arena::reset() noexcept {
+        if (!_blocks)
+            return;
+        BlockPool *pool = blockPool();
+        while (_blocks) {
+            Block *block = _blocks;
+            _blocks = block->next;
+            if (pool && block->size == kBlockSize && pool->count < kMaxPooledBlocks) {
+                block->next = pool->head;
+                pool->head = block;
+                ++pool->count;
+            } else {
+                ::free(block);
+            }
+        }
+        _pos = _end = 0;
+    }
+
+}
@@ -0,0 +1,126 @@
+//
+// Arena.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "PlatformCompat.hh"
+#include "fleece/slice.hh"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace litecore {
+
+    /** A bump allocator: allocations are carved sequentially out of blocks of memory, and are
+        all freed at once when the Arena is reset or destructed. It suits a group of objects
+        that are created and destroyed together, like the metadata of a document.
+        Blocks are recycled through a small per-thread pool, so in steady state (an Arena being
+        repeatedly created and destructed on the same thread) it doesn't call malloc at all.
+        Not thread-safe. */
+    class Arena {
+    public:
+        static constexpr size_t kBlockSize = 4096;
+
+        Arena() =default;
+        ~Arena()                                        {reset();}
+
+        Arena(const Arena&) =delete;
+        Arena& operator=(const Arena&) =delete;
+
+        /** Allocates memory, which stays valid until the Arena is reset or destructed.
+            `alignment` must be a power of 2. */
+        void* alloc(size_t size, size_t alignment =alignof(std::max_align_t)) {
+            uintptr_t pos = (_pos + alignment - 1) & ~uintptr_t(alignment - 1);
+            if (_usuallyFalse(pos + size > _end || _end == 0))
+                return allocSlow(size, alignment);
+            _pos = pos + size;
+            return (void*)pos;
+        }
+
+        /** Gives back memory; this only has an effect if it was the latest allocation. So an
+            Arena whose contents are repeatedly replaced keeps growing until it's reset. */
+        void free(void *ptr, size_t size) noexcept {
+            if ((uintptr_t)ptr + size == _pos)
+                _pos = (uintptr_t)ptr;
+        }
+
+        /** Constructs an object in the Arena. Its destructor won't be called, so it has to be
+            trivially destructible. */
+        template <class T, class... Args>
+        T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible<T>::value,
+                          "Arena doesn't call destructors");
+            return new (alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /** Copies the bytes of `s` into the Arena. */
+        fleece::slice copy(fleece::slice s) {
+            if (s.size == 0)
+                return s;
+            void *buf = alloc(s.size, 1);
+            memcpy(buf, s.buf, s.size);
+            return {buf, s.size};
+        }
+
+        /** Frees everything allocated, returning the blocks to this thread's pool. */
+        void reset() noexcept;
+
+    private:
+        struct Block {
+            Block* next;
+            size_t size;
+        };
+        struct BlockPool;
+
+        static BlockPool* blockPool() noexcept;
+        void* allocSlow(size_t size, size_t alignment);
+
+        Block*    _blocks {nullptr};        // Blocks allocated, current one first
+        uintptr_t _pos {0};                 // Next free byte in the current block
+        uintptr_t _end {0};                 // End of the current block
+    };
+
+
+    /** An STL allocator that allocates from an Arena, for containers whose lifetime is that of
+        the Arena. Deallocating only reclaims the Arena's latest allocation. */
+    template <class T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        ArenaAllocator(Arena &arena) noexcept                       :_arena(&arena) { }
+        template <class U>
+        ArenaAllocator(const ArenaAllocator<U> &other) noexcept     :_arena(other._arena) { }
+
+        T* allocate(size_t n)                   {return (T*)_arena->alloc(n * sizeof(T), alignof(T));}
+        void deallocate(T *p, size_t n) noexcept    {_arena->free(p, n * sizeof(T));}
+
+        template <class U>
+        bool operator== (const ArenaAllocator<U> &other) const noexcept {return _arena == other._arena;}
+        template <class U>
+        bool operator!= (const ArenaAllocator<U> &other) const noexcept {return _arena != other._arena;}
+
+    private:
+        template <class U> friend class ArenaAllocator;
+
+        Arena* _arena;
+    };
+
+}
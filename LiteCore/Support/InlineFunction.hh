@@ -0,0 +1,135 @@
+//
+// InlineFunction.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace litecore { namespace actor {
+
+    template <class Signature, size_t InlineSize =56>
+    class InlineFunction;
+
+
+    /** A move-only alternative to `std::function` that stores callables of up to `InlineSize`
+        bytes inside itself instead of on the heap. Larger callables (or ones whose move
+        constructor can throw) still work, but are heap-allocated.
+        The default size makes an `InlineFunction` exactly 64 bytes, which fits a lambda that
+        captures an object pointer, a member-function pointer and a few arguments. */
+    template <class R, class... Args, size_t InlineSize>
+    class InlineFunction<R(Args...), InlineSize> {
+    public:
+        InlineFunction() noexcept                           { }
+        InlineFunction(std::nullptr_t) noexcept             { }
+
+        template <class F,
+                  class = std::enable_if_t<!std::is_same<std::decay_t<F>, InlineFunction>::value>>
+        InlineFunction(F &&f) {
+            using Fn = std::decay_t<F>;
+            if constexpr (fitsInline<Fn>()) {
+                new (&_storage) Fn(std::forward<F>(f));
+                _ops = &InlineOps<Fn>::kOps;
+            } else {
+                *reinterpret_cast<Fn**>(&_storage) = new Fn(std::forward<F>(f));
+                _ops = &HeapOps<Fn>::kOps;
+            }
+        }
+
+        InlineFunction(InlineFunction &&other) noexcept {
+            moveFrom(other);
+        }
+
+        InlineFunction& operator=(InlineFunction &&other) noexcept {
+            if (this != &other) {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        InlineFunction(const InlineFunction&) =delete;
+        InlineFunction& operator=(const InlineFunction&) =delete;
+
+        ~InlineFunction()                                   {reset();}
+
+        explicit operator bool() const noexcept             {return _ops != nullptr;}
+
+        R operator() (Args... args) const {
+            return _ops->invoke(const_cast<Storage*>(&_storage), std::forward<Args>(args)...);
+        }
+
+    private:
+        using Storage = std::aligned_storage_t<InlineSize, alignof(void*)>;
+
+        struct Ops {
+            R    (*invoke)(Storage*, Args&&...);
+            void (*move)(Storage *dst, Storage *src) noexcept;   // Move-constructs & destroys src
+            void (*destroy)(Storage*) noexcept;
+        };
+
+        template <class Fn>
+        static constexpr bool fitsInline() {
+            return sizeof(Fn) <= InlineSize && alignof(Fn) <= alignof(Storage)
+                && std::is_nothrow_move_constructible<Fn>::value;
+        }
+
+        template <class Fn>
+        struct InlineOps {
+            static Fn* get(Storage *s)                      {return reinterpret_cast<Fn*>(s);}
+            static R invoke(Storage *s, Args&&... args)     {return (*get(s))(std::forward<Args>(args)...);}
+            static void move(Storage *dst, Storage *src) noexcept {
+                new (dst) Fn(std::move(*get(src)));
+                get(src)->~Fn();
+            }
+            static void destroy(Storage *s) noexcept        {get(s)->~Fn();}
+            static constexpr Ops kOps {&invoke, &move, &destroy};
+        };
+
+        template <class Fn>
+        struct HeapOps {
+            static Fn*& get(Storage *s)                     {return *reinterpret_cast<Fn**>(s);}
+            static R invoke(Storage *s, Args&&... args)     {return (*get(s))(std::forward<Args>(args)...);}
+            static void move(Storage *dst, Storage *src) noexcept {
+                *reinterpret_cast<Fn**>(dst) = get(src);
+            }
+            static void destroy(Storage *s) noexcept        {delete get(s);}
+            static constexpr Ops kOps {&invoke, &move, &destroy};
+        };
+
+        void moveFrom(InlineFunction &other) noexcept {
+            if (other._ops) {
+                other._ops->move(&_storage, &other._storage);
+                _ops = other._ops;
+                other._ops = nullptr;
+            }
+        }
+
+        void reset() noexcept {
+            if (_ops) {
+                _ops->destroy(&_storage);
+                _ops = nullptr;
+            }
+        }
+
+        Storage _storage;
+        const Ops* _ops {nullptr};
+    };
+
+} }
@@ -0,0 +1,133 @@
+//
+// MPSCQueue.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <atomic>
+#include <new>
+#include <utility>
+#include <stddef.h>
+
+namespace litecore { namespace actor {
+
+    /** A multi-producer, single-consumer FIFO queue; this is Dmitry Vyukov's intrusive
+        non-blocking MPSC queue. `push` never blocks and may be called from any thread; `front`
+        and `pop` must only be called by one consumer at a time.
+        Nodes are recycled through a small per-thread free list, so in steady state (where the
+        threads that consume also produce, as with Actors) pushing doesn't allocate. */
+    template <class T>
+    class MPSCQueue {
+    public:
+        MPSCQueue() {
+            _tail = allocNode();
+            _head.store(_tail, std::memory_order_relaxed);
+        }
+
+        ~MPSCQueue() {
+            while (front())
+                pop();
+            freeNode(_tail);
+        }
+
+        MPSCQueue(const MPSCQueue&) =delete;
+        MPSCQueue& operator=(const MPSCQueue&) =delete;
+
+        /** Adds an item to the back of the queue. Thread-safe, wait-free. */
+        void push(T &&item) {
+            Node *node = allocNode();
+            new (&node->value) T(std::move(item));
+            Node *prev = _head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        /** Returns a pointer to the item at the front of the queue, or nullptr if it's empty.
+            Note: this can also return nullptr very briefly while a push is in progress on
+            another thread, so a consumer that knows an item is coming should retry.
+            Consumer only. */
+        T* front() const {
+            Node *next = _tail->next.load(std::memory_order_acquire);
+            return next ? &next->value : nullptr;
+        }
+
+        /** Removes the front item. The queue MUST be non-empty (i.e. `front` returned non-null.)
+            Consumer only. */
+        void pop() {
+            Node *next = _tail->next.load(std::memory_order_acquire);
+            next->value.~T();           // `next` now becomes the value-less stub node
+            freeNode(_tail);
+            _tail = next;
+        }
+
+    private:
+        // The node at `_tail` is always a "stub" whose value has been consumed (or was never
+        // initialized), so `value` is a union member with manually-managed lifetime.
+        struct Node {
+            Node()  { }
+            ~Node() { }
+            std::atomic<Node*> next {nullptr};
+            union { T value; };
+        };
+
+        // Per-thread cache of unused Nodes.
+        struct FreeList {
+            ~FreeList() {
+                while (head) {
+                    Node *n = head;
+                    head = n->next.load(std::memory_order_relaxed);
+                    delete n;
+                }
+            }
+            Node* head {nullptr};
+            size_t count {0};
+        };
+
+        static constexpr size_t kMaxFreeNodes = 256;
+
+        static FreeList& freeList() {
+            static thread_local FreeList sFreeList;
+            return sFreeList;
+        }
+
+        static Node* allocNode() {
+            FreeList &list = freeList();
+            Node *n = list.head;
+            if (n) {
+                list.head = n->next.load(std::memory_order_relaxed);
+                --list.count;
+                n->next.store(nullptr, std::memory_order_relaxed);
+            } else {
+                n = new Node;
+            }
+            return n;
+        }
+
+        static void freeNode(Node *n) {
+            FreeList &list = freeList();
+            if (list.count < kMaxFreeNodes) {
+                n->next.store(list.head, std::memory_order_relaxed);
+                list.head = n;
+                ++list.count;
+            } else {
+                delete n;
+            }
+        }
+
+        std::atomic<Node*> _head;       // Most recently pushed node (producers)
+        Node* _tail;                    // Stub node preceding the front item (consumer)
+    };
+
+} }
@@ -23,8 +23,8 @@
 #include "Error.hh"
 #include "Timer.hh"
 #include "Logging.hh"
+#include <algorithm>
 #include <future>
-#include <random>
 #include <map>
 #include <sstream>
 
@@ -64,15 +64,15 @@ namespace litecore { namespace actor {
         }
     };
     
-    static Scheduler* sScheduler;
-    static random_device rd;
-    static mt19937 sRandGen(rd());
+    thread_local Scheduler::Worker* Scheduler::sCurrentWorker;
+
 
     Scheduler* Scheduler::sharedScheduler() {
-        if (!sScheduler) {
-            sScheduler = new Scheduler;
-            sScheduler->start();
-        }
+        static Scheduler* const sScheduler = [] {
+            auto scheduler = new Scheduler;
+            scheduler->start();
+            return scheduler;
+        }();
         return sScheduler;
     }
 
@@ -85,6 +85,10 @@ namespace litecore { namespace actor {
                     _numThreads = 2;
             }
             LogTo(ActorLog, "Starting Scheduler<%p> with %u threads", this, _numThreads);
+            _stopping = false;
+            _workers.clear();
+            for (unsigned i = 0; i < _numThreads; i++)
+                _workers.emplace_back(new Worker(i));
             for (unsigned id = 1; id <= _numThreads; id++)
                 _threadPool.emplace_back([this,id]{task(id);});
         }
@@ -93,39 +97,172 @@ namespace litecore { namespace actor {
 
     void Scheduler::stop() {
         LogTo(ActorLog, "Stopping Scheduler<%p>...", this);
-        _queue.close();
+        _stopping = true;
+        {
+            lock_guard<mutex> lock(_parkMutex);
+            _parkCond.notify_all();
+        }
         for (auto &t : _threadPool) {
             t.join();
         }
+        _threadPool.clear();
         LogTo(ActorLog, "Scheduler<%p> has stopped", this);
         _started.clear();
     }
 
 
+    // Thread body. A taskID of 0 means we're running synchronously on the caller's thread,
+    // without a Worker of our own, and should return as soon as there's nothing left to do.
     void Scheduler::task(unsigned taskID) {
         LogToAt(ActorLog, Verbose, "   task %d starting", taskID);
-        char name[100];
-        sprintf(name, "CBL Scheduler#%u", taskID);
-        SetThreadName(name);
-        ThreadedMailbox *mailbox;
-        while ((mailbox = _queue.pop()) != nullptr) {
-            LogToAt(ActorLog, Verbose, "   task %d calling Actor<%p>", taskID, mailbox);
-            mailbox->performNextMessage();
-            mailbox = nullptr;
+        Worker *me = nullptr;
+        if (taskID > 0) {
+            char name[100];
+            sprintf(name, "CBL Scheduler#%u", taskID);
+            SetThreadName(name);
+            me = _workers[taskID - 1].get();
+            sCurrentWorker = me;
+        }
+        while (true) {
+            ThreadedMailbox *mailbox = findWork(me);
+            if (mailbox) {
+                LogToAt(ActorLog, Verbose, "   task %d calling Actor<%p>", taskID, mailbox);
+                mailbox->performNextMessage();
+            } else if (!me || _stopping) {
+                break;
+            } else {
+                park();
+            }
         }
+        sCurrentWorker = nullptr;
         LogTo(ActorLog, "   task %d finished", taskID);
     }
 
 
+    // Returns the next Mailbox the given worker should run: first from its own queue (after
+    // moving in anything other threads posted to it), else stolen from another worker.
+    ThreadedMailbox* Scheduler::findWork(Worker *me) {
+        unsigned start = 0;
+        if (me) {
+            pushAll(me, me->takeInbox());
+            if (auto mbox = me->deque.steal())
+                return mbox;
+            start = me->index + 1;
+        }
+        for (unsigned i = 0; i < _numThreads; ++i) {
+            Worker *victim = _workers[(start + i) % _numThreads].get();
+            if (victim == me)
+                continue;
+            if (auto mbox = victim->deque.steal())
+                return mbox;
+            if (victim->inbox.load(memory_order_relaxed)) {
+                // Victim hasn't drained its inbox yet; grab the whole thing.
+                auto mbox = victim->takeInbox();
+                if (mbox) {
+                    auto rest = mbox->_nextScheduled;
+                    if (me) {
+                        pushAll(me, rest);
+                    } else {
+                        // No deque of our own (synchronous mode), so give the rest back:
+                        while (rest) {
+                            auto next = rest->_nextScheduled;
+                            victim->post(rest);
+                            rest = next;
+                        }
+                    }
+                    return mbox;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+
+    // Pushes a list returned by takeInbox() onto a worker's own deque.
+    void Scheduler::pushAll(Worker *me, ThreadedMailbox *list) {
+        while (list) {
+            // Must read the link first: once pushed, the mailbox may be stolen and re-posted.
+            auto next = list->_nextScheduled;
+            me->deque.push(list);
+            list = next;
+        }
+    }
+
+
+    bool Scheduler::hasWork() const {
+        for (auto &worker : _workers) {
+            if (!worker->deque.empty() || worker->inbox.load(memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+
+    // Blocks an idle worker until wakeWorker() is called or the Scheduler stops.
+    void Scheduler::park() {
+        unique_lock<mutex> lock(_parkMutex);
+        ++_sleepers;
+        // The fence pairs with the one in wakeWorker(): either it sees our increment of
+        // _sleepers, or we see the work it just queued.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!hasWork() && !_stopping)
+            _parkCond.wait(lock);
+        --_sleepers;
+    }
+
+
+    void Scheduler::wakeWorker() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_sleepers.load(memory_order_relaxed) > 0) {
+            lock_guard<mutex> lock(_parkMutex);
+            _parkCond.notify_one();
+        }
+    }
+
+
     void Scheduler::schedule(ThreadedMailbox *mbox) {
-        sScheduler->_queue.push(mbox);
+        sharedScheduler()->_schedule(mbox);
+    }
+
+
+    void Scheduler::_schedule(ThreadedMailbox *mbox) {
+        Worker *current = sCurrentWorker;
+        if (current && (current->index >= _workers.size() || _workers[current->index].get() != current))
+            current = nullptr;      // current thread belongs to a different Scheduler
+        int last = mbox->_lastWorker.load(memory_order_relaxed);
+        if (current && (last < 0 || unsigned(last) == current->index)) {
+            // Fast path: we're on the mailbox's home thread, so push to our own deque:
+            current->deque.push(mbox);
+        } else {
+            unsigned target = (last >= 0) ? unsigned(last) : (_nextWorker++ % _numThreads);
+            _workers[target]->post(mbox);
+        }
+        wakeWorker();
     }
 
 
-    // Explicitly instantiate the Channel specializations we need; this corresponds to the
-    // "extern template..." declarations at the bottom of Actor.hh
-    template class Channel<ThreadedMailbox*>;
-    template class Channel<std::function<void()>>;
+    // Pushes a Mailbox onto a Worker's inbox. Safe to call from any thread.
+    void Scheduler::Worker::post(ThreadedMailbox *mbox) {
+        ThreadedMailbox *head = inbox.load(memory_order_relaxed);
+        do {
+            mbox->_nextScheduled = head;
+        } while (!inbox.compare_exchange_weak(head, mbox, memory_order_release,
+                                                          memory_order_relaxed));
+    }
+
+
+    // Atomically empties the inbox, returning its contents as a linked list in FIFO order.
+    ThreadedMailbox* Scheduler::Worker::takeInbox() {
+        ThreadedMailbox *list = inbox.exchange(nullptr, memory_order_acquire);
+        ThreadedMailbox *fifo = nullptr;
+        while (list) {
+            auto next = list->_nextScheduled;
+            list->_nextScheduled = fifo;
+            fifo = list;
+            list = next;
+        }
+        return fifo;
+    }
 
 
 #pragma mark - MAILBOX:
@@ -139,85 +276,75 @@ namespace litecore { namespace actor {
     ThreadedMailbox::ThreadedMailbox(Actor *a, const std::string &name, ThreadedMailbox *parent)
     :_actor(a)
     ,_name(name)
+    ,_delayTimer([this]{ fireDelayed(); })
     {
         Scheduler::sharedScheduler()->start();
     }
 
-    void ThreadedMailbox::enqueue(const char* name, const std::function<void()> &f) {
-        beginLatency();
+    void ThreadedMailbox::enqueue(const char* name, MessageFn &&f) {
         retain(_actor);
+        push(instrument(name, move(f)));
+    }
 
-#if ACTORS_USE_MANIFESTS
-        auto threadManifest = sThreadManifest ? sThreadManifest : make_shared<ChannelManifest>();
-        threadManifest->addEnqueueCall(_actor, name);
-        _localManifest.addEnqueueCall(_actor, name);
-        const auto wrappedBlock = [f, threadManifest, name, SELF]
-        {
-            threadManifest->addExecution(_actor, name);
-            sThreadManifest = threadManifest;
-            _localManifest.addExecution(_actor, name);
-#else
-        const auto wrappedBlock = [f, SELF]
-        {
-#endif
-            endLatency();
-            beginBusy();
-            safelyCall(f);
-            afterEvent();
+    // Delayed messages are kept in a per-mailbox heap with a single Timer, armed for the
+    // earliest one, instead of allocating a Timer for every call.
+    void ThreadedMailbox::enqueueAfter(delay_t delay, const char* name, MessageFn &&f) {
+        if (delay <= delay_t::zero())
+            return enqueue(name, move(f));
 
-#if ACTORS_USE_MANIFESTS
-            sThreadManifest.reset();
-#endif
-        };
+        retain(_actor);
+        auto fireTime = Timer::clock::now() + chrono::duration_cast<Timer::duration>(delay);
+
+        lock_guard<mutex> lock(_delayedMutex);
+        _delayed.push_back({fireTime, instrument(name, move(f), delay)});
+        push_heap(_delayed.begin(), _delayed.end(), DelayedMessage::firesLater);
+        ++_delayedEventCount;
+        if (_delayed.front().fireTime == fireTime)
+            _delayTimer.fireAt(fireTime);       // This is now the earliest message
+    }
 
-        if (push(wrappedBlock))
-            reschedule();
+    // Called by _delayTimer: moves the delayed messages whose time has come into the queue.
+    void ThreadedMailbox::fireDelayed() {
+        lock_guard<mutex> lock(_delayedMutex);
+        auto now = Timer::clock::now();
+        while (!_delayed.empty() && _delayed.front().fireTime <= now) {
+            pop_heap(_delayed.begin(), _delayed.end(), DelayedMessage::firesLater);
+            --_delayedEventCount;
+            push(move(_delayed.back().fn));
+            _delayed.pop_back();
+        }
+        if (!_delayed.empty())
+            _delayTimer.fireAt(_delayed.front().fireTime);
     }
 
-    void ThreadedMailbox::enqueueAfter(delay_t delay, const char* name, const std::function<void()> &f) {
-        if (delay <= delay_t::zero())
-            return enqueue(name, f);
 
+    // In builds that track stats or manifests, wraps a message in a function that records
+    // its latency and its place in the manifests. Otherwise it's returned as-is.
+    MessageFn ThreadedMailbox::instrument(const char *name, MessageFn &&f, delay_t delay) {
+#if ACTORS_USE_MANIFESTS || ACTORS_TRACK_STATS
         beginLatency();
-        _delayedEventCount++;
-        retain(_actor);
-
 #if ACTORS_USE_MANIFESTS
         auto threadManifest = sThreadManifest ? sThreadManifest : make_shared<ChannelManifest>();
         threadManifest->addEnqueueCall(_actor, name, delay.count());
         _localManifest.addEnqueueCall(_actor, name, delay.count());
-        auto timer = new Timer([f, threadManifest, name, this]
+        return [f = move(f), threadManifest, name, SELF]
         {
-            const auto wrappedBlock = [f, threadManifest, name, SELF]
-            {
-                threadManifest->addExecution(_actor, name);
-                sThreadManifest = threadManifest;
-                _localManifest.addExecution(_actor, name);
+            threadManifest->addExecution(_actor, name);
+            sThreadManifest = threadManifest;
+            _localManifest.addExecution(_actor, name);
 #else
-        auto timer = new Timer([f, this]
+        return [f = move(f), SELF]
         {
-             const auto wrappedBlock = [f, SELF]
-             {
 #endif
-                endLatency();
-                beginBusy();
-                safelyCall(f);
-                --_delayedEventCount;
-                afterEvent();
-#if ACTORS_USE_MANIFESTS
-                sThreadManifest.reset();
+            endLatency();
+            f();
+        };
+#else
+        return move(f);
 #endif
-            };
-            
-            if (push(wrappedBlock))
-                reschedule();
-        });
-
-        timer->autoDelete();
-        timer->fireAfter(chrono::duration_cast<Timer::duration>(delay));
     }
 
-    void ThreadedMailbox::safelyCall(const std::function<void()>& f) const
+    void ThreadedMailbox::safelyCall(const MessageFn &f) const
     {
         try {
             f();
@@ -249,6 +376,14 @@ namespace litecore { namespace actor {
     }
 
 
+    // Adds a message to the queue, and schedules me if the queue was empty.
+    void ThreadedMailbox::push(MessageFn &&fn) {
+        _queue.push(move(fn));
+        if (_queueSize.fetch_add(1) == 0)
+            reschedule();
+    }
+
+
     void ThreadedMailbox::reschedule() {
         Scheduler::schedule(this);
     }
@@ -257,17 +392,30 @@ namespace litecore { namespace actor {
     void ThreadedMailbox::performNextMessage() {
         LogToAt(ActorLog, Verbose, "%s performNextMessage", _actor->actorName().c_str());
         DebugAssert(++_active == 1);     // Fail-safe check to detect 'impossible' re-entrant call
+        if (auto worker = Scheduler::sCurrentWorker)
+            _lastWorker.store(int(worker->index), memory_order_relaxed);
         sCurrentActor = _actor;
-        auto &fn = front();
-        fn();
+        auto fn = _queue.front();
+        while (!fn) {
+            // The producer that bumped _queueSize hasn't finished linking its node in yet:
+            this_thread::yield();
+            fn = _queue.front();
+        }
+        beginBusy();
+        safelyCall(*fn);
+        afterEvent();
+#if ACTORS_USE_MANIFESTS
+        sThreadManifest.reset();
+#endif
         sCurrentActor = nullptr;
         
         DebugAssert(--_active == 0);
 
-        bool empty;
-        popNoWaiting(empty);
+        _queue.pop();
+        // Check the count before releasing, since the release may free this mailbox:
+        bool more = (_queueSize.fetch_sub(1) > 1);
         release(_actor); // For enqueue's retain call
-        if (!empty)
+        if (more)
             reschedule();
     }
 
@@ -19,12 +19,20 @@
 #pragma once
 #include "Channel.hh"
 #include "ChannelManifest.hh"
+#include "InlineFunction.hh"
+#include "MPSCQueue.hh"
 #include "RefCounted.hh"
 #include "Stopwatch.hh"
+#include "Timer.hh"
+#include "WorkStealingDeque.hh"
 #include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <functional>
+#include <vector>
 
 namespace litecore { namespace actor {
     using fleece::RefCounted;
@@ -38,19 +46,22 @@ namespace litecore { namespace actor {
     /** A delay expressed in floating-point seconds */
     using delay_t = std::chrono::duration<double>;
 
+    /** A function queued in a Mailbox; small ones are stored without any heap allocation. */
+    using MessageFn = InlineFunction<void()>;
+
 
     #ifndef ACTORS_USE_GCD
     /** Default Actor mailbox implementation that uses a thread pool run by a Scheduler. */
-    class ThreadedMailbox : Channel<std::function<void()>> {
+    class ThreadedMailbox {
     public:
         ThreadedMailbox(Actor*, const std::string &name ="", ThreadedMailbox *parentMailbox =nullptr);
 
         const std::string& name() const                     {return _name;}
 
-        unsigned eventCount() const                         {return (unsigned)size() + (unsigned)_delayedEventCount;}
+        unsigned eventCount() const                         {return (unsigned)_queueSize + (unsigned)_delayedEventCount;}
 
-        void enqueue(const char* name, const std::function<void()>&);
-        void enqueueAfter(delay_t delay, const char* name, const std::function<void()>&);
+        void enqueue(const char* name, MessageFn&&);
+        void enqueueAfter(delay_t delay, const char* name, MessageFn&&);
 
         static Actor* currentActor()                        {return sCurrentActor;}
 
@@ -61,15 +72,22 @@ namespace litecore { namespace actor {
     private:
         friend class Scheduler;
         
+        MessageFn instrument(const char *name, MessageFn&&, delay_t delay =delay_t::zero());
+        void fireDelayed();
+        void push(MessageFn&&);
         void reschedule();
         void performNextMessage();
         void afterEvent();
-        void safelyCall(const std::function<void()> &f) const;
+        void safelyCall(const MessageFn &f) const;
 
         Actor* const _actor;
         std::string const _name;
+        MPSCQueue<MessageFn> _queue;    // Pending messages; front one is running
+        std::atomic<int> _queueSize {0};            // Number of messages in _queue
 
-        int _delayedEventCount {0};
+        std::atomic<int> _delayedEventCount {0};
+        std::atomic<int> _lastWorker {-1};          // Index of Scheduler worker that last ran me
+        ThreadedMailbox* _nextScheduled {nullptr};  // Link in a Scheduler worker's inbox
 #if DEBUG
         std::atomic_int _active {0};
 #endif
@@ -88,10 +106,29 @@ namespace litecore { namespace actor {
         mutable ChannelManifest _localManifest;
         static thread_local std::shared_ptr<ChannelManifest> sThreadManifest;
 #endif
+
+        /** A message queued by enqueueAfter, waiting for its time to come. */
+        struct DelayedMessage {
+            Timer::time fireTime;
+            MessageFn fn;
+
+            // Heap ordering that puts the earliest fireTime at the front
+            static bool firesLater(const DelayedMessage &a, const DelayedMessage &b) {
+                return a.fireTime > b.fireTime;
+            }
+        };
+
+        std::mutex _delayedMutex;
+        std::vector<DelayedMessage> _delayed;       // Min-heap ordered by fireTime
+        Timer _delayTimer;                          // Fires at _delayed's earliest fireTime
+                                                    // (Declared last so it's destructed first)
     };
 
     /** The Scheduler is reponsible for calling ThreadedMailboxes to run their Actor methods.
-        It managers a thread pool on which Mailboxes and Actors will run. */
+        It managers a thread pool on which Mailboxes and Actors will run.
+        Each thread has its own lock-free run queue; a Mailbox that becomes ready is queued on
+        the thread that last ran it (for cache locality), and idle threads steal from the
+        others' queues. */
     class Scheduler {
     public:
         Scheduler(unsigned numThreads =0)
@@ -118,19 +155,38 @@ namespace litecore { namespace actor {
         static void schedule(ThreadedMailbox* mbox);
 
     private:
+        /** Per-thread state. `deque` is pushed only by its own thread; other threads hand it
+            Mailboxes via the lock-free `inbox` stack, which the owner drains into `deque`. */
+        struct Worker {
+            explicit Worker(unsigned i)                     :index(i) { }
+            void post(ThreadedMailbox*);
+            ThreadedMailbox* takeInbox();
+
+            unsigned const index;
+            WorkStealingDeque<ThreadedMailbox*> deque;
+            std::atomic<ThreadedMailbox*> inbox {nullptr};
+        };
+
         void task(unsigned taskID);
+        void _schedule(ThreadedMailbox*);
+        ThreadedMailbox* findWork(Worker*);
+        static void pushAll(Worker*, ThreadedMailbox *list);
+        bool hasWork() const;
+        void park();
+        void wakeWorker();
 
         unsigned _numThreads;
-        Channel<ThreadedMailbox*> _queue;
+        std::vector<std::unique_ptr<Worker>> _workers;
         std::vector<std::thread> _threadPool;
         std::atomic_flag _started = ATOMIC_FLAG_INIT;
+        std::atomic<bool> _stopping {false};
+        std::atomic<unsigned> _nextWorker {0};      // Round-robin for Mailboxes with no affinity
+        std::atomic<unsigned> _sleepers {0};        // Number of workers blocked in park()
+        std::mutex _parkMutex;
+        std::condition_variable _parkCond;
 
-
+        static thread_local Worker* sCurrentWorker;
     };
-
-    // This prevents the compiler from specializing Channel in every compilation unit:
-    extern template class Channel<ThreadedMailbox*>;
-    extern template class Channel<std::function<void()>>;
 #endif
 
 } }
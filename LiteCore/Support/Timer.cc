@@ -19,6 +19,9 @@
 #include "Timer.hh"
 #include "ThreadUtil.hh"
 #include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 using namespace std;
 
@@ -30,24 +33,175 @@ namespace litecore { namespace actor {
     }
 
 
+    // Returns the index of the lowest set bit. `bits` must be nonzero.
+    static inline unsigned lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return unsigned(index);
+#else
+        return unsigned(__builtin_ctzll(bits));
+#endif
+    }
+
+
     Timer::Manager::Manager()
-    :_thread([this](){ run(); })
+    :_epoch(clock::now())
+    ,_thread([this](){ run(); })
     { }
 
 
+    // Converts a time to a tick, rounding up so a Timer never fires early.
+    Timer::Manager::tick_t Timer::Manager::tickAt(time t) const {
+        if (t <= _epoch)
+            return 0;
+        return tick_t(chrono::ceil<chrono::milliseconds>(t - _epoch).count());
+    }
+
+
+    Timer::time Timer::Manager::timeAtTick(tick_t tick) const {
+        return _epoch + chrono::milliseconds(tick);
+    }
+
+
+    Timer::Manager::List& Timer::Manager::listFor(int8_t level, uint8_t slot) {
+        if (level >= 0)
+            return _wheel[level][slot];
+        else
+            return (level == kDueList) ? _due : _overflow;
+    }
+
+
+    // Adds a Timer to the list for its `_tick`. The level chosen is that of the highest digit
+    // in which `_tick` differs from `_currentTick`; so the Timer's slot is always ahead of the
+    // current position in that level, and it'll be cascaded down before the wheel passes it.
+    // Precondition: _mutex must be locked.
+    void Timer::Manager::insert(Timer *timer) {
+        if (timer->_tick <= _currentTick) {
+            timer->_level = kDueList;
+            append(_due, timer);
+            return;
+        }
+        tick_t diff = timer->_tick ^ _currentTick;
+        unsigned level = 0;
+        while (level < kNumLevels && (diff >> (kLevelBits * (level + 1))) != 0)
+            ++level;
+        if (level >= kNumLevels) {
+            timer->_level = kOverflowList;
+            append(_overflow, timer);
+        } else {
+            auto slot = uint8_t((timer->_tick >> (kLevelBits * level)) & (kSlotsPerLevel - 1));
+            timer->_level = int8_t(level);
+            timer->_slot = slot;
+            append(_wheel[level][slot], timer);
+            _occupied[level] |= (uint64_t(1) << slot);
+        }
+    }
+
+
+    void Timer::Manager::append(List &list, Timer *timer) {
+        timer->_next = nullptr;
+        timer->_prev = list.last;
+        if (list.last)
+            list.last->_next = timer;
+        else
+            list.first = timer;
+        list.last = timer;
+    }
+
+
+    // Removes a Timer from whatever list it's in. Precondition: _mutex must be locked.
+    void Timer::Manager::remove(Timer *timer) {
+        List &list = listFor(timer->_level, timer->_slot);
+        if (timer->_prev)
+            timer->_prev->_next = timer->_next;
+        else
+            list.first = timer->_next;
+        if (timer->_next)
+            timer->_next->_prev = timer->_prev;
+        else
+            list.last = timer->_prev;
+        timer->_prev = timer->_next = nullptr;
+        if (!list.first && timer->_level >= 0)
+            _occupied[timer->_level] &= ~(uint64_t(1) << timer->_slot);
+    }
+
+
+    // Empties a list, re-inserting its Timers relative to the current tick.
+    void Timer::Manager::cascade(List &list) {
+        Timer *timer = list.first;
+        list.first = list.last = nullptr;
+        while (timer) {
+            Timer *next = timer->_next;
+            insert(timer);
+            timer = next;
+        }
+    }
+
+
+    // Returns the next tick at which something in the wheel needs attention: the start of the
+    // nearest non-empty slot ahead of the current position, at any level. (A slot at a lower
+    // level always comes before one at a higher level, so the first one found wins.)
+    Timer::Manager::tick_t Timer::Manager::nextEventTick() const {
+        for (unsigned level = 0; level < kNumLevels; ++level) {
+            unsigned shift = kLevelBits * level;
+            unsigned digit = (_currentTick >> shift) & (kSlotsPerLevel - 1);
+            if (digit == kSlotsPerLevel - 1)
+                continue;
+            uint64_t ahead = _occupied[level] & (~uint64_t(0) << (digit + 1));
+            if (ahead) {
+                tick_t base = _currentTick & ~((tick_t(1) << (shift + kLevelBits)) - 1);
+                return base | (tick_t(lowestBit(ahead)) << shift);
+            }
+        }
+        if (_overflow.first) {
+            // Overflow timers get re-examined when the top level comes around again:
+            return (_currentTick | ((tick_t(1) << (kLevelBits * kNumLevels)) - 1)) + 1;
+        }
+        return UINT64_MAX;
+    }
+
+
+    // Advances the wheel up to tick `now`, moving Timers that are due into _due.
+    // Empty stretches are skipped over, so this is proportional to the number of events.
+    // Precondition: _mutex must be locked.
+    void Timer::Manager::advance(tick_t now) {
+        while (_currentTick < now) {
+            tick_t next = nextEventTick();
+            if (next > now) {
+                _currentTick = now;
+                break;
+            }
+            _currentTick = next;
+            // Cascade Timers down from each level whose lower digits just rolled over to zero,
+            // highest level first, since those can land in the levels below:
+            for (unsigned level = kNumLevels; level >= 1; --level) {
+                if (_currentTick & ((tick_t(1) << (kLevelBits * level)) - 1))
+                    continue;
+                if (level == kNumLevels) {
+                    cascade(_overflow);
+                } else {
+                    auto slot = (_currentTick >> (kLevelBits * level)) & (kSlotsPerLevel - 1);
+                    _occupied[level] &= ~(uint64_t(1) << slot);
+                    cascade(_wheel[level][slot]);
+                }
+            }
+            // Everything in the current level-0 slot is now due:
+            auto slot = _currentTick & (kSlotsPerLevel - 1);
+            _occupied[0] &= ~(uint64_t(1) << slot);
+            cascade(_wheel[0][slot]);
+        }
+    }
+
+
     // Body of the manager's background thread. Waits for timers and calls their callbacks.
     void Timer::Manager::run() {
         SetThreadName("Timer (CBL)");
         unique_lock<mutex> lock(_mutex);
         while(true) {
-            auto earliest = _schedule.begin();
-            if (earliest == _schedule.end()) {
-                // Schedule is empty; just wait for a change
-                _condition.wait(lock);
-
-            } else if (earliest->first <= clock::now()) {
+            advance(tick_t(chrono::floor<chrono::milliseconds>(clock::now() - _epoch).count()));
+            if (Timer *timer = _due.first) {
                 // A Timer is ready to fire, so remove it and call the callback:
-                auto timer = earliest->second;
                 timer->_triggered = true;
                 _unschedule(timer);
 
@@ -63,37 +217,39 @@ namespace litecore { namespace actor {
                 lock.lock();
 
             } else {
-                // Wait for the first timer's fireTime, or until the _schedule is updated:
-                auto nextFireTime = earliest->first;
-                _condition.wait_until(lock, nextFireTime);
+                // Wait until the next tick that has anything scheduled, or until a Timer is
+                // scheduled before then:
+                _wakeTick = nextEventTick();
+                if (_wakeTick == UINT64_MAX)
+                    _condition.wait(lock);
+                else
+                    _condition.wait_until(lock, timeAtTick(_wakeTick));
+                _wakeTick = 0;
             }
         }
     }
 
 
-    // Removes a Timer from _scheduled. Returns true if the next fire time is affected.
+    // Removes a Timer from the schedule.
     // Precondition: _mutex must be locked.
-    // Postconditions: timer is not in _scheduled. timer->_state != kScheduled.
-    bool Timer::Manager::_unschedule(Timer *timer) {
+    // Postconditions: timer is not in any list. timer->_state != kScheduled.
+    void Timer::Manager::_unschedule(Timer *timer) {
         if (timer->_state != kScheduled)
-            return false;
-        bool affectsTiming = (timer->_entry == _schedule.begin());
-        _schedule.erase(timer->_entry);
-        timer->_entry = _schedule.end();
+            return;
+        remove(timer);
         timer->_state = kUnscheduled;
         timer->_fireTime = time();
-        return affectsTiming && !_schedule.empty();
     }
 
 
     // Unschedules a timer, preventing it from firing if it hasn't been triggered yet.
     // (Called by Timer::stop())
     // Precondition: _mutex must NOT be locked.
-    // Postcondition: timer is not in _scheduled. timer->_state != kScheduled.
+    // Postcondition: timer is not in any list. timer->_state != kScheduled.
     void Timer::Manager::unschedule(Timer *timer, bool deleting) {
         unique_lock<mutex> lock(_mutex);
-        if (_unschedule(timer))
-            _condition.notify_one();        // wakes up run() so it can recalculate its wait time
+        // (No need to wake run(); at worst it'll wake up for a tick with nothing to do.)
+        _unschedule(timer);
 
         if (deleting) {
             timer->_state = kDeleted;
@@ -108,7 +264,7 @@ namespace litecore { namespace actor {
     // Schedules or re-schedules a timer. (Called by Timer::fireAt/fireAfter())
     // If `earlier` is true, it will only move the fire time closer, else it returns `false`.
     // Precondition: _mutex must NOT be locked.
-    // Postcondition: timer is in _scheduled. timer->_state == kScheduled.
+    // Postcondition: timer is in a list. timer->_state == kScheduled.
     bool Timer::Manager::setFireTime(Timer *timer, clock::time_point when, bool earlier) {
         unique_lock<mutex> lock(_mutex);
         // Don't allow timer's callback to reschedule itself when deletion is pending:
@@ -116,11 +272,12 @@ namespace litecore { namespace actor {
             return false;
         if (earlier && timer->scheduled() && when >= timer->_fireTime)
             return false;
-        bool notify = _unschedule(timer);
-        timer->_entry = _schedule.insert({when, timer});
-        timer->_state = kScheduled;
+        _unschedule(timer);
         timer->_fireTime = when;
-        if (timer->_entry == _schedule.begin() || notify)
+        timer->_tick = tickAt(when);
+        insert(timer);
+        timer->_state = kScheduled;
+        if (timer->_tick < _wakeTick)
             _condition.notify_one();        // wakes up run() so it can recalculate its wait time
         return true;
     }
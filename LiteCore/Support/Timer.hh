@@ -25,6 +25,7 @@
 #include <thread>
 #include <vector>
 #include <condition_variable>
+#include <stdint.h>
 
 namespace litecore { namespace actor {
 
@@ -87,26 +88,56 @@ namespace litecore { namespace actor {
 
         enum state : uint8_t {
             kUnscheduled,               // Idle
-            kScheduled,                 // In _scheduled queue, waiting to fire
+            kScheduled,                 // In the Manager's wheel, waiting to fire
             kDeleted,                   // Destructor called, waiting for fire to complete
         };
 
-        /** Internal singleton that tracks all scheduled Timers and runs a background thread. */
+        /** Internal singleton that tracks all scheduled Timers and runs a background thread.
+            Timers are kept in a hierarchical timing wheel (Varghese & Lauck): each level is a
+            ring of slots, each slot an intrusive list of Timers, so scheduling and unscheduling
+            are O(1) and never allocate. Level 0 has 1ms slots; each higher level's slots span
+            an entire revolution of the level below, and their Timers are moved ("cascaded")
+            down into lower levels as their time approaches. */
         class Manager {
         public:
-            using map = std::multimap<time, Timer*>;
-            
             Manager();
             bool setFireTime(Timer*, time, bool ifEarlier =false);
             void unschedule(Timer*, bool deleting =false);
             
         private:
-            bool _unschedule(Timer*);
+            using tick_t = uint64_t;
+
+            static constexpr unsigned kLevelBits = 6;
+            static constexpr unsigned kSlotsPerLevel = 1 << kLevelBits;
+            static constexpr unsigned kNumLevels = 5;               // Range is 2^30 ms, ~12 days
+            static constexpr int8_t kDueList = -1, kOverflowList = -2;
+
+            struct List {
+                Timer* first {nullptr};
+                Timer* last {nullptr};
+            };
+
+            tick_t tickAt(time) const;
+            time timeAtTick(tick_t) const;
+            List& listFor(int8_t level, uint8_t slot);
+            void insert(Timer*);
+            void append(List&, Timer*);
+            void remove(Timer*);
+            void cascade(List&);
+            void advance(tick_t now);
+            tick_t nextEventTick() const;
+            void _unschedule(Timer*);
             void run();
 
-            map _schedule;                      // A priority queue of Timers ordered by time
-            std::mutex _mutex;                  // Thread-safety for _schedule
-            std::condition_variable _condition; // Used to signal that _schedule has changed
+            time const _epoch;                  // Time of tick 0
+            tick_t _currentTick {0};            // Tick the wheel has advanced to
+            tick_t _wakeTick {0};               // Tick run() is waiting for (0 if awake)
+            List _wheel[kNumLevels][kSlotsPerLevel];
+            uint64_t _occupied[kNumLevels] {};  // Bitmaps of non-empty slots in each level
+            List _overflow;                     // Timers too far in the future for the wheel
+            List _due;                          // Timers whose time has come, about to fire
+            std::mutex _mutex;                  // Thread-safety for all of the above
+            std::condition_variable _condition; // Used to signal that the schedule has changed
             std::thread _thread;                // Bg thread that waits & fires Timers
         };
 
@@ -118,7 +149,11 @@ namespace litecore { namespace actor {
         std::atomic<state> _state {kUnscheduled};   // Current state
         std::atomic<bool> _triggered {false};   // True while callback is being called
         bool _autoDelete {false};               // If true, delete after firing
-        Manager::map::iterator _entry;          // My map entry in Manager::_schedule
+        int8_t _level {0};                      // Which Manager list I'm in (when scheduled)
+        uint8_t _slot {0};                      // Slot within level (if _level >= 0)
+        uint64_t _tick {0};                     // Manager tick at which I fire
+        Timer* _prev {nullptr};                 // Links in Manager list
+        Timer* _next {nullptr};
     };
 
 } }
@@ -0,0 +1,108 @@
+//
+// WorkStealingDeque.hh
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace litecore { namespace actor {
+
+    /** A lock-free work-stealing deque, after Chase & Lev ("Dynamic Circular Work-Stealing
+        Deque", 2005) with the C11 memory orderings of Lê et al. (2013).
+        Only a single "owner" thread may call `push`; any thread may call `steal`, which takes
+        items from the opposite end, so items come out in FIFO order.
+        T must be a trivially-copyable type whose default value means "empty", e.g. a pointer. */
+    template <class T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(size_t initialCapacity =64)
+        :_array(new Array(initialCapacity))
+        {
+            _retired.emplace_back(_array.load(std::memory_order_relaxed));
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) =delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) =delete;
+
+        /** Adds an item at the bottom. Must only be called by the owner thread. */
+        void push(T item) {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            Array *a = _array.load(std::memory_order_relaxed);
+            if (b - t > int64_t(a->capacity) - 1)
+                a = grow(a, t, b);
+            a->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /** Removes and returns the item at the top, or a default T if the deque is empty.
+            Safe to call from any thread, including the owner. */
+        T steal() {
+            while (true) {
+                int64_t t = _top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t b = _bottom.load(std::memory_order_acquire);
+                if (t >= b)
+                    return T();
+                T item = _array.load(std::memory_order_acquire)->get(t);
+                if (_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                           std::memory_order_relaxed))
+                    return item;
+                // Lost a race with another thief; try again.
+            }
+        }
+
+        /** True if the deque appears empty. (This is only a snapshot, of course.) */
+        bool empty() const {
+            return _bottom.load(std::memory_order_acquire) <= _top.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct Array {
+            explicit Array(size_t cap)      :capacity(cap), mask(cap - 1), items(new std::atomic<T>[cap]) { }
+            T get(int64_t i) const          {return items[i & mask].load(std::memory_order_relaxed);}
+            void put(int64_t i, T item)     {items[i & mask].store(item, std::memory_order_relaxed);}
+
+            size_t const capacity;          // Always a power of 2
+            size_t const mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+        // Replaces the array with one twice as large. Owner thread only.
+        // The old array can't be freed, since a thief may still be reading from it; it's kept in
+        // `_retired` until the deque is destructed. (The deque never shrinks, so this is bounded.)
+        Array* grow(Array *a, int64_t t, int64_t b) {
+            auto bigger = new Array(a->capacity * 2);
+            for (int64_t i = t; i < b; ++i)
+                bigger->put(i, a->get(i));
+            _retired.emplace_back(bigger);
+            _array.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        std::atomic<int64_t> _top {0};          // Index of the next item to steal
+        std::atomic<int64_t> _bottom {0};       // Index the owner will push to next
+        std::atomic<Array*> _array;             // Current circular buffer
+        std::vector<std::unique_ptr<Array>> _retired;   // All arrays ever allocated
+    };
+
+} }
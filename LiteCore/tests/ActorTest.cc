@@ -0,0 +1,132 @@
+//
+// ActorTest.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "Actor.hh"
+#include "InlineFunction.hh"
+#include "LiteCoreTest.hh"
+#include "Stopwatch.hh"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace litecore;
+using namespace litecore::actor;
+using namespace fleece;
+using namespace std;
+
+
+namespace {
+
+    class CounterActor : public Actor {
+    public:
+        CounterActor(atomic<uint64_t> &counter)
+        :Actor(kC4Cpp_DefaultLog, "CounterActor")
+        ,_counter(counter)
+        { }
+
+        void add(int n)                 {enqueue(FUNCTION_TO_QUEUE(CounterActor::_add), n);}
+
+    private:
+        void _add(int n)                {_counter += n;}
+
+        atomic<uint64_t> &_counter;
+    };
+
+
+    // Sends `totalMessages` messages, spread over `numActors` actors, from `numThreads`
+    // concurrent threads; returns once every actor has handled all of its messages.
+    void sendMessages(unsigned numThreads, unsigned numActors, unsigned totalMessages) {
+        atomic<uint64_t> counter {0};
+        vector<Retained<CounterActor>> actors;
+        for (unsigned i = 0; i < numActors; ++i)
+            actors.push_back(new CounterActor(counter));
+
+        unsigned perThread = totalMessages / numThreads;
+        Stopwatch st;
+        vector<thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t] {
+                for (unsigned i = 0; i < perThread; ++i)
+                    actors[(i + t) % numActors]->add(1);
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        for (auto &actor : actors)
+            actor->waitTillCaughtUp();
+        st.stop();
+
+        CHECK(counter == uint64_t(perThread) * numThreads);
+        char what[100];
+        sprintf(what, "Actor messages from %u threads", numThreads);
+        st.printReport(what, perThread * numThreads, "message");
+    }
+
+}
+
+
+TEST_CASE("Actor message throughput", "[Actor][Perf][.slow]") {
+    static constexpr unsigned kNumActors = 256, kNumMessages = 1000000;
+    for (unsigned numThreads : {1, 4, 16, 64})
+        sendMessages(numThreads, kNumActors, kNumMessages);
+}
+
+
+namespace {
+    struct Payload : public RefCounted {
+        int total {0};
+        void handle(Retained<Payload> p, int a, int b)  {total += a + b;}
+    };
+
+
+    // Queues up and then runs a batch of calls of the typical Actor-message shape (a method
+    // with a Retained<> and two ints), using FN to hold the bound call.
+    template <class FN, class BIND>
+    void benchmarkMessages(const char *what, BIND bind) {
+        static constexpr int kBatch = 1000, kRounds = 1000;
+        Retained<Payload> payload = new Payload;
+        deque<FN> queue;
+        Stopwatch st;
+        for (int round = 0; round < kRounds; ++round) {
+            for (int i = 0; i < kBatch; ++i)
+                queue.emplace_back(bind(payload.get(), payload, i, round));
+            while (!queue.empty()) {
+                queue.front()();
+                queue.pop_front();
+            }
+        }
+        st.stop();
+        CHECK(payload->refCount() == 1);
+        st.printReport(what, kBatch * kRounds, "message");
+    }
+}
+
+
+TEST_CASE("Actor MessageFn vs std::function", "[Actor][Perf][.slow]") {
+    benchmarkMessages<std::function<void()>>("std::function + std::bind",
+                                             [](Payload *rcvr, Retained<Payload> p, int a, int b) {
+        return std::bind(&Payload::handle, rcvr, p, a, b);
+    });
+    benchmarkMessages<MessageFn>("MessageFn + lambda",
+                                 [](Payload *rcvr, Retained<Payload> p, int a, int b) {
+        auto fn = &Payload::handle;
+        return [=]{ (rcvr->*fn)(p, a, b); };
+    });
+}
@@ -28,7 +28,9 @@
 #endif
 
 #include "LiteCoreTest.hh"
+#include <atomic>
 #include <sstream>
+#include <thread>
 #include <cinttypes>
 
 using namespace litecore;
@@ -235,6 +237,63 @@ N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile TransactionsThenIterate",
 }
 
 
+N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile Concurrent Readers", "[DataFile]") {
+    static constexpr int kNDocs = 100, kNReaders = 4, kNWrites = 50;
+    createNumberedDocs(store, kNDocs, false);
+
+    // Several threads read and enumerate (on pooled read-only connections), while this thread
+    // keeps committing transactions through another DataFile on the same file. The readers
+    // should see only committed data.
+    // (Catch assertions aren't thread-safe, so the threads just count errors.)
+    unique_ptr<DataFile> writer { newDatabase(db->filePath()) };
+    KeyStore &writerStore = writer->defaultKeyStore();
+    atomic<bool> stop {false};
+    atomic<int> errors {0}, reads {0};
+    vector<thread> readers;
+    for (int r = 0; r < kNReaders; ++r) {
+        readers.emplace_back([&, r] {
+            while (!stop) {
+                for (int i = 1 + r; i <= kNDocs; i += kNReaders) {
+                    string docID = stringWithFormat("rec-%03d", i);
+                    Record rec = store->get(slice(docID));
+                    if (!rec.exists() || !rec.body().hasPrefix(slice(docID)))
+                        ++errors;
+                    if (store->get("uncommitted"_sl).exists())
+                        ++errors;
+                    ++reads;
+                }
+                int n = 0;
+                for (RecordEnumerator e(*store); e.next(); )
+                    ++n;
+                if (n < kNDocs)
+                    ++errors;
+            }
+        });
+    }
+
+    for (int w = 0; w < kNWrites; ++w) {
+        Transaction t(*writer);
+        for (int i = 1; i <= kNDocs; i += 7) {
+            string docID = stringWithFormat("rec-%03d", i);
+            writerStore.set(slice(docID), slice(docID + "-" + to_string(w)), t);
+        }
+        if (w % 2 == 0) {
+            t.commit();
+        } else {
+            writerStore.set("uncommitted"_sl, "nope"_sl, t);
+            // Reads within the transaction must see its changes:
+            CHECK(writerStore.get("uncommitted"_sl).exists());
+            t.abort();
+        }
+    }
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+    CHECK(errors == 0);
+    CHECK(reads > 0);
+}
+
+
 N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile DeleteKey", "[DataFile]") {
     slice key("a");
     {
@@ -17,11 +17,13 @@
 //
 
 #include "DataFile.hh"
+#include "SQLiteDataFile.hh"
 #include "Query.hh"
 #include "Error.hh"
 #include "StringUtil.hh"
 
 #include "LiteCoreTest.hh"
+#include <algorithm>
 
 using namespace litecore;
 using namespace std;
@@ -497,3 +499,60 @@ TEST_CASE_METHOD(FTSTest, "Missing FTS columns", "[FTS][Query]") {
         expectedMissing = 0;
     }
 }
+
+
+TEST_CASE_METHOD(FTSTest, "Query Full-Text Large Index", "[Query][FTS]") {
+    // Enough docs that the index is populated in chunks, after it's created:
+    static constexpr int kNumDocs = 2500;
+    {
+        Transaction t(store->dataFile());
+        for (int i = 5; i < kNumDocs; i++)
+            createDoc(t, i, (i % 10 == 0) ? stringWithFormat("Searching for doc %d", i)
+                                          : stringWithFormat("Nothing to see in doc %d", i));
+        t.commit();
+    }
+    vector<double> progress;
+    IndexSpec::Options options {"english", true};
+    options.progressCallback = [](void *context, double fractionDone) {
+        ((vector<double>*)context)->push_back(fractionDone);
+    };
+    options.progressContext = &progress;
+    CHECK(store->createIndex("sentence", "[[\".sentence\"]]", IndexSpec::kFullText, &options));
+    REQUIRE(progress.size() >= 2);
+    CHECK(is_sorted(progress.begin(), progress.end()));
+    CHECK(progress.front() > 0.0);
+    CHECK(progress.back() == 1.0);
+    CHECK(!store->createIndex("sentence", "[[\".sentence\"]]", IndexSpec::kFullText, &options));
+
+    auto countMatches = [&] {
+        Retained<Query> query{ store->compileQuery(json5(
+            "['SELECT', {'WHERE': ['MATCH', 'sentence', 'search'], WHAT: [['.sentence']]}]")) };
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        return e->getRowCount();
+    };
+    // Docs 0-4 have 4 matches, plus every 10th of the others:
+    CHECK(countMatches() == 4 + (kNumDocs - 10) / 10);
+
+    // The triggers keep the index up to date:
+    {
+        Transaction t(store->dataFile());
+        createDoc(t, 10, "Nothing to see here");
+        createDoc(t, kNumDocs - 1, "Search me");
+        t.commit();
+    }
+    CHECK(countMatches() == 4 + (kNumDocs - 10) / 10);
+
+    // A table without a registered index, as left by an interrupted build, isn't used:
+    {
+        Transaction t(store->dataFile());
+        ((SQLiteDataFile&)store->dataFile()).exec("DELETE FROM indexes WHERE name='sentence'");
+        t.commit();
+    }
+    ExpectException(error::Domain::LiteCore, error::LiteCoreError::NoSuchIndex, [&] {
+        Retained<Query> query{ store->compileQuery(json5(
+            "['SELECT', {'WHERE': ['MATCH', 'sentence', 'nothing'], WHAT: [['._id']]}]")) };
+    });
+    // ...and creating the index again replaces it:
+    CHECK(store->createIndex("sentence", "[[\".sentence\"]]", IndexSpec::kFullText, &options));
+    CHECK(countMatches() == 4 + (kNumDocs - 10) / 10);
+}
@@ -0,0 +1,122 @@
+//
+// PollerTest.cc
+//
+// Copyright (c) 2020 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef _WIN32
+
+#include "Poller.hh"
+#include "LiteCoreTest.hh"
+#include "Stopwatch.hh"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace litecore;
+using namespace litecore::net;
+using namespace std;
+
+
+namespace {
+
+    // Opens `numSockets` socket pairs, keeps a read Listener registered on one end of each, then
+    // writes to randomly-chosen pairs one at a time and measures how long each event takes to
+    // be delivered. With poll() this grows with the number of sockets; with epoll it shouldn't.
+    void pollerScaling(int numSockets, int numEvents) {
+        vector<array<int,2>> pairs(numSockets);
+        for (auto &pair : pairs)
+            REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()) == 0);
+
+        mutex m;
+        condition_variable cond;
+        int lastReadable = -1;
+
+        function<void(int)> listen = [&](int i) {
+            Poller::forFD(pairs[i][0]).addListener(pairs[i][0], Poller::kReadable, [&, i] {
+                char c;
+                ::recv(pairs[i][0], &c, 1, MSG_DONTWAIT);
+                {
+                    lock_guard<mutex> lock(m);
+                    lastReadable = i;
+                }
+                cond.notify_one();
+                listen(i);
+            });
+        };
+        for (int i = 0; i < numSockets; ++i)
+            listen(i);
+
+        mt19937 random(numSockets);
+        Stopwatch st;
+        for (int e = 0; e < numEvents; ++e) {
+            int i = random() % numSockets;
+            REQUIRE(::write(pairs[i][1], "x", 1) == 1);
+            unique_lock<mutex> lock(m);
+            cond.wait(lock, [&]{return lastReadable == i;});
+            lastReadable = -1;
+        }
+        st.stop();
+
+        for (auto &pair : pairs) {
+            Poller::forFD(pair[0]).removeListeners(pair[0]);
+            ::close(pair[0]);
+            ::close(pair[1]);
+        }
+
+        char what[100];
+        sprintf(what, "Poller events with %d sockets", numSockets);
+        st.printReport(what, numEvents, "event");
+    }
+
+}
+
+
+TEST_CASE("Poller threads", "[Networking]") {
+    // There's one shared Poller per core, up to kMaxThreads, and fds are spread across them:
+    unsigned n = Poller::threadCount();
+    unsigned cores = thread::hardware_concurrency();
+    CHECK(n == ((cores == 0) ? Poller::kMaxThreads : min(cores, Poller::kMaxThreads)));
+    CHECK(&Poller::instance() == &Poller::forFD(0));
+    for (int fd = 0; fd < 10; ++fd)
+        CHECK(&Poller::forFD(fd) == &Poller::forFD(fd + int(n)));
+    if (n > 1)
+        CHECK(&Poller::forFD(0) != &Poller::forFD(1));
+}
+
+
+TEST_CASE("Poller connection scaling", "[Networking][Perf][.slow]") {
+    static constexpr int kNumEvents = 10000;
+    rlimit limit;
+    REQUIRE(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    for (int numSockets : {10, 100, 1000, 4000}) {
+        if (rlim_t(2 * numSockets + 100) > limit.rlim_cur) {
+            WARN("Skipping " << numSockets << " sockets; not enough file descriptors");
+            continue;
+        }
+        pollerScaling(numSockets, kNumEvents);
+    }
+}
+
+#endif // _WIN32
@@ -221,6 +221,36 @@ TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryParserTest, "QueryParser incremental", "[Query]") {
+    using Scope = QueryParser::IncrementalScope;
+    auto parser = [&](string json) {
+        auto qp = make_unique<QueryParser>(*this);
+        alloc_slice fleece = fleece::impl::JSONConverter::convertJSON(json5(json));
+        qp->parse(fleece::impl::Value::fromTrustedData(fleece));
+        return qp;
+    };
+
+    auto qp = parser("{WHAT: ['.name'], WHERE: ['>', ['.age'], 21],"
+                     " ORDER_BY: [['.name']], LIMIT: 10}");
+    REQUIRE(qp->isIncremental());
+    CHECK(qp->hasOrderBy());
+    CHECK(qp->hasLimit());
+    CHECK(qp->incrementalSQL(Scope::kAllDocs)
+          == "SELECT _doc.key, fl_result(fl_value(_doc.body, 'name')) FROM kv_default AS _doc WHERE (fl_value(_doc.body, 'age') > 21) AND (_doc.flags & 1 = 0) ORDER BY fl_value(_doc.body, 'name') LIMIT MAX(0, 10)");
+    CHECK(qp->incrementalSQL(Scope::kChangedDocs)
+          == "SELECT _doc.key, fl_result(fl_value(_doc.body, 'name')) FROM kv_default AS _doc WHERE (fl_value(_doc.body, 'age') > 21) AND (_doc.flags & 1 = 0) AND _doc.sequence > :since");
+    CHECK(qp->incrementalSQL(Scope::kCandidateDocs)
+          == "SELECT _doc.key, fl_result(fl_value(_doc.body, 'name')) FROM kv_default AS _doc WHERE (fl_value(_doc.body, 'age') > 21) AND (_doc.flags & 1 = 0) AND (_doc.sequence > :since OR _doc.key IN (SELECT value FROM fl_each(:docIDs))) ORDER BY fl_value(_doc.body, 'name') LIMIT MAX(0, 10)");
+
+    CHECK(parser("['=', ['.type'], 'person']")->isIncremental());
+    CHECK(!parser("{WHAT: [['count()', ['.name']]]}")->isIncremental());
+    CHECK(!parser("{WHAT: ['.name'], DISTINCT: true}")->isIncremental());
+    CHECK(!parser("{WHAT: ['.name'], LIMIT: 10, OFFSET: 5}")->isIncremental());
+    CHECK(!parser("{WHAT: ['.book.title'], FROM: [{as: 'book'},"
+                  " {as: 'library', 'on': ['=', ['.book.library'], ['.library._id']]}]}")->isIncremental());
+}
+
+
 TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT FTS", "[Query][FTS]") {
     CHECK(parseWhere("['SELECT', {\
                      WHERE: ['MATCH', 'bio', 'mobile']}]")
@@ -268,6 +298,40 @@ TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT WHAT", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT covered properties", "[Query]") {
+    coveringTablesList = {{"kv_default:covering:byAge", {"name", "address.city"}}};
+    CHECK(parseWhere("['SELECT', {WHAT: ['.name', ['.address.city'], ['.age']],\
+                                 WHERE: ['>', ['.age'], 21]}]")
+          == "SELECT fl_result(cov1.c0), fl_result(cov1.c1), fl_result(fl_value(_doc.body, 'age')) FROM kv_default AS _doc JOIN \"kv_default:covering:byAge\" AS cov1 ON cov1.docid = _doc.rowid WHERE (fl_value(_doc.body, 'age') > 21) AND (_doc.flags & 1 = 0)");
+    // Only plain result columns are read from the index:
+    CHECK(parseWhere("['SELECT', {WHAT: [['upper()', ['.name']]], WHERE: ['=', ['.name'], 'Bob']}]")
+          == "SELECT fl_result(N1QL_upper(fl_value(_doc.body, 'name'))) FROM kv_default AS _doc WHERE (fl_value(_doc.body, 'name') = 'Bob') AND (_doc.flags & 1 = 0)");
+    CHECK(parseWhere("['SELECT', {WHAT: [['AS', ['.name'], 'who']]}]")
+          == "SELECT fl_result(cov1.c0) AS \"who\" FROM kv_default AS _doc JOIN \"kv_default:covering:byAge\" AS cov1 ON cov1.docid = _doc.rowid WHERE (_doc.flags & 1 = 0)");
+}
+
+
+TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT from aggregate index", "[Query]") {
+    aggregateTablesList = {{"kv_default:aggregate:sales",
+        alloc_slice(R"({"WHAT":[["COUNT()"],["SUM()",[".amount"]],["MAX()",[".amount"]]],)"
+                    R"( "GROUP_BY":[[".city"]]})"_sl)}};
+    CHECK(parseWhere("['SELECT', {WHAT: [['.city'], ['count()'], ['SUM()', ['.amount']]],\
+                                 GROUP_BY: [['.city']], ORDER_BY: [['.city']]}]")
+          == "SELECT fl_result(_agg.r0), fl_result(_agg.n), fl_result((CASE WHEN _agg.c1 > 0 THEN _agg.s1 END)) FROM \"kv_default:aggregate:sales\" AS _agg ORDER BY _agg.k0");
+    CHECK(parseWhere("['SELECT', {WHAT: [['max()', ['.amount']]], GROUP_BY: [['.city']],\
+                                 HAVING: ['>', ['count()'], 1]}]")
+          == "SELECT fl_result(_agg.m2) FROM \"kv_default:aggregate:sales\" AS _agg WHERE _agg.n > 1");
+    // Queries using anything else the index doesn't store read the documents:
+    CHECK(parseWhere("['SELECT', {WHAT: [['.name']], GROUP_BY: [['.city']]}]")
+          == "SELECT fl_result(fl_value(_doc.body, 'name')) FROM kv_default AS _doc WHERE (_doc.flags & 1 = 0) GROUP BY fl_value(_doc.body, 'city')");
+    CHECK(parseWhere("['SELECT', {WHAT: [['min()', ['.amount']]], GROUP_BY: [['.city']]}]")
+          == "SELECT fl_result(min(fl_value(_doc.body, 'amount'))) FROM kv_default AS _doc WHERE (_doc.flags & 1 = 0) GROUP BY fl_value(_doc.body, 'city')");
+    CHECK(parseWhere("['SELECT', {WHAT: [['max()', ['.amount']]], WHERE: ['>', ['.amount'], 0],\
+                                 GROUP_BY: [['.city']]}]")
+          == "SELECT fl_result(max(fl_value(_doc.body, 'amount'))) FROM kv_default AS _doc WHERE (fl_value(_doc.body, 'amount') > 0) AND (_doc.flags & 1 = 0) GROUP BY fl_value(_doc.body, 'city')");
+}
+
+
 TEST_CASE_METHOD(QueryParserTest, "QueryParser CASE", "[Query]") {
     CHECK(parseWhere("['CASE', ['.color'], 'red', 1, 'green', 2]")
           == "CASE fl_value(body, 'color') WHEN 'red' THEN 1 WHEN 'green' THEN 2 END");
@@ -336,6 +400,22 @@ TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT UNNEST", "[Query][FTS]") {
 }
 
 
+TEST_CASE_METHOD(QueryParserTest, "QueryParser indexable properties", "[Query]") {
+    // Properties only read by the WHAT clause aren't indexable; UNNESTed arrays are:
+    QueryParser qp(*this);
+    alloc_slice fleece = fleece::impl::JSONConverter::convertJSON(json5(
+        "['SELECT', {WHAT: [['.book.title'], ['.notes']],\
+                     FROM: [{as: 'book'}, {as: 'notes', 'unnest': ['.book.notes']}],\
+                    WHERE: ['>', ['.book.year'], 1900],\
+                 ORDER_BY: [['.book.author']]}]"));
+    qp.parseJustExpression(fleece::impl::Value::fromTrustedData(fleece));
+    using Prop = QueryParser::IndexableProperty;
+    CHECK(qp.indexableProperties() == (set<Prop>{{"book", "author", false},
+                                                 {"book", "notes", true},
+                                                 {"book", "year", false}}));
+}
+
+
 TEST_CASE_METHOD(QueryParserTest, "QueryParser SELECT UNNEST optimized", "[Query][FTS]") {
     tablesExist = true;
     
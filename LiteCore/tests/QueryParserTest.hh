@@ -45,6 +45,12 @@ protected:
     virtual bool tableExists(const string &tableName) const override {
         return tablesExist;
     }
+    virtual std::vector<CoveringTable> coveringTables() const override {
+        return coveringTablesList;
+    }
+    virtual std::vector<AggregateTable> aggregateTables() const override {
+        return aggregateTablesList;
+    }
 #ifdef COUCHBASE_ENTERPRISE
     virtual std::string predictiveTableName(const std::string &property) const override {
         return tableName() + ":predict:" + property;
@@ -52,4 +58,6 @@ protected:
 #endif
 
     bool tablesExist {false};
+    std::vector<CoveringTable> coveringTablesList;
+    std::vector<AggregateTable> aggregateTablesList;
 };
@@ -18,6 +18,7 @@
 
 #include "QueryTest.hh"
 #include "SQLiteDataFile.hh"
+#include "SQLiteFleeceUtil.hh"
 #include <ctime>
 #include <cfloat>
 #include <cinttypes>
@@ -130,6 +131,144 @@ TEST_CASE_METHOD(QueryTest, "Partial Index with NOT MISSING", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryTest, "Covering Index", "[Query]") {
+    {
+        Transaction t(store->dataFile());
+        for (int i = 1; i <= 10; i++) {
+            writeDoc(slice(stringWithFormat("rec-%03d", i)), DocumentFlags::kNone, t,
+                     [=](Encoder &enc) {
+                enc.writeKey("num");
+                enc.writeInt(i);
+                enc.writeKey("name");
+                enc.writeString(numberString(i));
+                enc.writeKey("even");
+                enc.writeBool(i % 2 == 0);
+            });
+        }
+        t.commit();
+    }
+
+    const char *indexJSON = R"({"WHAT":[[".num"]], "INCLUDE":[[".name"], ".even"]})";
+    CHECK(store->createIndex("nums"_sl, slice(indexJSON)));
+    CHECK(!store->createIndex("nums"_sl, slice(indexJSON)));
+
+    auto checkResults = [&](const char *name4) {
+        Retained<Query> query = store->compileQuery(json5(
+            "{WHAT: ['.name', ['.even'], ['.num']], WHERE: ['BETWEEN', ['.num'], 3, 4],"
+            " ORDER_BY: [['.num']]}"));
+        checkOptimized(query);
+        CHECK(query->explain().find("kv_default:covering:nums") != string::npos);
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        REQUIRE(e->getRowCount() == 2);
+        REQUIRE(e->next());
+        CHECK(e->columns()[0]->asString() == "three"_sl);
+        CHECK(e->columns()[1]->type() == kBoolean);
+        CHECK(e->columns()[1]->asBool() == false);
+        CHECK(e->columns()[2]->asInt() == 3);
+        REQUIRE(e->next());
+        CHECK(e->columns()[0]->asString() == slice(name4));
+        CHECK(e->columns()[1]->asBool() == true);
+    };
+    checkResults("four");
+
+    // Updating a doc updates the stored values:
+    {
+        Transaction t(store->dataFile());
+        writeDoc("rec-004"_sl, DocumentFlags::kNone, t, [=](Encoder &enc) {
+            enc.writeKey("num");
+            enc.writeInt(4);
+            enc.writeKey("name");
+            enc.writeString("FOUR");
+            enc.writeKey("even");
+            enc.writeBool(true);
+        });
+        t.commit();
+    }
+    checkResults("FOUR");
+
+    // Changing the INCLUDE clause replaces the index:
+    CHECK(store->createIndex("nums"_sl, R"({"WHAT":[[".num"]], "INCLUDE":[[".name"]]})"_sl));
+
+    // Deleting the index deletes its table:
+    store->deleteIndex("nums"_sl);
+    CHECK(!((SQLiteDataFile&)store->dataFile()).tableExists("kv_default:covering:nums"));
+    Retained<Query> query = store->compileQuery(json5("{WHAT: ['.name']}"));
+    CHECK(query->explain().find("covering") == string::npos);
+}
+
+
+TEST_CASE_METHOD(QueryTest, "Aggregate Index", "[Query]") {
+    auto writeSale = [&](int i, const char *city, int amount) {
+        Transaction t(store->dataFile());
+        writeDoc(slice(stringWithFormat("rec-%03d", i)), DocumentFlags::kNone, t,
+                 [=](Encoder &enc) {
+            enc.writeKey("city");
+            enc.writeString(city);
+            enc.writeKey("amount");
+            enc.writeInt(amount);
+        });
+        t.commit();
+    };
+    static const char* kCities[3] = {"C", "A", "B"};
+    for (int i = 1; i <= 10; i++)
+        writeSale(i, kCities[i % 3], i);
+
+    // Runs the GROUP BY query, and also the same query with DISTINCT, which can't use the index,
+    // and checks that both return the expected groups:
+    auto checkResults = [&](const char *expected, bool indexed) {
+        for (int distinct = 0; distinct <= 1; ++distinct) {
+            Retained<Query> query = store->compileQuery(json5(CONCAT(
+                "{WHAT: [['.city'], ['count()'], ['sum()', ['.amount']], ['min()', ['.amount']],"
+                "        ['max()', ['.amount']], ['avg()', ['.amount']]],"
+                " GROUP_BY: [['.city']], ORDER_BY: [['.city']]"
+                << (distinct ? ", DISTINCT: true}" : "}"))));
+            bool usesIndex = query->explain().find("kv_default:aggregate:sales") != string::npos;
+            CHECK(usesIndex == (indexed && !distinct));
+            Retained<QueryEnumerator> e(query->createEnumerator());
+            string result;
+            while (e->next()) {
+                auto cols = e->columns();
+                result += stringWithFormat("%s:%lld,%lld,%lld,%lld,%g; ",
+                                           string(cols[0]->asString()).c_str(),
+                                           (long long)cols[1]->asInt(),
+                                           (long long)cols[2]->asInt(),
+                                           (long long)cols[3]->asInt(),
+                                           (long long)cols[4]->asInt(),
+                                           cols[5]->asDouble());
+            }
+            CHECK(result == expected);
+        }
+    };
+
+    checkResults("A:4,22,1,10,5.5; B:3,15,2,8,5; C:3,18,3,9,6; ", false);
+
+    const char *indexJSON = R"({"WHAT":[["COUNT()"],["SUM()",[".amount"]],["MIN()",[".amount"]],)"
+                            R"(["MAX()",[".amount"]],["AVG()",[".amount"]]],)"
+                            R"( "GROUP_BY":[[".city"]]})";
+    CHECK(store->createIndex("sales"_sl, slice(indexJSON), IndexSpec::kAggregate));
+    CHECK(!store->createIndex("sales"_sl, slice(indexJSON), IndexSpec::kAggregate));
+    checkResults("A:4,22,1,10,5.5; B:3,15,2,8,5; C:3,18,3,9,6; ", true);
+
+    // The index is updated as documents change:
+    writeSale(10, "A", 100);
+    checkResults("A:4,112,1,100,28; B:3,15,2,8,5; C:3,18,3,9,6; ", true);
+    deleteDoc("rec-001"_sl, true);      // (group's MIN value)
+    checkResults("A:3,111,4,100,37; B:3,15,2,8,5; C:3,18,3,9,6; ", true);
+    deleteDoc("rec-002"_sl, false);
+    checkResults("A:3,111,4,100,37; B:2,13,5,8,6.5; C:3,18,3,9,6; ", true);
+    writeSale(9, "B", 9);               // (moves group C's MAX value to B)
+    checkResults("A:3,111,4,100,37; B:3,22,5,9,7.33333; C:2,9,3,6,4.5; ", true);
+    deleteDoc("rec-003"_sl, true);
+    deleteDoc("rec-006"_sl, true);
+    checkResults("A:3,111,4,100,37; B:3,22,5,9,7.33333; ", true);
+
+    // Deleting the index deletes its table:
+    store->deleteIndex("sales"_sl);
+    CHECK(!((SQLiteDataFile&)store->dataFile()).tableExists("kv_default:aggregate:sales"));
+    checkResults("A:3,111,4,100,37; B:3,22,5,9,7.33333; ", false);
+}
+
+
 TEST_CASE_METHOD(QueryTest, "Query SELECT", "[Query]") {
     addNumberedDocs();
     // Use a (SQL) query based on the Fleece "num" property:
@@ -306,6 +445,122 @@ TEST_CASE_METHOD(QueryTest, "Query refresh", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryTest, "Query incremental refresh", "[Query]") {
+    addNumberedDocs();
+    auto nums = [](QueryEnumerator *e) {
+        std::vector<int64_t> result;
+        while (e->next())
+            result.push_back(e->columns()[0]->asInt());
+        return result;
+    };
+    auto writeNum = [&](int i, int num) {
+        Transaction t(db);
+        writeDoc(slice(stringWithFormat("rec-%03d", i)), DocumentFlags::kNone, t,
+                 [=](Encoder &enc) {
+            enc.writeKey("num");
+            enc.writeInt(num);
+        });
+        t.commit();
+    };
+
+    SECTION("Unordered") {
+        Retained<Query> query{ store->compileQuery(json5(
+                                        "{WHAT: ['.num'], WHERE: ['>', ['.num'], 95]}")) };
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        CHECK(nums(e) == (std::vector<int64_t>{96, 97, 98, 99, 100}));
+
+        // The first refresh runs the whole query; results are unchanged:
+        writeNum(10, 10);
+        CHECK(e->refresh(query) == nullptr);
+        // Later ones only look at the changed docs:
+        writeNum(10, 11);
+        CHECK(e->refresh(query) == nullptr);
+        CHECK(e->lastSequence() == 102);
+
+        // A changed doc that no longer matches is removed, and a new match is appended:
+        writeNum(97, 5);
+        writeNum(10, 500);
+        Retained<QueryEnumerator> e2(e->refresh(query));
+        REQUIRE(e2);
+        CHECK(e2->getRowCount() == 5);
+        CHECK(nums(e2) == (std::vector<int64_t>{96, 98, 99, 100, 500}));
+
+        // A changed value is updated:
+        writeNum(99, 999);
+        Retained<QueryEnumerator> e3(e2->refresh(query));
+        REQUIRE(e3);
+        CHECK(nums(e3) == (std::vector<int64_t>{96, 98, 100, 500, 999}));
+
+        // Deletion:
+        {
+            Transaction t(db);
+            store->set("rec-096"_sl, "2-ffff"_sl, nullslice, DocumentFlags::kDeleted, t);
+            t.commit();
+        }
+        Retained<QueryEnumerator> e4(e3->refresh(query));
+        REQUIRE(e4);
+        CHECK(nums(e4) == (std::vector<int64_t>{98, 100, 500, 999}));
+        CHECK(e4->refresh(query) == nullptr);
+    }
+
+    SECTION("Ordered with limit") {
+        Retained<Query> query{ store->compileQuery(json5(
+                        "{WHAT: ['.num'], WHERE: ['>', ['.num'], 50],"
+                        " ORDER_BY: [['DESC', ['.num']]], LIMIT: 3}")) };
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        CHECK(nums(e) == (std::vector<int64_t>{100, 99, 98}));
+        writeNum(10, 10);
+        CHECK(e->refresh(query) == nullptr);
+
+        // Changes to docs outside the results don't affect them:
+        writeNum(60, 61);
+        CHECK(e->refresh(query) == nullptr);
+
+        // A new doc at the top pushes the last one out:
+        writeNum(10, 150);
+        Retained<QueryEnumerator> e2(e->refresh(query));
+        REQUIRE(e2);
+        CHECK(nums(e2) == (std::vector<int64_t>{150, 100, 99}));
+
+        // A doc that leaves the results is replaced by one that didn't fit before:
+        writeNum(100, 1);
+        Retained<QueryEnumerator> e3(e2->refresh(query));
+        REQUIRE(e3);
+        CHECK(nums(e3) == (std::vector<int64_t>{150, 99, 98}));
+    }
+
+    SECTION("Same rows from different docs") {
+        Retained<Query> query{ store->compileQuery(json5(
+                        "{WHAT: ['.num'], ORDER_BY: [['.num']], LIMIT: 2}")) };
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        CHECK(nums(e) == (std::vector<int64_t>{1, 2}));
+        writeNum(10, 10);
+        CHECK(e->refresh(query) == nullptr);
+
+        // The rows are the same, but the second one now comes from rec-003:
+        {
+            Transaction t(db);
+            writeDoc("rec-002"_sl, DocumentFlags::kNone, t, [](Encoder &enc) {
+                enc.writeKey("num");
+                enc.writeInt(50);
+            });
+            writeDoc("rec-003"_sl, DocumentFlags::kNone, t, [](Encoder &enc) {
+                enc.writeKey("num");
+                enc.writeInt(2);
+            });
+            t.commit();
+        }
+        CHECK(e->refresh(query) == nullptr);
+
+        // So a change to rec-003 has to bring in rec-004, not rec-002:
+        writeNum(3, 10);
+        Retained<QueryEnumerator> e2(e->refresh(query));
+        REQUIRE(e2);
+        CHECK(nums(e2) == (std::vector<int64_t>{1, 4}));
+    }
+}
+
+
 TEST_CASE_METHOD(QueryTest, "Query boolean", "[Query]") {
     {
         Transaction t(store->dataFile());
@@ -1775,3 +2030,49 @@ TEST_CASE_METHOD(QueryTest, "Query Special Chars", "[Query]") {
         CHECK(e->columns()[0]->asString() == "special"_sl);
     }
 }
+
+
+TEST_CASE_METHOD(QueryTest, "Query properties per row", "[Query][Perf][.slow]") {
+    // Compares queries reading one and four properties of each doc, with and without the
+    // connection's cache of the last doc body (QueryBodyCache.)
+    static constexpr int kNumDocs = 50000;
+    {
+        Transaction t(store->dataFile());
+        string padding(500, '.');
+        for (int i = 0; i < kNumDocs; i++) {
+            writeDoc(slice(stringWithFormat("rec-%06d", i)), DocumentFlags::kNone, t,
+                     [&](Encoder &enc) {
+                enc.writeKey("a");  enc.writeInt(i);
+                enc.writeKey("b");  enc.writeString(numberString(i));
+                enc.writeKey("c");  enc.writeDouble(i / 3.0);
+                enc.writeKey("d");  enc.writeBool(i % 2);
+                enc.writeKey("padding");  enc.writeString(padding);
+            });
+        }
+        t.commit();
+    }
+
+    auto run = [&](const char *json, const char *what) {
+        Retained<Query> query{ store->compileQuery(json5(json)) };
+        double best = 1e9;
+        for (int pass = 0; pass < 5; ++pass) {
+            Stopwatch st;
+            Retained<QueryEnumerator> e(query->createEnumerator());
+            int n = 0;
+            while (e->next())
+                ++n;
+            best = std::min(best, st.elapsed());
+            CHECK(n == kNumDocs);
+        }
+        fprintf(stderr, "%-40s %8.3f ms\n", what, best * 1000.0);
+    };
+
+    for (bool cache : {false, true}) {
+        QueryBodyCache::sEnabled = cache;
+        run("{WHAT: [['.a']]}",
+            cache ? "1 property/row, cached" : "1 property/row, uncached");
+        run("{WHAT: [['.a'], ['.b'], ['.c'], ['.d']]}",
+            cache ? "4 properties/row, cached" : "4 properties/row, uncached");
+    }
+    QueryBodyCache::sEnabled = true;
+}
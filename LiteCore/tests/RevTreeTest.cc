@@ -17,6 +17,8 @@
 //
 
 #include "RevTree.hh"
+#include "VersionedDocument.hh"
+#include "Error.hh"
 
 #include "LiteCoreTest.hh"
 
@@ -50,3 +52,112 @@ TEST_CASE("RevID Parsing") {
     CHECK(!r.tryParse("1-aa "_sl));
     CHECK(!r.tryParse(" 1-aa"_sl));
 }
+
+
+TEST_CASE("RevTree Lazy Decoding") {
+    RevTree tree;
+    int httpStatus;
+    revidBuffer rev1("1-aa"_sl), rev2("2-bb"_sl), rev3("3-cc"_sl);
+    REQUIRE(tree.insert(rev1, alloc_slice("body 1"_sl), Rev::kNoFlags, revid(), false, false, httpStatus));
+    REQUIRE(tree.insert(rev2, alloc_slice("body 2"_sl), Rev::kNoFlags, rev1, false, false, httpStatus));
+    REQUIRE(tree.insert(rev3, alloc_slice("body 3"_sl), Rev::kDeleted, rev2, false, false, httpStatus));
+    tree.setLatestRevisionOnRemote(RevTree::kDefaultRemoteID, tree[rev2]);
+    alloc_slice encoded = tree.encode();
+
+    RevTree lazy;
+    lazy.decodeLazily(encoded, 17);
+    RevInfo info;
+    REQUIRE(lazy.currentRevisionInfo(info));
+    CHECK(info.revID == rev3);
+    CHECK(info.flags == Rev::Flags(Rev::kLeaf | Rev::kDeleted));
+    CHECK(info.sequence == 17);
+    CHECK(info.body == "body 3"_sl);
+    REQUIRE(lazy.revisionInfo(rev1, info));
+    CHECK(info.revID == rev1);
+    CHECK(info.body == "body 1"_sl);
+    CHECK(!lazy.revisionInfo(revidBuffer("4-dd"_sl), info));
+    REQUIRE(lazy.parentRevisionInfo(rev3, info));
+    CHECK(info.revID == rev2);
+    CHECK(!lazy.parentRevisionInfo(rev1, info));
+    REQUIRE(lazy.latestRevisionInfoOnRemote(RevTree::kDefaultRemoteID, info));
+    CHECK(info.revID == rev2);
+    CHECK(!lazy.latestRevisionInfoOnRemote(2, info));
+    CHECK(!lazy.isDecoded());
+
+    // Accessing Revs decodes the tree:
+    CHECK(lazy.size() == 3);
+    CHECK(lazy.isDecoded());
+    CHECK(lazy.currentRevision()->revID == rev3);
+    CHECK(lazy.latestRevisionOnRemote(RevTree::kDefaultRemoteID) == lazy[rev2]);
+    REQUIRE(lazy.parentRevisionInfo(rev3, info));
+    CHECK(info.revID == rev2);
+
+    // A corrupt tree is rejected right away, not when it's read:
+    RevTree bad;
+    ExpectException(error::LiteCore, error::CorruptRevisionData, [&]{
+        bad.decodeLazily(slice(encoded.buf, encoded.size - 6), 17);
+    });
+    alloc_slice badParent(slice{encoded});
+    ((uint8_t*)badParent.buf)[4] = 0x7F;       // parent index of the first rev
+    ExpectException(error::LiteCore, error::CorruptRevisionData, [&]{
+        bad.decodeLazily(badParent, 17);
+    });
+}
+
+
+TEST_CASE_METHOD(DataFileTestFixture, "VersionedDocument Lazy Decoding Synced", "[RevTree]") {
+    revidBuffer rev1("1-aa"_sl), rev2("2-bb"_sl);
+    {
+        VersionedDocument doc(*store, "doc"_sl);
+        int httpStatus;
+        REQUIRE(doc.insert(rev1, alloc_slice("body 1"_sl), Rev::kNoFlags, revid(), false, false, httpStatus));
+        REQUIRE(doc.insert(rev2, alloc_slice("body 2"_sl), Rev::kNoFlags, rev1, false, false, httpStatus));
+        Transaction t(store->dataFile());
+        REQUIRE(doc.save(t) == VersionedDocument::kNewSequence);
+        // Mark the current revision as pushed, as c4db_markSynced does:
+        REQUIRE(store->setDocumentFlag("doc"_sl, doc.sequence(), DocumentFlags::kSynced, t));
+        t.commit();
+    }
+
+    // Reading in place applies the kSynced flag, as didDecodeLazily would:
+    VersionedDocument doc(*store, "doc"_sl);
+    CHECK(!doc.isDecoded());
+    RevInfo info;
+    REQUIRE(doc.currentRevisionInfo(info));
+    CHECK(info.revID == rev2);
+    CHECK((info.flags & Rev::kKeepBody) != 0);
+    REQUIRE(doc.revisionInfo(rev1, info));
+    CHECK((info.flags & Rev::kKeepBody) == 0);
+    REQUIRE(doc.latestRevisionInfoOnRemote(RevTree::kDefaultRemoteID, info));
+    CHECK(info.revID == rev2);
+    CHECK(!doc.isDecoded());
+
+    // Decoding applies it to the Revs, without marking the doc as changed:
+    const Rev *cur = doc.currentRevision();
+    CHECK(doc.isDecoded());
+    CHECK(cur->revID == rev2);
+    CHECK(cur->keepBody());
+    CHECK(doc.latestRevisionOnRemote(RevTree::kDefaultRemoteID) == cur);
+    CHECK(!doc.changed());
+}
+
+
+TEST_CASE("RevTree Copy") {
+    // The copy's Revs and revIDs are allocated in its own arena, so it outlives the original:
+    auto tree = make_unique<RevTree>();
+    int httpStatus;
+    revidBuffer rev1("1-aa"_sl), rev2("2-bb"_sl);
+    REQUIRE(tree->insert(rev1, alloc_slice("body 1"_sl), Rev::kNoFlags, revid(), false, false, httpStatus));
+    REQUIRE(tree->insert(rev2, alloc_slice("body 2"_sl), Rev::kNoFlags, rev1, false, false, httpStatus));
+    tree->setLatestRevisionOnRemote(RevTree::kDefaultRemoteID, (*tree)[rev1]);
+
+    RevTree copy(*tree);
+    tree.reset();
+    REQUIRE(copy.size() == 2);
+    const Rev *cur = copy.currentRevision();
+    CHECK(cur->revID == rev2);
+    CHECK(cur->body() == "body 2"_sl);
+    CHECK(cur->parent == copy[rev1]);
+    CHECK(cur->parent->owner == &copy);
+    CHECK(copy.latestRevisionOnRemote(RevTree::kDefaultRemoteID) == copy[rev1]);
+}
@@ -123,6 +123,28 @@ N_WAY_TEST_CASE_METHOD(SQLiteFunctionsTest, "SQLite fl_contains", "[Query]") {
 }
 
 
+N_WAY_TEST_CASE_METHOD(SQLiteFunctionsTest, "SQLite fl_value multiple properties per row", "[Query]") {
+    // Each row's body is read by several fl_value calls, which share the connection's cached
+    // copy of the body. Bodies of the same size are likely to reuse SQLite's buffer between
+    // rows, so the cache mustn't go by address. Bodies over QueryBodyCache::kMaxBodySize
+    // aren't cached at all.
+    string big(300 * 1024, 'z');
+    insert("one",   "{\"a\": \"a1\", \"b\": \"b1\"}");
+    insert("two",   "{\"a\": \"a2\", \"b\": \"b2\"}");
+    insert("three", ("{\"a\": \"a3\", \"b\": \"b3\", \"big\": \"" + big + "\"}").c_str());
+    insert("four",  ("{\"a\": \"a4\", \"b\": \"b4\", \"big\": \"" + big + "\"}").c_str());
+    insert("five",  "{\"a\": \"a5\", \"b\": \"b5\"}");
+    insert("six",   "{\"a\": \"a1\", \"b\": \"b1\"}");
+
+    CHECK(query("SELECT fl_value(body, 'a') || '/' || fl_value(body, 'b') || '/' || "
+                "ifnull(length(fl_value(body, 'big')), 0) FROM kv")
+            == (vector<string>{"a1/b1/0", "a2/b2/0", "a3/b3/307200", "a4/b4/307200",
+                               "a5/b5/0", "a1/b1/0"}));
+    CHECK(query("SELECT key FROM kv WHERE fl_value(body, 'a') = 'a4' AND fl_value(body, 'b') = 'b4'")
+            == (vector<string>{"four"}));
+}
+
+
 N_WAY_TEST_CASE_METHOD(SQLiteFunctionsTest, "SQLite array_sum of fl_value", "[Query]") {
     insert("a",   "{\"hey\": [1, 2, 3, 4]}");
     insert("b",   "{\"hey\": [2, 4, 6, 8]}");
@@ -18,6 +18,7 @@
 
 #include "LiteCoreTest.hh"
 #include "SequenceTracker.hh"
+#include "StringUtil.hh"
 #include <sstream>
 
 using namespace std;
@@ -51,12 +52,10 @@ namespace litecore {
         string dump(bool verbose =false) { return tracker.dump(verbose); }
 #endif
 
-        SequenceTracker::const_iterator since(sequence_t s) {
-            return tracker._since(s);
-        }
-        
-        SequenceTracker::const_iterator end() {
-            return tracker.end();
+        // Returns the docID of the first change after sequence `s`, or nullslice if none.
+        slice since(sequence_t s) {
+            auto pos = tracker._since(s);
+            return pos < tracker._endPos ? tracker.entryAt(pos).docID : nullslice;
         }
 
     private:
@@ -85,11 +84,11 @@ TEST_CASE_METHOD(litecore::SequenceTrackerTest, "SequenceTracker", "[notificatio
     CHECK(tracker.lastSequence() == seq);
     REQUIRE_IF_DEBUG(dump(true) == "[(C@3#3333, B@5#5555, A@6#6666, D@7#7777)]");
 
-    REQUIRE(since(0)->docID == "C"_sl);
-    REQUIRE(since(4)->docID == "B"_sl);
-    REQUIRE(since(5)->docID == "A"_sl);
-    REQUIRE(since(6)->docID == "D"_sl);
-    REQUIRE(since(7) == end());
+    REQUIRE(since(0) == "C"_sl);
+    REQUIRE(since(4) == "B"_sl);
+    REQUIRE(since(5) == "A"_sl);
+    REQUIRE(since(6) == "D"_sl);
+    REQUIRE(since(7) == nullslice);
 }
 
 
@@ -422,3 +421,68 @@ TEST_CASE_METHOD(litecore::SequenceTrackerTest, "SequenceTracker Purge", "[notif
         CHECK(changes[1].sequence == 0);
     }
 }
+
+
+TEST_CASE_METHOD(litecore::SequenceTrackerTest, "SequenceTracker ChangeSpan", "[notification]") {
+    DatabaseChangeNotifier cn(tracker, nullptr);
+
+    tracker.beginTransaction();
+    tracker.documentChanged("A"_asl, "1-aa"_asl, ++seq, 1111);
+    tracker.documentChanged("B"_asl, "1-bb"_asl, ++seq, 2222);
+    tracker.documentChanged("C"_asl, "1-cc"_asl, ++seq, 3333);
+    tracker.documentChanged("A"_asl, "2-aa"_asl, ++seq, 4444);
+    tracker.endTransaction(true);
+
+    // The span skips A's superseded entry:
+    auto span = cn.changes(2);
+    REQUIRE(span.size() == 2);
+    CHECK(!span.external());
+    auto i = span.begin();
+    CHECK(i->docID == "B"_sl);
+    CHECK(i->revID == "1-bb"_sl);
+    CHECK(i->sequence == 2);
+    ++i;
+    CHECK(i->docID == "C"_sl);
+    CHECK(i->bodySize == 3333);
+    ++i;
+    CHECK(i == span.end());
+
+    span = cn.changes(10);
+    REQUIRE(span.size() == 1);
+    CHECK(span.begin()->docID == "A"_sl);
+    CHECK(span.begin()->sequence == 4);
+
+    CHECK(!cn.hasChanges());
+    CHECK(cn.changes(10).empty());
+}
+
+
+TEST_CASE_METHOD(litecore::SequenceTrackerTest, "SequenceTracker Ring Growth", "[notification]") {
+    // A notifier that doesn't read changes keeps the ring from being trimmed, so it has to grow
+    // (or be compacted) many times:
+    int count = 0;
+    DatabaseChangeNotifier cn(tracker, [&](DatabaseChangeNotifier&) {++count;});
+
+    const int kNumDocs = 100, kNumRounds = 20;
+    tracker.beginTransaction();
+    for (int round = 0; round < kNumRounds; ++round) {
+        for (int d = 0; d < kNumDocs; ++d) {
+            alloc_slice docID(format("doc-%03d", d));
+            alloc_slice revID(format("%d-%03d", round + 1, d));
+            tracker.documentChanged(docID, revID, ++seq, d);
+        }
+    }
+    tracker.endTransaction(true);
+    CHECK(count == 1);
+
+    // Only the latest change of each doc is left, in order:
+    SequenceTracker::Change changes[2 * kNumDocs];
+    bool external;
+    REQUIRE(cn.readChanges(changes, 2 * kNumDocs, external) == kNumDocs);
+    for (int d = 0; d < kNumDocs; ++d) {
+        CHECK(changes[d].docID == slice(format("doc-%03d", d)));
+        CHECK(changes[d].revID == slice(format("%d-%03d", kNumRounds, d)));
+        CHECK(changes[d].sequence == sequence_t((kNumRounds - 1) * kNumDocs + d + 1));
+    }
+    CHECK(!cn.hasChanges());
+}
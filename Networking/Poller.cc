@@ -33,6 +33,11 @@
 #include <poll.h>
 #endif
 
+#ifdef POLLER_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 #define WSLog (*(LogDomain*)kC4WebSocketLog)
 #define LOG(LEVEL, ...) LogToAt(WSLog, LEVEL, ##__VA_ARGS__)
 
@@ -55,7 +60,21 @@ namespace litecore { namespace net {
         // To allow poll() system calls to be interrupted, we create a pipe and have poll()
         // watch its read end. Then writing to the pipe will cause poll() to return. As a bonus,
         // we can use the data written to the pipe as a message, to let waitForIO know what happened.
-#ifndef _WIN32
+#if defined(POLLER_USE_EPOLL)
+        // With epoll, an eventfd does the waking instead of a pipe, and the messages are queued
+        // in _interruptMessages.
+        _epollFD = ::epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFD < 0)
+            throwSocketError();
+        _interruptReadFD = _interruptWriteFD = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (_interruptReadFD < 0)
+            throwSocketError();
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = _interruptReadFD;
+        if (::epoll_ctl(_epollFD, EPOLL_CTL_ADD, _interruptReadFD, &ev) < 0)
+            throwSocketError();
+#elif !defined(_WIN32)
         int fd[2];
         if (::pipe(fd) < 0)
             throwSocketError();
@@ -80,6 +99,12 @@ namespace litecore { namespace net {
 
 
     Poller::~Poller() {
+#ifdef POLLER_USE_EPOLL
+        if (_interruptReadFD >= 0)
+            ::close(_interruptReadFD);
+        if (_epollFD >= 0)
+            ::close(_epollFD);
+#else
         if (_interruptReadFD >= 0) {
 #ifndef _WIN32
             ::close(_interruptReadFD);
@@ -89,21 +114,71 @@ namespace litecore { namespace net {
             ::closesocket(_interruptWriteFD);
 #endif
         }
+#endif
+    }
+
+
+    // The shared Pollers are created (and started) on first use, and never destructed.
+    /*static*/ const vector<Poller*>& Poller::shared() {
+        static const vector<Poller*> sPollers = [] {
+            unsigned n = thread::hardware_concurrency();
+            if (n == 0 || n > kMaxThreads)
+                n = kMaxThreads;
+            LOG(Info, "Starting %u Poller threads", n);
+            vector<Poller*> pollers;
+            for (unsigned i = 0; i < n; ++i)
+                pollers.push_back(new Poller(true));
+            return pollers;
+        }();
+        return sPollers;
+    }
+
+
+    /*static*/ unsigned Poller::threadCount() {
+        return unsigned(shared().size());
+    }
+
+
+    /*static*/ Poller& Poller::forFD(int fd) {
+        // Since the OS reuses the lowest available fd numbers, a simple modulus spreads them
+        // evenly. It also ensures that a reused fd number goes to the same Poller as before,
+        // which will have noticed (and cleaned up after) the old fd being closed.
+        auto key = unsigned(fd);
+#ifdef _WIN32
+        // Winsock SOCKET handles are multiples of 4, which would skip most of the Pollers:
+        key >>= 2;
+#endif
+        auto &pollers = shared();
+        return *pollers[key % pollers.size()];
     }
 
 
     /*static*/ Poller& Poller::instance() {
-        static Poller* sInstance = new Poller(true);
-        return *sInstance;
+        return *shared()[0];
     }
 
 
     void Poller::addListener(int fd, Event event, Listener listener) {
         Assert(fd >= 0);
         lock_guard<mutex> lock(_mutex);
-        _listeners[fd][event] = listener;
+        auto &listeners = _listeners[fd];
+        listeners[event] = listener;
+#ifdef POLLER_USE_EPOLL
+        // epoll registrations take effect immediately, even during epoll_wait:
+        if (!epollControl(EPOLL_CTL_MOD, fd, listeners)) {
+            if (errno == ENOENT) {
+                // The fd isn't registered yet -- or was, but the kernel dropped it when it was
+                // closed, in which case any other Listener left over for it is stale.
+                listeners[(event == kReadable) ? kWriteable : kReadable] = nullptr;
+                if (epollControl(EPOLL_CTL_ADD, fd, listeners))
+                    return;
+            }
+            LOG(Warning, "Poller: couldn't register fd %d with epoll: errno %d", fd, errno);
+        }
+#else
         if (_waiting)
             interrupt(0);
+#endif
     }
 
 
@@ -112,6 +187,10 @@ namespace litecore { namespace net {
         lock_guard<mutex> lock(_mutex);
         if (auto i = _listeners.find(fd); i != _listeners.end())
             _listeners.erase(i);
+#ifdef POLLER_USE_EPOLL
+        // (Fails harmlessly if the fd was never registered, or has been closed.)
+        ::epoll_ctl(_epollFD, EPOLL_CTL_DEL, fd, nullptr);
+#endif
         // no need to interrupt the poll thread
     }
 
@@ -135,7 +214,14 @@ namespace litecore { namespace net {
 
 
     void Poller::interrupt(int message) {
-#ifdef WIN32
+#if defined(POLLER_USE_EPOLL)
+        {
+            lock_guard<mutex> lock(_mutex);
+            _interruptMessages.push_back(message);
+        }
+        uint64_t n = 1;
+        if (::write(_interruptWriteFD, &n, sizeof(n)) < 0 && errno != EAGAIN)
+#elif defined(WIN32)
         if(::send(_interruptWriteFD, (const char *)&message, sizeof(message), 0) < 0)
 #else
         if(::write(_interruptWriteFD, &message, sizeof(message)) < 0)
@@ -144,6 +230,21 @@ namespace litecore { namespace net {
     }
 
 
+    // Handles a message sent by interrupt(). Returns false if the loop should stop.
+    bool Poller::handleInterrupt(int message) {
+        LOG(Debug, "Poller: interruption %d", message);
+        if (message < 0) {
+            // Receiving a negative message aborts the loop
+            return false;
+        } else if (message > 0) {
+            // A positive message is a file descriptor to call:
+            callAndRemoveListener(message, kReadable);
+            callAndRemoveListener(message, kWriteable);
+        }
+        return true;
+    }
+
+
     Poller& Poller::start() {
         _thread = thread([=] {
             SetThreadName("CBL Networking");
@@ -217,15 +318,7 @@ namespace litecore { namespace net {
         if(FD_ISSET(_interruptReadFD, &fds_read)) {
             int message;
             ::recv(_interruptReadFD, (char *)&message, sizeof(message), 0);
-            LOG(Debug, "Poller: interruption %d", message);
-            if (message < 0) {
-                // Receiving a negative message aborts the loop
-                result = false;
-            } else if (message > 0) {
-                // A positive message is a file descriptor to call:
-                callAndRemoveListener(message, kReadable);
-                callAndRemoveListener(message, kWriteable);
-            }
+            result = handleInterrupt(message);
         }
 
         for (SOCKET s : all_fds) {
@@ -245,6 +338,72 @@ namespace litecore { namespace net {
         return result;
     }
 
+#elif defined(POLLER_USE_EPOLL)
+
+    // Registers `fd` with epoll (`op` is EPOLL_CTL_ADD or _MOD) for the events it has Listeners
+    // for. Registrations are one-shot, so after an event the fd is disabled until re-armed with
+    // EPOLL_CTL_MOD; this matches the Listener semantics, and keeps an fd that nobody's
+    // listening to from waking up the thread.
+    bool Poller::epollControl(int op, int fd, const array<Listener,2> &listeners) {
+        epoll_event ev = {};
+        ev.events = EPOLLONESHOT;
+        if (listeners[kReadable])
+            ev.events |= EPOLLIN;
+        if (listeners[kWriteable])
+            ev.events |= EPOLLOUT;
+        ev.data.fd = fd;
+        return ::epoll_ctl(_epollFD, op, fd, &ev) == 0;
+    }
+
+
+    // After dispatching events for `fd`, re-arms it for whatever Listeners remain.
+    void Poller::rearm(int fd) {
+        lock_guard<mutex> lock(_mutex);
+        auto i = _listeners.find(fd);
+        if (i != _listeners.end() && (i->second[kReadable] || i->second[kWriteable]))
+            epollControl(EPOLL_CTL_MOD, fd, i->second);
+    }
+
+
+    bool Poller::poll() {
+        static constexpr int kMaxEvents = 64;
+        epoll_event events[kMaxEvents];
+        _waiting = true;
+        int n;
+        while ((n = ::epoll_wait(_epollFD, events, kMaxEvents, -1)) < 0) {
+            if (errno != EINTR)
+                return false;
+        }
+        _waiting = false;
+
+        // Dispatch the events:
+        bool result = true;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t revents = events[i].events;
+            if (fd == _interruptReadFD) {
+                // Reset the eventfd, then handle all the queued messages:
+                uint64_t count;
+                (void)::read(_interruptReadFD, &count, sizeof(count));
+                vector<int> messages;
+                {
+                    lock_guard<mutex> lock(_mutex);
+                    messages.swap(_interruptMessages);
+                }
+                for (int message : messages)
+                    result = handleInterrupt(message) && result;
+            } else {
+                LOG(Debug, "Poller: fd %d got event 0x%02x", fd, revents);
+                if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                    callAndRemoveListener(fd, kReadable);
+                if (revents & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    callAndRemoveListener(fd, kWriteable);
+                rearm(fd);
+            }
+        }
+        return result;
+    }
+
 #else
 
     bool Poller::poll() {
@@ -282,15 +441,7 @@ namespace litecore { namespace net {
                     // This is an interrupt -- read the byte from the pipe:
                     int message;
                     ::read(_interruptReadFD, &message, sizeof(message));
-                    LOG(Debug, "Poller: interruption %d", message);
-                    if (message < 0) {
-                        // Receiving a negative message aborts the loop
-                        result = false;
-                    } else if (message > 0) {
-                        // A positive message is a file descriptor to call:
-                        callAndRemoveListener(message, kReadable);
-                        callAndRemoveListener(message, kWriteable);
-                    }
+                    result = handleInterrupt(message) && result;
                 } else {
                     LOG(Debug, "Poller: fd %d got event 0x%02x", fd, entry.revents);
                     if (entry.revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
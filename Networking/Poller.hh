@@ -11,21 +11,41 @@
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 #include "sockpp/platform.h"
 #include "sockpp/socket.h"
 
+#if defined(__linux__)
+// On Linux, use epoll instead of rebuilding a pollfd array on every call to poll()
+#define POLLER_USE_EPOLL 1
+#endif
+
 namespace litecore { namespace net {
 	// This needs to stay here because of the platform variations of
 	// socket_t and INVALID_SOCKET (Windows has them globally and
 	// Unix has them in this namespace)
 	using namespace sockpp; 
 	
-    /** Enables async I/O by running `poll` on a background thread. */
+    /** Enables async I/O by running `poll` (or `epoll` on Linux) on a background thread.
+        In normal use there is a fixed set of shared Pollers, each with its own thread, and every
+        file descriptor is assigned to one of them by `forFD`, so that I/O on different
+        connections is spread across cores. */
     class Poller {
     public:
-        /// The single shared instance (all that's necessary in normal use)
+        /// The shared Poller that handles the given file descriptor. The mapping is stable:
+        /// the same fd always goes to the same Poller, so all of its Listeners are called on
+        /// the same thread, in order.
+        static Poller& forFD(int fd);
+
+        /// The first shared Poller. (Equivalent to `forFD(0)`.)
         static Poller& instance();
 
+        /// The number of shared Pollers (and threads), which is fixed: one per CPU core, up to
+        /// `kMaxThreads`.
+        static unsigned threadCount();
+
+        static constexpr unsigned kMaxThreads = 4;
+
         enum Event {
             kReadable, kWriteable
         };
@@ -33,7 +53,7 @@ namespace litecore { namespace net {
         using Listener = std::function<void()>;
 
         /// The next time the Event is possible on the file descriptor, call the Listener.
-        /// The Listener is called on a shared background thread and should return ASAP.
+        /// The Listener is called on this Poller's background thread and should return ASAP.
         /// It will not be called again -- if you need another notification, call `addListener`
         /// again (it's fine to call it from inside the callback.)
         void addListener(int fd, Event, Listener);
@@ -52,14 +72,25 @@ namespace litecore { namespace net {
 
     private:
         Poller(bool startNow)               :Poller() {if (startNow) start();}
+        static const std::vector<Poller*>& shared();
         bool poll();
         void callAndRemoveListener(int fd, Event);
+        bool handleInterrupt(int message);
+#ifdef POLLER_USE_EPOLL
+        bool epollControl(int op, int fd, const std::array<Listener,2>&);
+        void rearm(int fd);
+#endif
         
         std::mutex _mutex;
         std::unordered_map<socket_t, std::array<Listener,2>> _listeners;
         std::thread _thread;
         std::atomic_bool _waiting {false};
 
+#ifdef POLLER_USE_EPOLL
+        int _epollFD {-1};                          // epoll instance; fds are added one-shot
+        std::vector<int> _interruptMessages;        // Messages queued by interrupt()
+        // (_interruptReadFD and _interruptWriteFD are the same eventfd)
+#endif
         socket_t _interruptReadFD  {INVALID_SOCKET}; // Pipe used to interrupt poll()
         socket_t _interruptWriteFD {INVALID_SOCKET}; // Other end of the pipe
     };
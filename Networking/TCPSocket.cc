@@ -448,12 +448,12 @@ namespace litecore { namespace net {
 
 
     void TCPSocket::onReadable(function<void()> listener) {
-        Poller::instance().addListener(fileDescriptor(), Poller::kReadable, listener);
+        Poller::forFD(fileDescriptor()).addListener(fileDescriptor(), Poller::kReadable, listener);
     }
 
 
     void TCPSocket::onWriteable(function<void()> listener) {
-        Poller::instance().addListener(fileDescriptor(), Poller::kWriteable, listener);
+        Poller::forFD(fileDescriptor()).addListener(fileDescriptor(), Poller::kWriteable, listener);
     }
 
 
@@ -461,7 +461,7 @@ namespace litecore { namespace net {
         if(fileDescriptor() >= 0) {
             // If an interrupt is called with an invalid socket, the poller's
             // loop will exit, so don't do that
-            Poller::instance().interrupt(fileDescriptor());
+            Poller::forFD(fileDescriptor()).interrupt(fileDescriptor());
         }
     }
 
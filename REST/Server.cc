@@ -152,7 +152,7 @@ namespace litecore { namespace REST {
             return;
 
         c4log(ListenerLog, kC4LogInfo,"Stopping server");
-        Poller::instance().removeListeners(_acceptor->handle());
+        Poller::forFD(_acceptor->handle()).removeListeners(_acceptor->handle());
         _acceptor->close();
         _acceptor.reset();
         _rules.clear();
@@ -164,7 +164,7 @@ namespace litecore { namespace REST {
         if (!_acceptor)
             return;
         
-        Poller::instance().addListener(_acceptor->handle(), Poller::kReadable, [=] {
+        Poller::forFD(_acceptor->handle()).addListener(_acceptor->handle(), Poller::kReadable, [=] {
             Retained<Server> selfRetain = this;
             acceptConnection();
         });
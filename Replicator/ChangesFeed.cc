@@ -112,28 +112,31 @@ namespace litecore { namespace repl {
     void ChangesFeed::getHistoricalChanges(Changes &changes, unsigned limit) {
         logVerbose("Reading up to %u local changes since #%" PRIu64, limit, _maxSequence);
 
-        // Run a by-sequence enumerator to find the changed docs:
-        C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
-        if (!_getForeignAncestors && !_options.pushFilter)
-            options.flags &= ~kC4IncludeBodies;
-        if (!_skipDeleted)
-            options.flags |= kC4IncludeDeleted;
+        if (!_options.pushFilter) {
+            // Without a push filter the documents don't need to be loaded:
+            scanHistoricalChanges(changes, limit);
+        } else {
+            // Run a by-sequence enumerator to find the changed docs:
+            C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
+            if (!_skipDeleted)
+                options.flags |= kC4IncludeDeleted;
 
-        _db.use([&](C4Database* db) {
-            c4::ref<C4DocEnumerator> e = c4db_enumerateChanges(db, _maxSequence, &options, &changes.err);
-            if (e) {
-                changes.revs.reserve(limit);
-                while (c4enum_next(e, &changes.err) && limit > 0) {
-                    C4DocumentInfo info;
-                    c4enum_getDocumentInfo(e, &info);
-                    auto rev = makeRevToSend(info, e, db);
-                    if (rev) {
-                        changes.revs.push_back(rev);
-                        --limit;
+            _db.use([&](C4Database* db) {
+                c4::ref<C4DocEnumerator> e = c4db_enumerateChanges(db, _maxSequence, &options, &changes.err);
+                if (e) {
+                    changes.revs.reserve(limit);
+                    while (c4enum_next(e, &changes.err) && limit > 0) {
+                        C4DocumentInfo info;
+                        c4enum_getDocumentInfo(e, &info);
+                        auto rev = makeRevToSend(info, e, db);
+                        if (rev) {
+                            changes.revs.push_back(rev);
+                            --limit;
+                        }
                     }
                 }
-            }
-        });
+            });
+        }
 
         if (limit > 0 && !_caughtUp) {
             // Couldn't get as many changes as asked for, so I've caught up with the DB.
@@ -143,6 +146,44 @@ namespace litecore { namespace repl {
     }
 
 
+    // Reads the changed docs' metadata in batches with c4db_getChanges, which also finds their
+    // remote ancestors, instead of instantiating each document. Decrements `limit` for every
+    // rev added to `changes`.
+    void ChangesFeed::scanHistoricalChanges(Changes &changes, unsigned &limit) {
+        static constexpr uint32_t kMaxBatchSize = 200;
+        C4ChangeInfo batch[kMaxBatchSize];
+        C4EnumeratorFlags flags = _skipDeleted ? 0 : kC4IncludeDeleted;
+        C4RemoteID remote = (_getForeignAncestors && _isCheckpointValid) ? remoteDBID() : 0;
+
+        _db.use([&](C4Database* db) {
+            changes.revs.reserve(limit);
+            while (limit > 0) {
+                auto batchSize = min(limit, kMaxBatchSize);
+                int64_t n = c4db_getChanges(db, _maxSequence, flags, remote,
+                                            batch, batchSize, &changes.err);
+                if (n <= 0)
+                    break;
+                int64_t i;
+                for (i = 0; i < n && limit > 0; ++i) {
+                    C4ChangeInfo &change = batch[i];
+                    C4DocumentInfo info {change.flags, change.docID, change.revID,
+                                         change.sequence, change.bodySize, change.expiration};
+                    slice remoteAncestorRevID = change.remoteAncestorRevID;
+                    auto rev = makeRevToSend(info, nullptr, db,
+                                             (remote ? &remoteAncestorRevID : nullptr));
+                    if (rev) {
+                        changes.revs.push_back(rev);
+                        --limit;
+                    }
+                }
+                c4db_releaseChangeInfo(batch, uint32_t(n));
+                if (i < n || n < batchSize)
+                    break;      // Reached the limit, or the end of the changes
+            }
+        });
+    }
+
+
     void ChangesFeed::getObservedChanges(Changes &changes, unsigned limit) {
         logVerbose("Asking DB observer for %u new changes since sequence #%" PRIu64 " ...",
                    limit, _maxSequence);
@@ -224,7 +265,10 @@ namespace litecore { namespace repl {
     // Common subroutine of _getChanges and dbChanged that adds a document to a list of Revs.
     // It does some quick tests, and if those pass creates a RevToSend and passes it on to the
     // other shouldPushRev, which does more expensive checks.
-    Retained<RevToSend> ChangesFeed::makeRevToSend(C4DocumentInfo &info, C4DocEnumerator *e, C4Database *db)
+    // If `remoteAncestorRevID` is non-null, it's the remote ancestor of the doc's current revision,
+    // already found by c4db_getChanges, and there's no push filter; then the doc isn't loaded.
+    Retained<RevToSend> ChangesFeed::makeRevToSend(C4DocumentInfo &info, C4DocEnumerator *e, C4Database *db,
+                                                   const slice *remoteAncestorRevID)
     {
         _maxSequence = info.sequence;
         if (info.expiration > 0 && info.expiration < c4_now()) {
@@ -237,6 +281,8 @@ namespace litecore { namespace repl {
             return nullptr;             // skip rev: not in list of docIDs
         } else {
             auto rev = retained(new RevToSend(info));
+            if (remoteAncestorRevID)
+                return checkRemoteRevID(rev, *remoteAncestorRevID) ? rev : nullptr;
             return shouldPushRev(rev, e, db) ? rev : nullptr;
         }
     }
@@ -288,6 +334,12 @@ namespace litecore { namespace repl {
     }
 
 
+    // Overridden by ReplicatorChangesFeed
+    bool ChangesFeed::checkRemoteRevID(RevToSend *rev, slice foreignAncestor) const {
+        return true;
+    }
+
+
 #pragma mark - REPLICATOR CHANGES FEED:
 
 
@@ -296,6 +348,11 @@ namespace litecore { namespace repl {
     { }
 
 
+    C4RemoteID ReplicatorChangesFeed::remoteDBID() const {
+        return ((DBAccess&)_db).remoteDBID();
+    }
+
+
     // Assigns rev->remoteAncestorRevID based on the document.
     // Returns false to reject the document if the remote is equal to or newer than this rev.
     bool ReplicatorChangesFeed::getRemoteRevID(RevToSend *rev, C4Document *doc) const {
@@ -304,10 +361,17 @@ namespace litecore { namespace repl {
         Assert(dbAccess.remoteDBID());
         alloc_slice foreignAncestor = dbAccess.getDocRemoteAncestor(doc);
         logDebug("remoteRevID of '%.*s' is %.*s", SPLAT(doc->docID), SPLAT(foreignAncestor));
-        if (foreignAncestor == slice(doc->revID))
+        return checkRemoteRevID(rev, foreignAncestor);
+    }
+
+
+    // Assigns rev->remoteAncestorRevID, given the foreign ancestor of its (current) revision.
+    // Returns false to reject the document if the remote is equal to or newer than this rev.
+    bool ReplicatorChangesFeed::checkRemoteRevID(RevToSend *rev, slice foreignAncestor) const {
+        if (foreignAncestor == rev->revID)
             return false;   // skip this rev: it's already on the peer
         if (foreignAncestor
-                    && c4rev_getGeneration(foreignAncestor) >= c4rev_getGeneration(doc->revID)) {
+                    && c4rev_getGeneration(foreignAncestor) >= c4rev_getGeneration(rev->revID)) {
             if (_options.pull <= kC4Passive) {
                 C4Error error = c4error_make(WebSocketDomain, 409,
                                      "conflicts with newer server revision"_sl);
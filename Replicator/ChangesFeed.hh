@@ -72,12 +72,16 @@ namespace litecore::repl {
     protected:
         std::string loggingClassName() const override;
         virtual bool getRemoteRevID(RevToSend *rev NONNULL, C4Document *doc NONNULL) const;
+        virtual bool checkRemoteRevID(RevToSend *rev NONNULL, slice foreignAncestor) const;
+        virtual C4RemoteID remoteDBID() const       {return 0;}
 
     private:
         void getHistoricalChanges(Changes&, unsigned limit);
+        void scanHistoricalChanges(Changes&, unsigned &limit);
         void getObservedChanges(Changes&, unsigned limit);
         void _dbChanged();
-        Retained<RevToSend> makeRevToSend(C4DocumentInfo&, C4DocEnumerator*, C4Database* NONNULL);
+        Retained<RevToSend> makeRevToSend(C4DocumentInfo&, C4DocEnumerator*, C4Database* NONNULL,
+                                          const slice *remoteAncestorRevID =nullptr);
         bool shouldPushRev(RevToSend*, C4DocEnumerator*, C4Database* NONNULL) const;
 
     protected:
@@ -110,5 +114,7 @@ namespace litecore::repl {
 
     protected:
         bool getRemoteRevID(RevToSend *rev NONNULL, C4Document *doc NONNULL) const override;
+        bool checkRemoteRevID(RevToSend *rev NONNULL, slice foreignAncestor) const override;
+        C4RemoteID remoteDBID() const override;
     };
 }
@@ -54,6 +54,8 @@ function(set_litecore_source_base)
         LiteCore/Query/SQLiteFleeceFunctions.cc
         LiteCore/Query/SQLiteFleeceUtil.cc
         LiteCore/Query/SQLiteFTSRankFunction.cc
+        LiteCore/Query/SQLiteIndexAdvisor.cc
+        LiteCore/Query/SQLiteKeyStore+AggregateIndexes.cc
         LiteCore/Query/SQLiteKeyStore+ArrayIndexes.cc
         LiteCore/Query/SQLiteKeyStore+FTSIndexes.cc
         LiteCore/Query/SQLiteKeyStore+Indexes.cc
@@ -61,6 +63,7 @@ function(set_litecore_source_base)
         LiteCore/Query/SQLiteN1QLFunctions.cc
         LiteCore/Query/SQLitePredictionFunction.cc
         LiteCore/Query/SQLiteQuery.cc
+        LiteCore/Query/SQLiteQueryCache.cc
         LiteCore/Query/N1QL_Parser/n1ql.cc
         LiteCore/RevTrees/RawRevTree.cc
         LiteCore/RevTrees/RevID.cc
@@ -111,6 +114,7 @@ function(set_litecore_source_base)
         LiteCore/Support/PlatformIO.cc
         LiteCore/Support/StringUtil.cc
         LiteCore/Support/ChannelManifest.cc
+        LiteCore/Support/Arena.cc
         PARENT_SCOPE
     )
 endfunction()